@@ -0,0 +1,126 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// Event loops: post-to-dispatch latency through a real loop.
+
+#include "benchmark/benchmark.h"
+#include "BenchUtils.h"
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+#include "event_loop/ThreadEventLoop.h"
+#include <atomic>
+#else
+#include "event_loop/BareMetalEventLoop.h"
+#endif
+
+
+namespace {
+
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+
+struct Echo
+{
+    void on_ping(const uint32_t& value) { m_pong.store(value, std::memory_order_release); }
+    std::atomic<uint32_t> m_pong{};
+};
+
+
+// Round trip from emit() in this thread to the slot running in the loop's thread. This 
+// includes the wake up of the loop thread, which dominates.
+void BM_ThreadEventLoopRoundTrip(benchmark::State& state)
+{
+    eg::ThreadEventLoop loop{"bench"};
+    Echo echo;
+    eg::Signal<uint32_t> ping;
+    ping.connect<&Echo::on_ping>(&echo, loop);
+
+    uint32_t value = 0;
+    for (auto _: state)
+    {
+        ping.emit(++value);
+        while (echo.m_pong.load(std::memory_order_acquire) != value) {}
+    }
+
+    eg::EventLoopStats stats;
+    loop.get_stats(stats);
+    state.counters["p50_us"] = stats.get_latency_percentile(50);
+    state.counters["p99_us"] = stats.get_latency_percentile(99);
+    loop.stop();
+}
+BENCHMARK(BM_ThreadEventLoopRoundTrip)->UseRealTime();
+
+
+// Throughput when the loop is kept busy: a burst of events, then wait for the last.
+void BM_ThreadEventLoopBurst(benchmark::State& state)
+{
+    eg::ThreadEventLoop loop{"bench"};
+    Echo echo;
+    eg::Signal<uint32_t> ping;
+    ping.connect<&Echo::on_ping>(&echo, loop);
+
+    const auto burst = static_cast<uint32_t>(state.range(0));
+    uint32_t value = 0;
+    for (auto _: state)
+    {
+        for (uint32_t i = 0; i < burst; ++i) ping.emit(++value);
+        while (echo.m_pong.load(std::memory_order_acquire) != value) {}
+    }
+    state.SetItemsProcessed(state.iterations() * burst);
+    loop.stop();
+}
+BENCHMARK(BM_ThreadEventLoopBurst)->Arg(32)->UseRealTime();
+
+#else
+
+struct Counter
+{
+    void on_event(const uint32_t& value) { m_total += value; }
+    uint32_t m_total{};
+};
+
+
+void BM_BareMetalEventLoopPostDispatch(benchmark::State& state)
+{
+    eg::BareMetalEventLoop<32> loop;
+    eg::bench::set_current_loop(&loop);
+    Counter counter;
+    eg::Signal<uint32_t> signal;
+    signal.connect<&Counter::on_event>(&counter, loop);
+
+    for (auto _: state)
+    {
+        signal.emit(1);
+        loop.run_once();
+    }
+    benchmark::DoNotOptimize(counter.m_total);
+    eg::bench::set_current_loop(nullptr);
+}
+BENCHMARK(BM_BareMetalEventLoopPostDispatch);
+
+
+void BM_BareMetalEventLoopEmitFromIsr(benchmark::State& state)
+{
+    eg::BareMetalEventLoop<32> loop;
+    eg::bench::set_current_loop(&loop);
+    Counter counter;
+    eg::Signal<uint32_t> signal;
+    signal.connect<&Counter::on_event>(&counter, loop);
+
+    for (auto _: state)
+    {
+        signal.emit_from_isr(1);
+        loop.run_once();
+    }
+    benchmark::DoNotOptimize(counter.m_total);
+    eg::bench::set_current_loop(nullptr);
+}
+BENCHMARK(BM_BareMetalEventLoopEmitFromIsr);
+
+#endif
+
+} // namespace {
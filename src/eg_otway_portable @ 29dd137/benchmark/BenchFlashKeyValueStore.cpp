@@ -0,0 +1,116 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// FlashKeyValueStore updates against MockFlashMemory. The interesting results are the counters
+// rather than the times: how many bytes are programmed for each byte of value written (including 
+// headers, padding and garbage collection), how often pages are erased, and how evenly.
+
+#include "benchmark/benchmark.h"
+#include "drivers/FlashKeyValueStore.h"
+#include "mock/MockFlashMemory.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+
+namespace {
+
+constexpr uint32_t kPageSize  = 2048;
+constexpr uint32_t kWriteSize = 8;
+constexpr uint32_t kNumPages  = 16;
+using Flash = eg::MockFlashMemory<0x0800'0000, kPageSize, kNumPages, kWriteSize>;
+using Store = eg::FlashKeyValueStore<kWriteSize, 256>;
+
+
+// Random updates to the given number of keys, with values of the given size. A quarter of the 
+// keys are written once and never change, as is typical of configuration.
+void BM_FlashKeyValueStoreUpdate(benchmark::State& state)
+{
+    const auto keys = static_cast<uint16_t>(state.range(0));
+    const auto size = static_cast<uint16_t>(state.range(1));
+    auto flash = std::make_unique<Flash>();
+    Store store{*flash};
+
+    std::vector<uint8_t> value(size);
+    for (uint16_t key = 0; key < keys; ++key)
+        store.write(key, value.data(), size);
+    flash->reset_counts();
+    const uint64_t flash_bytes = store.get_flash_bytes_written();
+    const uint64_t value_bytes = store.get_value_bytes_written();
+
+    uint32_t random = 12345;
+    for (auto _: state)
+    {
+        random = random * 1664525U + 1013904223U;
+        const auto key = static_cast<uint16_t>(keys / 4 + (random >> 8) % (keys - keys / 4));
+        value[0] = static_cast<uint8_t>(random);
+        ++value[size - 1];
+        benchmark::DoNotOptimize(store.write(key, value.data(), size));
+    }
+
+    uint32_t least = UINT32_MAX;
+    uint32_t most  = 0;
+    for (uint32_t page = 0; page < kNumPages; ++page)
+    {
+        least = std::min(least, flash->get_page_erase_count(page));
+        most  = std::max(most, flash->get_page_erase_count(page));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["write_amplification"] = static_cast<double>(store.get_flash_bytes_written() - flash_bytes) / 
+                                            static_cast<double>(store.get_value_bytes_written() - value_bytes);
+    state.counters["erases_per_1k_writes"] = 1000.0 * flash->get_erase_count() / state.iterations();
+    state.counters["wear_spread"] = most - least;
+}
+BENCHMARK(BM_FlashKeyValueStoreUpdate)->Args({16, 8})->Args({16, 64})->Args({128, 8})->Args({128, 64});
+
+
+// Open an existing store, which scans every page to rebuild the index.
+void BM_FlashKeyValueStoreInitialise(benchmark::State& state)
+{
+    auto flash = std::make_unique<Flash>();
+    {
+        Store store{*flash};
+        std::vector<uint8_t> value(16);
+        for (uint32_t i = 0; i < 5000; ++i)
+        {
+            ++value[i % 16];
+            store.write(static_cast<uint16_t>(i % 128), value.data(), static_cast<uint16_t>(value.size()));
+        }
+    }
+
+    for (auto _: state)
+    {
+        Store store{*flash};
+        benchmark::DoNotOptimize(store.get_key_count());
+    }
+}
+BENCHMARK(BM_FlashKeyValueStoreInitialise);
+
+
+// Lookup is through the RAM index, and then a read of the value. 
+void BM_FlashKeyValueStoreRead(benchmark::State& state)
+{
+    auto flash = std::make_unique<Flash>();
+    Store store{*flash};
+    std::vector<uint8_t> value(16);
+    for (uint16_t key = 0; key < 128; ++key)
+        store.write(key, value.data(), static_cast<uint16_t>(value.size()));
+
+    uint16_t key  = 0;
+    uint16_t size = 0;
+    for (auto _: state)
+    {
+        key = (key + 37) % 128;
+        benchmark::DoNotOptimize(store.read(key, value.data(), static_cast<uint16_t>(value.size()), size));
+    }
+}
+BENCHMARK(BM_FlashKeyValueStoreRead);
+
+} // namespace {
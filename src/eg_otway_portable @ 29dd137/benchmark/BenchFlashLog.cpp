@@ -0,0 +1,229 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// FlashLog operations against the in-RAM MockFlashMemory. These mostly measure the log's own
+// bookkeeping, as the mock flash is as fast as RAM. The append throughput benchmarks at the end
+// also add up the time the operations would take on real flash.
+
+#include "benchmark/benchmark.h"
+#include "drivers/FlashLog.h"
+#include "drivers/BufferedFlashLog.h"
+#include "mock/MockFlashMemory.h"
+#include <array>
+#include <memory>
+
+
+namespace {
+
+struct Record
+{
+    uint32_t timestamp;
+    uint32_t values[3];
+};
+
+constexpr uint32_t kPageSize  = 2048;
+constexpr uint32_t kWriteSize = 4;
+constexpr uint32_t kNumPages  = 128;
+using Flash = eg::MockFlashMemory<0x0800'0000, kPageSize, kNumPages, kWriteSize>;
+using Log   = eg::FlashLog<Record, kWriteSize>;
+
+
+// Fill the given fraction of the flash, in percent.
+void fill(Log& log, int64_t percent)
+{
+    const uint32_t records = static_cast<uint32_t>((log.get_records_per_page() * kNumPages * percent) / 100);
+    Record record{};
+    for (uint32_t i = 0; i < records; ++i)
+    {
+        record.timestamp = i;
+        log.append_record(record);
+    }
+}
+
+
+void BM_FlashLogAppend(benchmark::State& state)
+{
+    auto flash = std::make_unique<Flash>();
+    Log log{*flash};
+    fill(log, state.range(0));
+
+    Record record{};
+    for (auto _: state)
+    {
+        ++record.timestamp;
+        log.append_record(record);
+    }
+}
+BENCHMARK(BM_FlashLogAppend)->Arg(10)->Arg(90);
+
+
+void BM_FlashLogRecordCount(benchmark::State& state)
+{
+    auto flash = std::make_unique<Flash>();
+    Log log{*flash};
+    fill(log, state.range(0));
+
+    for (auto _: state)
+    {
+        benchmark::DoNotOptimize(log.get_record_count());
+    }
+}
+BENCHMARK(BM_FlashLogRecordCount)->Arg(10)->Arg(90);
+
+
+void BM_FlashLogReadByIndex(benchmark::State& state)
+{
+    auto flash = std::make_unique<Flash>();
+    Log log{*flash};
+    fill(log, state.range(0));
+
+    const uint32_t count = log.get_record_count();
+    uint32_t index = 0;
+    Record record{};
+    flash->reset_counts();
+    for (auto _: state)
+    {
+        index = (index + 97) % count;
+        log.read_record_by_index(index, record);
+        benchmark::DoNotOptimize(record);
+    }
+    // Flash reads per record read. This was one per page header plus one before the log 
+    // cached its oldest page.
+    state.counters["flash_reads"] = benchmark::Counter(flash->get_read_count(), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_FlashLogReadByIndex)->Arg(10)->Arg(90);
+
+
+// Read the whole log, record by record, as for an upload.
+void BM_FlashLogReadAllByIndex(benchmark::State& state)
+{
+    auto flash = std::make_unique<Flash>();
+    Log log{*flash};
+    fill(log, state.range(0));
+
+    Record record{};
+    for (auto _: state)
+    {
+        const uint32_t count = log.get_record_count();
+        for (uint32_t index = 0; index < count; ++index)
+        {
+            log.read_record_by_index(index, record);
+            benchmark::DoNotOptimize(record);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * log.get_record_count());
+}
+BENCHMARK(BM_FlashLogReadAllByIndex)->Arg(10)->Arg(90);
+
+
+void BM_FlashLogIterate(benchmark::State& state)
+{
+    auto flash = std::make_unique<Flash>();
+    Log log{*flash};
+    fill(log, state.range(0));
+
+    for (auto _: state)
+    {
+        for (const Record& record: log.records())
+            benchmark::DoNotOptimize(record);
+    }
+    state.SetItemsProcessed(state.iterations() * log.get_record_count());
+}
+BENCHMARK(BM_FlashLogIterate)->Arg(10)->Arg(90);
+
+
+void BM_FlashLogReadInBulk(benchmark::State& state)
+{
+    auto flash = std::make_unique<Flash>();
+    Log log{*flash};
+    fill(log, state.range(0));
+
+    std::array<Record, 64> buffer{};
+    for (auto _: state)
+    {
+        uint32_t index = 0;
+        while (uint32_t copied = log.read_records(index, buffer.data(), buffer.size()))
+        {
+            benchmark::DoNotOptimize(buffer);
+            index += copied;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * log.get_record_count());
+}
+BENCHMARK(BM_FlashLogReadInBulk)->Arg(10)->Arg(90);
+
+
+// Open an existing log, as at power up.
+void BM_FlashLogInitialise(benchmark::State& state)
+{
+    auto flash = std::make_unique<Flash>();
+    {
+        Log log{*flash};
+        fill(log, state.range(0));
+    }
+
+    for (auto _: state)
+    {
+        Log log{*flash};
+        benchmark::DoNotOptimize(log);
+    }
+}
+BENCHMARK(BM_FlashLogInitialise)->Arg(10)->Arg(90);
+
+
+// The mock flash with STM32G4-like operation times added up.
+using TimedFlash = eg::TimedFlashMemory<Flash>;
+
+
+// Records per second of simulated flash time, which is what limits the logging rate on a device.
+void report_throughput(benchmark::State& state, const TimedFlash& flash)
+{
+    state.SetItemsProcessed(state.iterations());
+    state.counters["records_per_flash_second"] = state.iterations() / (flash.get_elapsed_ns() * 1e-9);
+}
+
+
+void BM_FlashLogAppendTimed(benchmark::State& state)
+{
+    auto flash = std::make_unique<TimedFlash>();
+    Log log{*flash};
+
+    Record record{};
+    for (auto _: state)
+    {
+        ++record.timestamp;
+        log.append_record(record);
+    }
+    report_throughput(state, *flash);
+}
+BENCHMARK(BM_FlashLogAppendTimed);
+
+
+// The template argument is the size of the staging buffer in records.
+template <uint32_t kBufferRecords>
+void BM_BufferedFlashLogAppendTimed(benchmark::State& state)
+{
+    using BufferedLog = eg::BufferedFlashLog<Record, kWriteSize, kBufferRecords>;
+    auto flash = std::make_unique<TimedFlash>();
+    auto log   = std::make_unique<BufferedLog>(*flash);
+
+    Record record{};
+    for (auto _: state)
+    {
+        ++record.timestamp;
+        log->append_record(record);
+    }
+    log->flush();
+    report_throughput(state, *flash);
+}
+BENCHMARK(BM_BufferedFlashLogAppendTimed<8>);
+BENCHMARK(BM_BufferedFlashLogAppendTimed<32>);
+BENCHMARK(BM_BufferedFlashLogAppendTimed<128>);
+
+} // namespace {
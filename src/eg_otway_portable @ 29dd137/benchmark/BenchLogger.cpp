@@ -0,0 +1,70 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// Logger formatting. The backend discards the output, so this is the cost of the formatting
+// and the locking. Logging is compiled out for the benchmarks (see CMakeLists.txt) except for 
+// the Assert level, which is always formatted, so that level is used here.
+
+#include "benchmark/benchmark.h"
+#include "logging/Logger.h"
+#include "logging/NullLoggerBackend.h"
+
+
+namespace {
+
+eg::NullLoggerBackend g_backend;
+
+uint32_t get_tick() { return 123456; }
+
+void register_backend()
+{
+    static bool registered = eg::Logger::register_backend(g_backend);
+    (void)registered;
+}
+
+
+void BM_LoggerPlainMessage(benchmark::State& state)
+{
+    register_backend();
+    for (auto _: state)
+    {
+        eg::Logger::log<eg::Logger::Level::Assert>("file.cpp", 42, "function", "Nothing to format");
+    }
+}
+BENCHMARK(BM_LoggerPlainMessage);
+
+
+void BM_LoggerFormattedMessage(benchmark::State& state)
+{
+    register_backend();
+    uint32_t value = 0;
+    for (auto _: state)
+    {
+        eg::Logger::log<eg::Logger::Level::Assert>("file.cpp", 42, "function", "value=%lu ratio=%d.%02d name=%s", 
+            static_cast<unsigned long>(++value), 3, 14, "channel");
+    }
+}
+BENCHMARK(BM_LoggerFormattedMessage);
+
+
+void BM_LoggerWithTimestamp(benchmark::State& state)
+{
+    register_backend();
+    eg::Logger::register_ticker(get_tick);
+    uint32_t value = 0;
+    for (auto _: state)
+    {
+        eg::Logger::log<eg::Logger::Level::Assert>("file.cpp", 42, "function", "value=%lu", static_cast<unsigned long>(++value));
+    }
+    eg::Logger::register_ticker(nullptr);
+}
+BENCHMARK(BM_LoggerWithTimestamp);
+
+
+} // namespace {
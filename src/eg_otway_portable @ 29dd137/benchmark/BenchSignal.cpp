@@ -0,0 +1,133 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// Signal::call(), emit() and dispatch for the current backend. Build with each platform to 
+// compare the Linux and bare metal implementations.
+
+#include "benchmark/benchmark.h"
+#include "BenchUtils.h"
+
+
+namespace {
+
+struct Receiver
+{
+    void on_none()                                    { ++m_count; }
+    void on_one(const uint32_t& value)                { m_count += value; }
+    void on_two(const uint32_t& value, const float& scale) { m_count += value; m_scale = scale; }
+
+    uint32_t m_count{};
+    float    m_scale{};
+};
+
+
+void BM_SignalCall(benchmark::State& state)
+{
+    Receiver receiver;
+    eg::bench::BenchEventLoop loop;
+    eg::Signal<uint32_t> signal;
+    signal.connect<&Receiver::on_one>(&receiver, loop);
+
+    for (auto _: state)
+    {
+        signal.call(1);
+    }
+    benchmark::DoNotOptimize(receiver.m_count);
+}
+BENCHMARK(BM_SignalCall);
+
+
+void BM_SignalEmitNoArgs(benchmark::State& state)
+{
+    Receiver receiver;
+    eg::bench::BenchEventLoop loop;
+    eg::Signal<> signal;
+    signal.connect<&Receiver::on_none>(&receiver, loop);
+
+    for (auto _: state)
+    {
+        signal.emit();
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_SignalEmitNoArgs);
+
+
+void BM_SignalEmitDispatchNoArgs(benchmark::State& state)
+{
+    Receiver receiver;
+    eg::bench::BenchEventLoop loop;
+    eg::Signal<> signal;
+    signal.connect<&Receiver::on_none>(&receiver, loop);
+
+    for (auto _: state)
+    {
+        signal.emit();
+        loop.dispatch_all();
+    }
+    benchmark::DoNotOptimize(receiver.m_count);
+}
+BENCHMARK(BM_SignalEmitDispatchNoArgs);
+
+
+void BM_SignalEmitDispatchOneArg(benchmark::State& state)
+{
+    Receiver receiver;
+    eg::bench::BenchEventLoop loop;
+    eg::Signal<uint32_t> signal;
+    signal.connect<&Receiver::on_one>(&receiver, loop);
+
+    for (auto _: state)
+    {
+        signal.emit(1);
+        loop.dispatch_all();
+    }
+    benchmark::DoNotOptimize(receiver.m_count);
+}
+BENCHMARK(BM_SignalEmitDispatchOneArg);
+
+
+void BM_SignalEmitDispatchTwoArgs(benchmark::State& state)
+{
+    Receiver receiver;
+    eg::bench::BenchEventLoop loop;
+    eg::Signal<uint32_t, float> signal;
+    signal.connect<&Receiver::on_two>(&receiver, loop);
+
+    for (auto _: state)
+    {
+        signal.emit(1, 0.5F);
+        loop.dispatch_all();
+    }
+    benchmark::DoNotOptimize(receiver.m_count);
+}
+BENCHMARK(BM_SignalEmitDispatchTwoArgs);
+
+
+// Several slots in the same loop share one event.
+void BM_SignalEmitDispatchManySlots(benchmark::State& state)
+{
+    std::vector<Receiver> receivers(static_cast<size_t>(state.range(0)));
+    eg::bench::BenchEventLoop loop;
+    eg::Signal<uint32_t> signal;
+    for (auto& receiver: receivers)
+    {
+        signal.connect<&Receiver::on_one>(&receiver, loop);
+    }
+
+    for (auto _: state)
+    {
+        signal.emit(1);
+        loop.dispatch_all();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SignalEmitDispatchManySlots)->Arg(1)->Arg(8);
+
+} // namespace {
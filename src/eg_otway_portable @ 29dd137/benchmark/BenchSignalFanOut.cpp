@@ -0,0 +1,115 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// Cost of emitting a signal connected to 1, 4 and 16 event loops. Signal::emit() packs the 
+// arguments once and posts the same event to every loop. The RebuildPerLoop case reproduces
+// the previous implementation, which built and packed a new event for each loop.
+
+#include "benchmark/benchmark.h"
+#include "BenchUtils.h"
+#include <memory>
+#include <vector>
+
+
+namespace {
+
+// A typical sensor reading: big enough for the packing to cost something.
+struct Reading
+{
+    uint32_t channel;
+    uint32_t timestamp;
+    float    values[8];
+};
+
+struct Receiver
+{
+    void on_reading(const uint32_t& sequence, const Reading& reading) { m_sequence = sequence; m_last = reading.values[0]; }
+    uint32_t m_sequence{};
+    float    m_last{};
+};
+
+
+struct FanOut
+{
+    explicit FanOut(int64_t num_loops)
+    : m_loops(static_cast<size_t>(num_loops))
+    {
+        for (auto& loop: m_loops)
+        {
+            loop = std::make_unique<eg::bench::BenchEventLoop>();
+            m_signal.connect<&Receiver::on_reading>(&m_receiver, *loop);
+        }
+    }
+
+    std::vector<std::unique_ptr<eg::bench::BenchEventLoop>> m_loops;
+    Receiver                                                m_receiver;
+    eg::Signal<uint32_t, Reading>                           m_signal;
+};
+
+
+void BM_FanOutEmit(benchmark::State& state)
+{
+    FanOut  fan_out{state.range(0)};
+    Reading reading{};
+    uint32_t sequence = 0;
+
+    for (auto _: state)
+    {
+        fan_out.m_signal.emit(++sequence, reading);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FanOutEmit)->Arg(1)->Arg(4)->Arg(16);
+
+
+void BM_FanOutRebuildPerLoop(benchmark::State& state)
+{
+    FanOut   fan_out{state.range(0)};
+    Reading  reading{};
+    uint32_t sequence = 0;
+
+    for (auto _: state)
+    {
+        ++sequence;
+        for (auto& loop: fan_out.m_loops)
+        {
+            eg::Event event{fan_out.m_signal};
+            event.pack(sequence);
+            event.pack(reading);
+            loop->post(event);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FanOutRebuildPerLoop)->Arg(1)->Arg(4)->Arg(16);
+
+
+// Emit and dispatch to every loop, for the complete round trip.
+void BM_FanOutEmitDispatch(benchmark::State& state)
+{
+    FanOut   fan_out{state.range(0)};
+    Reading  reading{};
+    uint32_t sequence = 0;
+
+    for (auto _: state)
+    {
+        fan_out.m_signal.emit(++sequence, reading);
+        for (auto& loop: fan_out.m_loops)
+        {
+            loop->dispatch_all();
+        }
+    }
+    benchmark::DoNotOptimize(fan_out.m_receiver.m_sequence);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FanOutEmitDispatch)->Arg(1)->Arg(4)->Arg(16);
+
+} // namespace {
@@ -0,0 +1,78 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// Software timers: starting and stopping with other timers running, and servicing expiries.
+
+#include "benchmark/benchmark.h"
+#include "BenchUtils.h"
+#include "timers/Timer.h"
+#include <memory>
+#include <vector>
+
+
+namespace {
+
+// Other timers running with a range of expiry times.
+std::vector<std::unique_ptr<eg::Timer>> make_running_timers(int64_t count)
+{
+    std::vector<std::unique_ptr<eg::Timer>> timers;
+    for (int64_t i = 0; i < count; ++i)
+    {
+        timers.push_back(std::make_unique<eg::Timer>(static_cast<uint32_t>(1000 + i * 10), eg::Timer::Type::Repeating));
+        timers.back()->start();
+    }
+    return timers;
+}
+
+
+void BM_TimerStartStop(benchmark::State& state)
+{
+    auto others = make_running_timers(state.range(0));
+    eg::Timer timer{5000, eg::Timer::Type::OneShot};
+    for (auto _: state)
+    {
+        timer.start();
+        timer.stop();
+    }
+}
+BENCHMARK(BM_TimerStartStop)->Arg(0)->Arg(16)->Arg(128);
+
+
+// Service one tick in which every timer expires. Nothing is connected to the timers, so 
+// this is the cost of the queue alone.
+void BM_TimerExpiries(benchmark::State& state)
+{
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+    eg::Timer::set_virtual_time(true);
+#endif
+    std::vector<std::unique_ptr<eg::Timer>> timers;
+    for (int64_t i = 0; i < state.range(0); ++i)
+    {
+        timers.push_back(std::make_unique<eg::Timer>(1, eg::Timer::Type::Repeating));
+        timers.back()->start();
+    }
+
+    for (auto _: state)
+    {
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+        eg::Timer::advance_virtual_time(1);
+#else
+        eg::tick_software_timers();
+#endif
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+
+    timers.clear();
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+    eg::Timer::set_virtual_time(false);
+#endif
+}
+BENCHMARK(BM_TimerExpiries)->Arg(1)->Arg(16)->Arg(128);
+
+} // namespace {
@@ -0,0 +1,207 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// Containers and algorithms from utilities/.
+
+#include "benchmark/benchmark.h"
+#include "utilities/RingBuffer.h"
+#include "utilities/BlockBuffer.h"
+#include "utilities/MemoryPool.h"
+#include "utilities/LockFreeMemoryPool.h"
+#include "utilities/CriticalSection.h"
+#include "utilities/ObjectPool.h"
+#include "utilities/SlabAllocator.h"
+#include "utilities/CRC.h"
+#include <array>
+#include <memory>
+#include <vector>
+
+
+namespace {
+
+void BM_RingBufferPutGet(benchmark::State& state)
+{
+    eg::RingBufferArray<uint32_t, 64> buffer;
+    uint32_t value = 0;
+    for (auto _: state)
+    {
+        buffer.put(++value);
+        buffer.get(value);
+        benchmark::DoNotOptimize(value);
+    }
+}
+BENCHMARK(BM_RingBufferPutGet);
+
+
+// Filling and draining in bursts keeps the positions wrapping.
+void BM_RingBufferBurst(benchmark::State& state)
+{
+    eg::RingBufferArray<uint32_t, 64> buffer;
+    const auto burst = static_cast<uint32_t>(state.range(0));
+    uint32_t value = 0;
+    for (auto _: state)
+    {
+        for (uint32_t i = 0; i < burst; ++i) buffer.put(i);
+        while (buffer.get(value)) {}
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(state.iterations() * burst);
+}
+BENCHMARK(BM_RingBufferBurst)->Arg(8)->Arg(48);
+
+
+void BM_BlockBufferAppendConsume(benchmark::State& state)
+{
+    eg::BlockBufferArray<1024> buffer;
+    std::vector<uint8_t> data(static_cast<size_t>(state.range(0)), 0x5A);
+    for (auto _: state)
+    {
+        buffer.append({data.data(), static_cast<uint16_t>(data.size()), 0});
+        auto block = buffer.front();
+        buffer.remove(block);
+        benchmark::DoNotOptimize(block);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BlockBufferAppendConsume)->Arg(16)->Arg(128)->Arg(512);
+
+
+void BM_MemoryPoolAllocFree(benchmark::State& state)
+{
+    struct Item { uint32_t data[5]; };
+    static eg::MemoryPool<Item, 200> pool;
+    for (auto _: state)
+    {
+        Item* item = pool.alloc();
+        benchmark::DoNotOptimize(item);
+        pool.free(item);
+    }
+}
+BENCHMARK(BM_MemoryPoolAllocFree);
+
+
+// Many live allocations, freed in a different order to that in which they were allocated.
+void BM_MemoryPoolChurn(benchmark::State& state)
+{
+    struct Item { uint32_t data[5]; };
+    static eg::MemoryPool<Item, 200> pool;
+    std::array<Item*, 100> items{};
+    for (auto _: state)
+    {
+        for (auto& item: items) item = pool.alloc();
+        for (size_t i = 0; i < items.size(); i += 2) pool.free(items[i]);
+        for (size_t i = 1; i < items.size(); i += 2) pool.free(items[i]);
+    }
+    state.SetItemsProcessed(state.iterations() * items.size());
+}
+BENCHMARK(BM_MemoryPoolChurn);
+
+
+void BM_LockFreeMemoryPoolAllocFree(benchmark::State& state)
+{
+    struct Item { uint32_t data[5]; };
+    static eg::LockFreeMemoryPool<Item, 200> pool;
+    for (auto _: state)
+    {
+        Item* item = pool.alloc();
+        benchmark::DoNotOptimize(item);
+        pool.free(item);
+    }
+}
+BENCHMARK(BM_LockFreeMemoryPoolAllocFree)->ThreadRange(1, 4);
+
+
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+// The alternative to the lock-free pool: MemoryPool in a critical section. The mock bare 
+// metal critical section doesn't lock, so this is for Linux only.
+void BM_MemoryPoolLockedAllocFree(benchmark::State& state)
+{
+    struct Item { uint32_t data[5]; };
+    static eg::MemoryPool<Item, 200> pool;
+    static eg::LockDomain domain{"bench"};
+    for (auto _: state)
+    {
+        Item* item;
+        {
+            eg::CriticalSection cs{domain};
+            item = pool.alloc();
+        }
+        benchmark::DoNotOptimize(item);
+        {
+            eg::CriticalSection cs{domain};
+            pool.free(item);
+        }
+    }
+}
+BENCHMARK(BM_MemoryPoolLockedAllocFree)->ThreadRange(1, 4);
+#endif
+
+
+void BM_ObjectPoolMake(benchmark::State& state)
+{
+    struct Item { uint32_t data[5]; Item(uint32_t value) : data{value} {} };
+    static eg::ObjectPool<Item, 200> pool;
+    uint32_t value = 0;
+    for (auto _: state)
+    {
+        auto item = pool.make(++value);
+        benchmark::DoNotOptimize(item.get());
+    }
+}
+BENCHMARK(BM_ObjectPoolMake);
+
+
+// The heap, for comparison with the pool.
+void BM_HeapMakeUnique(benchmark::State& state)
+{
+    struct Item { uint32_t data[5]; Item(uint32_t value) : data{value} {} };
+    uint32_t value = 0;
+    for (auto _: state)
+    {
+        auto item = std::make_unique<Item>(++value);
+        benchmark::DoNotOptimize(item.get());
+    }
+}
+BENCHMARK(BM_HeapMakeUnique);
+
+
+void BM_SlabAllocateFree(benchmark::State& state)
+{
+    using Slab = eg::SlabAllocator<eg::SlabClass<32, 64>, eg::SlabClass<128, 16>, eg::SlabClass<512, 4>>;
+    static Slab slab;
+    const auto size = static_cast<size_t>(state.range(0));
+    for (auto _: state)
+    {
+        void* p = slab.allocate(size);
+        benchmark::DoNotOptimize(p);
+        slab.deallocate(p);
+    }
+}
+BENCHMARK(BM_SlabAllocateFree)->Arg(16)->Arg(100)->Arg(500);
+
+
+template <typename CRC>
+void BM_CRC(benchmark::State& state)
+{
+    std::vector<uint8_t> data(static_cast<size_t>(state.range(0)));
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i * 7);
+    CRC crc;
+    for (auto _: state)
+    {
+        auto value = crc.calculate(data.data(), static_cast<uint32_t>(data.size()));
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CRC<eg::CRC8_AUTOSAR>)->Arg(256)->Arg(4096);
+BENCHMARK(BM_CRC<eg::CRC16_CCITT_FALSE>)->Arg(256)->Arg(4096);
+BENCHMARK(BM_CRC<eg::CRC32>)->Arg(256)->Arg(4096);
+BENCHMARK(BM_CRC<eg::CRC32_BZIP2>)->Arg(256)->Arg(4096);
+
+} // namespace {
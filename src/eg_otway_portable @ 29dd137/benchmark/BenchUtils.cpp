@@ -0,0 +1,68 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "BenchUtils.h"
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+#include "event_loop/ThreadEventLoop.h"
+#endif
+
+
+namespace {
+
+eg::IEventLoop* g_current_loop{};
+
+} // namespace {
+
+
+namespace eg {
+
+// Required by the signals. See test/TestSingleThreadedUtils.cpp.
+IEventLoop* default_event_loop_impl() { return g_current_loop; } 
+IEventLoop* this_event_loop_impl()    
+{ 
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+    // Allow the library's own ThreadEventLoop to be measured too.
+    if (!g_current_loop) return get_thread_event_loop();
+#endif
+    return g_current_loop; 
+}
+
+void on_assert_triggered(char const* file, uint32_t line, const char* function, const char* message) 
+{ 
+    (void) file; 
+    (void) line;
+    (void) function;
+    (void) message;
+}
+
+} // namespace eg {
+
+
+namespace eg::bench {
+
+void set_current_loop(IEventLoop* loop)
+{
+    g_current_loop = loop;
+}
+
+
+void BenchEventLoop::dispatch_all()
+{
+    IEventLoop* previous = g_current_loop;
+    g_current_loop = this;
+
+    Event event;
+    while (m_queue.get(event))
+    {
+        event.dispatch();
+    }
+
+    g_current_loop = previous;
+}
+
+} // namespace eg::bench {
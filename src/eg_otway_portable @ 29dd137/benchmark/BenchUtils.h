@@ -0,0 +1,50 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "signals/Signal.h"
+#include "utilities/RingBuffer.h"
+
+
+namespace eg::bench {
+
+
+// A minimal event loop for measuring the cost of emit() and dispatch without any locking
+// or thread handoff. Posted events are copied into a ring, as in BareMetalEventLoop, and 
+// are discarded when it fills unless drained with dispatch_all().
+class BenchEventLoop : public IEventLoop
+{
+public:
+    void post(const Event& event) override
+    {
+        if (!m_queue.put(event))
+        {
+            m_queue.clear();
+            m_queue.put(event);
+        }
+    }
+
+    void run() override {}
+
+#if defined(OTWAY_EVENT_LOOP_WATER_MARK)
+    uint16_t get_high_water_mark() const { return 0; }
+#endif
+
+    // Dispatch everything pending, with this loop as the current loop.
+    void dispatch_all();
+
+private:
+    RingBufferArray<Event, 256> m_queue{};
+};
+
+
+// The loop returned by this_event_loop() and default_event_loop() in the benchmarks.
+void set_current_loop(IEventLoop* loop);
+
+
+} // namespace eg::bench {
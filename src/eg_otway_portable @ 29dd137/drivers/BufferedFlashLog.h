@@ -0,0 +1,142 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "drivers/FlashLog.h"
+#include "timers/Timer.h"
+#include "utilities/NonCopyable.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+
+namespace eg {
+
+
+// A FlashLog with a RAM staging buffer in front of it. Records are collected in the buffer and 
+// programmed into the flash in batches with append_records(), which amortises the overhead of each 
+// program operation over several records. The buffer is flushed when:
+// - it holds enough records to fill the rest of the current page (so a batch never spans an erase),
+// - it is full,
+// - flush() is called, or
+// - the flush timer expires. The timer is started by the first record placed in an empty buffer,
+//   so no record waits in RAM for longer than the flush period. A period of zero disables the timer.
+//
+// Each record which has reached the flash has the same power-fail guarantee as with FlashLog: it
+// is either intact or skipped on recovery. Records still in the buffer are lost on a reset. That is 
+// at most kBufferRecords records, or those appended within the last flush period. Call flush() before 
+// a controlled shutdown, and when a record is important enough to need programming immediately.
+//
+// The timer signal is delivered through the event loop which is current at construction, so the
+// object must be created in the thread (or main loop) which appends the records. 
+template <typename Record, uint32_t kWriteSize, uint32_t kBufferRecords>
+class BufferedFlashLog : public NonCopyable
+{
+public:
+    static_assert(kBufferRecords > 0);
+    using Log    = FlashLog<Record, kWriteSize>;
+    using Result = typename Log::Result;
+
+public:
+    BufferedFlashLog(IFlashMemory& flash, uint32_t flush_period_ms = 0)
+    : m_log{flash}
+    , m_timer{(flush_period_ms > 0) ? flush_period_ms : 1, Timer::Type::OneShot}
+    , m_timed{flush_period_ms > 0}
+    {
+        connect_timer();
+    }
+
+    // With background erasing of the next page. See FlashLog.
+    BufferedFlashLog(IFlashMemory& flash, IFlashStorage& eraser, uint32_t flush_period_ms = 0)
+    : m_log{flash, eraser}
+    , m_timer{(flush_period_ms > 0) ? flush_period_ms : 1, Timer::Type::OneShot}
+    , m_timed{flush_period_ms > 0}
+    {
+        connect_timer();
+    }
+
+    Result append_record(const Record& record)
+    {
+        // The buffer can only be full here if the last flush failed (e.g. eBusy while waiting 
+        // for a background erase). If it still can't be flushed, the new record is refused.
+        if (m_pending == kBufferRecords)
+        {
+            Result result = flush();
+            if (result != Result::eOK) return result;
+        }
+
+        m_buffer[m_pending++] = record;
+        if ((m_pending == kBufferRecords) || (m_pending >= get_page_space()))
+        {
+            return flush();
+        }
+
+        if (m_timed && (m_pending == 1))
+        {
+            m_timer.start();
+        }
+        return Result::eOK;
+    }
+
+    // Program any buffered records into the flash now. If this fails, the records which did not 
+    // get into the log stay in the buffer for the next attempt. Batches never span a page boundary, 
+    // so a failure to start the next page means that none of them were written. 
+    Result flush()
+    {
+        if (m_timed)
+        {
+            m_timer.stop();
+        }
+        if (m_pending == 0) return Result::eOK;
+
+        uint32_t appended = 0;
+        Result result = m_log.append_records(m_buffer.data(), m_pending, &appended);
+        std::copy(m_buffer.begin() + appended, m_buffer.begin() + m_pending, m_buffer.begin());
+        m_pending -= appended;
+        if ((result != Result::eOK) && m_timed)
+        {
+            m_timer.start();
+        }
+        return result;
+    }
+
+    // The records which are buffered in RAM, and not yet in the flash.
+    uint32_t get_pending_count() const { return m_pending; }
+
+    // The underlying log, for queries. These only see records which have been flushed. 
+    const Log& get_log() const { return m_log; }
+    Log&       get_log()       { return m_log; }
+
+private:
+    void connect_timer()
+    {
+        if (m_timed)
+        {
+            m_timer.on_update().template connect<&BufferedFlashLog::on_timer>(this);
+        }
+    }
+
+    void on_timer() { flush(); }
+
+    // How many records can be appended before the log starts a new page.
+    uint32_t get_page_space() const
+    {
+        const uint32_t space = m_log.get_slots_remaining();
+        return (space > 0) ? space : m_log.get_records_per_page();
+    }
+
+private:
+    Log                                 m_log;
+    std::array<Record, kBufferRecords>  m_buffer{};
+    uint32_t                            m_pending{};
+    Timer                               m_timer;
+    bool                                m_timed{};
+};
+
+
+} // namespace eg {
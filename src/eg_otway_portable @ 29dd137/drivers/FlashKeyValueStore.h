@@ -0,0 +1,584 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "utilities/NonCopyable.h"
+#include "utilities/CRC.h"
+#include "interfaces/IFlashMemory.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+
+namespace eg {
+
+
+// A log-structured key-value store for small, independently updated items such as configuration 
+// parameters. Keys are 16-bit, and values are variable length blobs of up to a page or so.
+//
+// Each write appends an entry (a header with the key, length and CRC, followed by the value) to 
+// the active page. A later entry for the same key supersedes the earlier one, and a zero-length 
+// "tombstone" entry erases the key. Nothing is ever overwritten in place, and an entry which is 
+// torn by a reset fails its CRC and is ignored on recovery, so the previous value survives. 
+//
+// The pages are used in turn as a ring. When the active page is full, the next page (which is 
+// always kept erased) becomes active, and the page after that, which holds the oldest entries, 
+// is garbage collected: its live entries are copied to the new active page, and it is erased 
+// ready to be the next spare. So every page is erased in turn, however the writes are spread 
+// over the keys, which levels the wear. Each page header holds its erase count.
+//
+// A RAM index (open addressing, sized for kMaxKeys) maps each key to the location of its current
+// entry, so lookups don't scan the flash. It is rebuilt by scanning the pages at start up.
+//
+// At least three pages are required. The live data is limited to (pages - 2) pages' worth, so 
+// that there is always room to garbage collect.
+template <uint32_t kWriteSize, uint32_t kMaxKeys>
+class FlashKeyValueStore : public NonCopyable
+{
+public:
+    static_assert(std::has_single_bit(kWriteSize));
+    static_assert(kMaxKeys > 0);
+
+    enum class Result
+    {
+        eOK,
+        eNotFound,
+        eInvalidKey,
+        eInvalidSize,     // The value is too large, or the buffer is too small to read it.
+        eIndexFull,       // Already holding kMaxKeys keys.
+        eStoreFull,       // Not enough space for the live data, even after garbage collection.
+        eFlashFailed,
+    };
+
+    static constexpr uint16_t kInvalidKey = 0xFFFF;
+
+public:
+    FlashKeyValueStore(IFlashMemory& flash)
+    : m_flash{flash}
+    {
+        initialise();
+    }
+
+    Result write(uint16_t key, const uint8_t* data, uint16_t size)
+    {
+        if (key == kInvalidKey) return Result::eInvalidKey;
+        if (size > get_max_value_size()) return Result::eInvalidSize;
+
+        // Writing the same value again is common for configuration, and costs nothing. 
+        const Slot* slot = find(key);
+        if ((slot != nullptr) && (slot->length == size) && equals(*slot, data)) return Result::eOK;
+        if ((slot == nullptr) && (m_key_count == kMaxKeys)) return Result::eIndexFull;
+
+        const uint32_t live = m_live_bytes + entry_size(size) - ((slot != nullptr) ? entry_size(slot->length) : 0);
+        if (live > get_capacity()) return Result::eStoreFull;
+
+        Result result = reserve(entry_size(size));
+        if (result != Result::eOK) return result;
+        result = write_entry(key, data, size);
+        if (result == Result::eOK) m_value_bytes_written += size;
+        return result;
+    }
+
+    template <typename T>
+    Result write(uint16_t key, const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        return write(key, reinterpret_cast<const uint8_t*>(&value), sizeof(T));
+    }
+
+    // Copy the value into the buffer and set size to its length. If the buffer is too small, 
+    // size is set to the length needed and nothing is copied.
+    Result read(uint16_t key, uint8_t* data, uint16_t max_size, uint16_t& size) const
+    {
+        const Slot* slot = find(key);
+        if (slot == nullptr) return Result::eNotFound;
+        size = slot->length;
+        if (slot->length > max_size) return Result::eInvalidSize;
+
+        auto result = m_flash.read(slot->page, slot->offset + kEntryHeaderSize, data, slot->length);
+        return (result == IFlashMemory::Result::eOK) ? Result::eOK : Result::eFlashFailed;
+    }
+
+    template <typename T>
+    Result read(uint16_t key, T& value) const
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        uint16_t size = 0;
+        const Slot* slot = find(key);
+        if ((slot != nullptr) && (slot->length != sizeof(T))) return Result::eInvalidSize;
+        return read(key, reinterpret_cast<uint8_t*>(&value), sizeof(T), size);
+    }
+
+    Result erase(uint16_t key)
+    {
+        if (find(key) == nullptr) return Result::eNotFound;
+
+        Result result = reserve(kEntryHeaderSize);
+        if (result != Result::eOK) return result;
+        return write_entry(key, nullptr, kTombstone);
+    }
+
+    bool contains(uint16_t key) const { return find(key) != nullptr; }
+
+    // The length of the value, or zero if there is no such key.
+    uint16_t get_value_size(uint16_t key) const
+    {
+        const Slot* slot = find(key);
+        return (slot != nullptr) ? slot->length : 0;
+    }
+
+    uint32_t get_key_count() const { return m_key_count; }
+
+    uint16_t get_max_value_size() const 
+    { 
+        const uint32_t size = m_page_size - kPageHeaderSize - kEntryHeaderSize;
+        return static_cast<uint16_t>(std::min<uint32_t>(size, kTombstone - 1));
+    }
+
+    // The space taken by the live entries, including their headers, and the limit on that.
+    uint32_t get_live_bytes() const { return m_live_bytes; }
+    uint32_t get_capacity() const   { return (m_page_count - 2) * (m_page_size - kPageHeaderSize); }
+
+    // For measuring write amplification. All the bytes programmed, including headers and the
+    // entries copied by garbage collection, and the value bytes passed to write().
+    uint64_t get_flash_bytes_written() const { return m_flash_bytes_written; }
+    uint64_t get_value_bytes_written() const { return m_value_bytes_written; }
+
+    // How many times the page has been erased by the store, from its header.
+    uint32_t get_page_erase_count(uint32_t page) const
+    {
+        PageHeader header;
+        m_flash.read(page, 0, reinterpret_cast<uint8_t*>(&header), sizeof(header));
+        return (header.magic == kMagic) ? header.erase_count : 0;
+    }
+
+    uint32_t get_active_page() const { return m_active_page; }
+
+private:
+    static constexpr uint32_t kMagic       = 0x4B56'5331; // "KVS1"
+    static constexpr uint32_t kUnusedWord  = 0xFFFF'FFFF;
+    static constexpr uint32_t kInvalidPage = kUnusedWord;
+    static constexpr uint16_t kTombstone   = 0xFFFF;
+
+    // The page header is programmed in two parts. The first part is written straight after the 
+    // page is erased, so the erase count is never lost. The sequence number is written when the 
+    // page becomes active, and orders the pages. Each part is a separate write.
+    struct PageHeader
+    {
+        uint32_t magic;
+        uint32_t erase_count;
+    };
+    struct PageSequence
+    {
+        uint32_t sequence;
+    };
+    // Everything is programmed in whole write units.
+    static constexpr uint32_t kHeaderPartSize   = ((sizeof(PageHeader) + kWriteSize - 1) / kWriteSize) * kWriteSize;
+    static constexpr uint32_t kSequencePartSize = ((sizeof(PageSequence) + kWriteSize - 1) / kWriteSize) * kWriteSize;
+    static constexpr uint32_t kSequenceOffset   = kHeaderPartSize;
+    static constexpr uint32_t kPageHeaderSize   = kHeaderPartSize + kSequencePartSize;
+
+    // The CRC covers the key, the length and the value.
+    struct EntryHeader
+    {
+        uint32_t crc;
+        uint16_t key;
+        uint16_t length;
+    };
+    static_assert(std::is_trivially_copyable_v<EntryHeader>);
+    static constexpr uint32_t kEntryHeaderSize = ((sizeof(EntryHeader) + kWriteSize - 1) / kWriteSize) * kWriteSize;
+
+    static constexpr uint32_t entry_size(uint16_t length)
+    {
+        const uint32_t value_size = (length == kTombstone) ? 0 : length;
+        return kEntryHeaderSize + ((value_size + kWriteSize - 1) & ~(kWriteSize - 1));
+    }
+
+    // The index is an open addressing hash table with linear probing, kept at most half full.
+    struct Slot
+    {
+        uint16_t key{kInvalidKey};
+        uint16_t length{};
+        uint16_t page{};
+        uint32_t offset{};
+    };
+    static constexpr uint32_t kIndexSize = std::bit_ceil(kMaxKeys * 2);
+
+    // Buffer for reading and copying entries in pieces.
+    static constexpr uint32_t kChunkSize = std::max<uint32_t>(64, kWriteSize);
+
+private:
+    void initialise()
+    {
+        m_page_count  = m_flash.get_page_count();
+        m_page_size   = m_flash.get_page_size(0);
+        m_active_page = kInvalidPage;
+        m_sequence    = 0;
+
+        // Find the active page, the one with the highest sequence number. Any page which doesn't 
+        // belong to the store is formatted. 
+        for (uint32_t page = 0; page < m_page_count; ++page)
+        {
+            PageHeader header;
+            m_flash.read(page, 0, reinterpret_cast<uint8_t*>(&header), sizeof(header));
+            if (header.magic != kMagic)
+            {
+                // A reset part way through an erase can leave the header blank but not the rest.
+                if (!is_page_blank(page))
+                {
+                    erase_page(page, 0);
+                }
+                else
+                {
+                    format_page(page, 0);
+                }
+                continue;
+            }
+
+            const uint32_t sequence = read_sequence(page);
+            if ((sequence != kUnusedWord) && ((m_active_page == kInvalidPage) || (sequence > m_sequence)))
+            {
+                m_active_page = page;
+                m_sequence    = sequence;
+            }
+        }
+
+        if (m_active_page == kInvalidPage)
+        {
+            activate_page(0);
+            return;
+        }
+
+        // The pages were activated in ring order, so replaying them in ring order from the oldest
+        // applies the entries in the order they were written. 
+        for (uint32_t i = 1; i <= m_page_count; ++i)
+        {
+            const uint32_t page = (m_active_page + i) % m_page_count;
+            if (read_sequence(page) == kUnusedWord) continue;
+            m_write_offset = scan_page(page);
+        }
+
+        // A reset during garbage collection can leave the spare page not yet erased.
+        collect_garbage((m_active_page + 1) % m_page_count);
+    }
+
+    // Index the entries in the page. Returns the offset after the last entry.
+    uint32_t scan_page(uint32_t page)
+    {
+        uint32_t offset = kPageHeaderSize;
+        while ((offset + kEntryHeaderSize) <= m_page_size)
+        {
+            EntryHeader header;
+            m_flash.read(page, offset, reinterpret_cast<uint8_t*>(&header), sizeof(header));
+            if ((header.key == kInvalidKey) && (header.length == kTombstone) && (header.crc == kUnusedWord)) break;
+
+            const uint32_t size = entry_size(header.length);
+            if ((header.key == kInvalidKey) || (size > (m_page_size - offset)))
+            {
+                // The header itself is damaged, so we can't tell where the next entry starts. 
+                // Nothing more will be written to this page.
+                return m_page_size;
+            }
+
+            if (check_crc(page, offset, header))
+            {
+                apply(header.key, header.length, page, offset);
+            }
+            offset += size;
+        }
+        return offset;
+    }
+
+    bool check_crc(uint32_t page, uint32_t offset, const EntryHeader& header) const
+    {
+        CRC32 crc;
+        crc.reset();
+        crc.update(header.key);
+        crc.update(header.length);
+
+        if (header.length != kTombstone)
+        {
+            std::array<uint8_t, kChunkSize> buffer;
+            for (uint32_t done = 0; done < header.length; )
+            {
+                const uint32_t size = std::min<uint32_t>(kChunkSize, header.length - done);
+                m_flash.read(page, offset + kEntryHeaderSize + done, buffer.data(), size);
+                crc.update(buffer.data(), size);
+                done += size;
+            }
+        }
+        return crc.finalise() == header.crc;
+    }
+
+    bool equals(const Slot& slot, const uint8_t* data) const
+    {
+        std::array<uint8_t, kChunkSize> buffer;
+        for (uint32_t done = 0; done < slot.length; )
+        {
+            const uint32_t size = std::min<uint32_t>(kChunkSize, slot.length - done);
+            m_flash.read(slot.page, slot.offset + kEntryHeaderSize + done, buffer.data(), size);
+            if (std::memcmp(buffer.data(), data + done, size) != 0) return false;
+            done += size;
+        }
+        return true;
+    }
+
+    // Make room for an entry of the given size in the active page, moving on to the next page 
+    // if necessary.
+    Result reserve(uint32_t size)
+    {
+        // Each new page reclaims the space in the oldest page, so going all the way round the
+        // ring without finding room means that it is full. The capacity check in write() should
+        // prevent that.
+        for (uint32_t pages = 0; (m_write_offset + size) > m_page_size; ++pages)
+        {
+            if (pages == m_page_count) return Result::eStoreFull;
+
+            const uint32_t next_page = (m_active_page + 1) % m_page_count;
+            if (!activate_page(next_page)) return Result::eFlashFailed;
+            if (!collect_garbage((next_page + 1) % m_page_count)) return Result::eFlashFailed;
+        }
+        return Result::eOK;
+    }
+
+    // Write the sequence number into an erased page to make it the active page.
+    bool activate_page(uint32_t page)
+    {
+        std::array<uint8_t, kSequencePartSize> buffer;
+        buffer.fill(0xFF);
+        const PageSequence sequence{++m_sequence};
+        std::memcpy(buffer.data(), &sequence, sizeof(sequence));
+
+        m_active_page  = page;
+        m_write_offset = kPageHeaderSize;
+        return program(page, kSequenceOffset, buffer.data(), buffer.size());
+    }
+
+    // Copy the live entries out of the page into the active page, then erase it. The live 
+    // entries are those the index still points at.
+    bool collect_garbage(uint32_t page)
+    {
+        if ((page == m_active_page) || (read_sequence(page) == kUnusedWord)) return true;
+
+        uint32_t offset = kPageHeaderSize;
+        while ((offset + kEntryHeaderSize) <= m_page_size)
+        {
+            EntryHeader header;
+            m_flash.read(page, offset, reinterpret_cast<uint8_t*>(&header), sizeof(header));
+            if (header.key == kInvalidKey) break;
+
+            const uint32_t size = entry_size(header.length);
+            if (size > (m_page_size - offset)) break;
+
+            Slot* slot = find(header.key);
+            if ((slot != nullptr) && (slot->page == page) && (slot->offset == offset))
+            {
+                if (!copy_entry(page, offset, size, *slot)) return false;
+            }
+            offset += size;
+        }
+
+        return erase_page(page, get_page_erase_count(page) + 1);
+    }
+
+    bool copy_entry(uint32_t page, uint32_t offset, uint32_t size, Slot& slot)
+    {
+        const uint32_t target = m_write_offset;
+        if ((target + size) > m_page_size) return false;
+
+        std::array<uint8_t, kChunkSize> buffer;
+        for (uint32_t done = 0; done < size; )
+        {
+            const uint32_t chunk = std::min<uint32_t>(kChunkSize, size - done);
+            m_flash.read(page, offset + done, buffer.data(), chunk);
+            if (!program(m_active_page, target + done, buffer.data(), chunk)) return false;
+            done += chunk;
+        }
+
+        m_write_offset += size;
+        slot.page   = static_cast<uint16_t>(m_active_page);
+        slot.offset = target;
+        return true;
+    }
+
+    // Append an entry to the active page. There must be room for it. The header goes first, so 
+    // that a reset part way through leaves an entry with a bad CRC rather than a blank header 
+    // in front of programmed data. If programming fails, the state of the entry is unknown, so 
+    // the page is closed and the next entry goes to a new page.
+    Result write_entry(uint16_t key, const uint8_t* data, uint16_t length)
+    {
+        CRC32 crc;
+        crc.reset();
+        crc.update(key);
+        crc.update(length);
+        const bool tombstone = (length == kTombstone);
+        if (!tombstone) crc.update(data, length);
+
+        std::array<uint8_t, kEntryHeaderSize> buffer;
+        buffer.fill(0xFF);
+        const EntryHeader header{crc.finalise(), key, length};
+        std::memcpy(buffer.data(), &header, sizeof(header));
+
+        const uint32_t offset = m_write_offset;
+        m_write_offset = m_page_size;
+        if (!program(m_active_page, offset, buffer.data(), buffer.size())) return Result::eFlashFailed;
+
+        if (!tombstone)
+        {
+            // Whole write units straight from the caller's data, then the remainder padded. 
+            const uint32_t body = length & ~(kWriteSize - 1);
+            if ((body > 0) && !program(m_active_page, offset + kEntryHeaderSize, data, body)) return Result::eFlashFailed;
+
+            if (body < length)
+            {
+                std::array<uint8_t, kWriteSize> tail;
+                tail.fill(0xFF);
+                std::memcpy(tail.data(), data + body, length - body);
+                if (!program(m_active_page, offset + kEntryHeaderSize + body, tail.data(), kWriteSize)) return Result::eFlashFailed;
+            }
+        }
+
+        m_write_offset = offset + entry_size(length);
+        apply(key, length, m_active_page, offset);
+        return Result::eOK;
+    }
+
+    bool program(uint32_t page, uint32_t offset, const uint8_t* data, uint32_t size)
+    {
+        m_flash_bytes_written += size;
+        return m_flash.write(page, offset, data, size) == IFlashMemory::Result::eOK;
+    }
+
+    bool erase_page(uint32_t page, uint32_t erase_count)
+    {
+        if (m_flash.erase_page(page) != IFlashMemory::Result::eOK) return false;
+        return format_page(page, erase_count);
+    }
+
+    bool format_page(uint32_t page, uint32_t erase_count)
+    {
+        std::array<uint8_t, kHeaderPartSize> buffer;
+        buffer.fill(0xFF);
+        const PageHeader header{kMagic, erase_count};
+        std::memcpy(buffer.data(), &header, sizeof(header));
+        return program(page, 0, buffer.data(), buffer.size());
+    }
+
+    bool is_page_blank(uint32_t page) const
+    {
+        std::array<uint8_t, kChunkSize> buffer;
+        for (uint32_t offset = 0; offset < m_page_size; offset += kChunkSize)
+        {
+            const uint32_t chunk = std::min<uint32_t>(kChunkSize, m_page_size - offset);
+            m_flash.read(page, offset, buffer.data(), chunk);
+            if (!std::all_of(buffer.begin(), buffer.begin() + chunk, [](uint8_t b) { return b == 0xFF; })) return false;
+        }
+        return true;
+    }
+
+    uint32_t read_sequence(uint32_t page) const
+    {
+        PageSequence sequence;
+        m_flash.read(page, kSequenceOffset, reinterpret_cast<uint8_t*>(&sequence), sizeof(sequence));
+        return sequence.sequence;
+    }
+
+    // Update the index for an entry which is now in the flash.
+    void apply(uint16_t key, uint16_t length, uint32_t page, uint32_t offset)
+    {
+        Slot* slot = find(key);
+        if (slot != nullptr)
+        {
+            m_live_bytes -= entry_size(slot->length);
+            if (length == kTombstone)
+            {
+                remove(slot);
+                return;
+            }
+        }
+        else
+        {
+            // Tombstones for keys we don't know about can be ignored. Keys beyond kMaxKeys
+            // can only come from a store written with a larger index, and are dropped.
+            if ((length == kTombstone) || (m_key_count == kMaxKeys)) return;
+            slot = insert(key);
+        }
+
+        slot->length = length;
+        slot->page   = static_cast<uint16_t>(page);
+        slot->offset = offset;
+        m_live_bytes += entry_size(length);
+    }
+
+    static uint32_t hash(uint16_t key)
+    {
+        // Fibonacci hashing.
+        constexpr uint32_t kBits = std::countr_zero(kIndexSize);
+        return (kBits == 0) ? 0 : ((key * 2654435769U) >> (32 - kBits));
+    }
+
+    const Slot* find(uint16_t key) const
+    {
+        for (uint32_t i = hash(key); ; i = (i + 1) & (kIndexSize - 1))
+        {
+            if (m_index[i].key == key) return &m_index[i];
+            if (m_index[i].key == kInvalidKey) return nullptr;
+        }
+    }
+
+    Slot* find(uint16_t key)
+    {
+        return const_cast<Slot*>(static_cast<const FlashKeyValueStore*>(this)->find(key));
+    }
+
+    Slot* insert(uint16_t key)
+    {
+        uint32_t i = hash(key);
+        while (m_index[i].key != kInvalidKey) i = (i + 1) & (kIndexSize - 1);
+        m_index[i].key = key;
+        ++m_key_count;
+        return &m_index[i];
+    }
+
+    // Backward shift deletion, so that lookups never need tombstones in the index.
+    void remove(Slot* slot)
+    {
+        uint32_t hole = static_cast<uint32_t>(slot - m_index.data());
+        for (uint32_t i = (hole + 1) & (kIndexSize - 1); m_index[i].key != kInvalidKey; i = (i + 1) & (kIndexSize - 1))
+        {
+            // Move the entry back if its home position is not between the hole and where it is.
+            const uint32_t home = hash(m_index[i].key);
+            if (((i - home) & (kIndexSize - 1)) >= ((i - hole) & (kIndexSize - 1)))
+            {
+                m_index[hole] = m_index[i];
+                hole = i;
+            }
+        }
+        m_index[hole] = Slot{};
+        --m_key_count;
+    }
+
+private:
+    IFlashMemory&                  m_flash;
+    uint32_t                       m_page_count{};
+    uint32_t                       m_page_size{};
+    uint32_t                       m_active_page{kInvalidPage};
+    uint32_t                       m_write_offset{};
+    uint32_t                       m_sequence{};
+    std::array<Slot, kIndexSize>   m_index{};
+    uint32_t                       m_key_count{};
+    uint32_t                       m_live_bytes{};
+    uint64_t                       m_flash_bytes_written{};
+    uint64_t                       m_value_bytes_written{};
+};
+
+
+} // namespace eg {
@@ -9,6 +9,12 @@
 #pragma once
 #include "utilities/NonCopyable.h"
 #include "interfaces/IFlashMemory.h"
+#include "interfaces/IFlashStorage.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <ranges>
 #include <type_traits>
 
 
@@ -20,6 +26,27 @@ namespace eg {
 // filling the next page. If the next page is already full, we erase it first (it is the oldest 
 // data). The set of pages in the flash are used as a kind of ring buffer.
 //
+// The end of each page holds a commit marker for each record slot, one kWriteSize chunk each. A 
+// record is programmed first and then its marker, so a record only counts once its marker is 
+// fully programmed. A reset part way through an append leaves a torn record (programmed from the 
+// start, blank at the end) with no marker. That record is never counted or read. The slot can't 
+// be programmed again, so the rest of the page is left unused and the next append starts a new 
+// page. A failed write does the same. Such a short page leaves a gap in the sequence numbers.
+//
+// The header of each page holds kFormat. Pages written before the commit markers were added have 
+// a blank format word, records up to the end of the page, and no markers. A record in such a page 
+// is present if its first kWriteSize chunk is programmed. When a log in that format is opened, its 
+// pages are read with the old geometry until the ring overwrites them. The current page is closed, 
+// so new records always go into a new page in the current format.
+//
+// Erasing a page takes milliseconds to tens of milliseconds, which is a long time to block the event 
+// loop in append_record(). If the log is also given an IFlashStorage for the same pages (sector N is 
+// page N), it erases the page after the current one in the background as soon as the current page is 
+// started. The oldest page of records is discarded at that point rather than when the current page 
+// fills, so the log holds up to one page fewer records. If the erase has still not completed when the 
+// next page is needed, the append returns eBusy and the caller should try again later. The log must 
+// outlive its connection to IFlashStorage::OnFlashOperationComplete(). 
+//
 // TODO_AC Create a concrete base class to reduce code duplication. The log doesn't care about the 
 // record type other than its size. It is just memcpy'd in and out.
 template <typename Record, uint32_t kWriteSize>
@@ -32,6 +59,12 @@ public:
     static constexpr uint32_t kInvalidPage   = kUnusedWord;
     static constexpr uint32_t kInvalidIndex  = kUnusedWord;
     static constexpr uint32_t kInvalidOffset = kUnusedWord;
+    // The marker is all zeros, so that it is only complete if every bit has been programmed.
+    static constexpr uint32_t kCommitWord    = 0;
+    // The most markers programmed by one write.
+    static constexpr uint32_t kMarkerBatch   = 32;
+    // Identifies a page in the current format (with commit markers). 
+    static constexpr uint32_t kFormat        = 0x464C'4732; // "FLG2"
 
     // Each page in the log with any data at all has a header record at the beginning.
     // This makes it simpler to keep track of which pages hold the oldest and newest data.
@@ -41,7 +74,7 @@ public:
     struct alignas(kWriteSize) Header
     {
         uint32_t index{};
-        uint32_t unused1{kUnusedWord};
+        uint32_t format{kFormat};
         uint32_t unused2{kUnusedWord};
         uint32_t unused3{kUnusedWord};
     };
@@ -50,6 +83,96 @@ public:
 
     using Result = IFlashMemory::Result; 
 
+    // Walks the records in order, one page at a time, without recalculating the position of 
+    // each record from scratch. Dereferencing returns a copy of the record. On memory-mapped 
+    // flash, get() returns a pointer directly into the flash instead (nullptr otherwise). The 
+    // iterator is bidirectional, so the records can be walked in reverse with std::views::reverse. 
+    // Appending to the log may invalidate iterators, as it can erase the oldest page.
+    // Dereferencing returns by value, so to the pre-C++20 algorithms this is only an input iterator.
+    // Use std::ranges::prev() and friends rather than std::prev(). 
+    class Iterator
+    {
+    public:
+        using value_type        = Record;
+        using difference_type   = std::ptrdiff_t;
+        using iterator_concept  = std::bidirectional_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+
+        Iterator() = default;
+
+        Record operator*() const
+        {
+            Record record;
+            if (const Record* data = get())
+                std::memcpy(&record, data, sizeof(Record));
+            else
+                m_log->m_flash.read(m_page, slot_offset(m_slot), reinterpret_cast<uint8_t*>(&record), sizeof(Record));
+            return record;
+        }
+
+        const Record* get() const
+        {
+            return reinterpret_cast<const Record*>(m_log->m_flash.get_data(m_page, slot_offset(m_slot)));
+        }
+
+        // The position of the record in the log, as used by read_record_by_index().
+        uint32_t index() const    { return m_index; }
+        // The sequence number of the record. See get_oldest_sequence().
+        uint64_t sequence() const { return m_log->get_page_sequence(m_page) + m_slot; }
+
+        // Short pages are skipped. Only the current page can be the last.
+        Iterator& operator++()
+        {
+            ++m_index;
+            ++m_slot;
+            while ((m_slot >= m_count) && (m_page != m_log->m_current_page))
+            {
+                m_page  = (m_page + 1) % m_log->m_page_count;
+                m_slot  = 0;
+                m_count = m_log->get_page_record_count(m_page);
+            }
+            return *this;
+        }
+
+        Iterator& operator--()
+        {
+            --m_index;
+            while (m_slot == 0)
+            {
+                m_page  = (m_page + m_log->m_page_count - 1) % m_log->m_page_count;
+                m_count = m_log->get_page_record_count(m_page);
+                m_slot  = m_count;
+            }
+            --m_slot;
+            return *this;
+        }
+
+        Iterator operator++(int) { Iterator temp{*this}; ++*this; return temp; }
+        Iterator operator--(int) { Iterator temp{*this}; --*this; return temp; }
+
+        bool operator==(const Iterator& other) const { return m_index == other.m_index; }
+
+    private:
+        friend class FlashLog;
+        Iterator(const FlashLog* log, uint32_t index)
+        : m_log{log}
+        , m_index{index}
+        {
+            log->locate(index, m_page, m_slot);
+            m_count = log->get_page_record_count(m_page);
+        }
+
+    private:
+        const FlashLog* m_log{};
+        uint32_t        m_index{};
+        uint32_t        m_page{};
+        uint32_t        m_slot{};
+        // The number of records in m_page.
+        uint32_t        m_count{};
+    };
+
+    using Range = std::ranges::subrange<Iterator>;
+
 public:    
     FlashLog(IFlashMemory& flash)
     : m_flash{flash}
@@ -57,77 +180,157 @@ public:
         initialise();
     }
 
+    // As above, but with background erasing of the next page. See the comment at the top.
+    FlashLog(IFlashMemory& flash, IFlashStorage& eraser)
+    : m_flash{flash}
+    , m_eraser{&eraser}
+    {
+        eraser.OnFlashOperationComplete().connect<&FlashLog::on_operation_complete>(this);
+        initialise();
+    }
+
+    // Returns the result of programming the record. If that fails, the record is not in the log.
     Result append_record(const Record& record)
     {
-        uint32_t page_size    = m_flash.get_page_size(m_current_page);
-        uint32_t page_address = m_flash.get_page_address(m_current_page);
+        if (get_slots_remaining() == 0)
+        {
+            Result result = start_next_page();
+            if (result != Result::eOK) return result;
+        }
 
-        if ((m_current_offset + sizeof(Record)) > page_size)
+        return program(&record, 1);
+    }
+
+    // As append_record(), but programs each run of records which falls in a page with a single 
+    // write, and then their markers with one write per kMarkerBatch. This saves the per-operation 
+    // overhead of the flash controller when logging at a high rate. A record is only in the log 
+    // once its marker is programmed, so a reset part way through leaves the earlier records intact 
+    // and none of the rest. A record torn by the reset is never read, and its page is closed (see 
+    // the comment at the top). That is, the power-fail guarantee is still per record. If this 
+    // fails, e.g. with eBusy at a page boundary, the records before the failure are in the log and 
+    // the rest are not. The number in the log is returned in appended, if given. A write which 
+    // fails part way through a batch of markers may leave some of them programmed, in which case 
+    // a few more records than that are found after a reset.
+    Result append_records(const Record* records, uint32_t count, uint32_t* appended = nullptr)
+    {
+        uint32_t done   = 0;
+        Result   result = Result::eOK;
+        while ((done < count) && (result == Result::eOK))
         {
-            // The page is full. Additional work is needed.
-            Header header;
-
-            // Determine the index of the next page.
-            m_flash.read(page_address, reinterpret_cast<uint8_t*>(&header), sizeof(header));
-            uint32_t next_index = header.index + 1;            
-
-            // Advance to the next page. This may wrap around to the zeroth page.
-            uint32_t page_count = m_flash.get_page_count();
-            m_current_page   = (m_current_page + 1) % page_count;
-            m_current_offset = sizeof(Header);
-
-            // Test whether we need to erase the page. That is, if it already contains data.
-            page_address = m_flash.get_page_address(m_current_page);
-            m_flash.read(page_address, reinterpret_cast<uint8_t*>(&header), sizeof(header));            
-            if (header.index != kInvalidIndex)
+            if (get_slots_remaining() == 0)
             {
-                m_flash.erase_address(page_address);
+                result = start_next_page();
+                if (result != Result::eOK) break;
             }
 
-            // Now write the page header. 
-            header.index = next_index;
-            //std::cout << "header " << std::hex << header.index << std::endl;
-            m_flash.write(page_address, reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+            const uint32_t chunk  = std::min(count - done, get_slots_remaining());
+            const uint32_t before = m_current_count;
+            result = program(records + done, chunk);
+            done  += m_current_count - before;
         }
 
-        // Finally write the new record.
-        //std::cout << "record " << std::hex << page_address << " " << m_current_offset << std::endl;
-        m_flash.write(page_address + m_current_offset, reinterpret_cast<const uint8_t*>(&record), sizeof(Record)); 
-        m_current_offset += sizeof(Record); 
+        if (appended != nullptr) *appended = done;
+        return result;          
+    }
 
-        return Result::eOK;          
+    // The number of records which can be appended before the log moves on to the next page. 
+    // This is zero when the current page is full, or has been closed by a failed write. 
+    uint32_t get_slots_remaining() const
+    {
+        return m_current_closed ? 0U : (m_records_per_page - m_current_count);
     }
 
     const Record* get_pointer_by_index(uint32_t index) const
     {
-        if (index > get_record_count()) return nullptr;
+        if (index >= get_record_count()) return nullptr;
 
-        uint32_t size = get_records_per_page();
-        uint32_t page = get_oldest_page();
-
-        // TODO_AC This assumes we have pages all the same size. Reasonable in context.
-        page  = (page + index / size) % m_flash.get_page_count();
-        index = index % size; 
-
-        uint32_t offset = sizeof(Header) + index * sizeof(Record);
+        uint32_t page;
+        uint32_t slot;
+        locate(index, page, slot);
         // TODO_AC Have we already constrained the alignment enough to not need memcpy?
-        return reinterpret_cast<const Record*>(m_flash.get_data(page, offset));
+        return reinterpret_cast<const Record*>(m_flash.get_data(page, slot_offset(slot)));
     }
 
     Result read_record_by_index(uint32_t index, Record& record) const
     {
-        if (index > get_record_count()) return Result::eInvalidOffset;
+        if (index >= get_record_count()) return Result::eInvalidOffset;
 
-        uint32_t size = get_records_per_page();
-        uint32_t page = get_oldest_page();
+        uint32_t page;
+        uint32_t slot;
+        locate(index, page, slot);
+        m_flash.read(page, slot_offset(slot), reinterpret_cast<uint8_t*>(&record), sizeof(Record));
+        return Result::eOK;
+    }
 
-        // TODO_AC This assumes we have pages all the same size. Reasonable in context.
-        page  = (page + index / size) % m_flash.get_page_count();
-        index = index % size; 
+    // All the records from the oldest to the newest, or those from the given index onwards. 
+    Iterator begin() const { return Iterator{this, 0}; }
+    Iterator end() const   { return Iterator{this, get_record_count()}; }
+    Range records(uint32_t first_index = 0) const
+    {
+        const uint32_t count = get_record_count();
+        return Range{Iterator{this, (first_index < count) ? first_index : count}, end()};
+    }
 
-        uint32_t offset = sizeof(Header) + index * sizeof(Record);
-        m_flash.read(page, offset, reinterpret_cast<uint8_t*>(&record), sizeof(Record));
-        return Result::eOK;
+    // Every record appended to the log has a sequence number, one more than the previous record
+    // unless a short page lies between them (see the comment at the top). They carry on across 
+    // page boundaries and restarts, and are only reset by erase_all_records(). A client which 
+    // uploads the log incrementally can remember the next sequence number and later ask for the 
+    // records since then. If some of those records have been overwritten, the range starts at 
+    // the oldest remaining record.
+    uint64_t get_oldest_sequence() const 
+    { 
+        return get_page_sequence(m_oldest_page); 
+    }
+
+    uint64_t get_next_sequence() const 
+    { 
+        return get_page_sequence(m_current_page) + m_current_count; 
+    }
+
+    Range records_since(uint64_t sequence) const
+    {
+        if (sequence <= get_oldest_sequence()) return records();
+        if (sequence >= get_next_sequence())   return records(get_record_count());
+
+        // Count the records in the pages before the one holding the sequence number.
+        uint32_t index = 0;
+        uint32_t page  = m_oldest_page;
+        while ((get_page_sequence(page) + get_page_slots(page)) <= sequence)
+        {
+            index += get_page_record_count(page);
+            page   = (page + 1) % m_page_count;
+        }
+        const uint32_t slot = static_cast<uint32_t>(sequence - get_page_sequence(page));
+        return records(index + std::min(slot, get_page_record_count(page)));
+    }
+
+    // Copy up to max_count records into the buffer, starting from the given index. This makes 
+    // one read of the flash for each page touched rather than one for each record, which helps
+    // on flash which isn't memory-mapped (e.g. SPI). Returns the number of records copied.
+    uint32_t read_records(uint32_t first_index, Record* buffer, uint32_t max_count) const
+    {
+        const uint32_t count = get_record_count();
+        if (first_index >= count) return 0;
+        if (max_count > (count - first_index)) max_count = count - first_index;
+
+        uint32_t page;
+        uint32_t slot;
+        locate(first_index, page, slot);
+
+        uint32_t copied = 0;
+        while (copied < max_count)
+        {
+            // The records are contiguous to the end of those in the page. 
+            const uint32_t chunk = std::min(max_count - copied, get_page_record_count(page) - slot);
+            if (chunk > 0)
+            {
+                m_flash.read(page, slot_offset(slot), reinterpret_cast<uint8_t*>(&buffer[copied]), chunk * sizeof(Record));
+                copied += chunk;
+            }
+            page = (page + 1) % m_page_count;
+            slot = 0;
+        }
+        return copied;
     }
 
     Result erase_all_records()
@@ -142,146 +345,463 @@ public:
 
     uint32_t get_records_per_page() const
     {
-        // TODO_AC This assumes we have pages all the same size. Reasonable in context.
-        return (m_flash.get_page_size(0) - sizeof(Header)) / sizeof(Record);
+        return m_records_per_page;
     }
 
+    // The oldest and newest pages, and the record count, are held in RAM and kept up to date 
+    // as records are appended. Only initialise() needs to scan the page headers and markers.
     uint32_t get_oldest_page() const 
     {
+        return m_oldest_page;
+    }
+
+    uint32_t get_newest_page() const 
+    {
+        return m_current_page;
+    }
+
+    uint32_t get_record_count() const
+    {
+        return m_record_count;
+    }
+
+private:
+    Result initialise() 
+    {
+        // Better to make these static assertions but we would have to template IFlashMemory 
+        // Perhaps that's a good idea since we don't really need dynamic polymorphism.
+        // Assert that kWriteSize matches m_flash.get_write_size().
+        // Assert that (sizeof(Record) + kWriteSize - sizeof(Header)) <= m_flash.get_page_size().
+
+        // TODO_AC This assumes we have pages all the same size. Reasonable in context.
+        m_page_count       = m_flash.get_page_count();
+        m_page_size        = m_flash.get_page_size(0);
+        m_records_per_page = (m_page_size - sizeof(Header)) / (sizeof(Record) + kWriteSize);
+        m_legacy_per_page  = (m_page_size - sizeof(Header)) / sizeof(Record);
+        m_legacy_pages     = 0;
+        m_current_closed   = false;
+        m_blank_page       = kInvalidPage;
+
+        // A single pass over the page headers finds both ends of the log. 
         uint32_t oldest_page  = kInvalidPage;
         uint32_t oldest_index = kInvalidIndex;
-
-        Header   header;
-        uint32_t page_count = m_flash.get_page_count();
-        for (uint32_t page = 0; page < page_count; ++page)
+        uint32_t newest_page  = kInvalidPage;
+        uint32_t newest_index = kInvalidIndex;
+        bool     newest_tagged{};
+        uint32_t pages        = 0;
+        uint32_t untagged     = 0;
+        for (uint32_t page = 0; page < m_page_count; ++page)
         {
-            uint32_t address = m_flash.get_page_address(page);
-            m_flash.read(address, reinterpret_cast<uint8_t*>(&header), sizeof(header));            
+            const Header header = read_header(page);
             if (header.index == kInvalidIndex) continue;
+            const bool tagged = (header.format == kFormat);
+            ++pages;
+            if (!tagged) ++untagged;
             if ((oldest_index == kInvalidIndex) || (header.index < oldest_index))
             {
                 oldest_index = header.index;
                 oldest_page  = page; 
             }
+            if ((newest_index == kInvalidIndex) || (header.index > newest_index))
+            {
+                newest_index  = header.index;
+                newest_page   = page; 
+                newest_tagged = tagged;
+            }
         }
-        return oldest_page;
-    }
 
-    uint32_t get_newest_page() const 
-    {
-        uint32_t newest_page  = kInvalidPage;
-        uint32_t newest_index = kInvalidIndex;
+        // Pages in the old format are always older than those in the current format. So if the 
+        // newest page is untagged but others are not, a reset tore its header as the page was 
+        // started. It holds no records, so it is left out of the log, and is erased when the log 
+        // next moves on. The rest of the untagged pages are in the old format.
+        if (!newest_tagged && (untagged < pages))
+        {
+            newest_page  = (newest_page + m_page_count - 1) % m_page_count;
+            newest_index = read_page_index(newest_page);
+            --untagged;
+        }
 
-        Header   header;
-        uint32_t page_count = m_flash.get_page_count();
-        for (uint32_t page = 0; page < page_count; ++page)
+        Result result = Result::eOK;
+        if (newest_page == kInvalidPage)
         {
-            uint32_t address = m_flash.get_page_address(page);
-            m_flash.read(address, reinterpret_cast<uint8_t*>(&header), sizeof(header));            
-            if (header.index == kInvalidIndex) continue;
-            if ((newest_index == kInvalidIndex) || (header.index > newest_index))
+            // The flash is completely empty, so create a header in the first page.
+            m_current_page  = 0;
+            m_current_count = 0;
+            m_current_index = 0;
+            m_oldest_page   = 0;
+            m_oldest_index  = 0;
+            m_record_count  = 0;
+            m_short_pages   = 0;
+
+            Header header{};
+            header.index = 0;
+            uint32_t address = m_flash.get_page_address(m_current_page);
+            result = m_flash.write(address, reinterpret_cast<const uint8_t*>(&header), sizeof(Header));
+            m_current_closed = (result != Result::eOK);
+        }
+        else 
+        {
+            // There is at least one page with records in it (at least a header). 
+            m_current_page  = newest_page;
+            m_current_index = newest_index;
+            m_oldest_page   = oldest_page;
+            m_oldest_index  = oldest_index;
+            m_legacy_pages  = untagged;
+
+            // The committed records in each page are a run from the first slot. Those before the 
+            // newest page are nearly always full, which needs only a check of the last marker. 
+            m_record_count = 0;
+            m_short_pages  = 0;
+            for (uint32_t page = m_oldest_page; page != m_current_page; page = (page + 1) % m_page_count)
+            {
+                const uint32_t count = count_committed(page);
+                m_record_count += count;
+                if (is_short(page, count)) ++m_short_pages;
+            }
+            m_current_count = count_committed(m_current_page);
+            m_record_count += m_current_count;
+
+            // Because the flash is programmed in address order, a torn record has its start programmed 
+            // and its end blank, and no marker. We must not program over it, so if the slot after the 
+            // committed records is not blank, the page is closed and the next append starts a new one.
+            // This normally costs only the reads of that one slot. A page in the old format is always 
+            // closed.
+            if (is_legacy_page(m_current_page))
             {
-                newest_index = header.index;
-                newest_page  = page; 
+                m_current_closed = true;
             }
+            else if (m_current_count < m_records_per_page)
+            {
+                uint32_t page_address = m_flash.get_page_address(m_current_page);
+                m_current_closed = !is_blank(page_address + slot_offset(m_current_count), sizeof(Record)) ||
+                                   !is_blank(page_address + marker_offset(m_current_count), kWriteSize);
+            }
+
+            // When the current page is full or closed, do nothing now, but when it is time to write a record, 
+            // we will advance to the next page and start writing in it (that page may need to be erased before 
+            // writing the header).
         }
-        return newest_page;
+
+        erase_next_page();
+        return result; 
     }
 
-    uint32_t get_record_count() const
+    // The current page is full. Move on to the next, erasing it first if it holds the oldest data. 
+    Result start_next_page()
     {
-        // TODO_AC This assumes we have pages all the same size. Reasonable in context.
-        const uint32_t kRecordsPerPage = get_records_per_page();
+        if (m_erase_pending) return Result::eBusy;
+
+        // If the next page holds the oldest records, they are discarded when it is erased.
+        const uint32_t next_page = (m_current_page + 1) % m_page_count;
+        const uint32_t discarded = (next_page == m_oldest_page) ? get_page_record_count(next_page) : 0U;
+        // After a page in the old format, which has more slots, the index of the next page skips 
+        // ahead far enough that the sequence numbers still increase.
+        const bool     legacy    = is_legacy_page(m_current_page);
+        const uint64_t sequence  = get_page_sequence(m_current_page) + get_page_slots(m_current_page);
+
+        // Test whether we need to erase the page. That is, if it already contains data. A reset 
+        // part way through an erase can leave the header erased but not the rest of the page, so 
+        // check all of it. This stops at the first programmed chunk, so is only costly for a page 
+        // which really is blank. That cost is not paid twice: a page already found to be blank, or 
+        // erased in the background, is not checked again.
+        uint32_t page_address = m_flash.get_page_address(next_page);
+        if ((next_page != m_blank_page) && !is_blank(page_address, m_page_size))
+        {
+            Result result = m_flash.erase_address(page_address);
+            if (result != Result::eOK) return result;
+        }
+        m_blank_page = kInvalidPage;
 
-        // We can work this out from the oldest page, current page and current offset.
-        uint32_t result = 0;
-        uint32_t page   = get_oldest_page();
-        while (page != m_current_page)
+        // The page we are leaving counts as short if it was closed early. 
+        if (is_short(m_current_page, m_current_count)) ++m_short_pages;
+        if (next_page == m_oldest_page)
+        {
+            m_record_count -= discarded;
+            discard_oldest_page(discarded);
+        }
+
+        // Advance to the next page. This may wrap around to the zeroth page.
+        // The index of the next page follows on from the current page.
+        m_current_page   = next_page;
+        m_current_count  = 0;
+        m_current_index  = legacy ? static_cast<uint32_t>((sequence + m_records_per_page - 1) / m_records_per_page) 
+                                  : (m_current_index + 1);
+        m_current_closed = false;
+
+        // Now write the page header. 
+        Header header;
+        header.index = m_current_index;
+        Result result = m_flash.write(page_address, reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+        m_current_closed = (result != Result::eOK);
+
+        // If we just overwrote the oldest page, the oldest data is now in the page after it.
+        // With a single page, that is the page we just started.
+        if (m_current_page == m_oldest_page)
         {
-            result += kRecordsPerPage;
-            page = (page + 1) % m_flash.get_page_count(); 
+            m_oldest_page  = (m_current_page + 1) % m_page_count;
+            m_oldest_index = read_page_index(m_oldest_page);
         }
 
-        result += (m_current_offset - sizeof(Header)) / sizeof(Record);
+        erase_next_page();
         return result;
     }
 
-private:
-    Result initialise() 
+    // Program records into the current page, and then their markers. The markers are written in 
+    // batches from a constant buffer. A failure closes the page, as a torn record does.
+    Result program(const Record* records, uint32_t count)
     {
-        // Better to make these static assertions but we would have to template IFlashMemory 
-        // Perhaps that's a good idea since we don't really need dynamic polymorphism.
-        // Assert that kWriteSize matches m_flash.get_write_size().
-        // Assert that (sizeof(Record) - sizeof(Header)) <= m_flash.get_page_size().
-
-        //uint32_t oldest_page = get_oldest_page();
-        uint32_t newest_page = get_newest_page();
-        // uint32_t oldest_page = kInvalidPage;
-        // uint32_t newest_page = kInvalidPage;
-        // Header   header;
-        // uint32_t page_count = m_flash.get_page_count();
-        // for (uint32_t page = 0; page < page_count; ++page)
-        // {
-        //     uint32_t address = m_flash.get_page_address(page);
-        //     m_flash.read(address, reinterpret_cast<uint8_t*>(&header), sizeof(header));            
-        //     if (header.index == kInvalidIndex) continue;
-        //     oldest_page = ((oldest_page == kInvalidPage) || (oldest_page > page)) ? page : oldest_page; 
-        //     newest_page = ((newest_page == kInvalidPage) || (newest_page < page)) ? page : newest_page; 
-        // }
+        uint32_t page_address = m_flash.get_page_address(m_current_page);
+        Result result = m_flash.write(page_address + slot_offset(m_current_count), 
+            reinterpret_cast<const uint8_t*>(records), count * sizeof(Record)); 
+        for (uint32_t done = 0; (result == Result::eOK) && (done < count); )
+        {
+            const uint32_t batch = std::min(count - done, kMarkerBatch);
+            result = m_flash.write(page_address + marker_offset(m_current_count), &kMarkers[0], batch * kWriteSize); 
+            if (result == Result::eOK)
+            {
+                m_current_count += batch;
+                m_record_count  += batch;
+                done            += batch;
+            }
+        }
+        m_current_closed = (result != Result::eOK);
+        return result;
+    }
 
-        if (newest_page == kInvalidPage)
+    // With background erasing, make sure that the page after the current one is blank by the time 
+    // it is needed. If it holds the oldest records, they are discarded now. This needs at least two 
+    // pages, as the current page can't be erased.
+    void erase_next_page()
+    {
+        if ((m_eraser == nullptr) || (m_page_count < 2)) return;
+
+        const uint32_t next_page = (m_current_page + 1) % m_page_count;
+        if (next_page == m_blank_page) return;
+        if (is_blank(m_flash.get_page_address(next_page), m_page_size))
         {
-            // The flash is completely empty, so create a header in the first page.
-            // m_current_offset is set to the write location of the next (i.e. first) log record.  
-            m_current_page   = 0;
-            m_current_offset = sizeof(Header);
+            m_blank_page = next_page;
+            return;
+        }
 
-            Header header{};
-            header.index = 0;
-            uint32_t address = m_flash.get_page_address(m_current_page);
-            //std::cout << "header " << std::hex << header.index << std::endl;
-            m_flash.write(address, reinterpret_cast<const uint8_t*>(&header), sizeof(Header));
+        if (next_page == m_oldest_page)
+        {
+            const uint32_t discarded = get_page_record_count(next_page);
+            m_record_count -= discarded;
+            discard_oldest_page(discarded);
+            m_oldest_page  = (next_page + 1) % m_page_count;
+            m_oldest_index = read_page_index(m_oldest_page);
         }
-        else 
+
+        // The completion may be signalled before EraseSector() returns. 
+        m_erase_pending = true;
+        m_erase_page    = next_page;
+        if (m_eraser->EraseSector(next_page) != FlashOperationStatus::Success)
         {
-            // There is at least one page with records in it (at least a header). 
-            m_current_page   = newest_page;
-            m_current_offset = sizeof(Header);
+            // Could not start the erase (e.g. the flash is busy with something else). Fall back 
+            // to erasing synchronously when the page is needed.
+            m_erase_pending = false;
+        }
+    }
 
-            // Walk the page to find the place where the next log record would be written. 
-            uint32_t page_size    = m_flash.get_page_size(m_current_page);
-            uint32_t page_address = m_flash.get_page_address(m_current_page);
-            while (m_current_offset < page_size)
+    void on_operation_complete(const OperationCompletion_t& completion)
+    {
+        if (m_erase_pending && (completion.Op == Operation::Erase) && (completion.SectorNumber == m_erase_page))
+        {
+            // If the erase failed, or was aborted by another client of the flash, start_next_page() 
+            // will check the page and erase it synchronously.
+            m_erase_pending = false;
+            if (completion.Status == FlashOperationStatus::Success)
             {
-                constexpr uint32_t kWords = kWriteSize / sizeof(uint32_t);
-                
-                // We don't need to read the whole record, but just want to check whether a record 
-                // is present. Reading one chunk of kWriteSize should be sufficient.
-                uint32_t buffer[kWords];
-                m_flash.read(page_address + m_current_offset, reinterpret_cast<uint8_t*>(&buffer[0]), kWriteSize);
-                uint32_t test = kUnusedWord; 
-                for (uint32_t w = 0; w < kWords; ++w)
-                    test &= buffer[w];
-                if (test == kUnusedWord)
-                    break;           
-
-                // Advance to the next record.
-                m_current_offset += sizeof(Record);
+                m_blank_page = m_erase_page;
             }
+        }
+    }
+
+    static constexpr uint32_t slot_offset(uint32_t slot)
+    {
+        return sizeof(Header) + slot * sizeof(Record);
+    }
 
-            // At this point m_current_offset points to the byte after the end of the last record. This could 
-            // be the first byte of the next page, or it could be too close to the end of the page to fit another 
-            // record in (same thing). In this case, do nothing now, but when it is time to write a record, we will
-            // advance to the next page and start writing in it (that page may need to be erased before writing the 
-            // header).
+    // The markers follow the last record slot.
+    uint32_t marker_offset(uint32_t slot) const
+    {
+        return slot_offset(m_records_per_page) + slot * kWriteSize;
+    }
+
+    // Is the flash erased over the given range? Reads one kWriteSize chunk at a time, so stops 
+    // early at the first programmed chunk.
+    bool is_blank(uint32_t address, uint32_t size) const
+    {
+        constexpr uint32_t kWords = kWriteSize / sizeof(uint32_t);
+        for (uint32_t offset = 0; offset < size; offset += kWriteSize)
+        {
+            uint32_t buffer[kWords];
+            m_flash.read(address + offset, reinterpret_cast<uint8_t*>(&buffer[0]), kWriteSize);
+            uint32_t test = kUnusedWord; 
+            for (uint32_t w = 0; w < kWords; ++w)
+                test &= buffer[w];
+            if (test != kUnusedWord)
+                return false;
+        }
+        return true;
+    }
+
+    bool is_committed(uint32_t page, uint32_t slot) const
+    {
+        constexpr uint32_t kWords = kWriteSize / sizeof(uint32_t);
+        uint32_t buffer[kWords];
+        m_flash.read(page, marker_offset(slot), reinterpret_cast<uint8_t*>(&buffer[0]), kWriteSize);
+        for (uint32_t w = 0; w < kWords; ++w)
+            if (buffer[w] != kCommitWord) return false;
+        return true;
+    }
+
+    // The number of committed records in a page, read from the flash. The markers are written in 
+    // order, so we can binary search for the first which is not complete. We don't need to read 
+    // the records themselves. A page in the old format has no markers, so the search is over the
+    // first chunk of each record instead.
+    uint32_t count_committed(uint32_t page) const
+    {
+        if (is_legacy_page(page))
+        {
+            const uint32_t page_address = m_flash.get_page_address(page);
+            return count_run(m_legacy_per_page, [&](uint32_t slot) 
+                { return !is_blank(page_address + slot_offset(slot), kWriteSize); });
+        }
+        return count_run(m_records_per_page, [&](uint32_t slot) { return is_committed(page, slot); });
+    }
+
+    // The length of the run of slots from the first for which the predicate holds. The last slot 
+    // is checked first, as pages are nearly always full.
+    template <typename Predicate>
+    static uint32_t count_run(uint32_t slots, Predicate used)
+    {
+        if (used(slots - 1)) return slots;
+
+        uint32_t lower = 0;
+        uint32_t upper = slots - 1;
+        while (lower < upper)
+        {
+            const uint32_t middle = lower + (upper - lower) / 2;
+            if (used(middle))
+                lower = middle + 1;
+            else
+                upper = middle;
+        }
+        return lower;
+    }
+
+    // Pages in the old format are only ever at the oldest end of the log.
+    bool is_legacy_page(uint32_t page) const
+    {
+        return ((page + m_page_count - m_oldest_page) % m_page_count) < m_legacy_pages;
+    }
+
+    // The number of record slots in a page of the log.
+    uint32_t get_page_slots(uint32_t page) const
+    {
+        return is_legacy_page(page) ? m_legacy_per_page : m_records_per_page;
+    }
+
+    // Whether a page before the current one stops locate() assuming it is full. 
+    bool is_short(uint32_t page, uint32_t count) const
+    {
+        return (count != m_records_per_page) || is_legacy_page(page);
+    }
+
+    // Update the counts for the oldest page being discarded, before m_oldest_page moves on.
+    void discard_oldest_page(uint32_t discarded)
+    {
+        if (is_short(m_oldest_page, discarded)) --m_short_pages;
+        if (m_legacy_pages > 0) --m_legacy_pages;
+    }
+
+    // The number of records in a page of the log. Only short pages need to be read.
+    uint32_t get_page_record_count(uint32_t page) const
+    {
+        if (page == m_current_page) return m_current_count;
+        if (m_short_pages == 0)     return m_records_per_page;
+        return count_committed(page);
+    }
+
+    // The sequence number of the first slot in a page of the log. The page indices are consecutive 
+    // apart from the skip after the last page in the old format.
+    uint64_t get_page_sequence(uint32_t page) const
+    {
+        if (is_legacy_page(page))
+        {
+            const uint32_t pages = (page + m_page_count - m_oldest_page) % m_page_count;
+            return (uint64_t{m_oldest_index} + pages) * m_legacy_per_page;
+        }
+        const uint32_t pages = (m_current_page + m_page_count - page) % m_page_count;
+        return (uint64_t{m_current_index} - pages) * m_records_per_page;
+    }
+
+    Header read_header(uint32_t page) const
+    {
+        Header header;
+        m_flash.read(m_flash.get_page_address(page), reinterpret_cast<uint8_t*>(&header), sizeof(header));            
+        return header;
+    }
+
+    uint32_t read_page_index(uint32_t page) const
+    {
+        return read_header(page).index;
+    }
+
+    // Find the page and slot of the record with the given index, counting from the oldest. Unless
+    // there are short pages, every page before the current one is full. An index past the newest 
+    // record gives the next slot to be written.
+    void locate(uint32_t index, uint32_t& page, uint32_t& slot) const
+    {
+        if (m_short_pages == 0)
+        {
+            page = (m_oldest_page + index / m_records_per_page) % m_page_count;
+            slot = index % m_records_per_page;
+            return;
+        }
+
+        page = m_oldest_page;
+        while (page != m_current_page)
+        {
+            const uint32_t count = get_page_record_count(page);
+            if (index < count) break;
+            index -= count;
+            page   = (page + 1) % m_page_count;
         }
-        return Result::eOK; 
+        slot = index;
     }
 
 private:
-    IFlashMemory& m_flash;
+    static constexpr uint8_t kMarkers[kMarkerBatch * kWriteSize]{};
+    static_assert(kCommitWord == 0, "kMarkers is zero filled");
+
+    IFlashMemory&  m_flash;
+    IFlashStorage* m_eraser{};
+    bool           m_erase_pending{};
+    uint32_t       m_erase_page{kInvalidPage};
+    // A page which is known to be blank, so need not be checked again before it is started.
+    uint32_t       m_blank_page{kInvalidPage};
     uint32_t m_current_page{kInvalidPage};
-    uint32_t m_current_offset{kInvalidOffset};
+    // The number of committed records in the current page.
+    uint32_t m_current_count{};
+    // Set when the current page can't be written any further, after a torn record or failed write.
+    bool     m_current_closed{};
+    // The header index of the current page. Each new page has the next index.
+    uint32_t m_current_index{kInvalidIndex};
+    uint32_t m_oldest_page{kInvalidPage};
+    uint32_t m_oldest_index{kInvalidIndex};
+    uint32_t m_record_count{};
+    // The number of pages before the current one which hold fewer than m_records_per_page records,
+    // or are in the old format.
+    uint32_t m_short_pages{};
+    // The number of pages in the old format, starting from the oldest.
+    uint32_t m_legacy_pages{};
+    // Cached geometry.
+    uint32_t m_page_count{};
+    uint32_t m_page_size{};
+    uint32_t m_records_per_page{};
+    uint32_t m_legacy_per_page{};
 };
 
 
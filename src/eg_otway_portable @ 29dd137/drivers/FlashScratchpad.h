@@ -6,11 +6,17 @@
 #include "signals/Signal.h"
 #include "utilities/CRC.h"
 #include "utilities/ErrorHandler.h"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
 
 namespace eg
 {
     constexpr uint32_t kBlankNumber = 0xFFFFFFFF;
 	constexpr uint32_t kMagicNumber = 0xA55AA55A;
+	constexpr uint32_t kDeltaMagicNumber = 0xA55A5AA5;
 
 	// Flash page
 	struct Page_t
@@ -20,7 +26,12 @@ namespace eg
 	};
 	    
 
-    template <typename DATA_STRUCTURE>
+    // With DELTA_UPDATES, an update which changes only part of the data appends a delta record holding 
+    // just the changed 16-byte chunks, rather than a whole new copy. The current data is then kept in RAM,
+    // and rebuilt at start up by replaying the latest full copy and the deltas which follow it. A full 
+    // copy is still written when a delta would be no smaller, and as the first record after a page swap.
+    // Small changes to a large structure fill the pages more slowly, so they are erased less often.
+    template <typename DATA_STRUCTURE, bool DELTA_UPDATES = false>
     class FlashScratchpad
     {
       public:        
@@ -68,7 +79,7 @@ namespace eg
 	            crc = crc_calc.calculate(reinterpret_cast<const uint8_t*>(this), sizeof(DataContainer_t) - sizeof(uint32_t));
             }
 
-	        uint32_t ComputeCrc()
+	        uint32_t ComputeCrc() const
 	        {
 		        CRC32 crc_calc;
 		        return crc_calc.calculate(reinterpret_cast<const uint8_t*>(this), sizeof(DataContainer_t) - sizeof(uint32_t));
@@ -89,6 +100,43 @@ namespace eg
 	    // Structure padding etc should take care of this
 	    static_assert((sizeof(DataContainer_t) & 15u) == 0u);
 
+	    // Delta records divide the data into chunks, and hold only those which changed. 
+	    static constexpr uint32_t kChunkSize  = 16u;
+	    static constexpr uint32_t kChunkCount = (sizeof(DATA_STRUCTURE) + kChunkSize - 1u) / kChunkSize;
+	    static constexpr uint32_t kMaskWords  = (kChunkCount + 31u) / 32u;
+
+	    // Header of a delta record: 16 bytes for data of up to 512 bytes. The mask has a bit set for each 
+	    // changed chunk. Those chunks follow the header in index order, the last one padded with 0xFF if the 
+	    // data is not a whole number of chunks. The CRC covers the whole record except itself.
+	    struct DeltaHeader_t
+	    {
+		    uint32_t magic;
+		    uint32_t counter;
+		    uint32_t crc;
+		    uint32_t chunkMask[kMaskWords];
+
+		    uint32_t ChunkCount() const
+		    {
+			    uint32_t count = 0u;
+			    for (uint32_t word : chunkMask)
+			    {
+				    count += std::popcount(word);
+			    }
+			    return count;
+		    }
+	    } __attribute__((aligned(16)));
+
+	    static_assert((sizeof(DeltaHeader_t) & 15u) == 0u);
+
+	    // The result of replaying the records in a page.
+	    struct PageScan_t
+	    {
+		    bool     valid;          // Found a good full copy of the data
+		    bool     blank;
+		    uint32_t counter;        // Of the last good record
+		    uint32_t writeOffset;    // For the next record. The sector size if the page cannot take any more.
+	    };
+
         eg::IFlashStorage &mFlashStorage;
 
         eg::Signal<FlashOperationStatus> mOnDataRead;
@@ -105,6 +153,12 @@ namespace eg
 	    bool			mValidData;
 	    
 	    const size_t    mDataContainerSize = sizeof(DataContainer_t);
+
+	    // Only used with DELTA_UPDATES, in place of mCurrentDataContainer.
+	    struct Empty_t {};
+	    [[no_unique_address]] std::conditional_t<DELTA_UPDATES, DATA_STRUCTURE, Empty_t> mData;
+	    uint32_t        mCounter;
+	    uint32_t        mWriteOffset;
 	    	    
 	    
         [[nodiscard]] Page_t ConstructPageInfo(uint32_t pageNumber);
@@ -115,13 +169,27 @@ namespace eg
 	    Page_t *FindLatestPage();
 	    DataContainer_t *FindLatestDataContainer(Page_t &page);	    
 	    uint32_t RoundUpToPowerOf2(uint32_t i);	    
+
+	    void RestoreFromRecords(const DATA_STRUCTURE &defaults);
+	    PageScan_t ScanPage(const Page_t &page, DATA_STRUCTURE *pData);
+	    void UpdateDataWithDelta(const DATA_STRUCTURE &dataStructure);
+	    uint32_t BuildDeltaRecord(const DATA_STRUCTURE &dataStructure, uint8_t *pRecord);
+	    static void ApplyDeltaRecord(const DeltaHeader_t &header, DATA_STRUCTURE &data);
+	    static uint32_t ComputeDeltaCrc(const uint8_t *pRecord, uint32_t size);
     };
 
-    template <typename DATA_STRUCTURE>
-    FlashScratchpad<DATA_STRUCTURE>::FlashScratchpad(eg::IFlashStorage &flashStorage, uint32_t pageOneOffset, uint32_t pageTwoOffset, const DATA_STRUCTURE &defaults)
-        : mFlashStorage(flashStorage), mPageOne(ConstructPageInfo(pageOneOffset)), mPageTwo(ConstructPageInfo(pageTwoOffset)), mValidData(false)
+    template <typename DATA_STRUCTURE, bool DELTA_UPDATES>
+    FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::FlashScratchpad(eg::IFlashStorage &flashStorage, uint32_t pageOneOffset, uint32_t pageTwoOffset, const DATA_STRUCTURE &defaults)
+        : mFlashStorage(flashStorage), mPageOne(ConstructPageInfo(pageOneOffset)), mPageTwo(ConstructPageInfo(pageTwoOffset)), 
+          mCurrentPage(&mPageOne), mCurrentDataContainer(nullptr), mValidData(false), mData{}, mCounter(0u), mWriteOffset(0u)
     {
-	    mFlashStorage.OnFlashOperationComplete().connect<&FlashScratchpad<DATA_STRUCTURE>::OnFlashOperationComplete>(this);
+	    mFlashStorage.OnFlashOperationComplete().connect<&FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::OnFlashOperationComplete>(this);
+
+	    if constexpr (DELTA_UPDATES)
+	    {
+		    RestoreFromRecords(defaults);
+		    return;
+	    }
 	    
 	    // data is stored in two "banks" of flash. First workout which is the active bank, then search in the bank for the latest data
 	    // Or, if none, reset to defaults
@@ -194,8 +262,8 @@ namespace eg
     }
 
 
-	template <typename DATA_STRUCTURE>
-	bool FlashScratchpad<DATA_STRUCTURE>::IsNextStructEmpty(const DataContainer_t &dC)
+	template <typename DATA_STRUCTURE, bool DELTA_UPDATES>
+	bool FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::IsNextStructEmpty(const DataContainer_t &dC)
     {	    
 	    bool isBlank = true;
 	    
@@ -211,8 +279,8 @@ namespace eg
         return isBlank;
     }
 
-    template <typename DATA_STRUCTURE>
-    Page_t *FlashScratchpad<DATA_STRUCTURE>::FindLatestPage()
+    template <typename DATA_STRUCTURE, bool DELTA_UPDATES>
+    Page_t *FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::FindLatestPage()
     {
 	    DataContainer_t *pDC1 = static_cast<DataContainer_t *>(mFlashStorage.GetSectorStartAddress(mPageOne.pageNumber));
 	    DataContainer_t *pDC2 = static_cast<DataContainer_t *>(mFlashStorage.GetSectorStartAddress(mPageTwo.pageNumber));
@@ -234,8 +302,8 @@ namespace eg
 	    return pPage;
     }
 
-	template <typename DATA_STRUCTURE>
-	uint32_t FlashScratchpad<DATA_STRUCTURE>::RoundUpToPowerOf2(uint32_t i)
+	template <typename DATA_STRUCTURE, bool DELTA_UPDATES>
+	uint32_t FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::RoundUpToPowerOf2(uint32_t i)
 	{			
 		if (i == 0u) {
 			return 1u;
@@ -251,8 +319,8 @@ namespace eg
 		return i + 1u;
 	}
 	
-	template <typename DATA_STRUCTURE>
-	FlashScratchpad<DATA_STRUCTURE>::DataContainer_t *FlashScratchpad<DATA_STRUCTURE>::FindLatestDataContainer(Page_t &page)
+	template <typename DATA_STRUCTURE, bool DELTA_UPDATES>
+	FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::DataContainer_t *FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::FindLatestDataContainer(Page_t &page)
 	{
 		// binary search for most recent data which is always at the end of the written data
 		DataContainer_t *pDC        = reinterpret_cast<DataContainer_t *>(page.pageStartAddr);
@@ -283,9 +351,15 @@ namespace eg
      * @params Data to overwrite that stored in flash with
      */
 
-    template <typename DATA_STRUCTURE>
-    void FlashScratchpad<DATA_STRUCTURE>::UpdateData(const DATA_STRUCTURE &dataStructure)
+    template <typename DATA_STRUCTURE, bool DELTA_UPDATES>
+    void FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::UpdateData(const DATA_STRUCTURE &dataStructure)
     {	    
+	    if constexpr (DELTA_UPDATES)
+	    {
+		    UpdateDataWithDelta(dataStructure);
+		    return;
+	    }
+
 	    if (0 != memcmp(reinterpret_cast<const void *>(&mCurrentDataContainer->data), reinterpret_cast<const void *>(&dataStructure), sizeof(DATA_STRUCTURE)))
 	    {	    
 		    uint32_t nextWriteOffset = reinterpret_cast<uint8_t *>(mCurrentDataContainer + 1) - mCurrentPage->pageStartAddr;
@@ -327,22 +401,27 @@ namespace eg
      * @brief Retrieve the latest saved copy of the data
      * @params a reference to the data structure where the read data should be put
      */
-    template <typename DATA_STRUCTURE>
-    const DATA_STRUCTURE &FlashScratchpad<DATA_STRUCTURE>::GetData(void)
+    template <typename DATA_STRUCTURE, bool DELTA_UPDATES>
+    const DATA_STRUCTURE &FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::GetData(void)
     {
 	    EG_ASSERT(mValidData, "No valid data available in the flash");
+
+	    if constexpr (DELTA_UPDATES)
+	    {
+		    return mData;
+	    }
 	    
 		return mCurrentDataContainer->data;
     }
 
-    template <typename DATA_STRUCTURE>
-    Page_t FlashScratchpad<DATA_STRUCTURE>::ConstructPageInfo(uint32_t pageNumber)
+    template <typename DATA_STRUCTURE, bool DELTA_UPDATES>
+    Page_t FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::ConstructPageInfo(uint32_t pageNumber)
     {	    
         return Page_t{pageNumber, mFlashStorage.GetSectorStartAddress(pageNumber)};
     }
 
-    template <typename DATA_STRUCTURE>
-    void FlashScratchpad<DATA_STRUCTURE>::OnFlashOperationComplete(const OperationCompletion_t& operation)
+    template <typename DATA_STRUCTURE, bool DELTA_UPDATES>
+    void FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::OnFlashOperationComplete(const OperationCompletion_t& operation)
     {
         if (operation.SectorNumber == mCurrentPage->pageNumber)
         {
@@ -360,7 +439,8 @@ namespace eg
                 break;
 	            
             case Operation::Read:
-	            if (mCurrentDataContainer->crc == mCurrentDataContainer->ComputeCrc())
+	            // Delta mode checked the records when it rebuilt the data
+	            if (DELTA_UPDATES || (mCurrentDataContainer->crc == mCurrentDataContainer->ComputeCrc()))
 	            {
 		            mOnDataRead.emit(operation.Status);		            
 	            }
@@ -375,6 +455,261 @@ namespace eg
             }
         }
     }
+
+    /**
+     * @brief Delta mode start up. Rebuild the data from the page holding the most recent good record, erasing 
+     *        the other page if an earlier page swap did not finish. If neither page holds good data, write the 
+     *        defaults.
+     */
+    template <typename DATA_STRUCTURE, bool DELTA_UPDATES>
+    void FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::RestoreFromRecords(const DATA_STRUCTURE &defaults)
+    {
+	    PageScan_t scanOne = ScanPage(mPageOne, nullptr);
+	    PageScan_t scanTwo = ScanPage(mPageTwo, nullptr);
+
+	    if (scanOne.valid || scanTwo.valid)
+	    {
+		    bool usePageOne = scanOne.valid && (!scanTwo.valid || (scanOne.counter > scanTwo.counter));
+		    mCurrentPage    = usePageOne ? &mPageOne : &mPageTwo;
+
+		    PageScan_t scan = ScanPage(*mCurrentPage, &mData);
+		    mCounter        = scan.counter;
+		    mWriteOffset    = scan.writeOffset;
+
+		    if (!(usePageOne ? scanTwo.blank : scanOne.blank))
+		    {
+			    Page_t &otherPage = usePageOne ? mPageTwo : mPageOne;
+			    mFlashStorage.EraseSector(otherPage.pageNumber);
+		    }
+	    }
+	    else
+	    {
+		    // Prefer a blank page for the defaults. Otherwise both pages hold something we cannot use.
+		    mCurrentPage = (scanOne.blank || !scanTwo.blank) ? &mPageOne : &mPageTwo;
+		    Page_t &otherPage = (mCurrentPage == &mPageOne) ? mPageTwo : mPageOne;
+		    if (!(scanOne.blank || scanTwo.blank))
+		    {
+			    mFlashStorage.Abort();
+			    mFlashStorage.EraseSector(mCurrentPage->pageNumber);
+			    mFlashStorage.CheckAndClearStatus();
+		    }
+
+		    DataContainer_t writeBuffer(defaults);
+		    writeBuffer.counter = 0u;
+		    writeBuffer.crc     = writeBuffer.ComputeCrc();
+		    mFlashStorage.Write(mCurrentPage->pageNumber, 0u, reinterpret_cast<uint8_t *>(&writeBuffer), sizeof(DataContainer_t));
+		    if (FlashOperationStatus::Success != mFlashStorage.CheckAndClearStatus())
+		    {
+			    // See the note about the reset in the constructor
+			    Error_Handler(); // LCOV_EXCL_LINE
+		    }
+
+		    if (!((mCurrentPage == &mPageOne) ? scanTwo.blank : scanOne.blank))
+		    {
+			    mFlashStorage.EraseSector(otherPage.pageNumber);
+		    }
+
+		    memcpy(&mData, &defaults, sizeof(DATA_STRUCTURE));
+		    mCounter     = 0u;
+		    mWriteOffset = sizeof(DataContainer_t);
+	    }
+
+	    mValidData = true;
+    }
+
+    /**
+     * @brief Delta mode. Replay the records in a page in order, applying each good one to the data.
+     * @params The page to scan, and the data to apply the records to, or nullptr to just find the latest counter
+     *
+     * Replay stops at the first blank slot. It also stops at a record which is torn or otherwise corrupt, since 
+     * the length of anything after that cannot be trusted. The page is then treated as full, so that the next 
+     * update swaps pages and starts again with a full copy.
+     */
+    template <typename DATA_STRUCTURE, bool DELTA_UPDATES>
+    typename FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::PageScan_t FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::ScanPage(const Page_t &page, DATA_STRUCTURE *pData)
+    {
+	    const uint32_t sectorSize = mFlashStorage.GetSectorSize(0);
+	    const uint8_t *pPage      = page.pageStartAddr;
+	    PageScan_t     scan{false, false, 0u, sectorSize};
+
+	    // Records are all multiples of 16 bytes, so there is always room to read a magic number
+	    uint32_t offset = 0u;
+	    while (offset < sectorSize)
+	    {
+		    uint32_t magic;
+		    memcpy(&magic, pPage + offset, sizeof(magic));
+
+		    uint32_t recordSize = 0u;
+		    if (kMagicNumber == magic)
+		    {
+			    const DataContainer_t *pDC = reinterpret_cast<const DataContainer_t *>(pPage + offset);
+			    recordSize = sizeof(DataContainer_t);
+			    if ((recordSize > (sectorSize - offset)) || (pDC->crc != pDC->ComputeCrc()))
+			    {
+				    break;
+			    }
+
+			    if (nullptr != pData)
+			    {
+				    memcpy(pData, &pDC->data, sizeof(DATA_STRUCTURE));
+			    }
+			    scan.valid   = true;
+			    scan.counter = pDC->counter;
+		    }
+		    else if ((kDeltaMagicNumber == magic) && scan.valid)
+		    {
+			    const DeltaHeader_t *pHeader = reinterpret_cast<const DeltaHeader_t *>(pPage + offset);
+			    uint32_t chunkCount = pHeader->ChunkCount();
+			    if ((chunkCount > kChunkCount) || (pHeader->counter != (scan.counter + 1u)))
+			    {
+				    break;
+			    }
+
+			    recordSize = sizeof(DeltaHeader_t) + (chunkCount * kChunkSize);
+			    if ((recordSize > (sectorSize - offset)) || (pHeader->crc != ComputeDeltaCrc(pPage + offset, recordSize)))
+			    {
+				    break;
+			    }
+
+			    if (nullptr != pData)
+			    {
+				    ApplyDeltaRecord(*pHeader, *pData);
+			    }
+			    scan.counter = pHeader->counter;
+		    }
+		    else
+		    {
+			    // Only write to the rest of the page if it is all erased. A reset part way through erasing
+			    // the page can leave the start blank and old records after it.
+			    if ((kBlankNumber == magic) && std::all_of(pPage + offset, pPage + sectorSize, [](uint8_t b) { return 0xFF == b; }))
+			    {
+				    scan.blank       = (0u == offset);
+				    scan.writeOffset = offset;
+			    }
+			    break;
+		    }
+
+		    offset += recordSize;
+	    }
+
+	    return scan;
+    }
+
+    template <typename DATA_STRUCTURE, bool DELTA_UPDATES>
+    void FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::UpdateDataWithDelta(const DATA_STRUCTURE &dataStructure)
+    {
+	    if (0 == memcmp(reinterpret_cast<const void *>(&mData), reinterpret_cast<const void *>(&dataStructure), sizeof(DATA_STRUCTURE)))
+	    {
+		    // data is the same so no need to write anything
+		    return;
+	    }
+
+	    // A delta is only used if it is smaller than a full copy, so this is big enough for either
+	    alignas(16) uint8_t record[sizeof(DataContainer_t)];
+	    uint32_t recordSize = BuildDeltaRecord(dataStructure, record);
+	    const uint32_t sectorSize = mFlashStorage.GetSectorSize(0);
+
+	    if ((0u == recordSize) || (recordSize > (sectorSize - mWriteOffset)))
+	    {
+		    DataContainer_t writeBuffer(dataStructure);
+		    writeBuffer.counter = mCounter + 1u;
+		    writeBuffer.crc     = writeBuffer.ComputeCrc();
+		    memcpy(record, &writeBuffer, sizeof(DataContainer_t));
+		    recordSize = sizeof(DataContainer_t);
+	    }
+
+	    EG_ASSERT(0u == (mWriteOffset & (mFlashStorage.GetWriteSize() - 1u)), "Badly aligned write offset");
+
+	    if (recordSize <= (sectorSize - mWriteOffset))
+	    {
+		    mFlashStorage.Write(mCurrentPage->pageNumber, mWriteOffset, record, recordSize);
+		    mWriteOffset += recordSize;
+	    }
+	    else
+	    {
+		    // The page is full, so start the other one with a full copy. The record is already a full copy,
+		    // since a delta never needs more space than one. Then erase the old page, as in UpdateData().
+		    uint32_t oldPageNumber = mCurrentPage->pageNumber;
+		    mCurrentPage = (mCurrentPage->pageNumber == mPageOne.pageNumber) ? &mPageTwo : &mPageOne;
+		    mFlashStorage.Write(mCurrentPage->pageNumber, 0u, record, recordSize);
+		    mWriteOffset = recordSize;
+
+		    mFlashStorage.Abort();
+		    mFlashStorage.EraseSector(oldPageNumber);
+	    }
+
+	    memcpy(&mData, &dataStructure, sizeof(DATA_STRUCTURE));
+	    ++mCounter;
+    }
+
+    /**
+     * @brief Build a delta record holding the chunks which differ from the current data
+     * @returns The size of the record, or zero if it would be no smaller than a full copy of the data
+     */
+    template <typename DATA_STRUCTURE, bool DELTA_UPDATES>
+    uint32_t FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::BuildDeltaRecord(const DATA_STRUCTURE &dataStructure, uint8_t *pRecord)
+    {
+	    memset(pRecord, 0xff, sizeof(DataContainer_t));
+	    DeltaHeader_t *pHeader = reinterpret_cast<DeltaHeader_t *>(pRecord);
+	    pHeader->magic      = kDeltaMagicNumber;
+	    pHeader->counter    = mCounter + 1u;
+	    memset(pHeader->chunkMask, 0, sizeof(pHeader->chunkMask));
+
+	    const uint8_t *pOld   = reinterpret_cast<const uint8_t *>(&mData);
+	    const uint8_t *pNew   = reinterpret_cast<const uint8_t *>(&dataStructure);
+	    uint8_t       *pChunk = pRecord + sizeof(DeltaHeader_t);
+	    uint32_t       chunkCount = 0u;
+	    for (uint32_t chunk = 0u; chunk < kChunkCount; ++chunk)
+	    {
+		    uint32_t offset = chunk * kChunkSize;
+		    uint32_t length = ((sizeof(DATA_STRUCTURE) - offset) < kChunkSize) ? (sizeof(DATA_STRUCTURE) - offset) : kChunkSize;
+		    if (0 != memcmp(pOld + offset, pNew + offset, length))
+		    {
+			    if ((sizeof(DeltaHeader_t) + ((chunkCount + 1u) * kChunkSize)) >= sizeof(DataContainer_t))
+			    {
+				    return 0u;
+			    }
+
+			    memcpy(pChunk, pNew + offset, length);
+			    pChunk += kChunkSize;
+			    pHeader->chunkMask[chunk / 32u] |= (1u << (chunk % 32u));
+			    ++chunkCount;
+		    }
+	    }
+
+	    uint32_t recordSize = sizeof(DeltaHeader_t) + (chunkCount * kChunkSize);
+	    pHeader->crc = ComputeDeltaCrc(pRecord, recordSize);
+	    return recordSize;
+    }
+
+    template <typename DATA_STRUCTURE, bool DELTA_UPDATES>
+    void FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::ApplyDeltaRecord(const DeltaHeader_t &header, DATA_STRUCTURE &data)
+    {
+	    uint8_t       *pData  = reinterpret_cast<uint8_t *>(&data);
+	    const uint8_t *pChunk = reinterpret_cast<const uint8_t *>(&header) + sizeof(DeltaHeader_t);
+	    for (uint32_t chunk = 0u; chunk < kChunkCount; ++chunk)
+	    {
+		    if (0u != (header.chunkMask[chunk / 32u] & (1u << (chunk % 32u))))
+		    {
+			    uint32_t offset = chunk * kChunkSize;
+			    uint32_t length = ((sizeof(DATA_STRUCTURE) - offset) < kChunkSize) ? (sizeof(DATA_STRUCTURE) - offset) : kChunkSize;
+			    memcpy(pData + offset, pChunk, length);
+			    pChunk += kChunkSize;
+		    }
+	    }
+    }
+
+    template <typename DATA_STRUCTURE, bool DELTA_UPDATES>
+    uint32_t FlashScratchpad<DATA_STRUCTURE, DELTA_UPDATES>::ComputeDeltaCrc(const uint8_t *pRecord, uint32_t size)
+    {
+	    // Skip the CRC field itself
+	    constexpr uint32_t kCrcOffset = offsetof(DeltaHeader_t, crc);
+	    CRC32 crc_calc;
+	    crc_calc.reset();
+	    crc_calc.update(pRecord, kCrcOffset);
+	    crc_calc.update(pRecord + kCrcOffset + sizeof(uint32_t), size - kCrcOffset - sizeof(uint32_t));
+	    return crc_calc.finalise();
+    }
 }
 
 #endif
\ No newline at end of file
@@ -8,14 +8,13 @@
 //  express written permission of eg technology ltd.
 
 #include "FlashStorageBase.h"
+#include <algorithm>
 #include <cstring>
 
 namespace eg
 {
-    FlashStorageBase::FlashStorageBase() : mOperation(Operation::None)
+    FlashStorageBase::FlashStorageBase(uint32_t writeSize) : mWriteSize(writeSize), mOperation(Operation::None)
     {
-        ClearToIdleState();
-
         // TODO EG ASSERT
         // EG_ASSERT(mWriteBuffer != nullptr, "Buffer pointer passed in is null");
 
@@ -41,17 +40,38 @@ namespace eg
             }
         }
 
-        if (flashOperationStatus == FlashOperationStatus::Success)
+        // The data may run on into the following sectors, which must all be valid
+        uint32_t available = (flashOperationStatus == FlashOperationStatus::Success) ? (GetSectorSize(sectorNumber) - offsetInSector) : 0u;
+        while ((flashOperationStatus == FlashOperationStatus::Success) && (length > available))
         {
-            if (offsetInSector + length > GetSectorSize(sectorNumber))
+            length -= available;
+            ++sectorNumber;
+            if (!IsValidSector(sectorNumber))
             {
                 flashOperationStatus = FlashOperationStatus::InvalidLength;
             }
+            else
+            {
+                available = GetSectorSize(sectorNumber);
+            }
         }
 
         return flashOperationStatus;
     }
 
+    FlashOperationStatus FlashStorageBase::CheckWriteAlignment(uint32_t offsetInSector, uint32_t length)
+    {
+        if ((offsetInSector % mWriteSize) != 0u)
+        {
+            return FlashOperationStatus::InvalidOffset;
+        }
+        if ((length % mWriteSize) != 0u)
+        {
+            return FlashOperationStatus::InvalidLength;
+        }
+        return FlashOperationStatus::Success;
+    }
+
     FlashOperationStatus FlashStorageBase::EraseSector(uint32_t sectorNumber)
     {
         const auto checkFlashLocationResult = CheckFlashLocation(sectorNumber, 0, 0);
@@ -62,17 +82,10 @@ namespace eg
             mOnFlashOperationComplete.emit(OperationCompletion_t{checkFlashLocationResult, Operation::Erase, sectorNumber});
             mLastOperationStatus = checkFlashLocationResult;
         }
-        else if (mOperation != Operation::None)
-        {
-            // Notify the caller immediately of the error and return.
-            mOnFlashOperationComplete.emit(OperationCompletion_t{FlashOperationStatus::Busy, Operation::Erase, sectorNumber});
-            mLastOperationStatus = FlashOperationStatus::Busy;
-        }
         else
         {
-            mOperation = Operation::Erase;
-            mSectorNumber = sectorNumber;
-            mLastOperationStatus = OnEraseSector(sectorNumber);
+            const Request_t request{Operation::Erase, sectorNumber, 0u, nullptr, nullptr, 0u, false, true};
+            mLastOperationStatus = Enqueue(&request, 1u);
         }
 
         return mLastOperationStatus;
@@ -97,16 +110,10 @@ namespace eg
             // Notify the caller immediately of the error and return.
             mOnFlashOperationComplete.emit(OperationCompletion_t{FlashOperationStatus::DataBufferIsNull, Operation::Read, sectorNumber});
         }
-        else if (mOperation != Operation::None)
-        {
-            // Notify the caller immediately of the error and return.
-            mOnFlashOperationComplete.emit(OperationCompletion_t{FlashOperationStatus::Busy, Operation::Read, sectorNumber});
-        }
         else
         {
-            mOperation = Operation::Read;
-            mSectorNumber = sectorNumber;
-            return OnReadBytes(sectorNumber, offsetInSector, dataBuffer, lengthToRead);
+            const Request_t request{Operation::Read, sectorNumber, offsetInSector, dataBuffer, nullptr, lengthToRead, false, true};
+            return Enqueue(&request, 1u);
         }
 
         return FlashOperationStatus::None;
@@ -114,7 +121,11 @@ namespace eg
 
     FlashOperationStatus FlashStorageBase::Write(uint32_t sectorNumber, uint32_t offsetInSector, const uint8_t *dataBuffer, uint32_t lengthToWrite)
     {
-        const auto checkFlashLocationResult = CheckFlashLocation(sectorNumber, offsetInSector, lengthToWrite);
+        auto checkFlashLocationResult = CheckFlashLocation(sectorNumber, offsetInSector, lengthToWrite);
+        if (checkFlashLocationResult == FlashOperationStatus::Success)
+        {
+            checkFlashLocationResult = CheckWriteAlignment(offsetInSector, lengthToWrite);
+        }
 
         if (checkFlashLocationResult != FlashOperationStatus::Success)
         {
@@ -134,35 +145,416 @@ namespace eg
             mOnFlashOperationComplete.emit(OperationCompletion_t{FlashOperationStatus::DataBufferIsNull, Operation::Write, sectorNumber});
             return FlashOperationStatus::DataBufferIsNull;
         }
-        else if (mOperation != Operation::None)
+        else
+        {
+            const Request_t request{Operation::Write, sectorNumber, offsetInSector, nullptr, dataBuffer, lengthToWrite, false, true};
+            return Enqueue(&request, 1u);
+        }
+    }
+
+    FlashOperationStatus FlashStorageBase::ReadSegments(const FlashReadSegment_t* segments, uint32_t count)
+    {
+        const uint32_t firstSector = ((segments != nullptr) && (count > 0u)) ? segments[0].SectorNumber : 0u;
+        FlashOperationStatus status = ((segments == nullptr) && (count > 0u)) ? FlashOperationStatus::DataBufferIsNull : FlashOperationStatus::Success;
+
+        // Check everything before queueing anything, so that the operation is all or nothing
+        uint32_t requestCount = 0u;
+        for (uint32_t i = 0u; (i < count) && (status == FlashOperationStatus::Success); ++i)
+        {
+            status = CheckFlashLocation(segments[i].SectorNumber, segments[i].Offset, segments[i].Length);
+            if ((status == FlashOperationStatus::Success) && (segments[i].Length > 0u))
+            {
+                status = (segments[i].Buffer == nullptr) ? FlashOperationStatus::DataBufferIsNull : FlashOperationStatus::Success;
+                ++requestCount;
+            }
+        }
+        if ((status == FlashOperationStatus::Success) && (requestCount > kMaxRequests))
+        {
+            status = FlashOperationStatus::Busy;
+        }
+
+        if ((status != FlashOperationStatus::Success) || (requestCount == 0u))
+        {
+            mOnFlashOperationComplete.emit(OperationCompletion_t{status, Operation::Read, firstSector});
+            return status;
+        }
+
+        Request_t requests[kMaxRequests];
+        uint32_t  index = 0u;
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+            if (segments[i].Length > 0u)
+            {
+                requests[index++] = Request_t{Operation::Read, segments[i].SectorNumber, segments[i].Offset, segments[i].Buffer, nullptr, segments[i].Length, false, false};
+            }
+        }
+        requests[index - 1u].last = true;
+        return Enqueue(requests, index);
+    }
+
+    FlashOperationStatus FlashStorageBase::WriteSegments(const FlashWriteSegment_t* segments, uint32_t count, bool eraseFirst)
+    {
+        const uint32_t firstSector = ((segments != nullptr) && (count > 0u)) ? segments[0].SectorNumber : 0u;
+        FlashOperationStatus status = ((segments == nullptr) && (count > 0u)) ? FlashOperationStatus::DataBufferIsNull : FlashOperationStatus::Success;
+
+        // Check everything before queueing anything, so that the operation is all or nothing. With erase first, 
+        // a segment which went back to an earlier sector would have it erased again.
+        uint32_t requestCount = 0u;
+        uint32_t previousEnd  = 0u;
+        for (uint32_t i = 0u; (i < count) && (status == FlashOperationStatus::Success); ++i)
+        {
+            const FlashWriteSegment_t& segment = segments[i];
+            status = CheckFlashLocation(segment.SectorNumber, segment.Offset, segment.Length);
+            if (status == FlashOperationStatus::Success)
+            {
+                status = CheckWriteAlignment(segment.Offset, segment.Length);
+            }
+            if ((status == FlashOperationStatus::Success) && (segment.Length > 0u))
+            {
+                status = (segment.Buffer == nullptr) ? FlashOperationStatus::DataBufferIsNull : FlashOperationStatus::Success;
+                if (eraseFirst && (status == FlashOperationStatus::Success))
+                {
+                    if ((requestCount > 0u) && (segment.SectorNumber < previousEnd))
+                    {
+                        status = FlashOperationStatus::InvalidSector;
+                    }
+                    // The last sector the segment touches
+                    uint32_t sector    = segment.SectorNumber;
+                    uint32_t remaining = segment.Length + segment.Offset;
+                    while (remaining > GetSectorSize(sector))
+                    {
+                        remaining -= GetSectorSize(sector);
+                        ++sector;
+                    }
+                    previousEnd = sector;
+                }
+                ++requestCount;
+            }
+        }
+        if ((status == FlashOperationStatus::Success) && (requestCount > kMaxRequests))
+        {
+            status = FlashOperationStatus::Busy;
+        }
+
+        if ((status != FlashOperationStatus::Success) || (requestCount == 0u))
+        {
+            mOnFlashOperationComplete.emit(OperationCompletion_t{status, Operation::Write, firstSector});
+            return status;
+        }
+
+        Request_t requests[kMaxRequests];
+        uint32_t  index = 0u;
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+            if (segments[i].Length > 0u)
+            {
+                requests[index++] = Request_t{Operation::Write, segments[i].SectorNumber, segments[i].Offset, nullptr, segments[i].Buffer, segments[i].Length, eraseFirst, false};
+            }
+        }
+        requests[index - 1u].last = true;
+        return Enqueue(requests, index);
+    }
+
+    FlashOperationStatus FlashStorageBase::Enqueue(const Request_t* requests, uint32_t count)
+    {
+        if (static_cast<uint32_t>(mRequests.capacity() - mRequests.size()) < count)
         {
             // Notify the caller immediately of the error and return.
-            mOnFlashOperationComplete.emit(OperationCompletion_t{FlashOperationStatus::Busy, Operation::Write, sectorNumber});
+            mOnFlashOperationComplete.emit(OperationCompletion_t{FlashOperationStatus::Busy, requests[0].op, requests[0].sectorNumber});
             return FlashOperationStatus::Busy;
         }
+
+        // If the device is idle the first operation starts now, and a synchronous device reports how it went
+        const bool startsNow = !mPumping && (mOperation == Operation::None) && (mRequests.size() == 0u);
+        for (uint32_t i = 0u; i < count; ++i)
+        {
+            mRequests.put(requests[i]);
+        }
+
+        mStartStatus = FlashOperationStatus::None;
+        Pump();
+        return (startsNow && (mStartStatus != FlashOperationStatus::None)) ? mStartStatus : FlashOperationStatus::Success;
+    }
+
+    void FlashStorageBase::Pump()
+    {
+        // A device may signal completion from within OnReadBytes() and so on, which brings us back here. Carry on in 
+        // the outer call rather than recursing.
+        if (mPumping)
+        {
+            mPumpAgain = true;
+            return;
+        }
+
+        mPumping = true;
+        do
+        {
+            mPumpAgain = false;
+            Step();
+        } while (mPumpAgain);
+        mPumping = false;
+    }
+
+    void FlashStorageBase::Step()
+    {
+        if (mOperation != Operation::None)
+        {
+            return;
+        }
+
+        if (!mInOperation && (mEraseAheadSector != kNoSector))
+        {
+            // Left over from an operation which failed. Wait for it before starting anything else.
+            if (!mEraseAheadDone)
+            {
+                return;
+            }
+            mEraseAheadSector = kNoSector;
+        }
+
+        if (mRequests.size() == 0u)
+        {
+            return;
+        }
+
+        const Request_t& request = mRequests.at(0);
+        if (!mInOperation)
+        {
+            mInOperation     = true;
+            mOperationOp     = request.op;
+            mOperationSector = request.sectorNumber;
+            mErasedSector    = kNoSector;
+        }
+        if (!mRequestStarted)
+        {
+            mRequestStarted = true;
+            mPieceSector    = request.sectorNumber;
+            mPieceOffset    = request.offset;
+            mDone           = 0u;
+        }
+
+        if (request.op == Operation::Erase)
+        {
+            mOperation    = Operation::Erase;
+            mSectorNumber = request.sectorNumber;
+            CheckStarted(OnEraseSector(request.sectorNumber));
+            return;
+        }
+
+        if (request.eraseFirst && (mPieceSector != mErasedSector))
+        {
+            if (mEraseAheadSector != kNoSector)
+            {
+                // This sector was erased alongside the last write. Wait for that to finish.
+                if (!mEraseAheadDone)
+                {
+                    return;
+                }
+                const uint32_t sector = mEraseAheadSector;
+                mEraseAheadSector = kNoSector;
+                if (sector == mPieceSector)
+                {
+                    if (mEraseAheadStatus != FlashOperationStatus::Success)
+                    {
+                        FinishRequest(mEraseAheadStatus);
+                        mPumpAgain = true;
+                        return;
+                    }
+                    mErasedSector = sector;
+                }
+            }
+
+            if (mPieceSector != mErasedSector)
+            {
+                mOperation    = Operation::Erase;
+                mSectorNumber = mPieceSector;
+                CheckStarted(OnEraseSector(mPieceSector));
+                return;
+            }
+        }
+
+        const uint32_t length = std::min(request.length - mDone, GetSectorSize(mPieceSector) - mPieceOffset);
+        StartTransfer(request, length);
+    }
+
+    void FlashStorageBase::StartTransfer(const Request_t& request, uint32_t length)
+    {
+        mOperation    = request.op;
+        mSectorNumber = mPieceSector;
+        mPieceLength  = length;
+
+        // Start the erase first, as it takes far longer. Take copies of what is needed, since a synchronous device
+        // completes the operations, and so moves the queue on, before they return.
+        const uint32_t sector = mPieceSector;
+        const uint32_t offset = mPieceOffset;
+        const uint32_t done   = mDone;
+        uint8_t*       readBuffer  = request.readBuffer;
+        const uint8_t* writeBuffer = request.writeBuffer;
+        if (request.eraseFirst)
+        {
+            StartEraseAhead(request, length);
+        }
+
+        if (mOperation != Operation::Read)
+        {
+            CheckStarted(OnWriteBytes(sector, offset, writeBuffer + done, length));
+        }
         else
         {
-            mOperation = Operation::Write;
-            mSectorNumber = sectorNumber;
-            return OnWriteBytes(sectorNumber, offsetInSector, dataBuffer, lengthToWrite);
+            CheckStarted(OnReadBytes(sector, offset, readBuffer + done, length));
+        }
+    }
+
+    void FlashStorageBase::StartEraseAhead(const Request_t& request, uint32_t length)
+    {
+        if (mEraseAheadSector != kNoSector)
+        {
+            return;
+        }
+
+        // The next sector this operation writes to, if any
+        uint32_t nextSector = kNoSector;
+        if ((mDone + length) < request.length)
+        {
+            nextSector = mPieceSector + 1u;
+        }
+        else if (!request.last && (mRequests.size() > 1u))
+        {
+            const Request_t& next = mRequests.at(1);
+            nextSector = (next.sectorNumber != mPieceSector) ? next.sectorNumber : kNoSector;
+        }
+
+        if ((nextSector != kNoSector) && CanEraseDuringWrite(nextSector, mPieceSector))
+        {
+            mEraseAheadSector = nextSector;
+            mEraseAheadDone   = false;
+            mEraseAheadStatus = FlashOperationStatus::None;
+            if (OnEraseSector(nextSector) != FlashOperationStatus::Success)
+            {
+                // The sector is erased in line when it is reached instead
+                mEraseAheadSector = kNoSector;
+            }
+        }
+    }
+
+    void FlashStorageBase::CheckStarted(FlashOperationStatus status)
+    {
+        // The first operation started by Enqueue() gives its result
+        if (mStartStatus == FlashOperationStatus::None)
+        {
+            mStartStatus = status;
+        }
+
+        if (status != FlashOperationStatus::Success)
+        {
+            // It did not start, so there will be no completion. Fail the request and move on to the next.
+            mOperation = Operation::None;
+            FinishRequest(status);
+            mPumpAgain = true;
+        }
+    }
+
+    void FlashStorageBase::FinishRequest(FlashOperationStatus status)
+    {
+        Request_t request{};
+        mRequests.get(request);
+        mRequestStarted = false;
+
+        // A failure abandons the rest of the operation
+        while ((status != FlashOperationStatus::Success) && !request.last && mRequests.get(request))
+        {
+        }
+
+        if (request.last)
+        {
+            mInOperation         = false;
+            mLastOperationStatus = status;
+            mOnFlashOperationComplete.emit(OperationCompletion_t{status, mOperationOp, mOperationSector});
+        }
+    }
+
+    bool FlashStorageBase::ReportStale(FlashOperationStatus status, Operation deviceOp)
+    {
+        // The completion of a forgotten device operation comes before those of any started since
+        if ((mStale.size() == 0u) || (mStale.front().deviceOp != deviceOp))
+        {
+            return false;
+        }
+
+        Stale_t stale{};
+        mStale.get(stale);
+        if (stale.report)
+        {
+            mLastOperationStatus = status;
+            mOnFlashOperationComplete.emit(OperationCompletion_t{status, stale.op, stale.sectorNumber});
+        }
+        return true;
+    }
+
+    void FlashStorageBase::ForgetOperation()
+    {
+        if (mOperation == Operation::None)
+        {
+            return;
+        }
+
+        // If this device operation is all that remains of its operation, the operation completes when it does
+        const Request_t& request = mRequests.at(0);
+        const bool last = request.last && (mOperation == request.op) && 
+            ((request.op == Operation::Erase) || ((mDone + mPieceLength) == request.length));
+
+        if (mStale.size() == mStale.capacity())
+        {
+            mStale.pop();
+        }
+        mStale.put(Stale_t{mOperation, mOperationOp, mOperationSector, last});
+        mOperation = Operation::None;
+
+        if (last)
+        {
+            Request_t done{};
+            mRequests.get(done);
+            mRequestStarted = false;
+            mInOperation    = false;
+        }
+        else
+        {
+            FinishRequest(FlashOperationStatus::Aborted);
         }
-        return FlashOperationStatus::None;
     }
 
     void FlashStorageBase::Abort()
     {
-        ClearToIdleState();
+        ForgetOperation();
+
+        // Complete everything else as aborted, including the rest of an operation which was between device operations
+        while (mRequests.size() > 0u)
+        {
+            if (!mInOperation)
+            {
+                mInOperation     = true;
+                mOperationOp     = mRequests.at(0).op;
+                mOperationSector = mRequests.at(0).sectorNumber;
+            }
+            FinishRequest(FlashOperationStatus::Aborted);
+        }
     }
 
     FlashOperationStatus FlashStorageBase::CheckAndClearStatus()
     {
-        ClearToIdleState();
-        return mLastOperationStatus;
+        // For a synchronous device the operation has finished by now, so forget it: its completion is passed on when it 
+        // arrives, and the next request starts straight away rather than being queued behind it. Other requests stay queued.
+        ForgetOperation();
+        Pump();
+
+        const FlashOperationStatus status = mLastOperationStatus;
+        mLastOperationStatus = FlashOperationStatus::None;
+        return status;
     }
 
     uint32_t FlashStorageBase::GetWriteSize()
     {
-        return 8u; // 128 bits
+        return mWriteSize;
     }
 
     SignalProxy<OperationCompletion_t> FlashStorageBase::OnFlashOperationComplete()
@@ -170,29 +562,78 @@ namespace eg
         return SignalProxy(mOnFlashOperationComplete);
     }
 
-    void FlashStorageBase::ClearToIdleState()
+    void FlashStorageBase::FlashReadComplete(const FlashOperationStatus& flashOperationStatus)
     {
-        mOperation = Operation::None;
+        if (ReportStale(flashOperationStatus, Operation::Read) || (mOperation != Operation::Read))
+        {
+            return;
+        }
+        TransferComplete(flashOperationStatus);
     }
 
-    void FlashStorageBase::FlashReadComplete(const FlashOperationStatus& flashOperationStatus)
+    void FlashStorageBase::FlashWriteComplete(const FlashOperationStatus& flashOperationStatus)
     {
-        ClearToIdleState();
-        mLastOperationStatus = flashOperationStatus;
-        mOnFlashOperationComplete.emit(OperationCompletion_t{flashOperationStatus, mOperation, mSectorNumber});
+        if (ReportStale(flashOperationStatus, Operation::Write) || (mOperation != Operation::Write))
+        {
+            return;
+        }
+        TransferComplete(flashOperationStatus);
     }
 
-    void FlashStorageBase::FlashWriteComplete(const FlashOperationStatus& flashOperationStatus)
+    void FlashStorageBase::TransferComplete(FlashOperationStatus flashOperationStatus)
     {
-        ClearToIdleState();
-        mLastOperationStatus = flashOperationStatus;
-        mOnFlashOperationComplete.emit(OperationCompletion_t{flashOperationStatus, Operation::Write, mSectorNumber});
+        mOperation = Operation::None;
+        if (flashOperationStatus != FlashOperationStatus::Success)
+        {
+            FinishRequest(flashOperationStatus);
+        }
+        else
+        {
+            mDone        += mPieceLength;
+            mPieceOffset += mPieceLength;
+            if (mPieceOffset >= GetSectorSize(mPieceSector))
+            {
+                ++mPieceSector;
+                mPieceOffset = 0u;
+            }
+            if (mDone == mRequests.at(0).length)
+            {
+                FinishRequest(FlashOperationStatus::Success);
+            }
+        }
+        Pump();
     }
 
     void FlashStorageBase::FlashEraseComplete(const FlashOperationStatus& flashOperationStatus)
     {
-        ClearToIdleState();
-        mLastOperationStatus = flashOperationStatus;
-        mOnFlashOperationComplete.emit(OperationCompletion_t{flashOperationStatus, Operation::Erase, mSectorNumber});
+        if (ReportStale(flashOperationStatus, Operation::Erase))
+        {
+            return;
+        }
+
+        if ((mEraseAheadSector != kNoSector) && !mEraseAheadDone && (mOperation != Operation::Erase))
+        {
+            mEraseAheadDone   = true;
+            mEraseAheadStatus = flashOperationStatus;
+            Pump();
+            return;
+        }
+
+        if (mOperation != Operation::Erase)
+        {
+            return;
+        }
+
+        mOperation = Operation::None;
+        if ((mRequests.at(0).op == Operation::Erase) || (flashOperationStatus != FlashOperationStatus::Success))
+        {
+            FinishRequest(flashOperationStatus);
+        }
+        else
+        {
+            // Erased ready for the write
+            mErasedSector = mSectorNumber;
+        }
+        Pump();
     }
 } // namespace eg::Flash
@@ -11,6 +11,7 @@
 #define FLASH_STORAGE_BASE_H_
 
 #include "interfaces/IFlashStorage.h"
+#include "utilities/RingBuffer.h"
 
 
 // TODO_AC Remove this - warning from GCC ignoring unknown pragma
@@ -25,14 +26,27 @@ namespace eg
     /**
     * @brief The Base class for a Flash Device. Implements IFlashStorage
     * This operates under a signals framework
+    * 
+    * Requests made while the device is busy are queued, up to kMaxRequests segments, and started in turn as the device
+    * signals completion. A request which runs over several sectors is split into one device operation per sector. For 
+    * a write with erase first, the erase of the next sector is started alongside the programming of the current one if
+    * the device says it can do both at once (see CanEraseDuringWrite()).
+    *
+    * Abort() completes the operation in progress and those queued as Aborted. CheckAndClearStatus() forgets the device
+    * operation in progress but leaves the queue alone. Either way, the completion of a forgotten device operation is
+    * passed on when it arrives if it was all that remained of its operation, and is otherwise ignored.
     */
     class FlashStorageBase : public virtual IFlashStorage
     {
     public:
+        static constexpr uint32_t kDefaultWriteSize = 8u;  // STM32G4 double word
+        static constexpr uint16_t kMaxRequests      = 8u;
+
         /**
         * @brief Constructor
+        * @param[in] writeSize The minimum size of data that the device can write, in bytes
         */
-        FlashStorageBase();
+        explicit FlashStorageBase(uint32_t writeSize = kDefaultWriteSize);
             
         /**
         * @brief Reads from a flash sector
@@ -52,6 +66,16 @@ namespace eg
         */
 	    FlashOperationStatus Write(uint32_t sectorNumber, uint32_t offsetInSector, const uint8_t* dataBuffer, uint32_t lengthToWrite) override;
 
+        /**
+        * @brief Reads into a list of buffers as one operation. See IFlashStorage.
+        */
+	    FlashOperationStatus ReadSegments(const FlashReadSegment_t* segments, uint32_t count) override;
+
+        /**
+        * @brief Writes a list of buffers as one operation. See IFlashStorage.
+        */
+	    FlashOperationStatus WriteSegments(const FlashWriteSegment_t* segments, uint32_t count, bool eraseFirst) override;
+
         /**
         * @brief Erases an entire flash sector. Please use with care.
         * @param[in] sectorNumber The number of the flash sector to be erased
@@ -59,12 +83,13 @@ namespace eg
 	    FlashOperationStatus EraseSector(uint32_t sectorNumber) override;
             
         /**
-        * @brief Signals that the read/write or erase currently in progress should be aborted.
+        * @brief Signals that the read/write or erase currently in progress should be aborted, and completes it and any
+        * which are queued as Aborted.
         */
         void Abort() override;
 
 	    /**
-	    * @brief Checks and clears the last operation status.
+	    * @brief Checks and clears the last operation status, and forgets the device operation in progress.
 	    * 
 	    * returns the status of the last operation
 	    */
@@ -74,6 +99,9 @@ namespace eg
 
     protected:
         // OnReadBytes, OnWriteBytes and OnEraseSector are called from the base class, ensuring parameter values are safe.
+        // Each returns Success if the operation has started, and its completion must then be signalled. Otherwise the
+        // operation has not started, and its completion must not be signalled: the base class completes the request
+        // with the error returned.
         /**
         * @brief Handles device-specific reading of the bytes. 
         * @param[in] sector The sector to read from
@@ -111,6 +139,14 @@ namespace eg
         */
         virtual void OnAbort() = 0;
 
+        /**
+        * @brief Whether the device can erase one sector while programming another, e.g. in the other bank of a dual bank flash.
+        * If so, the erase completion may be signalled before or after the write completion.
+        * @param[in] eraseSector The sector to erase
+        * @param[in] writeSector The sector being programmed
+        */
+        virtual bool CanEraseDuringWrite([[maybe_unused]] uint32_t eraseSector, [[maybe_unused]] uint32_t writeSector) { return false; }
+
 	    /**
         * @brief Gets the write size (the minimum size of data that can be written in a single operation)
         * @returns write size in bytes.
@@ -126,10 +162,46 @@ namespace eg
 	    FlashOperationStatus mLastOperationStatus = FlashOperationStatus::None;
 
     private:
-            
+        static constexpr uint32_t kNoSector = UINT32_MAX;
+
+        // One segment of a queued operation. The last segment of each operation is marked, since the operation completes
+        // when it does.
+        struct Request_t
+        {
+            Operation      op;
+            uint32_t       sectorNumber;
+            uint32_t       offset;
+            uint8_t*       readBuffer;
+            const uint8_t* writeBuffer;
+            uint32_t       length;
+            bool           eraseFirst;
+            bool           last;
+        };
+
+        // A device operation forgotten by Abort() or CheckAndClearStatus(), whose completion is still to come.
+        struct Stale_t
+        {
+            Operation deviceOp;
+            Operation op;
+            uint32_t  sectorNumber;
+            bool      report;       // Passed on as the completion of op, else ignored
+        };
+
         FlashOperationStatus CheckFlashLocation(uint32_t sectorNumber, uint32_t offsetInSector, uint32_t length);
-        void ClearToIdleState();
-            
+        FlashOperationStatus CheckWriteAlignment(uint32_t offsetInSector, uint32_t length);
+        FlashOperationStatus Enqueue(const Request_t* requests, uint32_t count);
+        void ForgetOperation();
+
+        // Start device operations until one is in progress, or there is nothing more to do.
+        void Pump();
+        void Step();
+        void StartTransfer(const Request_t& request, uint32_t length);
+        void StartEraseAhead(const Request_t& request, uint32_t length);
+        void CheckStarted(FlashOperationStatus status);
+        void TransferComplete(FlashOperationStatus status);
+        void FinishRequest(FlashOperationStatus status);
+        bool ReportStale(FlashOperationStatus status, Operation deviceOp);
+
         // signal handlers
         void FlashReadComplete(const FlashOperationStatus& flashOperationStatus);
         void FlashWriteComplete(const FlashOperationStatus& flashOperationStatus);
@@ -137,10 +209,38 @@ namespace eg
 
         // the size and pointer to the start of the write buffer are passed in by the derived implementation of this base class
         Signal<OperationCompletion_t> mOnFlashOperationComplete;             // To call back when whole operation has completed
-        
+
+        const uint32_t mWriteSize;
+        RingBufferArray<Request_t, kMaxRequests> mRequests;
+
+        // The device operation in progress, other than an erase ahead, and its sector.
 	    Operation mOperation;
-		    
 	    uint32_t mSectorNumber = 0;
+	    FlashOperationStatus mStartStatus = FlashOperationStatus::None;
+
+        // Device operations forgotten, oldest first. Completions arrive in the order the operations were started.
+        RingBufferArray<Stale_t, kMaxRequests> mStale;
+
+        // Progress through the request at the front of the queue.
+        bool     mRequestStarted = false;
+        uint32_t mPieceSector    = 0;
+        uint32_t mPieceOffset    = 0;
+        uint32_t mPieceLength    = 0;
+        uint32_t mDone           = 0;
+
+        // The operation the front request belongs to, which completes with its last segment.
+        bool                 mInOperation     = false;
+        Operation            mOperationOp     = Operation::None;
+        uint32_t             mOperationSector = 0;
+
+        // For writes with erase first: the sector last erased, and the erase of the next one if it is overlapped.
+        uint32_t             mErasedSector      = kNoSector;
+        uint32_t             mEraseAheadSector  = kNoSector;
+        bool                 mEraseAheadDone    = false;
+        FlashOperationStatus mEraseAheadStatus  = FlashOperationStatus::None;
+
+        bool mPumping   = false;
+        bool mPumpAgain = false;
     };
 }
 
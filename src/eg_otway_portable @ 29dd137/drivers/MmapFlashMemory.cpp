@@ -0,0 +1,277 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code
+// is confidential information and must not be disclosed to third parties or used without
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "MmapFlashMemory.h"
+#include "logging/Logger.h"
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace eg {
+
+
+MmapFlashMemory::MmapFlashMemory(const char* path, const Geometry& geometry, Mode mode, uint32_t sync_batch)
+: m_geometry{geometry}
+, m_mode{mode}
+, m_sync_batch{sync_batch}
+, m_size{geometry.page_size * geometry.page_count}
+, m_dirty_begin{m_size}
+{
+    const bool valid = std::has_single_bit(geometry.page_size) && std::has_single_bit(geometry.write_size) &&
+        (geometry.write_size <= geometry.page_size) && (geometry.page_count > 0) &&
+        ((geometry.base_address % geometry.page_size) == 0) &&
+        ((uint64_t{geometry.page_size} * geometry.page_count) <= (uint64_t{kInvalidAddress} - geometry.base_address));
+    if (!valid)
+    {
+        EG_LOG_WARN("Invalid flash geometry for %s", path);
+        return;
+    }
+
+    if (!open(path)) close();
+}
+
+
+MmapFlashMemory::~MmapFlashMemory()
+{
+    close();
+}
+
+
+bool MmapFlashMemory::open(const char* path)
+{
+    const bool read_only = (m_mode == Mode::eReadOnly);
+    m_fd = ::open(path, read_only ? O_RDONLY : (O_RDWR | O_CREAT), 0644);
+    if (m_fd < 0)
+    {
+        EG_LOG_WARN("Failed to open %s: %s", path, std::strerror(errno));
+        return false;
+    }
+
+    struct stat status{};
+    if (::fstat(m_fd, &status) != 0)
+    {
+        EG_LOG_WARN("Failed to stat %s: %s", path, std::strerror(errno));
+        return false;
+    }
+
+    // A dump opened read only must hold all the pages. Otherwise the new pages are erased below.
+    const auto existing = static_cast<uint32_t>(std::min<off_t>(status.st_size, m_size));
+    if (existing < m_size)
+    {
+        if (read_only)
+        {
+            EG_LOG_WARN("%s is smaller than the flash", path);
+            return false;
+        }
+        if (::ftruncate(m_fd, m_size) != 0)
+        {
+            EG_LOG_WARN("Failed to extend %s: %s", path, std::strerror(errno));
+            return false;
+        }
+    }
+
+    const int protection = read_only ? PROT_READ : (PROT_READ | PROT_WRITE);
+    void* data = ::mmap(nullptr, m_size, protection, MAP_SHARED, m_fd, 0);
+    if (data == MAP_FAILED)
+    {
+        EG_LOG_WARN("Failed to map %s: %s", path, std::strerror(errno));
+        return false;
+    }
+    m_data = static_cast<uint8_t*>(data);
+
+    if (existing < m_size)
+    {
+        std::memset(m_data + existing, 0xFF, m_size - existing);
+        changed(existing, m_size - existing);
+        flush();
+    }
+    return true;
+}
+
+
+void MmapFlashMemory::close()
+{
+    if (m_data != nullptr)
+    {
+        flush();
+        ::munmap(m_data, m_size);
+        m_data = nullptr;
+    }
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+
+IFlashMemory::Result MmapFlashMemory::flush()
+{
+    if (!is_open()) return Result::eFlashFailed;
+    m_pending = 0;
+    if (m_dirty_begin >= m_dirty_end) return Result::eOK;
+
+    // msync() needs an address aligned to the OS page size.
+    const auto os_page = static_cast<uint32_t>(::sysconf(_SC_PAGESIZE));
+    const uint32_t begin = m_dirty_begin / os_page * os_page;
+    const uint32_t end   = m_dirty_end;
+    m_dirty_begin = m_size;
+    m_dirty_end   = 0;
+
+    ++m_syncs;
+    if (::msync(m_data + begin, end - begin, MS_SYNC) != 0)
+    {
+        EG_LOG_WARN("Failed to sync flash: %s", std::strerror(errno));
+        return Result::eFlashFailed;
+    }
+    return Result::eOK;
+}
+
+
+IFlashMemory::Result MmapFlashMemory::changed(uint32_t offset, uint32_t size)
+{
+    m_dirty_begin = std::min(m_dirty_begin, offset);
+    m_dirty_end   = std::max(m_dirty_end, offset + size);
+    if ((m_sync_batch > 0) && (++m_pending >= m_sync_batch))
+    {
+        return flush();
+    }
+    return Result::eOK;
+}
+
+
+uint32_t MmapFlashMemory::get_offset(uint32_t address) const
+{
+    if (address < m_geometry.base_address) return kInvalidArgument;
+    address -= m_geometry.base_address;
+    if (address >= m_size) return kInvalidArgument;
+    return address;
+}
+
+
+uint32_t MmapFlashMemory::get_page_count() const
+{
+    return m_geometry.page_count;
+}
+
+
+uint32_t MmapFlashMemory::get_page_index(uint32_t address) const
+{
+    const uint32_t offset = get_offset(address);
+    if (offset == kInvalidArgument) return kInvalidArgument;
+    return offset / m_geometry.page_size;
+}
+
+
+uint32_t MmapFlashMemory::get_page_address(uint32_t page) const
+{
+    if (page >= m_geometry.page_count) return kInvalidArgument;
+    return m_geometry.base_address + page * m_geometry.page_size;
+}
+
+
+uint32_t MmapFlashMemory::get_page_size(uint32_t page) const
+{
+    if (page >= m_geometry.page_count) return kInvalidArgument;
+    return m_geometry.page_size;
+}
+
+
+uint32_t MmapFlashMemory::get_write_size() const
+{
+    return m_geometry.write_size;
+}
+
+
+IFlashMemory::Result MmapFlashMemory::erase_address(uint32_t address)
+{
+    const uint32_t offset = get_offset(address);
+    if (offset == kInvalidArgument) return Result::eInvalidAddress;
+    if (!is_open() || (m_mode == Mode::eReadOnly)) return Result::eFlashFailed;
+
+    const uint32_t start = offset / m_geometry.page_size * m_geometry.page_size;
+    std::memset(m_data + start, 0xFF, m_geometry.page_size);
+    return changed(start, m_geometry.page_size);
+}
+
+
+IFlashMemory::Result MmapFlashMemory::erase_page(uint32_t page)
+{
+    if (page >= m_geometry.page_count) return Result::eInvalidPage;
+    return erase_address(get_page_address(page));
+}
+
+
+IFlashMemory::Result MmapFlashMemory::write(uint32_t address, const uint8_t* data, uint32_t size)
+{
+    const uint32_t offset = get_offset(address);
+    if (offset == kInvalidArgument) return Result::eInvalidAddress;
+    if (size > (m_geometry.page_size - offset % m_geometry.page_size)) return Result::eInvalidSize;
+    if ((offset % m_geometry.write_size) != 0) return Result::eUnalignedAddress;
+    if ((size % m_geometry.write_size) != 0) return Result::eUnalignedSize;
+    if (!is_open() || (m_mode == Mode::eReadOnly)) return Result::eFlashFailed;
+
+    // Programming can only clear bits.
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        m_data[offset + i] &= data[i];
+    }
+    return changed(offset, size);
+}
+
+
+IFlashMemory::Result MmapFlashMemory::write(uint32_t page, uint32_t offset, const uint8_t* data, uint32_t size)
+{
+    if (page >= m_geometry.page_count) return Result::eInvalidPage;
+    if (offset >= m_geometry.page_size) return Result::eInvalidOffset;
+    return write(get_page_address(page) + offset, data, size);
+}
+
+
+IFlashMemory::Result MmapFlashMemory::read(uint32_t address, uint8_t* data, uint32_t size) const
+{
+    const uint32_t offset = get_offset(address);
+    if (offset == kInvalidArgument) return Result::eInvalidAddress;
+    if (size > (m_geometry.page_size - offset % m_geometry.page_size)) return Result::eInvalidSize;
+    if (!is_open()) return Result::eFlashFailed;
+
+    std::memcpy(data, m_data + offset, size);
+    return Result::eOK;
+}
+
+
+IFlashMemory::Result MmapFlashMemory::read(uint32_t page, uint32_t offset, uint8_t* data, uint32_t size) const
+{
+    if (page >= m_geometry.page_count) return Result::eInvalidPage;
+    if (offset >= m_geometry.page_size) return Result::eInvalidOffset;
+    return read(get_page_address(page) + offset, data, size);
+}
+
+
+const uint8_t* MmapFlashMemory::get_data(uint32_t address) const
+{
+    const uint32_t offset = get_offset(address);
+    if ((offset == kInvalidArgument) || !is_open()) return nullptr;
+    return m_data + offset;
+}
+
+
+const uint8_t* MmapFlashMemory::get_data(uint32_t page, uint32_t offset) const
+{
+    if ((page >= m_geometry.page_count) || (offset >= m_geometry.page_size)) return nullptr;
+    return get_data(get_page_address(page) + offset);
+}
+
+
+} // namespace eg {
@@ -0,0 +1,109 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code
+// is confidential information and must not be disclosed to third parties or used without
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "interfaces/IFlashMemory.h"
+#include <cstdint>
+
+
+#if !defined(OTWAY_TARGET_PLATFORM_LINUX)
+#error This file is requires OTWAY_TARGET_PLATFORM_LINUX to be defined.
+#endif
+
+
+namespace eg {
+
+
+// Flash memory backed by a memory mapped file, so that FlashLog, FlashKeyValueStore and the
+// other IFlashMemory clients keep their data across restarts on Linux. The file holds the
+// pages in order, and so has the same layout as a dump of the device flash. get_data() points
+// straight into the mapping, as it would into memory mapped flash on an STM32, so host tools
+// can open a dump read only and walk it at memory speed.
+//
+// Flash semantics are emulated: an erase sets the page to 0xFF, and programming can only clear
+// bits (the data is ANDed in). A new or short file is extended with erased pages.
+//
+// The mapping is shared, so the data survives the process crashing as soon as it is written.
+// Surviving the machine losing power needs msync(), which is slow, so it is batched: the pages
+// changed are synced after every sync_batch programs and erases, by flush(), and on destruction.
+// A sync_batch of 1 syncs every operation, and 0 only on flush() and destruction.
+//
+// Failures to open or map the file are logged, and leave the object closed (is_open() is false).
+// Every operation on a closed object fails with eFlashFailed, and get_data() returns nullptr.
+class MmapFlashMemory : public IFlashMemory
+{
+public:
+    // The pages are all the same size. Both sizes must be powers of 2. The base address is
+    // where the pages would be in the device memory map, and must be page aligned.
+    struct Geometry
+    {
+        uint32_t base_address;
+        uint32_t page_size;
+        uint32_t page_count;
+        uint32_t write_size;
+    };
+    // In the region of the STM32G4: 2KB pages, double word programming.
+    static constexpr Geometry kSTM32G4{0x0800'0000, 2048, 64, 8};
+
+    enum class Mode { eReadWrite, eReadOnly };
+    static constexpr uint32_t kDefaultSyncBatch = 32;
+
+public:
+    MmapFlashMemory(const char* path, const Geometry& geometry, Mode mode = Mode::eReadWrite,
+        uint32_t sync_batch = kDefaultSyncBatch);
+    ~MmapFlashMemory() override;
+
+    bool is_open() const { return m_data != nullptr; }
+    const Geometry& get_geometry() const { return m_geometry; }
+
+    // Sync the pages changed since the last sync to the file.
+    Result flush();
+    // Number of msync() calls made, for tests and tuning sync_batch.
+    uint32_t get_sync_count() const { return m_syncs; }
+
+    uint32_t get_page_count() const override;
+    uint32_t get_page_index(uint32_t address) const override;
+    uint32_t get_page_address(uint32_t page) const override;
+    uint32_t get_page_size(uint32_t page) const override;
+    uint32_t get_write_size() const override;
+
+    Result erase_address(uint32_t address) override;
+    Result erase_page(uint32_t page) override;
+    Result write(uint32_t address, const uint8_t* data, uint32_t size) override;
+    Result write(uint32_t page, uint32_t offset, const uint8_t* data, uint32_t size) override;
+    Result read(uint32_t address, uint8_t* data, uint32_t size) const override;
+    Result read(uint32_t page, uint32_t offset, uint8_t* data, uint32_t size) const override;
+
+    const uint8_t* get_data(uint32_t address) const override;
+    const uint8_t* get_data(uint32_t page, uint32_t offset) const override;
+
+private:
+    bool open(const char* path);
+    void close();
+    // The offset of the address in the file, or kInvalidArgument if it is not in any page.
+    uint32_t get_offset(uint32_t address) const;
+    // Count an operation on the given range of the file, and sync if the batch is full.
+    Result changed(uint32_t offset, uint32_t size);
+
+private:
+    Geometry m_geometry;
+    Mode     m_mode;
+    uint32_t m_sync_batch;
+    uint32_t m_size;
+    int      m_fd{-1};
+    uint8_t* m_data{};
+
+    // The range of the file changed since the last sync, and the operations since then.
+    uint32_t m_dirty_begin;
+    uint32_t m_dirty_end{};
+    uint32_t m_pending{};
+    uint32_t m_syncs{};
+};
+
+
+} // namespace eg {
@@ -9,11 +9,16 @@
 #pragma once
 #include "utilities/RingBuffer.h"
 #include "signals/Signal.h"
+#include "event_loop/EventLoopStats.h"
+#include "event_loop/OverflowPolicy.h"
 #include "utilities/NonCopyable.h"
 #include "utilities/CriticalSection.h"
+#include "utilities/DisableInterrupts.h"
+#include "utilities/WaitForInterrupt.h"
 #include "utilities/ErrorHandler.h"
 #include "logging/Assert.h"
 #include "logging/Logger.h"
+#include <cstring>
 
 
 // This class could be used on FreeRTOS or Linux systems, but you probably wouldn't.
@@ -25,12 +30,32 @@
 namespace eg {
 
 
-template <uint8_t QUEUE_SIZE>
+// What the loop does when its queue is empty. Spin is the original behaviour: poll the queue
+// continuously. The others sleep the core until an interrupt (WFI) or event (WFE) occurs,
+// which saves a lot of power on battery-backed devices. 
+enum class IdleStrategy : uint8_t { Spin, WaitForInterrupt, WaitForEvent };
+
+
+// QUEUE_SIZE is the capacity of the main queue. ISR_QUEUE_SIZE is the capacity (a power of 
+// two) of the lock-free ring used by Signal::emit_from_isr(). Events from the ring are 
+// dispatched first. If it is full, emit_from_isr() falls back to the main queue.
+template <uint8_t QUEUE_SIZE, uint16_t ISR_QUEUE_SIZE = 16>
 class BareMetalEventLoop : public eg::IEventLoop
 {
 public:
-    BareMetalEventLoop()
+    // Called each time the loop finds its queue empty, before sleeping. It can be used for 
+    // short pieces of background work. Post an event if there is more to do, else the loop 
+    // may sleep until the next interrupt.
+    using IdleHook = void (*)();
+
+public:
+    BareMetalEventLoop(IdleStrategy strategy = IdleStrategy::Spin, OverflowPolicy policy = OverflowPolicy::Assert)
+    : m_strategy{strategy}
+    , m_policy{policy}
     {
+        m_isr_queue.set_clock(&EventLoopMonitor::now);
+        m_isr_ring = &m_isr_queue;
+
 	    // Raise the priority to Otway level to prevent any interrupts firing until the
 	    // main loop is started
         CriticalSection::enter_otway_level();
@@ -39,21 +64,17 @@ public:
     void post(const eg::Event& ev) override
     {
         CriticalSection cs;
-        if (m_queue.put(ev) == false)
+        // While anything is in the spill queue, new events must follow it to keep the order.
+        // Only while spilling though: with another policy, the spill queue just drains.
+        const bool spilling = (m_policy == OverflowPolicy::Spill) && m_spill && (m_spill->size() > 0);
+        if (!spilling && m_queue.put(ev))
         {
-            // Failed to add to queue, this is a terminal error as an event has been lost.
-            EG_ASSERT_FAIL("Event queue has overflowed!");
-            Error_Handler(); // LCOV_EXCL_LINE
+            m_monitor.on_post(m_queue.back());
+            update_high_water_mark();
+            return;
         }
 
-#if defined(OTWAY_EVENT_LOOP_WATER_MARK)
-        // Update high water mark.
-        const uint16_t queue_size = m_queue.size();
-        if (queue_size > m_high_water_mark)
-        {
-            m_high_water_mark = queue_size;
-        }
-#endif
+        on_overflow(ev);
     }
 
     void run() override
@@ -63,18 +84,70 @@ public:
 
         while (true)
         {
-            Event event;
-            bool  valid;
-            {
-                CriticalSection cs;
-                valid = m_queue.get(event);
-            }
+            run_once();
+        }
+    }
 
+    // Dispatch the next event if there is one, else idle. Returns whether an event was 
+    // dispatched. This is exposed mainly for testing.
+    bool run_once()
+    {
+        Event event;
+        bool  valid;
+        // The ISR ring needs no lock to pop.
+        if (m_isr_queue.pop(event))
+        {
+            valid = true;
+            CriticalSection cs;
+            m_monitor.on_posted_from_isr();
+            m_monitor.on_get(event);
+        }
+        else
+        {
+            CriticalSection cs;
+            valid = m_queue.get(event) || (m_spill && m_spill->get(event));
             if (valid)
             {
-                event.dispatch();
+                m_monitor.on_get(event);
             }
         }
+
+        if (valid)
+        {
+            event.dispatch();
+            CriticalSection cs;
+            m_monitor.on_dispatched();
+            return true;
+        }
+
+        idle();
+        return false;
+    }
+
+    // What to do when the queue is full. See OverflowPolicy. Block is not supported, as 
+    // there is no other thread to wait for, and is treated as Assert. After a change away 
+    // from Spill, events left in the spill queue are still dispatched, but new events no 
+    // longer wait behind them.
+    void set_overflow_policy(OverflowPolicy policy) { m_policy = policy; }
+
+    // The secondary queue for OverflowPolicy::Spill. Events are taken from it only when the 
+    // main queue is empty. 
+    void set_spill_queue(RingBuffer<Event>* spill) { m_spill = spill; }
+
+    void set_idle_strategy(IdleStrategy strategy) { m_strategy = strategy; }
+    void set_idle_hook(IdleHook hook) { m_idle_hook = hook; }
+
+    bool get_stats(EventLoopStats& stats) const override
+    {
+        CriticalSection cs;
+        stats = m_monitor.get_stats();
+        return true;
+    }
+
+    void reset_stats()
+    {
+        CriticalSection cs;
+        m_monitor.reset();
     }
 
 #if defined(OTWAY_EVENT_LOOP_WATER_MARK)
@@ -85,9 +158,130 @@ public:
 #endif    
 
 private:
+    // Called with the lock held when the event cannot go in the main queue.
+    void on_overflow(const Event& ev)
+    {
+        switch (m_policy)
+        {
+            case OverflowPolicy::DropNewest:
+                m_monitor.on_dropped(false);
+                return;
+
+            case OverflowPolicy::DropOldest:
+                m_queue.pop();
+                m_monitor.on_dropped(true);
+                m_queue.put(ev);
+                m_monitor.on_post(m_queue.back());
+                return;
+
+            case OverflowPolicy::Coalesce:
+                // Linear search, but only when the queue is full. The pending event keeps its 
+                // place and its timestamp.
+                for (uint16_t index = 0; index < m_queue.size(); ++index)
+                {
+                    Event& pending = m_queue.at(index);
+                    if (pending.m_signal == ev.m_signal)
+                    {
+                        pending.m_length = ev.m_length;
+                        std::memcpy(pending.m_data, ev.m_data, ev.m_length);
+                        m_monitor.on_coalesced();
+                        return;
+                    }
+                }
+                m_monitor.on_dropped(false);
+                return;
+
+            case OverflowPolicy::Spill:
+                // If the spill queue is full too, the main queue may have drained since events 
+                // were last spilled. Move them back to make room.
+                if (m_spill && (m_spill->put(ev) || (unspill() && m_spill->put(ev))))
+                {
+                    m_monitor.on_post(m_spill->back());
+                    m_monitor.on_spilled();
+                    update_high_water_mark();
+                    return;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        // Failed to add to queue, this is a terminal error as an event has been lost.
+        EG_ASSERT_FAIL("Event queue has overflowed!");
+        Error_Handler(); // LCOV_EXCL_LINE
+    }
+
+    // Move spilled events to the back of the main queue while it has room. Nothing is put in the 
+    // main queue while there are spilled events, so everything in it is older and the order is kept.
+    // Returns whether any were moved.
+    bool unspill()
+    {
+        bool moved = false;
+        Event ev;
+        while ((m_spill->size() > 0) && (m_queue.size() < m_queue.capacity()))
+        {
+            m_spill->get(ev);
+            m_queue.put(ev);
+            moved = true;
+        }
+        return moved;
+    }
+
+    void update_high_water_mark()
+    {
+#if defined(OTWAY_EVENT_LOOP_WATER_MARK)
+        const uint16_t queue_size = m_queue.size() + (m_spill ? m_spill->size() : 0U);
+        if (queue_size > m_high_water_mark)
+        {
+            m_high_water_mark = queue_size;
+        }
+#endif
+    }
+
+    void idle()
+    {
+        if (m_idle_hook)
+        {
+            m_idle_hook();
+        }
+
+        if (m_strategy == IdleStrategy::Spin)
+        {
+            return;
+        }
+
+        // Check-then-sleep with all interrupts disabled. An interrupt which posts an event
+        // after the check is left pending, and a pending interrupt wakes the core from WFI 
+        // (or WFE, see platform_wait_for_event()) even with interrupts disabled. The handler
+        // then runs when they are re-enabled at the end of this scope. So an event can never
+        // wait in the queue while we sleep.
+        DisableInterrupts di;
+        if ((m_queue.size() == 0) && m_isr_queue.empty() && !(m_spill && (m_spill->size() > 0)))
+        {
+            const uint32_t start = EventLoopMonitor::now();
+            if (m_strategy == IdleStrategy::WaitForInterrupt)
+            {
+                platform_wait_for_interrupt();
+            }
+            else
+            {
+                platform_wait_for_event();
+            }
+            m_monitor.on_sleep(EventLoopMonitor::now() - start);
+        }
+    }
+
+private:
+    IdleStrategy                               m_strategy;
+    OverflowPolicy                             m_policy;
+    RingBuffer<Event>*                         m_spill{};
+    IdleHook                                   m_idle_hook{};
     eg::RingBufferArray<eg::Event, QUEUE_SIZE> m_queue;
+    IsrEventRingArray<ISR_QUEUE_SIZE>          m_isr_queue;
+    EventLoopMonitor                           m_monitor;
 #if defined(OTWAY_EVENT_LOOP_WATER_MARK)
-    uint16_t                                   m_high_water_mark;
+    uint16_t                                   m_high_water_mark{};
 #endif
 };
 
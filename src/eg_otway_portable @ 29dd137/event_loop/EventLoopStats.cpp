@@ -0,0 +1,121 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2024.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "EventLoopStats.h"
+#include "logging/Logger.h"
+#include <bit>
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+#include <chrono>
+#else
+#include "utilities/MicrosecondClock.h"
+#endif
+
+
+namespace eg {
+
+
+namespace {
+
+uint32_t default_clock()
+{
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+    using namespace std::chrono;
+    auto time = duration_cast<microseconds>(steady_clock::now().time_since_epoch());
+    return static_cast<uint32_t>(time.count());
+#else
+    return platform_get_microseconds();
+#endif
+}
+
+EventLoopMonitor::ClockFunc g_clock = default_clock;
+
+} // namespace {
+
+
+uint8_t EventLoopStats::get_load_percent() const
+{
+    const uint64_t total = busy_time + idle_time;
+    if (total == 0) return 0;
+    return static_cast<uint8_t>((busy_time * 100U) / total);
+}
+
+
+uint32_t EventLoopStats::get_latency_percentile(uint8_t percent) const
+{
+    // Histogram counts are used rather than dispatched, as an event may be between on_get() 
+    // and on_dispatched().
+    uint64_t total = 0;
+    for (auto count: latency_histogram) total += count;
+
+    const uint64_t target = (total * percent + 99U) / 100U;
+    uint64_t count = 0;
+    for (uint8_t index = 0; index < kLatencyBuckets; ++index)
+    {
+        count += latency_histogram[index];
+        if ((count >= target) && (count > 0))
+        {
+            return (index == 0) ? 0 : ((1UL << index) - 1U);
+        }
+    }
+    return max_latency;
+}
+
+
+void EventLoopMonitor::register_clock(ClockFunc clock)
+{
+    g_clock = clock ? clock : default_clock;
+    m_clock_start = now();
+    ++m_clock_changes;
+}
+
+
+uint32_t EventLoopMonitor::now()
+{
+    return g_clock();
+}
+
+
+void EventLoopMonitor::reset()
+{
+    const uint16_t depth = m_stats.depth;
+    m_stats       = EventLoopStats{};
+    m_stats.depth = depth;
+    m_mark        = now();
+    m_clock_id    = m_clock_changes;
+}
+
+
+uint8_t EventLoopMonitor::bucket(uint32_t latency)
+{
+    const auto index = static_cast<uint8_t>(std::bit_width(latency));
+    return (index < EventLoopStats::kLatencyBuckets) ? index : (EventLoopStats::kLatencyBuckets - 1U);
+}
+
+
+void EventLoopMonitor::log([[maybe_unused]] const char* name, [[maybe_unused]] const EventLoopStats& stats)
+{
+    // The casts are to keep the format strings portable between 32-bit and 64-bit targets.
+    EG_LOG_INFO("%s: posted=%lu dispatched=%lu depth=%u peak=%u dropped=%lu blocked=%lu coalesced=%lu spilled=%lu load=%u%% sleeps=%lu latency p50<=%lu p99<=%lu max=%lu us",
+        name, 
+        static_cast<unsigned long>(stats.posted), 
+        static_cast<unsigned long>(stats.dispatched),
+        static_cast<unsigned>(stats.depth),
+        static_cast<unsigned>(stats.peak_depth),
+        static_cast<unsigned long>(stats.dropped),
+        static_cast<unsigned long>(stats.blocked),
+        static_cast<unsigned long>(stats.coalesced),
+        static_cast<unsigned long>(stats.spilled),
+        static_cast<unsigned>(stats.get_load_percent()),
+        static_cast<unsigned long>(stats.sleeps),
+        static_cast<unsigned long>(stats.get_latency_percentile(50)),
+        static_cast<unsigned long>(stats.get_latency_percentile(99)),
+        static_cast<unsigned long>(stats.max_latency));
+}
+
+
+} // namespace eg {
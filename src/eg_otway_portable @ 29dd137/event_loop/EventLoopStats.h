@@ -0,0 +1,185 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2024.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "signals/Signal.h"
+#include <cstdint>
+
+
+namespace eg {
+
+
+// Load and latency telemetry for an event loop. Obtain a snapshot with IEventLoop::get_stats().
+// Times are in microseconds from the clock registered with EventLoopMonitor::register_clock().
+struct EventLoopStats
+{
+    // Latencies are held in log2 buckets: bucket 0 is 0us, bucket N is [2^(N-1), 2^N) us.
+    // The last bucket also holds everything larger.
+    static constexpr uint8_t kLatencyBuckets = 16;
+
+    uint32_t posted{};
+    uint32_t dispatched{};
+    uint16_t depth{};
+    uint16_t peak_depth{};
+    // Overflow handling, see OverflowPolicy. Dropped events were lost: either the one being
+    // posted or the oldest pending one. Blocked posts waited for room in the queue. Coalesced 
+    // posts updated a pending event for the same signal. Spilled events went to the overflow
+    // queue (and are included in posted).
+    uint32_t dropped{};
+    uint32_t blocked{};
+    uint32_t coalesced{};
+    uint32_t spilled{};
+    uint64_t busy_time{};
+    uint64_t idle_time{};
+    // Low power sleeps while idle, if the loop supports them. Sleep time is part of idle time.
+    uint32_t sleeps{};
+    uint64_t sleep_time{};
+    uint32_t max_latency{};
+    uint32_t latency_histogram[kLatencyBuckets]{};
+
+    // Fraction of the measured time spent dispatching events, in percent.
+    uint8_t get_load_percent() const;
+    // Upper bound of the histogram bucket containing the given percentage of latencies.
+    uint32_t get_latency_percentile(uint8_t percent) const;
+};
+
+
+// This is used by the event loop implementations to maintain an EventLoopStats. The owning
+// loop is responsible for thread safety: on_post() and on_get() are called while holding 
+// the loop's queue lock, and on_dispatched() from the loop's own thread. The cost is a 
+// few reads of the clock and some arithmetic per event, which is cheap enough to leave 
+// enabled in production.
+class EventLoopMonitor
+{
+public:
+    // A free running microsecond counter. Wrapping is fine as only differences are used.
+    // The default is the steady clock on Linux, and platform_get_microseconds() otherwise
+    // (see MicrosecondClock.h). Readings from different clocks can't be compared, so the
+    // time measured by each monitor starts again from when a clock is registered.
+    using ClockFunc = uint32_t (*)();
+    static void     register_clock(ClockFunc clock);
+    static uint32_t now();
+
+    // Stamp the event with the time it was placed in the queue.
+    void on_post(Event& event)
+    {
+        event.m_timestamp = now();
+        ++m_stats.posted;
+        ++m_stats.depth;
+        if (m_stats.depth > m_stats.peak_depth)
+        {
+            m_stats.peak_depth = m_stats.depth;
+        }
+    }
+
+    // An event from an IsrEventRing is about to be taken. The ISR could not update the stats
+    // without a lock, so the post is counted now. The event carries its timestamp.
+    void on_posted_from_isr()
+    {
+        ++m_stats.posted;
+        ++m_stats.depth;
+        if (m_stats.depth > m_stats.peak_depth)
+        {
+            m_stats.peak_depth = m_stats.depth;
+        }
+    }
+
+    // An event was lost to overflow. If it was pending (DropOldest) it leaves the queue.
+    void on_dropped(bool was_pending)
+    {
+        ++m_stats.dropped;
+        if (was_pending)
+        {
+            --m_stats.depth;
+        }
+    }
+
+    // A post had to wait for room in the queue.
+    void on_blocked()
+    {
+        ++m_stats.blocked;
+    }
+
+    // A post overwrote the arguments of a pending event.
+    void on_coalesced()
+    {
+        ++m_stats.coalesced;
+    }
+
+    // A post went to the overflow queue. Call on_post() as well.
+    void on_spilled()
+    {
+        ++m_stats.spilled;
+    }
+
+    // The event has been taken from the queue and is about to be dispatched.
+    void on_get(const Event& event)
+    {
+        const uint32_t time    = now();
+        const uint32_t latency = time - event.m_timestamp;
+        ++m_stats.latency_histogram[bucket(latency)];
+        if (latency > m_stats.max_latency)
+        {
+            m_stats.max_latency = latency;
+        }
+
+        --m_stats.depth;
+        m_stats.idle_time += elapsed(time);
+    }
+
+    // The event has been dispatched.
+    void on_dispatched()
+    {
+        m_stats.busy_time += elapsed(now());
+        ++m_stats.dispatched;
+    }
+
+    // The loop slept for a while with nothing to do. Called with interrupts disabled.
+    void on_sleep(uint32_t duration)
+    {
+        ++m_stats.sleeps;
+        m_stats.sleep_time += duration;
+    }
+
+    const EventLoopStats& get_stats() const { return m_stats; }
+    
+    // Clear the counters but not the current depth.
+    void reset();
+
+    // Write the stats to the Logger at Info level.
+    static void log(const char* name, const EventLoopStats& stats);
+
+    static uint8_t bucket(uint32_t latency);
+
+private:
+    // Time since the last mark, which moves to the given time.
+    uint32_t elapsed(uint32_t time)
+    {
+        if (m_clock_id != m_clock_changes)
+        {
+            m_clock_id = m_clock_changes;
+            m_mark     = m_clock_start;
+        }
+        const uint32_t result = time - m_mark;
+        m_mark = time;
+        return result;
+    }
+
+private:
+    // Counts calls to register_clock(), so that each monitor can tell when its mark is stale,
+    // and the first reading of the clock registered.
+    inline static uint32_t m_clock_changes{};
+    inline static uint32_t m_clock_start{};
+
+    EventLoopStats m_stats{};
+    uint32_t       m_mark{now()};
+    uint32_t       m_clock_id{m_clock_changes};
+};
+
+
+} // namespace eg {
@@ -7,10 +7,16 @@
 // the express written permission of eg technology ltd.
 /////////////////////////////////////////////////////////////////////////////////////////////
 #pragma once
-#include "freertos/FreeRTOSQueue.h"
 #include "freertos/FreeRTOSThread.h"
 #include "signals/Signal.h"
+#include "event_loop/EventLoopStats.h"
+#include "event_loop/OverflowPolicy.h"
+#include "event_loop/StaticEventQueue.h"
+#include "utilities/CriticalSection.h"
+#include "utilities/ErrorHandler.h"
+#include "logging/Assert.h"
 #include "task.h"
+#include "semphr.h"
 
 
 #if !defined(OTWAY_TARGET_PLATFORM_FREERTOS)
@@ -23,14 +29,24 @@ namespace eg {
 
 // This event loop implementation uses a private FreeRTOS thread to run the loop in its
 // own execution context.
+//
+// Pending events are held in a statically allocated StaticEventQueue rather than a FreeRTOS 
+// queue. An event is copied once, into its slot, when it is posted and is then dispatched 
+// in place. A FreeRTOS queue would copy it in and out again (and round the size up). The 
+// thread sleeps on its task notification when the queue is empty, which is cheaper than a 
+// queue or semaphore. What happens when the queue is full is set by the OverflowPolicy. The
+// counts of dropped and blocked posts are in the stats.
 template <uint32_t StackSizeBytes, uint32_t EventQueueSize>
 class FreeRTOSEventLoop : public IEventLoop
 {
+    static_assert(EventQueueSize < 255, "StaticEventQueue holds at most 254 events");
+
     public:
-        FreeRTOSEventLoop(const char* name, osPriority_t priority)
-        : m_thread{name, this, priority}
+        // The block timeout is only used with OverflowPolicy::Block. 
+        FreeRTOSEventLoop(const char* name, osPriority_t priority, 
+            OverflowPolicy policy = OverflowPolicy::Assert, uint32_t block_timeout_ms = 10)
+        : m_thread{name, this, priority, policy, pdMS_TO_TICKS(block_timeout_ms)}
         {
-
         }
         //~FreeRTOSEventLoop();
 
@@ -44,55 +60,224 @@ class FreeRTOSEventLoop : public IEventLoop
             // Nothing to do here. Could create the thread without starting it?
         }
 
+        bool get_stats(EventLoopStats& stats) const override
+        {
+            return m_thread.get_stats(stats);
+        }
+
+        void reset_stats()
+        {
+            m_thread.reset_stats();
+        }
+
+#if defined(OTWAY_EVENT_LOOP_WATER_MARK)
+        uint16_t get_high_water_mark() const override
+        {
+            EventLoopStats stats;
+            m_thread.get_stats(stats);
+            return stats.peak_depth;
+        }
+#endif    
+
     private:
         using ThreadBase = FreeRTOSThread<StackSizeBytes>;
-        using Queue      = FreeRTOSQueue<Event, EventQueueSize>;
+        using Queue      = StaticEventQueue<static_cast<uint8_t>(EventQueueSize)>;
 
         class Thread : public ThreadBase
         {
         public:
-            Thread(const char* name, IEventLoop* loop, osPriority_t priority) 
+            Thread(const char* name, IEventLoop* loop, osPriority_t priority, OverflowPolicy policy, TickType_t block_timeout) 
             : ThreadBase{name, priority}
+            , m_task{static_cast<TaskHandle_t>(ThreadBase::id())}
+            , m_policy{policy}
+            , m_block_timeout{block_timeout}
             {
                 // The TLS thread ID used when dispatching events to be handled in this thread.
                 // Is it safe to do this outside of the thread's execution context?
                 static_assert(configNUM_THREAD_LOCAL_STORAGE_POINTERS >= 1);
-                TaskHandle_t id = static_cast<TaskHandle_t>(ThreadBase::id());
-                vTaskSetThreadLocalStoragePointer(id, 0, loop);
+                vTaskSetThreadLocalStoragePointer(m_task, 0, loop);
+
+                m_space = xSemaphoreCreateBinaryStatic(&m_space_control);
+
+                // The thread may already be running if the scheduler has started. It waits
+                // for this notification so that it doesn't touch the members before they 
+                // have been constructed.
+                xTaskNotifyGive(m_task);
             }
 
             void post(const Event& event) 
             {
-                // This should be thread safe in FreeRTOS. 
-                // If not, we can add a critical section.
-                m_queue.put(event);
+                const bool in_isr = (xPortIsInsideInterrupt() == pdTRUE);
+                Event* slot = reserve(in_isr);
+                if (!slot)
+                {
+                    return;
+                }
+
+                // The slot is reserved for us until it is pushed, so the copy can be done 
+                // without holding the lock. Posts from ISRs or other tasks meanwhile cannot 
+                // take the slot, or overfill the queue.
+                *slot = event;
+                {
+                    CriticalSection cs;
+                    m_monitor.on_post(*slot);
+                    m_queue.push(slot);
+                }
+
+                if (in_isr)
+                {
+                    BaseType_t woken = pdFALSE;
+                    vTaskNotifyGiveFromISR(m_task, &woken);
+                    portYIELD_FROM_ISR(woken);
+                }
+                else
+                {
+                    xTaskNotifyGive(m_task);
+                }
+            }
+
+            bool get_stats(EventLoopStats& stats) const
+            {
+                CriticalSection cs;
+                stats = m_monitor.get_stats();
+                return true;
+            }
+
+            void reset_stats()
+            {
+                CriticalSection cs;
+                m_monitor.reset();
             }
 
         private:
+            // Find a slot for a new event, applying the overflow policy if the queue is full.
+            // Returns nullptr if the event is to be discarded.
+            Event* reserve(bool in_isr)
+            {
+                const TickType_t start = in_isr ? 0 : xTaskGetTickCount();
+                bool first = true;
+                while (true)
+                {
+                    // How long we have waited so far. Read once, so that the time left to wait 
+                    // can't wrap when the tick changes between the check and the wait.
+                    TickType_t waited = 0;
+                    {
+                        CriticalSection cs;
+                        if (Event* slot = m_queue.acquire())
+                        {
+                            if (!first) 
+                            {
+                                --m_waiters;
+                            }
+                            return slot;
+                        }
+
+                        switch (m_policy)
+                        {
+                            // Not supported by this loop.
+                            case OverflowPolicy::Coalesce:
+                            case OverflowPolicy::Spill:
+                            case OverflowPolicy::Assert:
+                                // This is a terminal error as an event has been lost.
+                                EG_ASSERT_FAIL("Event queue has overflowed!");
+                                Error_Handler(); // LCOV_EXCL_LINE
+                                break;
+
+                            case OverflowPolicy::DropOldest:
+                                if (Event* slot = m_queue.drop_oldest())
+                                {
+                                    m_monitor.on_dropped(true);
+                                    return slot;
+                                }
+                                break;
+
+                            default:
+                                break;
+                        }
+
+                        // Blocking is not possible from an ISR, before the scheduler starts, or
+                        // in our own thread (which would wait for itself). 
+                        const bool can_block = (m_policy == OverflowPolicy::Block) && !in_isr &&
+                            (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) &&
+                            (xTaskGetCurrentTaskHandle() != m_task);
+                        waited = can_block ? (xTaskGetTickCount() - start) : 0;
+                        if (!can_block || (waited >= m_block_timeout))
+                        {
+                            if (!first) 
+                            {
+                                --m_waiters;
+                            }
+                            m_monitor.on_dropped(false);
+                            return nullptr;
+                        }
+
+                        if (first) 
+                        {
+                            m_monitor.on_blocked();
+                            ++m_waiters;
+                            first = false;
+                        }
+                    }
+
+                    // Given by the loop thread each time it frees a slot while we wait. 
+                    xSemaphoreTake(m_space, m_block_timeout - waited);
+                }
+            }
+
             void execute() override
             {
-                // The TLS thread ID used when dispatching events to be handled in this thread.
-                // static_assert(configNUM_THREAD_LOCAL_STORAGE_POINTERS >= 1);
-                // TaskHandle_t id = static_cast<TaskHandle_t>(FreeRTOSThread::id());
-                // vTaskSetThreadLocalStoragePointer(id, 0, &m_loop);
+                // Wait for the constructor to finish. See above.
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
                 while (true)
                 {
-                    // This should be thread safe in FreeRTOS. 
-                    // If not, we can add a critical section.
-                    // Blocks when the queue is empty.
-                    if (m_queue.get(m_event))
+                    Event* slot;
+                    {
+                        CriticalSection cs;
+                        slot = m_queue.pop();
+                        if (slot)
+                        {
+                            m_monitor.on_get(*slot);
+                        }
+                    }
+
+                    if (!slot)
+                    {
+                        // Sleep until the next post. A post made after the check above leaves
+                        // the notification pending, so this returns immediately.
+                        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                        continue;
+                    }
+
+                    // Dispatched in place: the slot is not reused until it is released.
+                    slot->dispatch();
+
+                    bool waiters;
                     {
-                        m_event.dispatch();
+                        CriticalSection cs;
+                        m_monitor.on_dispatched();
+                        m_queue.release(slot);
+                        waiters = (m_waiters > 0);
+                    }
+                    if (waiters)
+                    {
+                        xSemaphoreGive(m_space);
                     }
                 }
             }
 
         private:
-            // Pending events
-            Queue m_queue{}; 
-            // Active event - made a member to take it off the stack
-            Event m_event{};
+            TaskHandle_t       m_task;
+            OverflowPolicy     m_policy;
+            TickType_t         m_block_timeout;
+            // Pending events, and the one being dispatched.
+            Queue              m_queue{}; 
+            // Used to wake posters waiting for room with OverflowPolicy::Block.
+            StaticSemaphore_t  m_space_control{};
+            SemaphoreHandle_t  m_space{};
+            uint8_t            m_waiters{};
+            // Load and latency telemetry
+            EventLoopMonitor   m_monitor{};
         };
 
     private:
@@ -101,5 +286,3 @@ class FreeRTOSEventLoop : public IEventLoop
 
 
 } // namespace eg {
-
-
@@ -0,0 +1,39 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <cstdint>
+
+
+namespace eg {
+
+
+// What an event loop does when an event is posted to a full queue. Losing an event is 
+// usually a design error, so Assert is the default. The others are for loops where some
+// loss is acceptable (e.g. telemetry) and should be visible in EventLoopStats::dropped.
+//
+// - Assert:     treat it as a terminal error (EG_ASSERT_FAIL then Error_Handler).
+// - DropNewest: discard the event being posted.
+// - DropOldest: discard the oldest pending event to make room. Use this when only recent
+//               events matter.
+// - Block:      the posting thread waits (with a timeout) for room. Not possible from an 
+//               ISR, in which case the event being posted is discarded. Only meaningful 
+//               for loops with their own thread, such as FreeRTOSEventLoop.
+// - Coalesce:   if an event for the same signal is pending, overwrite its arguments with the
+//               new ones (so the latest value wins), else discard the new event. Good for 
+//               signals which report state, such as a sensor reading.
+// - Spill:      place the event in a secondary overflow queue supplied by the application, 
+//               which could be in slower or external RAM. Nothing is lost unless that fills 
+//               too, which is then treated as Assert.
+//
+// Not every loop supports every policy. Coalesce and Spill are implemented by 
+// BareMetalEventLoop, and Block by FreeRTOSEventLoop. Others are treated as Assert.
+enum class OverflowPolicy : uint8_t { Assert, DropNewest, DropOldest, Block, Coalesce, Spill };
+
+
+} // namespace eg {
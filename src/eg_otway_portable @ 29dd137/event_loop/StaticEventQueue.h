@@ -0,0 +1,127 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "signals/Signal.h"
+#include <cstdint>
+
+
+namespace eg {
+
+
+// A statically allocated queue of events which are dispatched in place rather than being
+// copied out. There are N + 1 event slots: up to N pending events and one in flight. The 
+// queue itself holds only slot indices, so dropping the oldest pending event to make room
+// is O(1) and can never disturb the event being dispatched.
+//
+// The typical cycle for the producer is acquire() (or drop_oldest() if full), fill in the 
+// slot, push(). For the consumer it is pop(), dispatch the slot, release(). This class is 
+// not thread safe: the owning event loop holds its lock around each call. Filling in and 
+// dispatching the slots can be done outside the lock. A slot which has been acquired but 
+// not yet pushed is reserved, and counts against the N pending events, so that a producer
+// which interrupts another between acquire() and push() cannot overfill the queue.
+template <uint8_t N>
+class StaticEventQueue
+{
+    static_assert(N > 0, "The queue must hold at least one event");
+    static_assert(N < 255, "Slot indices are uint8_t");
+
+public:
+    StaticEventQueue()
+    {
+        for (uint8_t index = 0; index < kSlots; ++index)
+        {
+            m_free[index] = index;
+        }
+        m_num_free = kSlots;
+    }
+
+    // Reserve a free slot for a new event, or return nullptr if the queue is full.
+    Event* acquire()
+    {
+        if ((m_num_free == 0) || full()) return nullptr;
+        ++m_reserved;
+        return &m_slots[m_free[--m_num_free]];
+    }
+
+    // Remove the oldest pending event and reserve its slot for reuse. The caller has lost
+    // that event. Returns nullptr if nothing is pending.
+    Event* drop_oldest()
+    {
+        if (m_size == 0) return nullptr;
+        const uint8_t index = m_pending[m_get_pos];
+        m_get_pos = next(m_get_pos);
+        --m_size;
+        ++m_reserved;
+        return &m_slots[index];
+    }
+
+    // Append a reserved slot to the pending events.
+    void push(Event* slot)
+    {
+        m_pending[m_put_pos] = index_of(slot);
+        m_put_pos = next(m_put_pos);
+        ++m_size;
+        --m_reserved;
+    }
+
+    // Give up a reserved slot without pushing it.
+    void abandon(Event* slot)
+    {
+        --m_reserved;
+        m_free[m_num_free++] = index_of(slot);
+    }
+
+    // The oldest pending event, which is now in flight, or nullptr if nothing is pending.
+    Event* pop()
+    {
+        if (m_size == 0) return nullptr;
+        Event* slot = &m_slots[m_pending[m_get_pos]];
+        m_get_pos = next(m_get_pos);
+        --m_size;
+        return slot;
+    }
+
+    // Return a slot from pop() when it has been dispatched.
+    void release(Event* slot)
+    {
+        m_free[m_num_free++] = index_of(slot);
+    }
+
+    // The number of pending events, excluding any in flight or reserved.
+    uint8_t size() const  { return m_size; }
+    bool    empty() const { return m_size == 0; }
+    // No slot can be acquired, counting the reserved ones.
+    bool    full() const  { return (m_size + m_reserved) >= N; }
+    static constexpr uint8_t capacity() { return N; }
+
+    // The most recently pushed event.
+    Event& back() { return m_slots[m_pending[(m_put_pos + N - 1U) % N]]; }
+
+private:
+    static constexpr uint8_t kSlots = N + 1U;
+
+    static uint8_t next(uint8_t pos) { return (pos + 1U) % N; }
+    uint8_t index_of(const Event* slot) const { return static_cast<uint8_t>(slot - &m_slots[0]); }
+
+private:
+    Event   m_slots[kSlots]{};
+    // Ring of indices of pending slots, oldest first.
+    uint8_t m_pending[N]{};
+    uint8_t m_get_pos{};
+    uint8_t m_put_pos{};
+    uint8_t m_size{};
+    // Slots acquired but not yet pushed or abandoned.
+    uint8_t m_reserved{};
+    // Stack of indices of free slots.
+    uint8_t m_free[kSlots]{};
+    uint8_t m_num_free{};
+};
+
+
+} // namespace eg {
@@ -7,6 +7,8 @@
 // the express written permission of eg technology ltd.
 /////////////////////////////////////////////////////////////////////////////////////////////
 #include "ThreadEventLoop.h"
+#include "logging/Assert.h"
+#include "utilities/ErrorHandler.h"
 
 
 namespace eg {
@@ -31,9 +33,9 @@ IEventLoop* get_thread_event_loop()
 }
 
 
-ThreadEventLoop::ThreadEventLoop(const char* name)
+ThreadEventLoop::ThreadEventLoop(const char* name, const ThreadConfig& config)
 {
-    m_thread = std::jthread{std::jthread{&ThreadEventLoop::exec_static, this, name}};
+    m_thread = std::jthread{std::jthread{&ThreadEventLoop::exec_static, this, name, config}};
 }
 
 
@@ -48,11 +50,45 @@ ThreadEventLoop::~ThreadEventLoop()
 void ThreadEventLoop::post(const Event& event)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
+#if defined(OTWAY_LINUX_STATIC)
+    if (m_queue.put(event) == false)
+    {
+        // Failed to add to queue, this is a terminal error as an event has been lost.
+        EG_ASSERT_FAIL("Event queue has overflowed!");
+        Error_Handler(); // LCOV_EXCL_LINE
+    }
+#else
     m_queue.push(event);
+#endif
+    m_monitor.on_post(m_queue.back());
     m_condition.notify_one();
 }
 
 
+bool ThreadEventLoop::get_stats(EventLoopStats& stats) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stats = m_monitor.get_stats();
+    return true;
+}
+
+
+#if defined(OTWAY_EVENT_LOOP_WATER_MARK)
+uint16_t ThreadEventLoop::get_high_water_mark() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_monitor.get_stats().peak_depth;
+}
+#endif
+
+
+void ThreadEventLoop::reset_stats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_monitor.reset();
+}
+
+
 void ThreadEventLoop::stop()
 {
     if (m_thread.joinable())
@@ -63,9 +99,10 @@ void ThreadEventLoop::stop()
 }
 
 
-void ThreadEventLoop::exec_static(std::stop_token stoken, ThreadEventLoop* self, const char* name)
+void ThreadEventLoop::exec_static(std::stop_token stoken, ThreadEventLoop* self, const char* name, ThreadConfig config)
 {
     pthread_setname_np(pthread_self(), name);
+    apply_thread_config(config);
     set_thread_event_loop(self);
     self->exec(stoken);
 }
@@ -90,6 +127,7 @@ void ThreadEventLoop::exec(std::stop_token stoken)
             {
                 event = m_queue.front();
                 m_queue.pop();
+                m_monitor.on_get(*event);
             }
         }
 
@@ -97,6 +135,8 @@ void ThreadEventLoop::exec(std::stop_token stoken)
         if (event.has_value())
         {
             event->dispatch();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_monitor.on_dispatched();
         }
     }
 }
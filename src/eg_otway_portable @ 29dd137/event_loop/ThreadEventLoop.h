@@ -8,7 +8,10 @@
 /////////////////////////////////////////////////////////////////////////////////////////////
 #pragma once
 #include "signals/Signal.h"
+#include "event_loop/EventLoopStats.h"
 #include "utilities/NonCopyable.h"
+#include "utilities/ThreadConfig.h"
+#include "utilities/RingBuffer.h"
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -20,29 +23,54 @@
 #error This file is requires OTWAY_TARGET_PLATFORM_LINUX to be defined.
 #endif
 
+// With OTWAY_LINUX_STATIC the queue is a fixed size ring buffer. Overflow is a terminal error,
+// as for BareMetalEventLoop.
+#if !defined(OTWAY_THREAD_EVENT_LOOP_QUEUE_SIZE)
+#define OTWAY_THREAD_EVENT_LOOP_QUEUE_SIZE 64U
+#endif
+
 
 namespace eg {
 
 
+// The loop whose thread is the calling thread, if any. Applications typically return this 
+// from this_event_loop_impl().
+void        set_thread_event_loop(IEventLoop* loop);
+IEventLoop* get_thread_event_loop();
+
+
 class ThreadEventLoop : public IEventLoop
 {
     public:
-        ThreadEventLoop(const char* name = "loop");
+        // The config is applied by the loop's thread when it starts. See ThreadConfig.
+        ThreadEventLoop(const char* name = "loop", const ThreadConfig& config = {});
         ~ThreadEventLoop();
 
         void post(const Event& event) override;
         void run() override {}
         void stop();
 
+        bool get_stats(EventLoopStats& stats) const override;
+        void reset_stats();
+
+    #if defined(OTWAY_EVENT_LOOP_WATER_MARK)
+        uint16_t get_high_water_mark() const;
+    #endif
+
     private:
-        static void exec_static(std::stop_token stoken, ThreadEventLoop* self, const char* name);
+        static void exec_static(std::stop_token stoken, ThreadEventLoop* self, const char* name, ThreadConfig config);
         void exec(std::stop_token stoken);
 
     private:
         std::jthread                m_thread;
-        std::mutex                  m_mutex;
+        mutable std::mutex          m_mutex;
         std::condition_variable_any m_condition;
+    #if defined(OTWAY_LINUX_STATIC)
+        RingBufferArray<Event, OTWAY_THREAD_EVENT_LOOP_QUEUE_SIZE> m_queue;
+    #else
         std::queue<Event>           m_queue;
+    #endif
+        EventLoopMonitor            m_monitor;
 };
 
 
@@ -0,0 +1,306 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "ThreadPoolEventLoop.h"
+#include "ThreadEventLoop.h"
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <optional>
+
+
+namespace eg {
+
+
+namespace {
+
+// The worker which is the calling thread, if any. This is used to schedule work posted 
+// from a worker on its own deque.
+thread_local const ThreadPoolEventLoop* g_pool;
+thread_local uint8_t                    g_worker;
+
+} // namespace {
+
+
+ThreadPoolEventLoop::ThreadPoolEventLoop(uint8_t workers, const char* name)
+: m_name{name}
+{
+    if (workers == 0)
+    {
+        workers = static_cast<uint8_t>(std::max(1U, std::thread::hardware_concurrency()));
+    }
+
+    // All the deques must exist before any worker starts stealing.
+    for (uint8_t index = 0; index < workers; ++index)
+    {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (uint8_t index = 0; index < workers; ++index)
+    {
+        m_workers[index]->thread = std::jthread{&ThreadPoolEventLoop::exec_static, this, index};
+    }
+}
+
+
+ThreadPoolEventLoop::~ThreadPoolEventLoop()
+{
+    stop();
+}
+
+
+void ThreadPoolEventLoop::stop()
+{
+    for (auto& worker: m_workers)
+    {
+        worker->thread.request_stop();
+    }
+    for (auto& worker: m_workers)
+    {
+        if (worker->thread.joinable())
+        {
+            worker->thread.join();
+        }
+    }
+}
+
+
+void ThreadPoolEventLoop::on_connect(const SignalBase& signal, const void* obj)
+{
+    if (!obj) return;
+
+    // Merge the groups containing the signal and the object, by giving the members of the 
+    // smaller group the key of the larger one.
+    std::lock_guard<std::mutex> lock(m_groups_mutex);
+    const void* signal_key = find_key(&signal);
+    const void* obj_key    = find_key(obj);
+    if (signal_key == obj_key) return;
+
+    auto& signal_group = m_groups[signal_key];
+    auto& obj_group    = m_groups[obj_key];
+    if (signal_group.empty()) signal_group.push_back(signal_key);
+    if (obj_group.empty())    obj_group.push_back(obj_key);
+
+    auto* from = &signal_group;
+    auto* to   = &obj_group;
+    const void* key = obj_key;
+    if (from->size() > to->size())
+    {
+        std::swap(from, to);
+        key = signal_key;
+    }
+
+    for (const void* node: *from)
+    {
+        KeyShard& shard = get_shard(node);
+        std::lock_guard<std::mutex> shard_lock(shard.mutex);
+        shard.keys[node] = key;
+        to->push_back(node);
+    }
+    m_groups.erase((key == obj_key) ? signal_key : obj_key);
+}
+
+
+ThreadPoolEventLoop::KeyShard& ThreadPoolEventLoop::get_shard(const void* node)
+{
+    return m_shards[std::hash<const void*>{}(node) & (kKeyShards - 1)];
+}
+
+
+const void* ThreadPoolEventLoop::find_key(const void* node)
+{
+    // A node which has never been grouped is its own key.
+    KeyShard& shard = get_shard(node);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.keys.find(node);
+    return (it != shard.keys.end()) ? it->second : node;
+}
+
+
+void ThreadPoolEventLoop::post(const Event& event)
+{
+    const void*    key   = find_key(event.m_signal);
+    const uint16_t index = std::hash<const void*>{}(key) & (kStrands - 1);
+
+    Strand& strand = m_strands[index];
+    {
+        std::lock_guard<std::mutex> lock(strand.mutex);
+        strand.events.push_back(event);
+        strand.monitor.on_post(strand.events.back());
+        if (strand.scheduled) return;
+        strand.scheduled = true;
+    }
+    schedule(index);
+}
+
+
+bool ThreadPoolEventLoop::get_stats(EventLoopStats& stats) const
+{
+    stats = EventLoopStats{};
+    for (const Strand& strand: m_strands)
+    {
+        std::lock_guard<std::mutex> lock(strand.mutex);
+        const EventLoopStats& part = strand.monitor.get_stats();
+        stats.posted     += part.posted;
+        stats.dispatched += part.dispatched;
+        stats.depth       = static_cast<uint16_t>(stats.depth + part.depth);
+        stats.peak_depth  = std::max(stats.peak_depth, part.peak_depth);
+        stats.busy_time  += part.busy_time;
+        stats.max_latency = std::max(stats.max_latency, part.max_latency);
+        for (uint8_t bucket = 0; bucket < EventLoopStats::kLatencyBuckets; ++bucket)
+        {
+            stats.latency_histogram[bucket] += part.latency_histogram[bucket];
+        }
+    }
+
+    // The strands' own idle times only say how long each went without events. 
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    const uint64_t capacity = uint64_t{EventLoopMonitor::now() - m_stats_start} * m_workers.size();
+    stats.idle_time = (capacity > stats.busy_time) ? (capacity - stats.busy_time) : 0U;
+    return true;
+}
+
+
+void ThreadPoolEventLoop::reset_stats()
+{
+    std::lock_guard<std::mutex> lock(m_stats_mutex);
+    for (Strand& strand: m_strands)
+    {
+        std::lock_guard<std::mutex> strand_lock(strand.mutex);
+        strand.monitor.reset();
+    }
+    m_stats_start = EventLoopMonitor::now();
+}
+
+
+void ThreadPoolEventLoop::schedule(uint16_t strand)
+{
+    // Prefer the calling worker's own deque.
+    uint8_t index = (g_pool == this) ? g_worker : 
+        static_cast<uint8_t>(m_next_worker.fetch_add(1, std::memory_order_relaxed) % m_workers.size());
+
+    Worker& worker = *m_workers[index];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.strands.push_back(strand);
+    }
+    m_ready.fetch_add(1);
+
+    // Taking the lock ensures a worker cannot miss the notification between checking
+    // m_ready and waiting.
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+    }
+    m_sleep_condition.notify_one();
+}
+
+
+bool ThreadPoolEventLoop::take(uint8_t index, uint16_t& strand)
+{
+    // Own deque first, from the front so that strands run in the order they were scheduled.
+    {
+        Worker& worker = *m_workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.strands.empty())
+        {
+            strand = worker.strands.front();
+            worker.strands.pop_front();
+            return true;
+        }
+    }
+
+    // Steal from the back of the other deques.
+    const size_t count = m_workers.size();
+    for (size_t offset = 1; offset < count; ++offset)
+    {
+        Worker& victim = *m_workers[(index + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.strands.empty())
+        {
+            strand = victim.strands.back();
+            victim.strands.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void ThreadPoolEventLoop::run_strand(uint16_t index)
+{
+    Strand& strand = m_strands[index];
+
+    for (uint8_t count = 0; count < kBatchSize; ++count)
+    {
+        std::optional<Event> event;
+        {
+            std::lock_guard<std::mutex> lock(strand.mutex);
+            // The previous event's dispatch is recorded here to avoid taking the lock again.
+            if (count > 0) strand.monitor.on_dispatched();
+            if (strand.events.empty())
+            {
+                strand.scheduled = false;
+                return;
+            }
+            event = strand.events.front();
+            strand.events.pop_front();
+            strand.monitor.on_get(*event);
+        }
+
+        // This is called outside the scope of the mutex lock.
+        event->dispatch();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(strand.mutex);
+        strand.monitor.on_dispatched();
+        if (strand.events.empty())
+        {
+            strand.scheduled = false;
+            return;
+        }
+    }
+
+    // Still has events, so give the other strands a turn.
+    schedule(index);
+}
+
+
+void ThreadPoolEventLoop::exec_static(std::stop_token stoken, ThreadPoolEventLoop* self, uint8_t index)
+{
+    char name[16];
+    std::snprintf(name, sizeof(name), "%.10s-%u", self->m_name, index);
+    pthread_setname_np(pthread_self(), name);
+
+    set_thread_event_loop(self);
+    g_pool   = self;
+    g_worker = index;
+    self->exec(stoken, index);
+}
+
+
+void ThreadPoolEventLoop::exec(std::stop_token stoken, uint8_t index)
+{
+    while (!stoken.stop_requested())
+    {
+        uint16_t strand;
+        if (take(index, strand))
+        {
+            m_ready.fetch_sub(1);
+            run_strand(strand);
+            continue;
+        }
+
+        // Nothing to do anywhere, so block until a strand is scheduled.
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        m_sleep_condition.wait(lock, stoken, [this]{ return m_ready.load() > 0; });
+    }
+}
+
+
+} // namespace eg {
@@ -0,0 +1,136 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "signals/Signal.h"
+#include "event_loop/EventLoopStats.h"
+#include "utilities/NonCopyable.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+#if !defined(OTWAY_TARGET_PLATFORM_LINUX)
+#error This file is requires OTWAY_TARGET_PLATFORM_LINUX to be defined.
+#endif
+
+#if defined(OTWAY_LINUX_STATIC)
+#error ThreadPoolEventLoop is not available with OTWAY_LINUX_STATIC.
+#endif
+
+
+namespace eg {
+
+
+// An event loop which dispatches events on a pool of worker threads, so that CPU-heavy slots
+// can be spread across cores. 
+//
+// Ordering is preserved through serialisation keys. Each posted event is placed in a strand 
+// chosen by its key, and a strand is only ever run by one worker at a time, in FIFO order. 
+// The key is the signal, so the events from any one signal are dispatched in order. In 
+// addition, all the signals connected to member functions of the same object are given the
+// same key (see on_connect()). So an object whose slots were written for a single-threaded 
+// loop never has two of them called at once, and existing Signal::connect(obj, loop) code 
+// can move onto the pool unchanged. Distinct keys may share a strand, which only costs some 
+// parallelism.
+//
+// Strands which have events are scheduled on per-worker deques. A worker takes from the front
+// of its own deque and, when that is empty, steals from the back of the others. Events posted 
+// from a worker are scheduled on that worker's deque, which keeps related work on one core.
+//
+// The pool has no single queue, so the stats are kept per strand and added up by get_stats().
+// The peak depth is that of the deepest strand, and the idle time is the worker time since the
+// stats were reset which was not spent dispatching.
+class ThreadPoolEventLoop : public IEventLoop
+{
+    public:
+        // Zero workers means one per hardware thread.
+        ThreadPoolEventLoop(uint8_t workers = 0, const char* name = "pool");
+        ~ThreadPoolEventLoop();
+
+        void post(const Event& event) override;
+        void run() override {}
+        void stop();
+
+        void on_connect(const SignalBase& signal, const void* obj) override;
+
+        bool get_stats(EventLoopStats& stats) const override;
+        void reset_stats();
+
+        uint8_t get_worker_count() const { return static_cast<uint8_t>(m_workers.size()); }
+
+    private:
+        // A power of two. 
+        static constexpr uint16_t kStrands = 256;
+        // Events dispatched from a strand before it goes to the back of the deque, 
+        // for fairness between strands.
+        static constexpr uint8_t kBatchSize = 8;
+        // A power of two. 
+        static constexpr uint8_t kKeyShards = 16;
+
+        struct Strand
+        {
+            mutable std::mutex mutex;
+            std::deque<Event>  events;
+            bool               scheduled{};  // In a deque or being run by a worker.
+            EventLoopMonitor   monitor{};
+        };
+
+        // Part of the map from each signal or object to the key of its group.
+        struct KeyShard
+        {
+            std::mutex                                   mutex;
+            std::unordered_map<const void*, const void*> keys;
+        };
+
+        struct Worker
+        {
+            std::mutex           mutex;
+            std::deque<uint16_t> strands;
+            std::jthread         thread;
+        };
+
+    private:
+        static void exec_static(std::stop_token stoken, ThreadPoolEventLoop* self, uint8_t index);
+        void exec(std::stop_token stoken, uint8_t index);
+
+        KeyShard&   get_shard(const void* node);
+        const void* find_key(const void* node);
+        void        schedule(uint16_t strand);
+        bool        take(uint8_t index, uint16_t& strand);
+        void        run_strand(uint16_t strand);
+
+    private:
+        const char*                          m_name;
+        std::array<Strand, kStrands>         m_strands;
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        std::atomic<uint32_t>                m_next_worker{};
+        std::atomic<int32_t>                 m_ready{};   // Number of scheduled strands waiting in the deques.
+        std::mutex                           m_sleep_mutex;
+        std::condition_variable_any          m_sleep_condition;
+
+        // Signals and objects are grouped when connections are made, and each post looks up 
+        // the key of its signal's group. The lookups are spread over shards so that posts 
+        // of different signals do not contend for a lock. m_groups holds the members of each 
+        // group by key, and is used only by on_connect().
+        std::array<KeyShard, kKeyShards>                               m_shards;
+        std::mutex                                                     m_groups_mutex;
+        std::unordered_map<const void*, std::vector<const void*>>      m_groups;
+
+        mutable std::mutex m_stats_mutex;
+        uint32_t           m_stats_start{EventLoopMonitor::now()};
+};
+
+
+} // namespace eg {
@@ -34,6 +34,7 @@ public:
         eUnalignedAddress, 
         eUnalignedSize,
         eFlashFailed,
+        eBusy,            // Could not start now, e.g. waiting for a background erase. Try again later.
     };
     static constexpr uint32_t kInvalidArgument = 0xFFFF'FFFF;
     static constexpr uint32_t kInvalidAddress  = 0xFFFF'FFFF;
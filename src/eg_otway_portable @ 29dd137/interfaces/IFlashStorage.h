@@ -52,6 +52,28 @@ namespace eg
         uint32_t SectorNumber;
     };
 
+    /**
+    * @brief One buffer of a scatter/gather read. The data may run on from the offset into the following sectors.
+    */
+    struct FlashReadSegment_t
+    {
+        uint32_t SectorNumber;
+        uint32_t Offset;
+        uint8_t* Buffer;
+        uint32_t Length;
+    };
+
+    /**
+    * @brief One buffer of a gather write. The data may run on from the offset into the following sectors.
+    */
+    struct FlashWriteSegment_t
+    {
+        uint32_t       SectorNumber;
+        uint32_t       Offset;
+        const uint8_t* Buffer;
+        uint32_t       Length;
+    };
+
     /**
      * @brief The interface for a Flash Device
      */
@@ -118,6 +140,9 @@ namespace eg
         * @param[in] buffer The buffer to read into.
         * @param[in] lengthToRead The number of bytes to read
         * @param[in] callback A callback that will be called upon completion, giving an indication of success or failure. Might be called in interrupt context.
+        * 
+        * The read may run on from the offset into the following sectors. If another operation is in progress the read is queued, 
+        * and completion is signalled when it has been done.
         */
 	    virtual FlashOperationStatus Read(uint32_t sectorNumber, uint32_t offset, uint8_t* buffer, uint32_t lengthToRead) = 0;
 
@@ -133,11 +158,34 @@ namespace eg
         * writing to it with this method.  The application code may choose to write to the erased sector however it wishes, perhaps with
         * multiple calls to Write() addressing different parts of sector, and for this reason the Write() method needs to take into account that
         * locations adjacent to where it is writing may already have data in that needs preserving.
+        * 
+        * As for Read(), the write may run on into the following sectors, and is queued if another operation is in progress. The offset 
+        * and length must be multiples of GetWriteSize(). A queued write reads the buffer when it starts, so it must remain valid until completion.
         */
 	    virtual FlashOperationStatus Write(uint32_t sectorNumber, uint32_t offset, const uint8_t* buffer, uint32_t lengthToWrite) = 0;
+
+        /**
+        * @brief Reads into a list of buffers as one operation
+        * @param[in] segments Where to read from, and the buffers to read into. The list is copied, but the buffers must remain valid until completion.
+        * @param[in] count The number of segments
+        * 
+        * A single completion is signalled, for the first segment's sector, once all the segments have been read or one has failed.
+        */
+	    virtual FlashOperationStatus ReadSegments(const FlashReadSegment_t* segments, uint32_t count) = 0;
+
+        /**
+        * @brief Writes a list of buffers as one operation
+        * @param[in] segments Where to write to, and the data to write. The list is copied, but the buffers must remain valid until completion.
+        * @param[in] count The number of segments
+        * @param[in] eraseFirst Erase each sector before the first write to it. The segments must then be in address order.
+        * 
+        * A single completion is signalled, as for ReadSegments(). A failure stops the operation, so the later segments are not written.
+        */
+	    virtual FlashOperationStatus WriteSegments(const FlashWriteSegment_t* segments, uint32_t count, bool eraseFirst) = 0;
             
         /**
-            * @brief Signals that the read/write or erase currently in progress should be aborted.
+            * @brief Signals that the read/write or erase currently in progress should be aborted, and drops any which are queued.
+            * Each operation dropped is completed with FlashOperationStatus::Aborted.
             */
         virtual void Abort() = 0;
 
@@ -145,6 +193,9 @@ namespace eg
         * @brief Check and the result of the last operation and clear the status
         * 
         * Returns the staus of the last operation
+        * 
+        * For a blocking driver, whose operations are finished when they return, this also forgets the one in progress so that the next 
+        * request starts at once rather than being queued. Its completion is still signalled. Queued requests are left to run.
         */
 	    virtual FlashOperationStatus CheckAndClearStatus() = 0;
 
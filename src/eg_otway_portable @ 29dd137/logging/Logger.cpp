@@ -16,9 +16,22 @@
 namespace eg {
 
 
+namespace {
+
+// The logger has its own lock so that logging doesn't serialise with unrelated critical 
+// sections on Linux.
+LockDomain& lock_domain()
+{
+    static LockDomain domain{"logger"};
+    return domain;
+}
+
+} // namespace {
+
+
 void Logger::raw(const char* format, ...)
 {
-    CriticalSection cs;
+    CriticalSection cs{lock_domain()};
 
     va_list args;
     va_start(args, format);
@@ -44,7 +57,7 @@ void Logger::write(Level level, const char* file, long line, const char* functio
 
 void Logger::write(const char* level_name, const char* file, long line, const char* function, const char* format, va_list args)
 {
-    CriticalSection cs;
+    CriticalSection cs{lock_domain()};
 
     // Log level - leave some space in the buffer for a final \n and null.
     int buflen = kBufferSize - 1;
@@ -197,21 +210,21 @@ const char* Logger::level_name(Level level)
 
 void Logger::register_ticker(GetTickFunc get_tick_func)
 {
-    CriticalSection cs;
+    CriticalSection cs{lock_domain()};
     m_get_tick_func = get_tick_func;
 }
 
 
 void Logger::register_datetime_source(GetDateTimeFunc get_datetime_func)
 {
-    CriticalSection cs;
+    CriticalSection cs{lock_domain()};
     m_get_datetime_func = get_datetime_func;
 }
 
 
 bool Logger::register_backend(ILoggerBackend& backend)
 {
-    CriticalSection cs;
+    CriticalSection cs{lock_domain()};
 
     // Check if already registered.
     for (uint8_t i = 0; i < kMaxBackends; ++i)
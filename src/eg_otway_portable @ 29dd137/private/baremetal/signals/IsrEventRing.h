@@ -0,0 +1,174 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once 
+#include "SignalBase.h"
+#include "SignalEvent.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+
+namespace eg {
+
+
+// A bounded lock-free queue of small events, used by Signal::emit_from_isr(). Any number of
+// ISRs (including nested ones at different priorities) may push, and only the owning event 
+// loop pops. Each slot carries a sequence number which tells producers whether it is free 
+// and the consumer whether it is complete, so pushing is one compare-and-swap plus a small
+// copy: no critical section, no virtual call and no modulo. 
+//
+// Slots are much smaller than an Event. Signals with up to kMaxData bytes of arguments can 
+// use emit_from_isr(), and zero-argument signals (the common case for ISRs) write only the 
+// signal pointer. The number of slots must be a power of two.
+class IsrEventRing
+{
+public:
+    static constexpr uint8_t kMaxData = 8;
+
+    struct Slot
+    {
+        std::atomic<uint32_t> sequence{};
+        const SignalBase*     signal{};
+        uint32_t              timestamp{};
+        uint8_t               length{};
+        alignas(uint32_t) uint8_t data[kMaxData]{};
+    };
+
+    // Used to timestamp events for the loop's statistics. Optional.
+    using ClockFunc = uint32_t (*)();
+
+public:
+    IsrEventRing(Slot* slots, uint16_t size)
+    : m_slots{slots}
+    , m_mask{static_cast<uint16_t>(size - 1U)}
+    {
+    }
+
+    void set_clock(ClockFunc clock) { m_clock = clock; }
+
+    // Mark all slots free. Must be called before use, and not while in use.
+    void reset()
+    {
+        for (uint32_t index = 0; index <= m_mask; ++index)
+        {
+            m_slots[index].sequence.store(index, std::memory_order_relaxed);
+        }
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail = 0;
+    }
+
+    // Called from any context. Returns false if the ring is full.
+    bool push(const SignalBase& signal, const void* data, uint8_t length)
+    {
+        uint32_t pos = m_head.load(std::memory_order_relaxed);
+        Slot*    slot;
+        while (true)
+        {
+            slot = &m_slots[pos & m_mask];
+            const uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const auto     diff     = static_cast<int32_t>(sequence - pos);
+            if (diff == 0)
+            {
+                // The slot is free: claim it. On failure pos is updated to the new head.
+                if (m_head.compare_exchange_weak(pos, pos + 1U, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                // The slot still holds an event from the previous lap: full.
+                return false;
+            }
+            else
+            {
+                // Another producer claimed it first.
+                pos = m_head.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->signal    = &signal;
+        slot->timestamp = m_clock ? m_clock() : 0U;
+        slot->length    = length;
+        if (length > 0)
+        {
+            std::memcpy(slot->data, data, length);
+        }
+        // Publish the slot to the consumer.
+        slot->sequence.store(pos + 1U, std::memory_order_release);
+        return true;
+    }
+
+    // Called only from the owning loop. Returns false if there is no complete event at the 
+    // front of the ring.
+    bool pop(Event& event)
+    {
+        Slot& slot = m_slots[m_tail & m_mask];
+        if (slot.sequence.load(std::memory_order_acquire) != (m_tail + 1U))
+        {
+            return false;
+        }
+
+        event.m_signal    = slot.signal;
+        event.m_timestamp = slot.timestamp;
+        event.m_length    = slot.length;
+        if (slot.length > 0)
+        {
+            std::memcpy(event.m_data, slot.data, slot.length);
+        }
+
+        // Free the slot for the producers' next lap.
+        slot.sequence.store(m_tail + m_mask + 1U, std::memory_order_release);
+        ++m_tail;
+        return true;
+    }
+
+    // Only meaningful in the owning loop.
+    bool empty() const
+    {
+        return m_slots[m_tail & m_mask].sequence.load(std::memory_order_acquire) != (m_tail + 1U);
+    }
+
+private:
+    Slot*                 m_slots;
+    uint16_t              m_mask;
+    ClockFunc             m_clock{};
+    std::atomic<uint32_t> m_head{};
+    uint32_t              m_tail{};
+};
+
+
+// Helper to combine the ring and its storage.
+template <uint16_t SIZE>
+class IsrEventRingArray : public IsrEventRing
+{
+    static_assert((SIZE > 0) && ((SIZE & (SIZE - 1U)) == 0), "The size must be a power of two");
+
+public:
+    IsrEventRingArray()
+    : IsrEventRing{&m_items[0], SIZE}
+    {        
+        reset();
+    }
+
+private:
+    Slot m_items[SIZE]{};
+};
+
+
+inline void IEventLoop::post_from_isr(const SignalBase& signal, const void* data, uint8_t length)
+{
+    if (!m_isr_ring || !m_isr_ring->push(signal, data, length))
+    {
+        post_from_isr_fallback(signal, data, length);
+    }
+}
+
+
+} // namespace eg {
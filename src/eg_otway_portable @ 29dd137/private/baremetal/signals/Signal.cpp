@@ -43,10 +43,17 @@ uint16_t SignalBase::pool_free()
 }
 
 
+LockDomain& SignalBase::lock_domain()
+{
+    static LockDomain domain{"signals"};
+    return domain;
+}
+
+
 SignalBase::~SignalBase()
 {
     // Walk the collection of connected callbacks, unhook them all, and free them.
-    CriticalSection cs;
+    CriticalSection cs{lock_domain()};
     while (m_head)
     {
         DummyLink* head = m_head;
@@ -110,7 +117,7 @@ void* SignalBase::connect(void* link_in)
 
 bool SignalBase::disconnect(void* data)
 {
-    CriticalSection cs;
+    CriticalSection cs{lock_domain()};
 
     bool result = false;
 
@@ -171,6 +178,20 @@ bool SignalBase::disconnect(void* data)
 }
 
 
+// The ISR ring is full or the loop does not have one. This takes the slow path through
+// the loop's normal queue, so the event is not lost.
+void IEventLoop::post_from_isr_fallback(const SignalBase& signal, const void* data, uint8_t length)
+{
+    Event event{signal};
+    if (length > 0)
+    {
+        std::memcpy(event.m_data, data, length);
+    }
+    event.m_length = length;
+    post(event);
+}
+
+
 // Called from the signal template to allocate a new link to store a new connection.
 void* SignalBase::alloc_link()
 {
@@ -9,6 +9,7 @@
 #pragma once
 #include "SignalBase.h"
 #include "SignalEvent.h"
+#include "IsrEventRing.h"
 #include "SignalNArg.h"
 #include "SignalProxy.h"
 
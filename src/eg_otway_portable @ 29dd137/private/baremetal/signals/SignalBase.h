@@ -9,6 +9,7 @@
 #pragma once 
 #include <cstdint>
 #include "utilities/NonCopyable.h"
+#include "utilities/LockDomain.h"
 
 
 namespace eg {
@@ -17,6 +18,13 @@ namespace eg {
 // All events posted to event queues are of this type.
 class Event;
 
+// Load and latency telemetry for event loops. See event_loop/EventLoopStats.h.
+struct EventLoopStats;
+
+// Lock-free queue used by Signal::emit_from_isr(). See IsrEventRing.h.
+class IsrEventRing;
+class SignalBase;
+
 
 // Interface for all event loops which are used in conjunction with Signals.
 class IEventLoop : private NonCopyable
@@ -28,10 +36,24 @@ public:
     virtual void post(const Event& event) = 0;
     // Dispatch any pending events. Typically does not return.
     virtual void run() = 0;
+    // Copy the loop's statistics, if it maintains any, and return whether it does. 
+    virtual bool get_stats(EventLoopStats& stats) const { (void)stats; return false; }
 #if defined(OTWAY_EVENT_LOOP_WATER_MARK)
     // Retrieves the high water mark of the event loop.
     virtual uint16_t get_high_water_mark() const = 0;
 #endif
+
+    // Fast path used by Signal::emit_from_isr(). This is deliberately not virtual: if the
+    // loop has an ISR ring the event is placed in it without locking, else (or if the ring
+    // is full) it falls back to post(). Defined in IsrEventRing.h.
+    void post_from_isr(const SignalBase& signal, const void* data, uint8_t length);
+
+protected:
+    // Set by loops which support the fast path, e.g. BareMetalEventLoop.
+    IsrEventRing* m_isr_ring{};
+
+private:
+    void post_from_isr_fallback(const SignalBase& signal, const void* data, uint8_t length);
 };
 
 
@@ -69,6 +91,10 @@ protected:
     static void  free_link(void* link);
 	void* connect(void* conn);
 
+    // Connections are guarded by their own lock domain (only relevant on Linux), so that
+    // they don't serialise with unrelated critical sections.
+    static LockDomain& lock_domain();
+
 protected:
     DummyLink* m_head{};
 };
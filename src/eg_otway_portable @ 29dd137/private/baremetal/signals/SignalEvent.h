@@ -80,6 +80,8 @@ public:
 public:
     const SignalBase* m_signal{};
     uint16_t          m_length{};
+    // Time at which the event was posted, set by the event loop for its statistics.
+    uint32_t          m_timestamp{};
     uint8_t           m_data[kMaxEventData] = {};
 };
 
@@ -148,7 +148,7 @@ public:
             loop = &this_event_loop();
 
         // Better to set up all the connections from a single thread during initialisation.
-        CriticalSection cs;
+        CriticalSection cs{lock_domain()};
 
         SignalLink* link  = static_cast<SignalLink*>(alloc_link());
         link->loop        = loop;
@@ -179,7 +179,7 @@ public:
             loop = &this_event_loop();
 
         // Better to set up all the connections from a single thread during initialisation.
-        CriticalSection cs;
+        CriticalSection cs{lock_domain()};
 
         SignalLink* link  = static_cast<SignalLink*>(alloc_link());
         link->loop        = loop;
@@ -214,19 +214,53 @@ public:
     void emit(const Args&... args) const
     {
         DummyLink* link = m_head;
-        while (link)
+        if (!link)
         {
-            //Event must be constructed for each link head (i.e. recieving task)
-            //so that a copy of the arguments is constructed for each
-            //and therefore can be destructed for each dispatch safely
-            Event event(*this);
-            (event.pack(args), ...);
+            return;
+        }
 
+        // The arguments are packed once and the same event is posted to each loop (i.e. 
+        // receiving task). Each loop copies it into its own queue, so there is nothing to 
+        // share or destroy. This is safe because the arguments must be trivially copyable.
+        Event event(*this);
+        (event.pack(args), ...);
+        while (link)
+        {
             link->loop->post(event);
             link = link->next_head;
         }
     }
 
+    // A cheaper emit() for use in ISRs. Events go into each loop's lock-free IsrEventRing, if 
+    // it has one, rather than through the virtual post() with a critical section and a full
+    // Event copy. Zero-argument signals write only the signal pointer. The arguments are 
+    // limited to IsrEventRing::kMaxData bytes. Events from the ring may be dispatched ahead 
+    // of events posted with emit(), so don't mix the two for the same signal in one ISR.
+    void emit_from_isr(const Args&... args) const
+    {
+        static_assert((sizeof(Args) + ... + 0) <= IsrEventRing::kMaxData, "Arguments too big for emit_from_isr()");
+
+        if constexpr (sizeof...(Args) == 0)
+        {
+            for (DummyLink* link = m_head; link; link = link->next_head)
+            {
+                link->loop->post_from_isr(*this, nullptr, 0);
+            }
+        }
+        else
+        {
+            // Same layout as Event::pack().
+            alignas(uint32_t) uint8_t data[(sizeof(Args) + ...)];
+            uint8_t offset = 0;
+            ((std::memcpy(&data[offset], &args, sizeof(Args)), offset += sizeof(Args)), ...);
+
+            for (DummyLink* link = m_head; link; link = link->next_head)
+            {
+                link->loop->post_from_isr(*this, data, sizeof(data));
+            }
+        }
+    }
+
     // ...unpack the argument data now that the scheduler has dispatched the event,
     // and make the delayed call to the connected functions, if any.
 	virtual void dispatch(const Event& event) const override
@@ -35,6 +35,7 @@ Event::Event()
 Event::Event(const Event& other)
 : m_signal(other.m_signal)
 , m_length(other.m_length)
+, m_timestamp(other.m_timestamp)
 {
     std::memcpy(&m_data[0], &other.m_data[0], m_length);
 }
@@ -43,8 +44,9 @@ Event::Event(const Event& other)
 // Assignment operator copies only as many bytes as are used in the data.
 Event& Event::operator=(const Event& other)
 {
-    m_signal = other.m_signal;
-    m_length = other.m_length;
+    m_signal    = other.m_signal;
+    m_length    = other.m_length;
+    m_timestamp = other.m_timestamp;
     std::memcpy(&m_data[0], &other.m_data[0], m_length);
     return *this;
 }
@@ -17,6 +17,12 @@ namespace eg {
 // All events posted to event queues are of this type.
 class Event;
 
+// Load and latency telemetry for event loops. See event_loop/EventLoopStats.h.
+struct EventLoopStats;
+
+// Base class for all signals. 
+class SignalBase;
+
 
 // Interface for all event loops which are used in conjunction with Signals.
 class IEventLoop : private NonCopyable
@@ -28,6 +34,11 @@ public:
     virtual void post(const Event& event) = 0;
     // Dispatch any pending events. Typically does not return.
     virtual void run() = 0;
+    // Copy the loop's statistics, if it maintains any, and return whether it does. 
+    virtual bool get_stats(EventLoopStats& stats) const { (void)stats; return false; }
+    // Notification that a member function of obj has been connected to signal in this loop. 
+    // A loop which dispatches in parallel uses this to serialise all the slots of an object.
+    virtual void on_connect(const SignalBase& signal, const void* obj) { (void)signal; (void)obj; }
 };
 
 
@@ -53,6 +53,7 @@ public:
             (obj->*SlotFunc)(args...);
         }};
         connect(handler, loop);
+        loop.on_connect(*this, obj);
         return nullptr;
     }
 
@@ -91,14 +92,27 @@ public:
     {
         // This lock should be redundant if no more handlers are connected after initialisation phase.
         //std::lock_guard lock{m_mutex};        
+        if (m_connections.empty())
+        {
+            return;
+        }
+
+        // Pack once and post the same event to each loop, which copies it into its queue.
+        Event event(*this);
+        (event.pack(args), ... );
         for (const auto& [loop, handlers]: m_connections)
         {
-            Event event(*this);
-            (event.pack(args), ... );
             loop->post(event);
         }
     }
 
+    // For source compatibility with the bare metal implementation. There is no separate
+    // fast path on Linux.
+    void emit_from_isr(const Args& ...args) const
+    {
+        emit(args...);
+    }
+
 
     // Unpack the argument data now that the scheduler has dispatched the event,
     // and make the delayed call to the connected functions for the current thread,
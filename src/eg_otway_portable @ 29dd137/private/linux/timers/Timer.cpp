@@ -11,6 +11,7 @@
 #include <condition_variable>
 #include <mutex>
 #include <thread>
+#include <algorithm>
 //#include </usr/include/pthread.h>
 
 
@@ -31,13 +32,26 @@ class TimerQueue : private NonCopyable
         // These are called by the Timer implemenation.
         void insert(Timer* timer);
         void remove(Timer* timer);
+        bool is_running(const Timer* timer);
+        uint32_t get_ticks_remaining(const Timer* timer);
+        uint32_t get_tick_count();
+
+        // Virtual time support.
+        void set_virtual_time(bool enabled);
+        bool is_virtual_time();
+        void advance_virtual_time(uint32_t ticks);
+
+        void set_thread_config(const ThreadConfig& config);
 
     private:
+        using TimePoint = std::chrono::steady_clock::time_point;
+
         // Queue management
         void insert_impl(Timer* timer);
         void remove_impl(Timer* timer);
         void reinsert_impl(Timer::Link* timer);
-        void on_timeout();
+        void on_timeout(TimePoint now);
+        TimePoint now() const;
 
         // Thread execution
         static void exec_static(std::stop_token stoken, TimerQueue* self);
@@ -49,6 +63,14 @@ class TimerQueue : private NonCopyable
         std::condition_variable_any m_condition;
         bool                        m_changed{};
         Timer::Link*                m_head{};
+        // Reference point for get_tick_count().
+        TimePoint                   m_epoch{std::chrono::steady_clock::now()};
+        // When m_virtual is set, m_virtual_now replaces the steady clock.
+        bool                        m_virtual{};
+        TimePoint                   m_virtual_now{};
+        // Applied by the thread when it next wakes.
+        ThreadConfig                m_config{};
+        bool                        m_config_pending{};
 };
 
 
@@ -92,9 +114,10 @@ void TimerQueue::exec(std::stop_token stoken)
     {
         std::unique_lock<std::mutex> lock(m_mutex);
 
-        if (!m_head)
+        if (!m_head || m_virtual)
         {
             // Wake up when the queue is modified (i.e. a timer is started) or the queue is destroyed.
+            // In virtual time, expiries are handled by advance_virtual_time() rather than by this thread.
             m_condition.wait(lock, stoken, [this]{ return m_changed; });
         }
         else
@@ -106,11 +129,17 @@ void TimerQueue::exec(std::stop_token stoken)
         }
         if (stoken.stop_requested()) break;
 
+        if (m_config_pending)
+        {
+            apply_thread_config(m_config);
+            m_config_pending = false;
+        }
+
         // Starting or stopping a timer forces a "spurious" wake up so we can restart the waiting
         // with the revised m_head expiry time. Check here for any that have actually expired.
-        if (m_head && (m_head->expiry <= std::chrono::steady_clock::now()))
+        if (!m_virtual)
         {
-            on_timeout();
+            on_timeout(now());
         }
 
         // This stop condition is set whenever a timer is started or stopped, forcing the current
@@ -120,42 +149,51 @@ void TimerQueue::exec(std::stop_token stoken)
 }
 
 
-void TimerQueue::on_timeout()
+TimerQueue::TimePoint TimerQueue::now() const
 {
-    // Already locked as this is called from TimerQueue::exec() after the condition variable forces a wakeup.
+    // Already locked by caller
+    return m_virtual ? m_virtual_now : std::chrono::steady_clock::now();
+}
+
+
+void TimerQueue::on_timeout(TimePoint now)
+{
+    // Already locked as this is called from TimerQueue::exec() after the condition variable forces a wakeup,
+    // or from advance_virtual_time().
     //std::lock_guard<std::mutex> lock(m_mutex);
 
-    if (m_head)
+    while (m_head && (m_head->expiry <= now))
     {
-        auto now = std::chrono::steady_clock::now();
-        while (m_head && (m_head->expiry <= now))
+        // Remove the head item when its expiry time has passed, and emit an event from the
+        // software timer it represents.
+        Timer::Link* link = m_head;
+        m_head = m_head->next;
+        if (m_head)
         {
-            // Remove the head item when its tick count reaches zero, and emit an event from the
-            // software timer it represents.
-            Timer::Link* link = m_head;
-            m_head = m_head->next;
-            if (m_head)
-            {
-                m_head->prev = nullptr;
-            }
+            m_head->prev = nullptr;
+        }
 
-            // Note that emit() is called with m_mutex locked. This is fine since we are just
-            // placing an event in one or more queues (in EventLoops). There is a potential for
-            // deadlock if we use call() instead (synchronous): if a timer callback tries to
-            // start or stop a timer.
-            link->timer->emit();
+        // Note that emit() is called with m_mutex locked. This is fine since we are just
+        // placing an event in one or more queues (in EventLoops). There is a potential for
+        // deadlock if we use call() instead (synchronous): if a timer callback tries to
+        // start or stop a timer.
+        link->timer->emit();
 
-            link->next = nullptr;
-            link->prev = nullptr;
+        link->next = nullptr;
+        link->prev = nullptr;
 
-            // Re-insert the item if if is for a recurring timer.
-            if (link->timer->m_type == Timer::Type::Repeating)
-            {
-                // This would possibly drift forward in time due to delays.
-                // link->expiry = now + link->timer->m_period;
-                link->expiry += link->timer->m_period;
-                reinsert_impl(link);
-            }
+        // Re-insert the item if if is for a recurring timer.
+        if (link->timer->m_type == Timer::Type::Repeating)
+        {
+            // This would possibly drift forward in time due to delays.
+            // link->expiry = now + link->timer->m_period;
+            link->expiry += Timer::Millis{link->timer->m_period};
+            reinsert_impl(link);
+        }
+        else
+        {
+            // Make sure a OneShot timer is marked as not running once it fires.
+            link->timer->m_is_running = false;
         }
     }
 }
@@ -165,8 +203,9 @@ void TimerQueue::insert(Timer* timer)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
 
-    timer->m_link.expiry = std::chrono::steady_clock::now() + timer->m_period;
     remove_impl(timer);
+    timer->m_link.expiry = now() + Timer::Millis{timer->m_period};
+    timer->m_is_running  = true;
     insert_impl(timer);
 
     // Wake up the thread
@@ -180,6 +219,92 @@ void TimerQueue::remove(Timer* timer)
     std::lock_guard<std::mutex> lock(m_mutex);
 
     remove_impl(timer);
+    timer->m_is_running = false;
+
+    // Wake up the thread
+    m_changed = true;
+    m_condition.notify_one();
+}
+
+
+bool TimerQueue::is_running(const Timer* timer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return timer->m_is_running;
+}
+
+
+uint32_t TimerQueue::get_ticks_remaining(const Timer* timer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!timer->m_is_running) return 0;
+
+    // The link holds the absolute expiry time, so there is no need to walk the list. Round
+    // up so that a timer which has not yet fired never reports zero ticks remaining.
+    auto remaining = timer->m_link.expiry - now();
+    if (remaining.count() <= 0) return 0;
+    auto ticks = std::chrono::ceil<Timer::Millis>(remaining).count();
+    return static_cast<uint32_t>(ticks);
+}
+
+
+uint32_t TimerQueue::get_tick_count()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto ticks = std::chrono::duration_cast<Timer::Millis>(now() - m_epoch).count();
+    return static_cast<uint32_t>(ticks);
+}
+
+
+void TimerQueue::set_virtual_time(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (enabled && !m_virtual)
+    {
+        // Virtual time starts from the current real time so that running timers keep
+        // their remaining periods.
+        m_virtual_now = std::chrono::steady_clock::now();
+    }
+    m_virtual = enabled;
+
+    // Wake up the thread so that it stops (or starts) waiting on the head expiry.
+    m_changed = true;
+    m_condition.notify_one();
+}
+
+
+bool TimerQueue::is_virtual_time()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_virtual;
+}
+
+
+void TimerQueue::advance_virtual_time(uint32_t ticks)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_virtual) return;
+
+    // Step through the expiries one at a time so that the virtual clock reads the expiry
+    // time of each timer as it fires. Repeating timers may fire several times.
+    TimePoint target = m_virtual_now + Timer::Millis{ticks};
+    while (m_head && (m_head->expiry <= target))
+    {
+        m_virtual_now = std::max(m_virtual_now, m_head->expiry);
+        on_timeout(m_virtual_now);
+    }
+    m_virtual_now = target;
+}
+
+
+void TimerQueue::set_thread_config(const ThreadConfig& config)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_config         = config;
+    m_config_pending = true;
 
     // Wake up the thread
     m_changed = true;
@@ -287,13 +412,27 @@ void TimerQueue::remove_impl(Timer* timer)
 }
 
 
-void Timer::start(Millis period, Type type)
+Timer::Timer(uint32_t period, Type type)
+: m_period{period}
+, m_type{type}
+{
+}
+
+
+// Timers generally live forever, but should clean up the timer queue if they do go out of scope.
+// Call the equivalent of Timer::stop() in the deconstructor to avoid a call to a virtual function during deconstruction.
+Timer::~Timer()
+{
+    timer_queue().remove(this);
+}
+
+
+void Timer::start()
 {
     // Period cannot be zero. What is reasonable minimum in Linux?
-    if (period.count() < 1) return;
+    if (m_period < 1) return;
 
-    m_period = period;
-    m_type   = type;
+    // Also performs restart() if timer is running already.
     timer_queue().insert(this);
 }
 
@@ -304,4 +443,57 @@ void Timer::stop()
 }
 
 
+bool Timer::is_running() const
+{
+    return timer_queue().is_running(this);
+}
+
+
+uint32_t Timer::get_ticks_remaining() const
+{
+    return timer_queue().get_ticks_remaining(this);
+}
+
+
+uint32_t Timer::get_tick_count()
+{
+    return timer_queue().get_tick_count();
+}
+
+
+void Timer::set_virtual_time(bool enabled)
+{
+    timer_queue().set_virtual_time(enabled);
+}
+
+
+bool Timer::is_virtual_time()
+{
+    return timer_queue().is_virtual_time();
+}
+
+
+void Timer::advance_virtual_time(uint32_t ticks)
+{
+    timer_queue().advance_virtual_time(ticks);
+}
+
+
+void Timer::set_thread_config(const ThreadConfig& config)
+{
+    timer_queue().set_thread_config(config);
+}
+
+
+void Timer::start(Millis period, Type type)
+{
+    // Period cannot be zero. What is reasonable minimum in Linux?
+    if (period.count() < 1) return;
+
+    m_period = static_cast<uint32_t>(period.count());
+    m_type   = type;
+    start();
+}
+
+
 } // namespace eg
@@ -2,14 +2,17 @@
 // (c) eg technology ltd, 2024.  All rights reserved.
 //
 // This software is the property of eg technology ltd. and may not be copied or reproduced
-// otherwise than on to a single hard disk for backup or archival purposes. The source code 
-// is confidential information and must not be disclosed to third parties or used without 
+// otherwise than on to a single hard disk for backup or archival purposes. The source code
+// is confidential information and must not be disclosed to third parties or used without
 // the express written permission of eg technology ltd.
 /////////////////////////////////////////////////////////////////////////////////////////////
 #pragma once
+#include "timers/ITimer.h"
 #include "signals/Signal.h"
 #include "utilities/NonCopyable.h"
+#include "utilities/ThreadConfig.h"
 #include <chrono>
+#include <cstdint>
 
 
 namespace eg {
@@ -19,18 +22,53 @@ namespace eg {
 // useful as a member of another class such as a state machine, in which it can be used to generate timeouts
 // and other events which drive the state. Simply connect a member function to the exposed Signal object, and
 // then start or stop the timer wherever makes sense. See the Blinky example.
-class Timer : private NonCopyable
+//
+// The Linux implementation has the same API as the bare metal implementation (ITimer). One tick is one
+// millisecond. Running timers are serviced by a worker thread which follows std::chrono::steady_clock,
+// unless virtual time is enabled (see below).
+class Timer : public ITimer, private NonCopyable
 {
     public:
         using Millis = std::chrono::milliseconds;
-        enum class Type { OneShot, Repeating };
 
-        ~Timer() { stop(); }
+    public:
+        Timer(uint32_t period = 1, Type type = Type::OneShot);
+        ~Timer();
 
-        void start(Millis period, Type type);
-        void stop();
+        uint32_t get_period() const override          { return m_period; }
+        void     set_period(uint32_t period) override { stop(); m_period = period; }
+
+        Type get_type() const override    { return m_type; }
+        void set_type(Type type) override { stop(); m_type = type; }
+
+        bool is_running() const override;
+
+        void start() override;
+        void stop() override;
 
-        SignalProxy<> on_timer() { return SignalProxy<>{m_signal}; }
+        // This is O(1) because each running timer holds its absolute expiry time.
+        uint32_t get_ticks_remaining() const override;
+
+        SignalProxy<> on_update() override { return SignalProxy<>{m_signal}; }
+
+        // Milliseconds since the timer queue was created, or the virtual time if it is enabled.
+        static uint32_t get_tick_count();
+
+        // Deterministic virtual time for host-side testing and benchmarking. When enabled, the timer
+        // queue stops following the steady clock. Time advances only when advance_virtual_time() is
+        // called, and expired timers emit their signals from the calling thread in order of expiry.
+        // Timer-heavy code can then run as fast as the CPU allows, with repeatable results.
+        static void set_virtual_time(bool enabled);
+        static bool is_virtual_time();
+        static void advance_virtual_time(uint32_t ticks);
+
+        // Real-time configuration for the thread which services the timers. This is applied 
+        // by that thread the next time it wakes, which is immediately. 
+        static void set_thread_config(const ThreadConfig& config);
+
+        // Legacy API retained for existing Linux applications. Prefer the ITimer API above.
+        void start(Millis period, Type type);
+        SignalProxy<> on_timer() { return on_update(); }
 
     private:
         void emit() { m_signal.emit(); }   // Asynchronous - place an event in one or more event loops
@@ -53,8 +91,9 @@ class Timer : private NonCopyable
         friend class TimerQueue;
 
     private:
-        Millis   m_period{};
-        Type     m_type{};
+        uint32_t m_period{1};
+        Type     m_type{Type::OneShot};
+        bool     m_is_running{false};
         Signal<> m_signal{};
         Link     m_link{};
 };
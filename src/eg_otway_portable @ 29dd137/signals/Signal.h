@@ -7,9 +7,11 @@
 // the express written permission of eg technology ltd.
 /////////////////////////////////////////////////////////////////////////////////////////////
 #pragma once
-#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+// OTWAY_LINUX_STATIC selects the pooled bare metal signals on Linux, so that no heap is
+// used after initialisation. They are made thread safe by the Linux CriticalSection.
+#if defined(OTWAY_TARGET_PLATFORM_LINUX) && !defined(OTWAY_LINUX_STATIC)
 #include "private/linux/signals/Signal.h"
-#elif defined(OTWAY_TARGET_PLATFORM_BAREMETAL) || defined(OTWAY_TARGET_PLATFORM_FREERTOS)
+#elif defined(OTWAY_TARGET_PLATFORM_BAREMETAL) || defined(OTWAY_TARGET_PLATFORM_FREERTOS) || defined(OTWAY_LINUX_STATIC)
 #include "private/baremetal/signals/Signal.h"
 #else
 #error OTWAY_TARGET_PLATFORM must be set in CMake. See Otway Portable library README.md.
@@ -0,0 +1,498 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#if defined(OTWAY_TARGET_PLATFORM_BAREMETAL) 
+
+#include "gtest/gtest.h"
+#include "event_loop/BareMetalEventLoop.h"
+#include "TestSingleThreadedUtils.h"
+#include <thread>
+#include <vector>
+
+namespace eg 
+{ 
+// See mock/MockWaitForInterrupt.cpp
+extern uint32_t MOCK_WAIT_FOR_INTERRUPT_COUNT;
+extern uint32_t MOCK_WAIT_FOR_EVENT_COUNT;
+extern void   (*MOCK_WAIT_HOOK)();
+}
+
+
+namespace {
+
+using Loop = eg::BareMetalEventLoop<8>;
+
+Loop*        g_loop;
+eg::Signal<> g_signal;
+uint32_t     g_dispatched;
+uint32_t     g_idle_calls;
+uint32_t     g_time;
+
+void on_signal()     { ++g_dispatched; }
+void on_idle()       { ++g_idle_calls; }
+uint32_t get_time()  { return g_time; }
+
+// Simulates an interrupt which arrives while the core sleeps, and emits a signal.
+void interrupt_during_sleep()
+{
+    g_time += 100;
+    g_signal.emit();
+}
+
+} // namespace {
+
+
+class BareMetalEventLoopTest : public testing::Test {
+    protected:     
+    void* m_conn{};
+
+    virtual void SetUp() {
+        // The clock comes first, so that the loop's stats are measured with it from the start.
+        g_time = 0;
+        eg::EventLoopMonitor::register_clock(get_time);
+
+        g_loop = new Loop{};
+        eg::CURRENT_EVENT_LOOP = g_loop;
+        m_conn = g_signal.connect<on_signal>(*g_loop);
+
+        g_dispatched = 0;
+        g_idle_calls = 0;
+        eg::MOCK_WAIT_FOR_INTERRUPT_COUNT = 0;
+        eg::MOCK_WAIT_FOR_EVENT_COUNT     = 0;
+        eg::MOCK_WAIT_HOOK                = nullptr;
+    }
+
+    virtual void TearDown() {
+        eg::EventLoopMonitor::register_clock(nullptr);
+        eg::MOCK_WAIT_HOOK = nullptr;
+        g_signal.disconnect(m_conn);
+        delete g_loop;
+        eg::CURRENT_EVENT_LOOP = nullptr;
+    }
+};
+
+
+TEST_F(BareMetalEventLoopTest, SpinNeverSleeps)
+{
+    g_loop->set_idle_hook(on_idle);
+
+    EXPECT_FALSE(g_loop->run_once());
+    EXPECT_FALSE(g_loop->run_once());
+    EXPECT_EQ(g_idle_calls, 2U);
+    EXPECT_EQ(eg::MOCK_WAIT_FOR_INTERRUPT_COUNT, 0U);
+    EXPECT_EQ(eg::MOCK_WAIT_FOR_EVENT_COUNT, 0U);
+
+    g_signal.emit();
+    EXPECT_TRUE(g_loop->run_once());
+    EXPECT_EQ(g_dispatched, 1U);
+    EXPECT_EQ(g_idle_calls, 2U);
+}
+
+
+TEST_F(BareMetalEventLoopTest, WaitForInterruptWhenEmpty)
+{
+    g_loop->set_idle_strategy(eg::IdleStrategy::WaitForInterrupt);
+
+    // Pending events are dispatched without sleeping.
+    g_signal.emit();
+    g_signal.emit();
+    EXPECT_TRUE(g_loop->run_once());
+    EXPECT_TRUE(g_loop->run_once());
+    EXPECT_EQ(g_dispatched, 2U);
+    EXPECT_EQ(eg::MOCK_WAIT_FOR_INTERRUPT_COUNT, 0U);
+
+    EXPECT_FALSE(g_loop->run_once());
+    EXPECT_EQ(eg::MOCK_WAIT_FOR_INTERRUPT_COUNT, 1U);
+    EXPECT_EQ(eg::MOCK_WAIT_FOR_EVENT_COUNT, 0U);
+}
+
+
+TEST_F(BareMetalEventLoopTest, WaitForEventWhenEmpty)
+{
+    g_loop->set_idle_strategy(eg::IdleStrategy::WaitForEvent);
+
+    EXPECT_FALSE(g_loop->run_once());
+    EXPECT_EQ(eg::MOCK_WAIT_FOR_INTERRUPT_COUNT, 0U);
+    EXPECT_EQ(eg::MOCK_WAIT_FOR_EVENT_COUNT, 1U);
+}
+
+
+TEST_F(BareMetalEventLoopTest, InterruptWakesLoop)
+{
+    g_loop->set_idle_strategy(eg::IdleStrategy::WaitForInterrupt);
+    eg::MOCK_WAIT_HOOK = interrupt_during_sleep;
+
+    // Sleeps, and is woken by an interrupt which posts an event.
+    EXPECT_FALSE(g_loop->run_once());
+    eg::MOCK_WAIT_HOOK = nullptr;
+    EXPECT_TRUE(g_loop->run_once());
+    EXPECT_EQ(g_dispatched, 1U);
+    EXPECT_EQ(eg::MOCK_WAIT_FOR_INTERRUPT_COUNT, 1U);
+
+    eg::EventLoopStats stats;
+    EXPECT_TRUE(g_loop->get_stats(stats));
+    EXPECT_EQ(stats.sleeps, 1U);
+    EXPECT_EQ(stats.sleep_time, 100U);
+    EXPECT_EQ(stats.idle_time, 100U);
+    EXPECT_EQ(stats.dispatched, 1U);
+}
+
+
+TEST_F(BareMetalEventLoopTest, IdleHookWorkPreventsSleep)
+{
+    g_loop->set_idle_strategy(eg::IdleStrategy::WaitForInterrupt);
+
+    // Background work which posts an event must not be left waiting while the core sleeps.
+    g_loop->set_idle_hook([]() { ++g_idle_calls; g_signal.emit(); });
+
+    EXPECT_FALSE(g_loop->run_once());
+    EXPECT_EQ(g_idle_calls, 1U);
+    EXPECT_EQ(eg::MOCK_WAIT_FOR_INTERRUPT_COUNT, 0U);
+
+    g_loop->set_idle_hook(nullptr);
+    EXPECT_TRUE(g_loop->run_once());
+    EXPECT_EQ(g_dispatched, 1U);
+}
+
+
+namespace {
+
+eg::Signal<uint16_t, uint32_t> g_isr_signal;
+uint16_t g_isr_arg1;
+uint32_t g_isr_arg2;
+void on_isr_signal(const uint16_t& arg1, const uint32_t& arg2) { g_isr_arg1 = arg1; g_isr_arg2 = arg2; ++g_dispatched; }
+
+std::vector<int> g_order;
+void on_ordered(const int& value) { g_order.push_back(value); }
+
+} // namespace {
+
+
+TEST_F(BareMetalEventLoopTest, EmitFromIsr)
+{
+    void* conn = g_isr_signal.connect<on_isr_signal>(*g_loop);
+
+    g_time = 10;
+    g_signal.emit_from_isr();
+    g_isr_signal.emit_from_isr(0x1234, 0xCAFEF00D);
+    g_time = 30;
+
+    EXPECT_TRUE(g_loop->run_once());
+    EXPECT_EQ(g_dispatched, 1U);
+    EXPECT_TRUE(g_loop->run_once());
+    EXPECT_EQ(g_dispatched, 2U);
+    EXPECT_EQ(g_isr_arg1, 0x1234U);
+    EXPECT_EQ(g_isr_arg2, 0xCAFEF00DU);
+    EXPECT_FALSE(g_loop->run_once());
+
+    // The ISR events are counted and their latency measured from the emit.
+    eg::EventLoopStats stats;
+    EXPECT_TRUE(g_loop->get_stats(stats));
+    EXPECT_EQ(stats.posted, 2U);
+    EXPECT_EQ(stats.dispatched, 2U);
+    EXPECT_EQ(stats.depth, 0U);
+    EXPECT_EQ(stats.max_latency, 20U);
+
+    g_isr_signal.disconnect(conn);
+}
+
+
+TEST_F(BareMetalEventLoopTest, EmitFromIsrDispatchedFirst)
+{
+    g_order.clear();
+    eg::Signal<int> signal;
+    signal.connect<on_ordered>(*g_loop);
+
+    signal.emit(1);
+    signal.emit_from_isr(2);
+    signal.emit(3);
+    signal.emit_from_isr(4);
+    while (g_loop->run_once()) {}
+
+    EXPECT_EQ(g_order, (std::vector<int>{2, 4, 1, 3}));
+}
+
+
+TEST_F(BareMetalEventLoopTest, EmitFromIsrFallsBackWhenFull)
+{
+    // The ISR ring holds 16 events. The rest go through the main queue, which holds 8.
+    for (int i = 0; i < 24; ++i)
+    {
+        g_signal.emit_from_isr();
+    }
+    while (g_loop->run_once()) {}
+    EXPECT_EQ(g_dispatched, 24U);
+}
+
+
+TEST_F(BareMetalEventLoopTest, EmitFromIsrWithoutRing)
+{
+    // Loops without a ring use post().
+    class SimpleLoop : public eg::IEventLoop
+    {
+    public:
+        void post(const eg::Event& event) override { m_events.push_back(event); }
+        void run() override { for (const auto& event: m_events) event.dispatch(); m_events.clear(); }
+#if defined(OTWAY_EVENT_LOOP_WATER_MARK)
+        uint16_t get_high_water_mark() const override { return 0; }
+#endif
+        std::vector<eg::Event> m_events;
+    } loop;
+
+    g_order.clear();
+    eg::Signal<int> signal;
+    signal.connect<on_ordered>(loop);
+    signal.emit_from_isr(42);
+    EXPECT_EQ(loop.m_events.size(), 1U);
+
+    eg::CURRENT_EVENT_LOOP = &loop;
+    loop.run();
+    eg::CURRENT_EVENT_LOOP = g_loop;
+    EXPECT_EQ(g_order, (std::vector<int>{42}));
+}
+
+
+TEST(IsrEventRing, ConcurrentProducers)
+{
+    // Threads stand in for ISRs at different priorities. Each value must arrive exactly
+    // once, and in order per producer.
+    constexpr uint32_t kProducers = 4;
+    constexpr uint32_t kPerProducer = 20000;
+
+    eg::Signal<uint32_t>             signal;
+    eg::IsrEventRingArray<64>        ring;
+    std::vector<std::thread>         threads;
+    for (uint32_t producer = 0; producer < kProducers; ++producer)
+    {
+        threads.emplace_back([&ring, &signal, producer]()
+        {
+            for (uint32_t i = 0; i < kPerProducer; ++i)
+            {
+                const uint32_t value = (producer << 24) | i;
+                while (!ring.push(signal, &value, sizeof(value)))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    uint32_t next[kProducers]{};
+    uint32_t received = 0;
+    bool     ordered  = true;
+    eg::Event event;
+    while (received < (kProducers * kPerProducer))
+    {
+        if (!ring.pop(event))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        EXPECT_EQ(event.m_signal, &signal);
+        uint32_t value;
+        event.unpack(value);
+        const uint32_t producer = value >> 24;
+        ordered &= ((value & 0xFFFFFF) == next[producer]);
+        ++next[producer];
+        ++received;
+    }
+
+    for (auto& thread: threads) thread.join();
+    EXPECT_TRUE(ordered);
+    EXPECT_TRUE(ring.empty());
+}
+
+
+// The loop's queue holds 8 events. These tests post up to 14 values to overflow it.
+namespace {
+
+eg::Signal<int> g_value_signal;
+
+void post_values(int first, int last)
+{
+    for (int value = first; value <= last; ++value) g_value_signal.emit(value);
+}
+
+} // namespace {
+
+
+TEST_F(BareMetalEventLoopTest, OverflowDropNewest)
+{
+    g_order.clear();
+    void* conn = g_value_signal.connect<on_ordered>(*g_loop);
+    g_loop->set_overflow_policy(eg::OverflowPolicy::DropNewest);
+
+    post_values(1, 12);
+    while (g_loop->run_once()) {}
+    EXPECT_EQ(g_order, (std::vector<int>{1, 2, 3, 4, 5, 6, 7, 8}));
+
+    eg::EventLoopStats stats;
+    g_loop->get_stats(stats);
+    EXPECT_EQ(stats.posted, 8U);
+    EXPECT_EQ(stats.dropped, 4U);
+    EXPECT_EQ(stats.depth, 0U);
+    g_value_signal.disconnect(conn);
+}
+
+
+TEST_F(BareMetalEventLoopTest, OverflowDropOldest)
+{
+    g_order.clear();
+    void* conn = g_value_signal.connect<on_ordered>(*g_loop);
+    g_loop->set_overflow_policy(eg::OverflowPolicy::DropOldest);
+
+    post_values(1, 12);
+    while (g_loop->run_once()) {}
+    EXPECT_EQ(g_order, (std::vector<int>{5, 6, 7, 8, 9, 10, 11, 12}));
+
+    eg::EventLoopStats stats;
+    g_loop->get_stats(stats);
+    EXPECT_EQ(stats.posted, 12U);
+    EXPECT_EQ(stats.dispatched, 8U);
+    EXPECT_EQ(stats.dropped, 4U);
+    EXPECT_EQ(stats.depth, 0U);
+    g_value_signal.disconnect(conn);
+}
+
+
+TEST_F(BareMetalEventLoopTest, OverflowCoalesce)
+{
+    g_order.clear();
+    void* conn = g_value_signal.connect<on_ordered>(*g_loop);
+    g_loop->set_overflow_policy(eg::OverflowPolicy::Coalesce);
+
+    // Fill the queue with one value and seven of the other signal.
+    g_value_signal.emit(1);
+    for (int i = 0; i < 7; ++i) g_signal.emit();
+
+    // These overwrite the pending value, which keeps its place in the queue.
+    g_value_signal.emit(2);
+    g_value_signal.emit(3);
+    g_signal.emit();
+    // Nothing to coalesce with, so this is dropped.
+    eg::Signal<int> other;
+    other.connect<on_ordered>(*g_loop);
+    other.emit(4);
+
+    while (g_loop->run_once()) {}
+    EXPECT_EQ(g_order, (std::vector<int>{3}));
+    EXPECT_EQ(g_dispatched, 7U);
+
+    eg::EventLoopStats stats;
+    g_loop->get_stats(stats);
+    EXPECT_EQ(stats.posted, 8U);
+    EXPECT_EQ(stats.coalesced, 3U);
+    EXPECT_EQ(stats.dropped, 1U);
+    g_value_signal.disconnect(conn);
+}
+
+
+TEST_F(BareMetalEventLoopTest, OverflowSpill)
+{
+    g_order.clear();
+    void* conn = g_value_signal.connect<on_ordered>(*g_loop);
+    eg::RingBufferArray<eg::Event, 16> spill;
+    g_loop->set_overflow_policy(eg::OverflowPolicy::Spill);
+    g_loop->set_spill_queue(&spill);
+
+    post_values(1, 12);
+    EXPECT_EQ(spill.size(), 4U);
+
+    // Part drain the main queue. New events must still go behind the spilled ones.
+    for (int i = 0; i < 3; ++i) g_loop->run_once();
+    post_values(13, 14);
+    EXPECT_EQ(spill.size(), 6U);
+
+    while (g_loop->run_once()) {}
+    EXPECT_EQ(g_order, (std::vector<int>{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14}));
+
+    eg::EventLoopStats stats;
+    g_loop->get_stats(stats);
+    EXPECT_EQ(stats.posted, 14U);
+    EXPECT_EQ(stats.dispatched, 14U);
+    EXPECT_EQ(stats.spilled, 6U);
+    EXPECT_EQ(stats.peak_depth, 12U);
+#if defined(OTWAY_EVENT_LOOP_WATER_MARK)
+    EXPECT_EQ(g_loop->get_high_water_mark(), 12U);
+#endif
+
+    // Back to the main queue once the spill has drained.
+    post_values(15, 15);
+    EXPECT_EQ(spill.size(), 0U);
+    g_loop->set_spill_queue(nullptr);
+    g_value_signal.disconnect(conn);
+}
+
+
+TEST_F(BareMetalEventLoopTest, OverflowSpillFullMovesBack)
+{
+    g_order.clear();
+    void* conn = g_value_signal.connect<on_ordered>(*g_loop);
+    eg::RingBufferArray<eg::Event, 4> spill;
+    g_loop->set_overflow_policy(eg::OverflowPolicy::Spill);
+    g_loop->set_spill_queue(&spill);
+
+    // Both queues full.
+    post_values(1, 12);
+    EXPECT_EQ(spill.size(), 4U);
+
+    // The main queue has room again, so the spilled events move into it to make room for more.
+    for (int i = 0; i < 3; ++i) g_loop->run_once();
+    post_values(13, 15);
+    EXPECT_EQ(spill.size(), 4U);
+
+    while (g_loop->run_once()) {}
+    EXPECT_EQ(g_order, (std::vector<int>{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15}));
+
+    eg::EventLoopStats stats;
+    g_loop->get_stats(stats);
+    EXPECT_EQ(stats.posted, 15U);
+    EXPECT_EQ(stats.dispatched, 15U);
+    EXPECT_EQ(stats.spilled, 7U);
+    EXPECT_EQ(stats.dropped, 0U);
+
+    g_loop->set_spill_queue(nullptr);
+    g_value_signal.disconnect(conn);
+}
+
+
+TEST_F(BareMetalEventLoopTest, OverflowSpillPolicyChanged)
+{
+    g_order.clear();
+    void* conn = g_value_signal.connect<on_ordered>(*g_loop);
+    eg::RingBufferArray<eg::Event, 16> spill;
+    g_loop->set_overflow_policy(eg::OverflowPolicy::Spill);
+    g_loop->set_spill_queue(&spill);
+
+    post_values(1, 10);
+    EXPECT_EQ(spill.size(), 2U);
+
+    // With another policy, new events are handled as for that policy even though the spill
+    // queue is not empty.
+    g_loop->set_overflow_policy(eg::OverflowPolicy::DropNewest);
+    post_values(11, 11);
+    EXPECT_EQ(spill.size(), 2U);
+    g_loop->run_once();
+    post_values(12, 12);
+    EXPECT_EQ(spill.size(), 2U);
+
+    // The spilled events are still dispatched once the main queue is empty.
+    while (g_loop->run_once()) {}
+    EXPECT_EQ(g_order, (std::vector<int>{1, 2, 3, 4, 5, 6, 7, 8, 12, 9, 10}));
+
+    eg::EventLoopStats stats;
+    g_loop->get_stats(stats);
+    EXPECT_EQ(stats.dropped, 1U);
+    EXPECT_EQ(stats.dispatched, 11U);
+
+    g_loop->set_spill_queue(nullptr);
+    g_value_signal.disconnect(conn);
+}
+
+
+#endif  // defined(OTWAY_TARGET_PLATFORM_BAREMETAL)
@@ -0,0 +1,209 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2024.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include "event_loop/EventLoopStats.h"
+#include "signals/Signal.h"
+#include "TestSingleThreadedUtils.h"
+#if defined(OTWAY_TARGET_PLATFORM_BAREMETAL)
+#include "event_loop/BareMetalEventLoop.h"
+#endif
+
+
+namespace {
+
+uint32_t g_fake_time;
+uint32_t fake_clock() { return g_fake_time; }
+
+[[maybe_unused]] void on_signal() {}
+
+} // namespace {
+
+
+class EventLoopStatsTest : public testing::Test {
+    protected:     
+    virtual void SetUp() {
+        g_fake_time = 1000;
+        eg::EventLoopMonitor::register_clock(fake_clock);
+    }
+
+    virtual void TearDown() {
+        eg::EventLoopMonitor::register_clock(nullptr);
+    }
+};
+
+
+TEST_F(EventLoopStatsTest, Buckets)
+{
+    EXPECT_EQ(eg::EventLoopMonitor::bucket(0), 0U);
+    EXPECT_EQ(eg::EventLoopMonitor::bucket(1), 1U);
+    EXPECT_EQ(eg::EventLoopMonitor::bucket(2), 2U);
+    EXPECT_EQ(eg::EventLoopMonitor::bucket(3), 2U);
+    EXPECT_EQ(eg::EventLoopMonitor::bucket(4), 3U);
+    EXPECT_EQ(eg::EventLoopMonitor::bucket(1000), 10U);
+    EXPECT_EQ(eg::EventLoopMonitor::bucket(0xFFFFFFFF), 15U);
+}
+
+
+TEST_F(EventLoopStatsTest, PostAndDispatch)
+{
+    eg::Signal<> signal;
+    eg::EventLoopMonitor monitor;
+
+    // Two events posted together. 
+    eg::Event event1{signal};
+    eg::Event event2{signal};
+    monitor.on_post(event1);
+    monitor.on_post(event2);
+    EXPECT_EQ(event1.m_timestamp, 1000U);
+    EXPECT_EQ(monitor.get_stats().depth, 2U);
+    EXPECT_EQ(monitor.get_stats().peak_depth, 2U);
+
+    // The first waits 10us and takes 30us to dispatch.
+    g_fake_time += 10;
+    monitor.on_get(event1);
+    g_fake_time += 30;
+    monitor.on_dispatched();
+
+    // The second waits for the first.
+    monitor.on_get(event2);
+    g_fake_time += 30;
+    monitor.on_dispatched();
+
+    // Then nothing happens for a while.
+    g_fake_time += 30;
+    eg::Event event3{signal};
+    monitor.on_post(event3);
+    monitor.on_get(event3);
+    monitor.on_dispatched();
+
+    const auto& stats = monitor.get_stats();
+    EXPECT_EQ(stats.posted, 3U);
+    EXPECT_EQ(stats.dispatched, 3U);
+    EXPECT_EQ(stats.depth, 0U);
+    EXPECT_EQ(stats.peak_depth, 2U);
+    EXPECT_EQ(stats.busy_time, 60U);
+    EXPECT_EQ(stats.idle_time, 40U);
+    EXPECT_EQ(stats.get_load_percent(), 60U);
+    EXPECT_EQ(stats.max_latency, 40U);
+    EXPECT_EQ(stats.latency_histogram[0], 1U);
+    EXPECT_EQ(stats.latency_histogram[4], 1U);
+    EXPECT_EQ(stats.latency_histogram[6], 1U);
+    EXPECT_EQ(stats.get_latency_percentile(50), 15U);
+    EXPECT_EQ(stats.get_latency_percentile(100), 63U);
+
+    monitor.reset();
+    EXPECT_EQ(monitor.get_stats().posted, 0U);
+    EXPECT_EQ(monitor.get_stats().busy_time, 0U);
+}
+
+
+TEST_F(EventLoopStatsTest, ClockWraps)
+{
+    eg::Signal<> signal;
+    g_fake_time = 0xFFFFFFF0;
+    eg::EventLoopMonitor monitor;
+
+    eg::Event event{signal};
+    monitor.on_post(event);
+    g_fake_time += 0x20;
+    monitor.on_get(event);
+    EXPECT_EQ(monitor.get_stats().max_latency, 0x20U);
+}
+
+
+namespace {
+uint32_t g_other_time;
+uint32_t other_clock() { return g_other_time; }
+}
+
+TEST_F(EventLoopStatsTest, RegisterClockRestartsTime)
+{
+    eg::Signal<> signal;
+    eg::EventLoopMonitor monitor;
+
+    // The monitor was made with the fake clock. The other one is far behind it, which would 
+    // look like an idle time of almost 2^32us.
+    g_other_time = 10;
+    eg::EventLoopMonitor::register_clock(other_clock);
+    g_other_time = 50;
+
+    eg::Event event{signal};
+    monitor.on_post(event);
+    monitor.on_get(event);
+    g_other_time += 5;
+    monitor.on_dispatched();
+    EXPECT_EQ(monitor.get_stats().idle_time, 40U);
+    EXPECT_EQ(monitor.get_stats().busy_time, 5U);
+}
+
+
+TEST_F(EventLoopStatsTest, Overflow)
+{
+    eg::Signal<> signal;
+    eg::EventLoopMonitor monitor;
+
+    eg::Event event1{signal};
+    eg::Event event2{signal};
+    monitor.on_post(event1);
+    monitor.on_post(event2);
+
+    // A new event was discarded, then the oldest pending one.
+    monitor.on_dropped(false);
+    EXPECT_EQ(monitor.get_stats().depth, 2U);
+    monitor.on_dropped(true);
+    EXPECT_EQ(monitor.get_stats().depth, 1U);
+    monitor.on_blocked();
+
+    const auto& stats = monitor.get_stats();
+    EXPECT_EQ(stats.posted, 2U);
+    EXPECT_EQ(stats.dropped, 2U);
+    EXPECT_EQ(stats.blocked, 1U);
+
+    monitor.reset();
+    EXPECT_EQ(monitor.get_stats().dropped, 0U);
+    EXPECT_EQ(monitor.get_stats().depth, 1U);
+}
+
+
+TEST_F(EventLoopStatsTest, DefaultNotSupported)
+{
+    class Loop : public eg::IEventLoop
+    {
+        void post(const eg::Event&) override {}
+        void run() override {}
+#if defined(OTWAY_EVENT_LOOP_WATER_MARK)
+        uint16_t get_high_water_mark() const { return 0; }
+#endif
+    } loop;
+
+    eg::EventLoopStats stats;
+    EXPECT_FALSE(static_cast<eg::IEventLoop&>(loop).get_stats(stats));
+}
+
+
+#if defined(OTWAY_TARGET_PLATFORM_BAREMETAL)
+TEST_F(EventLoopStatsTest, BareMetalEventLoop)
+{
+    eg::BareMetalEventLoop<8> loop;
+    eg::Signal<> signal;
+    signal.connect<on_signal>(loop);
+
+    signal.emit();
+    signal.emit();
+    g_fake_time += 5;
+    signal.emit();
+
+    eg::EventLoopStats stats;
+    EXPECT_TRUE(loop.get_stats(stats));
+    EXPECT_EQ(stats.posted, 3U);
+    EXPECT_EQ(stats.depth, 3U);
+    EXPECT_EQ(stats.peak_depth, 3U);
+    EXPECT_EQ(stats.peak_depth, loop.get_high_water_mark());
+}
+#endif
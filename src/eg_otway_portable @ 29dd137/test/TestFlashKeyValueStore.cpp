@@ -0,0 +1,311 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include "drivers/FlashKeyValueStore.h"
+#include "mock/MockFlashMemory.h"
+#include "sim/SimFlashMemory.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+
+namespace {
+
+// Small pages, so that garbage collection happens often.
+constexpr uint32_t kPageSize  = 2048;
+constexpr uint32_t kWriteSize = 8;       // STM32G4 double word
+constexpr uint32_t kNumPages  = 4;
+using Flash = eg::MockFlashMemory<0x0800'0000, kPageSize, kNumPages, kWriteSize>;
+using Store = eg::FlashKeyValueStore<kWriteSize, 32>;
+using Result = Store::Result;
+
+struct Calibration
+{
+    float    gain;
+    float    offset;
+    uint16_t flags;
+};
+
+bool operator==(const Calibration& lhs, const Calibration& rhs)
+{
+    return (lhs.gain == rhs.gain) && (lhs.offset == rhs.offset) && (lhs.flags == rhs.flags);
+}
+
+// A value of the given length, varying with the key and version.
+std::vector<uint8_t> make_value(uint16_t key, uint32_t version, uint16_t length)
+{
+    std::vector<uint8_t> value(length);
+    for (uint16_t i = 0; i < length; ++i)
+        value[i] = static_cast<uint8_t>(key * 31 + version * 7 + i);
+    return value;
+}
+
+void expect_value(const Store& store, uint16_t key, const std::vector<uint8_t>& expected)
+{
+    std::array<uint8_t, 1024> buffer{};
+    uint16_t size = 0;
+    ASSERT_EQ(store.read(key, buffer.data(), static_cast<uint16_t>(buffer.size()), size), Result::eOK);
+    ASSERT_EQ(size, expected.size());
+    EXPECT_EQ(std::memcmp(buffer.data(), expected.data(), size), 0);
+}
+
+} // namespace {
+
+
+TEST(FlashKeyValueStore, WriteAndRead)
+{
+    auto flash = std::make_unique<Flash>();
+    Store store{*flash};
+    EXPECT_EQ(store.get_key_count(), 0U);
+    EXPECT_FALSE(store.contains(1));
+
+    // Values of different lengths, including ones which are not a whole number of write units.
+    for (uint16_t key = 1; key <= 20; ++key)
+    {
+        auto value = make_value(key, 0, key * 3);
+        EXPECT_EQ(store.write(key, value.data(), static_cast<uint16_t>(value.size())), Result::eOK);
+    }
+    EXPECT_EQ(store.get_key_count(), 20U);
+    for (uint16_t key = 1; key <= 20; ++key)
+    {
+        EXPECT_TRUE(store.contains(key));
+        EXPECT_EQ(store.get_value_size(key), key * 3);
+        expect_value(store, key, make_value(key, 0, key * 3));
+    }
+
+    // Typed access.
+    Calibration calibration{1.5f, -0.25f, 0x0102};
+    EXPECT_EQ(store.write(100, calibration), Result::eOK);
+    Calibration copy{};
+    EXPECT_EQ(store.read(100, copy), Result::eOK);
+    EXPECT_TRUE(copy == calibration);
+    uint32_t wrong_size{};
+    EXPECT_EQ(store.read(100, wrong_size), Result::eInvalidSize);
+
+    // Errors.
+    std::array<uint8_t, 4> small{};
+    uint16_t size = 0;
+    EXPECT_EQ(store.read(20, small.data(), 4, size), Result::eInvalidSize);
+    EXPECT_EQ(size, 60U);
+    EXPECT_EQ(store.read(99, small.data(), 4, size), Result::eNotFound);
+    EXPECT_EQ(store.write(Store::kInvalidKey, small.data(), 4), Result::eInvalidKey);
+    std::vector<uint8_t> huge(store.get_max_value_size() + 1U);
+    EXPECT_EQ(store.write(1, huge.data(), static_cast<uint16_t>(huge.size())), Result::eInvalidSize);
+}
+
+
+TEST(FlashKeyValueStore, UpdateAndErase)
+{
+    auto flash = std::make_unique<Flash>();
+    Store store{*flash};
+
+    auto v1 = make_value(7, 1, 10);
+    auto v2 = make_value(7, 2, 30);
+    EXPECT_EQ(store.write(7, v1.data(), 10), Result::eOK);
+    EXPECT_EQ(store.write(7, v2.data(), 30), Result::eOK);
+    EXPECT_EQ(store.get_key_count(), 1U);
+    expect_value(store, 7, v2);
+
+    // Writing the same value again doesn't touch the flash.
+    flash->reset_counts();
+    EXPECT_EQ(store.write(7, v2.data(), 30), Result::eOK);
+    EXPECT_EQ(flash->get_write_count(), 0U);
+
+    EXPECT_EQ(store.erase(7), Result::eOK);
+    EXPECT_FALSE(store.contains(7));
+    EXPECT_EQ(store.get_key_count(), 0U);
+    EXPECT_EQ(store.get_live_bytes(), 0U);
+    EXPECT_EQ(store.erase(7), Result::eNotFound);
+
+    // An empty value is not the same as no value.
+    EXPECT_EQ(store.write(8, nullptr, 0), Result::eOK);
+    EXPECT_TRUE(store.contains(8));
+    EXPECT_EQ(store.get_value_size(8), 0U);
+}
+
+
+TEST(FlashKeyValueStore, Recovery)
+{
+    auto flash = std::make_unique<Flash>();
+    {
+        Store store{*flash};
+        for (uint16_t key = 1; key <= 10; ++key)
+        {
+            auto value = make_value(key, 0, 16);
+            store.write(key, value.data(), 16);
+        }
+        auto value = make_value(3, 1, 5);
+        store.write(3, value.data(), 5);
+        store.erase(4);
+    }
+
+    Store store{*flash};
+    EXPECT_EQ(store.get_key_count(), 9U);
+    EXPECT_FALSE(store.contains(4));
+    expect_value(store, 3, make_value(3, 1, 5));
+    expect_value(store, 10, make_value(10, 0, 16));
+
+    // Recovery carries on appending where it left off.
+    auto value = make_value(11, 0, 16);
+    EXPECT_EQ(store.write(11, value.data(), 16), Result::eOK);
+    Store store2{*flash};
+    expect_value(store2, 11, value);
+}
+
+
+TEST(FlashKeyValueStore, TornEntryIsIgnored)
+{
+    auto flash = std::make_unique<Flash>();
+    uint32_t active_page = 0;
+    {
+        Store store{*flash};
+        auto v1 = make_value(5, 1, 40);
+        auto v2 = make_value(5, 2, 40);
+        store.write(5, v1.data(), 40);
+        store.write(5, v2.data(), 40);
+        active_page = store.get_active_page();
+    }
+
+    // Clear some bits in the last part of the newest value, as if a reset happened while it 
+    // was being programmed. Its CRC no longer matches, so the old value is still current.
+    const uint32_t page_address = flash->get_page_address(active_page);
+    const uint8_t* data = flash->get_data(page_address);
+    uint32_t end = kPageSize;
+    while ((end > 0) && (data[end - 1] == 0xFF)) --end;
+    std::array<uint8_t, kWriteSize> zeros{};
+    flash->write(page_address + ((end - 1) & ~(kWriteSize - 1)), zeros.data(), kWriteSize);
+
+    Store store{*flash};
+    expect_value(store, 5, make_value(5, 1, 40));
+
+    // New entries go after the damaged one. 
+    auto v3 = make_value(5, 3, 40);
+    EXPECT_EQ(store.write(5, v3.data(), 40), Result::eOK);
+    Store store2{*flash};
+    expect_value(store2, 5, v3);
+}
+
+
+TEST(FlashKeyValueStore, FailedWriteClosesPage)
+{
+    auto flash = std::make_unique<eg::sim::SimFlashMemory<Flash>>();
+    Store store{*flash};
+    auto v1 = make_value(5, 1, 40);
+    auto v2 = make_value(5, 2, 40);
+    ASSERT_EQ(store.write(5, v1.data(), 40), Result::eOK);
+    const uint32_t active_page = store.get_active_page();
+
+    // The flash fails after the header and part of the value are programmed. 
+    flash->cut_power_after(3);
+    EXPECT_EQ(store.write(5, v2.data(), 40), Result::eFlashFailed);
+    expect_value(store, 5, v1);
+
+    // The next write doesn't program over the failed entry, but goes to a new page.
+    flash->power_on();
+    auto v3 = make_value(5, 3, 40);
+    EXPECT_EQ(store.write(5, v3.data(), 40), Result::eOK);
+    EXPECT_NE(store.get_active_page(), active_page);
+    expect_value(store, 5, v3);
+
+    Store recovered{*flash};
+    expect_value(recovered, 5, v3);
+}
+
+
+TEST(FlashKeyValueStore, GarbageCollectionLevelsWear)
+{
+    auto flash = std::make_unique<Flash>();
+    Store store{*flash};
+
+    // A few parameters which never change, and a few which change all the time.
+    for (uint16_t key = 1; key <= 8; ++key)
+    {
+        auto value = make_value(key, 0, 24);
+        store.write(key, value.data(), 24);
+    }
+
+    std::array<uint32_t, 4> versions{};
+    for (uint32_t i = 0; i < 2000; ++i)
+    {
+        const uint16_t key = static_cast<uint16_t>(20 + i % versions.size());
+        auto value = make_value(key, ++versions[key - 20], 12 + (i % 5) * 9);
+        ASSERT_EQ(store.write(key, value.data(), static_cast<uint16_t>(value.size())), Result::eOK);
+    }
+
+    // Many times round the ring, and nothing lost.
+    for (uint16_t key = 1; key <= 8; ++key)
+        expect_value(store, key, make_value(key, 0, 24));
+    for (uint16_t key = 20; key < 24; ++key)
+    {
+        const uint32_t i = 2000 - 4 + (key - 20);
+        expect_value(store, key, make_value(key, versions[key - 20], static_cast<uint16_t>(12 + (i % 5) * 9)));
+    }
+
+    // Every page has been erased about the same number of times, including those which 
+    // held only the static parameters. The headers agree with the mock's counts.
+    uint32_t least = UINT32_MAX;
+    uint32_t most  = 0;
+    for (uint32_t page = 0; page < kNumPages; ++page)
+    {
+        least = std::min(least, flash->get_page_erase_count(page));
+        most  = std::max(most, flash->get_page_erase_count(page));
+        EXPECT_EQ(store.get_page_erase_count(page), flash->get_page_erase_count(page));
+    }
+    EXPECT_GT(least, 5U);
+    EXPECT_LE(most - least, 1U);
+
+    // The same state again after a restart.
+    Store store2{*flash};
+    EXPECT_EQ(store2.get_key_count(), store.get_key_count());
+    EXPECT_EQ(store2.get_live_bytes(), store.get_live_bytes());
+    for (uint16_t key = 1; key <= 8; ++key)
+        expect_value(store2, key, make_value(key, 0, 24));
+}
+
+
+TEST(FlashKeyValueStore, Limits)
+{
+    auto flash = std::make_unique<Flash>();
+    Store store{*flash};
+
+    // The index holds 32 keys.
+    for (uint16_t key = 0; key < 32; ++key)
+        EXPECT_EQ(store.write(key, key), Result::eOK);
+    EXPECT_EQ(store.write(32, nullptr, 0), Result::eIndexFull);
+    EXPECT_EQ(store.erase(31), Result::eOK);
+    EXPECT_EQ(store.write(32, nullptr, 0), Result::eOK);
+
+}
+
+
+TEST(FlashKeyValueStore, StoreFull)
+{
+    auto flash = std::make_unique<Flash>();
+    Store store{*flash};
+
+    // The live data is limited to two of the four pages.
+    EXPECT_EQ(store.get_capacity(), 2U * (kPageSize - 16U));
+    std::vector<uint8_t> big(900, 0x55);
+    uint16_t key = 100;
+    Result result = Result::eOK;
+    while (result == Result::eOK)
+    {
+        for (auto& byte: big) ++byte;
+        result = store.write(key++, big.data(), static_cast<uint16_t>(big.size()));
+    }
+    EXPECT_EQ(result, Result::eStoreFull);
+    EXPECT_LE(store.get_live_bytes(), store.get_capacity());
+
+    // Updates in place still work when full, as they don't add to the live data.
+    big[0] ^= 0xFF;
+    EXPECT_EQ(store.write(100, big.data(), static_cast<uint16_t>(big.size())), Result::eOK);
+    expect_value(store, 100, big);
+}
@@ -9,8 +9,16 @@
 #include "gtest/gtest.h"
 #include "interfaces/IFlashMemory.h"
 #include "drivers/FlashLog.h"
+#include "drivers/BufferedFlashLog.h"
+#include "TestSingleThreadedUtils.h"
 #include "mock/MockFlashMemory.h"
+#include "mock/MockFlashStorage.h"
+#include "sim/SimFlashMemory.h"
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <ranges>
+#include <vector>
 
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -62,7 +70,7 @@ TEST(FlashLog, FlashLog)
     EXPECT_TRUE(log.get_newest_page() == 0);
     EXPECT_TRUE(log.get_oldest_page() == 0);
     EXPECT_TRUE(log.get_record_count() == 0);
-    EXPECT_TRUE(log.get_records_per_page() == ((kPageSize - kWriteSize) / sizeof(TestLogItem)));
+    EXPECT_TRUE(log.get_records_per_page() == ((kPageSize - kWriteSize) / (sizeof(TestLogItem) + kWriteSize)));
 
     uint32_t count = log.get_records_per_page();
 
@@ -80,7 +88,7 @@ TEST(FlashLog, FlashLog)
             // We advance through the available pages in the log.
             EXPECT_TRUE(log.get_newest_page() == p);
             // This should never change.
-            EXPECT_TRUE(log.get_records_per_page() == ((kPageSize - kWriteSize) / sizeof(TestLogItem)));
+            EXPECT_TRUE(log.get_records_per_page() == ((kPageSize - kWriteSize) / (sizeof(TestLogItem) + kWriteSize)));
         }
     }
 
@@ -98,7 +106,7 @@ TEST(FlashLog, FlashLog)
             // We advance through the available pages in the log.
             EXPECT_TRUE(log.get_newest_page() == (p % kNumPages));
             // This should never change.
-            EXPECT_TRUE(log.get_records_per_page() == ((kPageSize - kWriteSize) / sizeof(TestLogItem)));
+            EXPECT_TRUE(log.get_records_per_page() == ((kPageSize - kWriteSize) / (sizeof(TestLogItem) + kWriteSize)));
         }
     }
 
@@ -112,7 +120,7 @@ TEST(FlashLog, FlashLog)
     EXPECT_TRUE(log.get_newest_page() == 0);
     EXPECT_TRUE(log.get_oldest_page() == 0);
     EXPECT_TRUE(log.get_record_count() == 0);
-    EXPECT_TRUE(log.get_records_per_page() == ((kPageSize - kWriteSize) / sizeof(TestLogItem)));
+    EXPECT_TRUE(log.get_records_per_page() == ((kPageSize - kWriteSize) / (sizeof(TestLogItem) + kWriteSize)));
 }
 
 
@@ -139,12 +147,12 @@ TEST(FlashLog, ReadLog)
     }
 
     // Write some more records.
-    for (uint32_t i = 100; i < 200; ++i)
+    for (uint32_t i = 100; i < 150; ++i)
     {
         TestLogItem item{i + 1};
         log.append_record(item);
     }
-    for (uint32_t i = 0; i < 200; ++i)
+    for (uint32_t i = 0; i < 150; ++i)
     {
         TestLogItem temp{i + 1};
         TestLogItem item{0};
@@ -155,23 +163,28 @@ TEST(FlashLog, ReadLog)
         EXPECT_TRUE(temp == *pitem);
     }
 
-    // Should not be able to read a record which does not exist.
+    // Should not be able to read a record which does not exist. Index 150 is the next slot to 
+    // be written.
     TestLogItem item{0};
-    auto result = log.read_record_by_index(201 , item);
+    auto result = log.read_record_by_index(151 , item);
+    EXPECT_TRUE(result == TestLog::Result::eInvalidOffset);
+    result = log.read_record_by_index(150 , item);
     EXPECT_TRUE(result == TestLog::Result::eInvalidOffset);
 
     // Should not be able to point to a record which does not exist.
-    const TestLogItem* pitem = log.get_pointer_by_index(201);
+    const TestLogItem* pitem = log.get_pointer_by_index(151);
+    EXPECT_TRUE(pitem == nullptr);
+    pitem = log.get_pointer_by_index(150);
     EXPECT_TRUE(pitem == nullptr);
 
     // Add enough records to move the next page.
     auto count = log.get_records_per_page();
-    for (uint32_t i = 200; i < (count + 200); ++i)
+    for (uint32_t i = 150; i < (count + 150); ++i)
     {
         TestLogItem item{i + 1};
         log.append_record(item);
     }
-    for (uint32_t i = 0; i < (count + 200); ++i)
+    for (uint32_t i = 0; i < (count + 150); ++i)
     {
         TestLogItem temp{i + 1};
         TestLogItem item{0};
@@ -184,14 +197,14 @@ TEST(FlashLog, ReadLog)
 
     // Add enough records to start erasing pages. We should wrap around so that the first few pages 
     // are erased. This means the 0th record advances by (count * erased pages). This loop will mean 
-    // we have written 6 full pages of records plus 200. The first three pages should have been 
+    // we have written 6 full pages of records plus 150. The first three pages should have been 
     // overwritten (two fully, one partially).
-    for (uint32_t i = (count + 200); i < (count * 6 + 200); ++i)
+    for (uint32_t i = (count + 150); i < (count * 6 + 150); ++i)
     {
         TestLogItem item{i + 1};
         log.append_record(item);
     }
-    for (uint32_t i = 0; i < 200; ++i)
+    for (uint32_t i = 0; i < 150; ++i)
     {
         // The oldest record (index 0) should now be the the (count * 2)th item written.
         TestLogItem temp{i + 1 + count * 3};
@@ -232,7 +245,7 @@ TEST(FlashLog, ReadLog)
     }
     // Advance to page 2 - only partially full
     memory = flash.get_data(flash.get_page_address(2));
-    for (uint32_t i = 0; i < 200; ++i)    
+    for (uint32_t i = 0; i < 150; ++i)    
     {        
         TestLogItem  temp{i + 1 + count * 6};
         const TestLogItem& item = *reinterpret_cast<const TestLogItem*>(memory + 16 + i * sizeof(TestLogItem));
@@ -258,4 +271,994 @@ TEST(FlashLog, InitialiseWithExistingRecords)
     }
     // Make a new log with the same memory.
     TestLog log2{flash};
-}
\ No newline at end of file
+}
+
+TEST(FlashLog, QueriesDoNotScanHeaders)
+{
+    MockU5FlashMemory flash;
+    TestLog log{flash};
+    auto count = log.get_records_per_page();
+    for (uint32_t i = 0; i < (count * 5 + 10); ++i)
+    {
+        log.append_record(TestLogItem{i + 1});
+    }
+
+    flash.reset_counts();
+    EXPECT_EQ(log.get_record_count(), count * 3 + 10);
+    EXPECT_EQ(log.get_oldest_page(), 2U);
+    EXPECT_EQ(log.get_newest_page(), 1U);
+    EXPECT_EQ(flash.get_read_count(), 0U);
+
+    // One read per record, however far into the log.
+    TestLogItem item{};
+    for (uint32_t i = 0; i < log.get_record_count(); i += 7)
+    {
+        EXPECT_EQ(log.read_record_by_index(i, item), TestLog::Result::eOK);
+        EXPECT_TRUE(item == TestLogItem{i + 1 + count * 2});
+    }
+    EXPECT_EQ(flash.get_read_count(), (count * 3 + 10 + 6) / 7);
+    EXPECT_TRUE(log.get_pointer_by_index(0) != nullptr);
+    EXPECT_EQ(flash.get_read_count(), (count * 3 + 10 + 6) / 7);
+
+    // Appending within a page writes only the record and its marker.
+    flash.reset_counts();
+    log.append_record(TestLogItem{0});
+    EXPECT_EQ(flash.get_read_count(), 0U);
+    EXPECT_EQ(flash.get_write_count(), 2U);
+}
+
+
+TEST(FlashLog, CachedStateMatchesRecovery)
+{
+    MockU5FlashMemory flash;
+    TestLog log{flash};
+    auto count = log.get_records_per_page();
+
+    // Compare the incrementally maintained state with that recovered from the flash after 
+    // each page boundary, and a few records either side of them.
+    uint32_t written = 0;
+    for (uint32_t step = 0; step < (kNumPages * 3); ++step)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            log.append_record(TestLogItem{++written});
+            if ((i < 2) || (i > (count - 3)))
+            {
+                TestLog recovered{flash};
+                EXPECT_EQ(recovered.get_oldest_page(), log.get_oldest_page());
+                EXPECT_EQ(recovered.get_newest_page(), log.get_newest_page());
+                EXPECT_EQ(recovered.get_record_count(), log.get_record_count());
+
+                TestLogItem first{};
+                TestLogItem last{};
+                EXPECT_EQ(recovered.read_record_by_index(0, first), TestLog::Result::eOK);
+                EXPECT_EQ(recovered.read_record_by_index(recovered.get_record_count() - 1, last), TestLog::Result::eOK);
+                EXPECT_TRUE(first == TestLogItem{written - log.get_record_count() + 1});
+                EXPECT_TRUE(last == TestLogItem{written});
+            }
+        }
+    }
+}
+
+
+TEST(FlashLog, SinglePage)
+{
+    eg::MockFlashMemory<kBaseAddress, kPageSize, 1, kWriteSize> flash;
+    TestLog log{flash};
+    auto count = log.get_records_per_page();
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        log.append_record(TestLogItem{i + 1});
+    }
+    EXPECT_EQ(log.get_record_count(), count);
+
+    // The only page is erased to make room, so all the older records are lost.
+    log.append_record(TestLogItem{count + 1});
+    EXPECT_EQ(log.get_record_count(), 1U);
+    EXPECT_EQ(log.get_oldest_page(), 0U);
+    TestLogItem item{};
+    EXPECT_EQ(log.read_record_by_index(0, item), TestLog::Result::eOK);
+    EXPECT_TRUE(item == TestLogItem{count + 1});
+
+    TestLog recovered{flash};
+    EXPECT_EQ(recovered.get_record_count(), 1U);
+}
+
+
+TEST(FlashLog, RecoveryIsLogarithmic)
+{
+    MockU5FlashMemory flash;
+    auto count = TestLog{flash}.get_records_per_page();
+
+    // Recovery cost: one header read per page, the last marker of each full page, a binary search 
+    // of the markers in the newest page, and reading the boundary slot and its marker in kWriteSize 
+    // chunks.
+    uint32_t log2 = 0;
+    while ((1U << log2) <= count) ++log2;
+    const uint32_t max_reads = kNumPages * 2 + log2 + sizeof(TestLogItem) / kWriteSize + 1;
+
+    for (uint32_t records: {0U, 1U, 2U, 100U, count - 1, count, count + 1, count * 2 + 37})
+    {
+        flash.erase_page(0);
+        flash.erase_page(1);
+        flash.erase_page(2);
+        flash.erase_page(3);
+        {
+            TestLog log{flash};
+            for (uint32_t i = 0; i < records; ++i)
+                log.append_record(TestLogItem{i + 1});
+        }
+
+        flash.reset_counts();
+        TestLog log{flash};
+        EXPECT_LE(flash.get_read_count(), max_reads) << records;
+        EXPECT_EQ(log.get_record_count(), records) << records;
+
+        // And appending carries on in the right place.
+        log.append_record(TestLogItem{records + 1});
+        TestLogItem item{};
+        EXPECT_EQ(log.read_record_by_index(records, item), TestLog::Result::eOK);
+        EXPECT_TRUE(item == TestLogItem{records + 1});
+        if (records > 0)
+        {
+            EXPECT_EQ(log.read_record_by_index(records - 1, item), TestLog::Result::eOK);
+            EXPECT_TRUE(item == TestLogItem{records});
+        }
+    }
+}
+
+
+namespace {
+
+// As the mock, but without direct access, like flash on an external SPI device.
+class UnmappedFlashMemory : public MockU5FlashMemory
+{
+public:
+    const uint8_t* get_data(uint32_t) const override           { return nullptr; }
+    const uint8_t* get_data(uint32_t, uint32_t) const override { return nullptr; }
+};
+
+static_assert(std::bidirectional_iterator<TestLog::Iterator>);
+static_assert(std::ranges::bidirectional_range<TestLog::Range>);
+
+} // namespace {
+
+
+TEST(FlashLog, RecoveryExcludesTornRecord)
+{
+    // A reset part way through the record, and one between the record and its marker.
+    for (const uint32_t programmed: {kWriteSize, static_cast<uint32_t>(sizeof(TestLogItem))})
+    {
+        SCOPED_TRACE(programmed);
+        MockU5FlashMemory flash;
+        uint32_t count = 0;
+        {
+            TestLog log{flash};
+            count = log.get_records_per_page();
+            for (uint32_t i = 0; i < 10; ++i)
+                log.append_record(TestLogItem{i + 1});
+        }
+
+        // The start of the 11th record is programmed, but not its marker.
+        const TestLogItem torn{11};
+        const uint32_t slot = kWriteSize + 10 * sizeof(TestLogItem);
+        EXPECT_EQ(flash.write(kBaseAddress + slot, reinterpret_cast<const uint8_t*>(&torn), programmed), IFlashMemory::Result::eOK);
+
+        // The torn record can't be seen. Its slot is not programmed again, so the next record starts 
+        // a new page.
+        TestLog log{flash};
+        EXPECT_EQ(log.get_record_count(), 10U);
+        EXPECT_EQ(log.get_slots_remaining(), 0U);
+        EXPECT_EQ(std::ranges::distance(log.records()), 10);
+        TestLogItem item{};
+        EXPECT_EQ(log.read_record_by_index(10, item), TestLog::Result::eInvalidOffset);
+        EXPECT_EQ(log.get_next_sequence(), 10U);
+
+        EXPECT_EQ(log.append_record(TestLogItem{12}), TestLog::Result::eOK);
+        EXPECT_EQ(log.get_newest_page(), 1U);
+        EXPECT_EQ(log.get_record_count(), 11U);
+        EXPECT_EQ(log.read_record_by_index(10, item), TestLog::Result::eOK);
+        EXPECT_TRUE(item == TestLogItem{12});
+        EXPECT_EQ(log.read_record_by_index(9, item), TestLog::Result::eOK);
+        EXPECT_TRUE(item == TestLogItem{10});
+
+        // The sequence numbers skip the rest of the short page.
+        EXPECT_EQ(std::ranges::prev(log.end()).sequence(), count);
+        EXPECT_EQ(log.get_next_sequence(), count + 1);
+        EXPECT_TRUE(*log.records_since(10).begin() == TestLogItem{12});
+
+        TestLog recovered{flash};
+        EXPECT_EQ(recovered.get_record_count(), 11U);
+        EXPECT_EQ(recovered.get_slots_remaining(), count - 1);
+        EXPECT_EQ(recovered.get_next_sequence(), count + 1);
+    }
+}
+
+
+// A log written before the commit markers were added: headers with a blank format word, and 
+// records packed up to the end of each page. 
+TEST(FlashLog, OpensLogInOldFormat)
+{
+    MockU5FlashMemory flash;
+    const uint32_t old_count = (kPageSize - sizeof(TestLog::Header)) / sizeof(TestLogItem);
+    uint32_t written = 0;
+    for (uint32_t page = 0; page < 3; ++page)
+    {
+        TestLog::Header header{};
+        header.index  = page;
+        header.format = TestLog::kUnusedWord;
+        const uint32_t address = flash.get_page_address(page);
+        flash.write(address, reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+        for (uint32_t slot = 0; slot < ((page < 2) ? old_count : 100U); ++slot)
+        {
+            const TestLogItem item{++written};
+            flash.write(address + sizeof(header) + slot * sizeof(TestLogItem), reinterpret_cast<const uint8_t*>(&item), sizeof(item));
+        }
+    }
+
+    // Every record can be read, and the sequence numbers increase through them.
+    auto check = [&](const TestLog& log, uint32_t expected_count)
+    {
+        EXPECT_EQ(log.get_record_count(), expected_count);
+        uint32_t expected = written - expected_count;
+        uint64_t sequence = 0;
+        for (auto it = log.begin(); it != log.end(); ++it)
+        {
+            EXPECT_TRUE(*it == TestLogItem{++expected});
+            if (it != log.begin()) EXPECT_GT(it.sequence(), sequence);
+            sequence = it.sequence();
+            EXPECT_EQ(log.records_since(sequence).begin().index(), it.index());
+        }
+        EXPECT_EQ(expected, written);
+        EXPECT_GT(log.get_next_sequence(), sequence);
+    };
+
+    TestLog log{flash};
+    check(log, written);
+    TestLogItem item{};
+    EXPECT_EQ(log.read_record_by_index(old_count, item), TestLog::Result::eOK);
+    EXPECT_TRUE(item == TestLogItem{old_count + 1});
+
+    // The old page is not appended to. New records go into a new page in the current format.
+    EXPECT_EQ(log.get_slots_remaining(), 0U);
+    EXPECT_EQ(log.append_record(TestLogItem{++written}), TestLog::Result::eOK);
+    EXPECT_EQ(log.get_newest_page(), 3U);
+    check(log, written);
+    check(TestLog{flash}, written);
+
+    // The old pages are overwritten in turn.
+    const uint32_t count = log.get_records_per_page();
+    const uint32_t old_records = old_count * 2 + 100;
+    for (uint32_t page = 0; page < 3; ++page)
+    {
+        while (log.get_slots_remaining() > 0)
+            log.append_record(TestLogItem{++written});
+        log.append_record(TestLogItem{++written});
+        const uint32_t expected_count = (page < 2) ? (written - old_count * (page + 1)) : (written - old_records);
+        check(log, expected_count);
+        check(TestLog{flash}, expected_count);
+    }
+    EXPECT_EQ(log.get_record_count(), count * 3 + 1);
+}
+
+
+// A reset while the header of a new page is programmed can leave the format word blank. The
+// page holds no records, and is not taken for one in the old format.
+TEST(FlashLog, RecoveryExcludesTornHeader)
+{
+    MockU5FlashMemory flash;
+    uint32_t count = 0;
+    {
+        TestLog log{flash};
+        count = log.get_records_per_page();
+        for (uint32_t i = 0; i < count; ++i)
+            log.append_record(TestLogItem{i + 1});
+    }
+
+    const uint32_t index = 1;
+    flash.write(flash.get_page_address(1), reinterpret_cast<const uint8_t*>(&index), sizeof(index));
+
+    TestLog log{flash};
+    EXPECT_EQ(log.get_newest_page(), 0U);
+    EXPECT_EQ(log.get_record_count(), count);
+    EXPECT_EQ(log.append_record(TestLogItem{count + 1}), TestLog::Result::eOK);
+    EXPECT_EQ(log.get_newest_page(), 1U);
+    EXPECT_EQ(log.get_next_sequence(), count + 1);
+
+    TestLog recovered{flash};
+    EXPECT_EQ(recovered.get_record_count(), count + 1);
+    EXPECT_TRUE(*std::ranges::prev(recovered.end()) == TestLogItem{count + 1});
+}
+
+
+TEST(FlashLog, ShortPages)
+{
+    UnmappedFlashMemory flash;
+    uint32_t written = 0;
+    uint32_t count   = 0;
+    {
+        TestLog log{flash};
+        count = log.get_records_per_page();
+        for (uint32_t i = 0; i < count + 20; ++i)
+            log.append_record(TestLogItem{++written});
+    }
+
+    // Tear a record part way through page 1. Page 1 then holds only 20 records.
+    const TestLogItem torn{};
+    const uint32_t slot = kWriteSize + 20 * sizeof(TestLogItem);
+    EXPECT_EQ(flash.write(kBaseAddress + kPageSize + slot, reinterpret_cast<const uint8_t*>(&torn), kWriteSize), IFlashMemory::Result::eOK);
+
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 1; i <= written; ++i)
+        expected.push_back(i);
+    auto log = std::make_unique<TestLog>(flash);
+    for (uint32_t i = 0; i < count + 5; ++i)
+    {
+        log->append_record(TestLogItem{++written});
+        expected.push_back(written);
+    }
+    ASSERT_EQ(log->get_newest_page(), 3U);
+    ASSERT_EQ(log->get_record_count(), expected.size());
+
+    auto check = [&](const TestLog& log)
+    {
+        // Forwards and backwards across the short page.
+        uint32_t index = 0;
+        for (const TestLogItem& item: log.records())
+            EXPECT_TRUE(item == TestLogItem{expected[index++]}) << index;
+        EXPECT_EQ(index, expected.size());
+        for (const TestLogItem& item: log.records() | std::views::reverse)
+            EXPECT_TRUE(item == TestLogItem{expected[--index]}) << index;
+
+        TestLogItem item{};
+        for (uint32_t i = 0; i < expected.size(); i += 7)
+        {
+            EXPECT_EQ(log.read_record_by_index(i, item), TestLog::Result::eOK);
+            EXPECT_TRUE(item == TestLogItem{expected[i]}) << i;
+        }
+
+        std::vector<TestLogItem> buffer(expected.size());
+        EXPECT_EQ(log.read_records(5, buffer.data(), static_cast<uint32_t>(buffer.size())), expected.size() - 5);
+        for (uint32_t i = 5; i < expected.size(); ++i)
+            EXPECT_TRUE(buffer[i - 5] == TestLogItem{expected[i]}) << i;
+
+        // Each iterator's sequence number finds it again.
+        for (auto it = log.begin(); it != log.end(); ++it)
+            EXPECT_EQ(log.records_since(it.sequence()).begin().index(), it.index());
+    };
+    check(*log);
+    log = std::make_unique<TestLog>(flash);
+    check(*log);
+
+    // A sequence number in the unused part of the short page gives the first record after it.
+    EXPECT_EQ(log->records_since(count + 25).begin().index(), count + 20);
+    EXPECT_EQ(log->records_since(count + 25).begin().sequence(), count * 2);
+
+    // When the short page is overwritten, the records are evenly spread again.
+    while (log->get_oldest_page() != 2U)
+    {
+        log->append_record(TestLogItem{++written});
+        expected.push_back(written);
+    }
+    expected.erase(expected.begin(), expected.end() - log->get_record_count());
+    EXPECT_EQ(log->get_oldest_sequence(), count * 2);
+    check(*log);
+}
+
+
+TEST(FlashLog, Iterator)
+{
+    MockU5FlashMemory flash;
+    TestLog log{flash};
+    EXPECT_TRUE(log.begin() == log.end());
+
+    // Wrap around so that the oldest record is not at the start of the flash.
+    auto count = log.get_records_per_page();
+    const uint32_t written = count * 5 + 17;
+    for (uint32_t i = 0; i < written; ++i)
+        log.append_record(TestLogItem{i + 1});
+    const uint32_t first = written - log.get_record_count() + 1;
+
+    uint32_t expected = first;
+    for (auto it = log.begin(); it != log.end(); ++it)
+    {
+        EXPECT_TRUE(*it == TestLogItem{expected});
+        // Zero copy on memory-mapped flash.
+        ASSERT_TRUE(it.get() != nullptr);
+        EXPECT_TRUE(*it.get() == TestLogItem{expected});
+        EXPECT_EQ(it.get(), log.get_pointer_by_index(it.index()));
+        ++expected;
+    }
+    EXPECT_EQ(expected, written + 1);
+
+    // Range-for and reverse views.
+    expected = first;
+    for (const TestLogItem& item: log.records())
+        EXPECT_TRUE(item == TestLogItem{expected++});
+
+    expected = written;
+    for (const TestLogItem& item: log.records() | std::views::reverse)
+        EXPECT_TRUE(item == TestLogItem{expected--});
+    EXPECT_EQ(expected, first - 1);
+
+    // Starting part way through.
+    auto range = log.records(count + 3);
+    EXPECT_TRUE(*range.begin() == TestLogItem{first + count + 3});
+    EXPECT_EQ(std::ranges::distance(range), log.get_record_count() - count - 3);
+    EXPECT_TRUE(log.records(log.get_record_count() + 10).empty());
+}
+
+
+TEST(FlashLog, IteratorUnmapped)
+{
+    UnmappedFlashMemory flash;
+    TestLog log{flash};
+    for (uint32_t i = 0; i < 300; ++i)
+        log.append_record(TestLogItem{i + 1});
+
+    uint32_t expected = 1;
+    for (auto it = log.begin(); it != log.end(); ++it)
+    {
+        EXPECT_TRUE(it.get() == nullptr);
+        EXPECT_TRUE(*it == TestLogItem{expected++});
+    }
+    EXPECT_EQ(expected, 301U);
+}
+
+
+TEST(FlashLog, ReadRecordsInBulk)
+{
+    UnmappedFlashMemory flash;
+    TestLog log{flash};
+    auto count = log.get_records_per_page();
+    const uint32_t written = count * 5 + 17;
+    for (uint32_t i = 0; i < written; ++i)
+        log.append_record(TestLogItem{i + 1});
+    const uint32_t first = written - log.get_record_count() + 1;
+
+    // Spans four pages (5 + count + count + 5 records), including the wrap from the last page
+    // to the first. There is one read per page rather than one per record.
+    std::vector<TestLogItem> buffer(count * 2 + 10);
+    flash.reset_counts();
+    EXPECT_EQ(log.read_records(count - 5, buffer.data(), static_cast<uint32_t>(buffer.size())), buffer.size());
+    EXPECT_EQ(flash.get_read_count(), 4U);
+    for (uint32_t i = 0; i < buffer.size(); ++i)
+        EXPECT_TRUE(buffer[i] == TestLogItem{first + count - 5 + i});
+
+    // Truncated at the end of the log.
+    const uint32_t total = log.get_record_count();
+    EXPECT_EQ(log.read_records(total - 4, buffer.data(), static_cast<uint32_t>(buffer.size())), 4U);
+    EXPECT_TRUE(buffer[3] == TestLogItem{written});
+    EXPECT_EQ(log.read_records(total, buffer.data(), 1), 0U);
+}
+
+
+TEST(FlashLog, RecordsSinceSequence)
+{
+    MockU5FlashMemory flash;
+    auto log = std::make_unique<TestLog>(flash);
+    auto count = log->get_records_per_page();
+    EXPECT_EQ(log->get_oldest_sequence(), 0U);
+    EXPECT_EQ(log->get_next_sequence(), 0U);
+
+    for (uint32_t i = 0; i < 50; ++i)
+        log->append_record(TestLogItem{i + 1});
+    EXPECT_EQ(log->get_next_sequence(), 50U);
+
+    // An incremental upload takes everything since the last one.
+    uint64_t uploaded = log->get_next_sequence();
+    for (uint32_t i = 50; i < 60; ++i)
+        log->append_record(TestLogItem{i + 1});
+
+    uint32_t expected = 51;
+    for (auto it = log->records_since(uploaded).begin(); it != log->end(); ++it)
+    {
+        EXPECT_EQ(it.sequence(), expected - 1);
+        EXPECT_TRUE(*it == TestLogItem{expected++});
+    }
+    EXPECT_EQ(expected, 61U);
+    EXPECT_TRUE(log->records_since(log->get_next_sequence()).empty());
+
+    // Sequence numbers survive a restart and wrapping around the flash.
+    const uint32_t written = count * 6 + 3;
+    for (uint32_t i = 60; i < written; ++i)
+        log->append_record(TestLogItem{i + 1});
+    log = std::make_unique<TestLog>(flash);
+    EXPECT_EQ(log->get_next_sequence(), written);
+    EXPECT_EQ(log->get_oldest_sequence(), written - log->get_record_count());
+
+    auto range = log->records_since(written - 5);
+    EXPECT_EQ(std::ranges::distance(range), 5);
+    EXPECT_TRUE(*range.begin() == TestLogItem{written - 4});
+
+    // Records which have been overwritten are skipped.
+    range = log->records_since(uploaded);
+    EXPECT_EQ(range.begin().sequence(), log->get_oldest_sequence());
+    EXPECT_EQ(std::ranges::distance(range), log->get_record_count());
+}
+
+
+TEST(FlashLog, AppendRecordsInBulk)
+{
+    MockU5FlashMemory flash;
+    TestLog log{flash};
+    auto count = log.get_records_per_page();
+    EXPECT_EQ(log.get_slots_remaining(), count);
+
+    // One write per page touched, the markers in batches, and the page headers.
+    std::vector<TestLogItem> items;
+    for (uint32_t i = 0; i < count * 2 + 5; ++i)
+        items.push_back(TestLogItem{i + 1});
+    flash.reset_counts();
+    EXPECT_EQ(log.append_records(items.data(), static_cast<uint32_t>(items.size())), TestLog::Result::eOK);
+    const uint32_t marker_writes = (count + TestLog::kMarkerBatch - 1) / TestLog::kMarkerBatch;
+    EXPECT_EQ(flash.get_write_count(), 3U + (marker_writes * 2 + 1) + 2U);
+    EXPECT_EQ(log.get_slots_remaining(), count - 5);
+
+    EXPECT_EQ(log.get_record_count(), items.size());
+    uint32_t expected = 1;
+    for (const TestLogItem& item: log.records())
+        EXPECT_TRUE(item == TestLogItem{expected++});
+
+    // Bulk appends wrap around and recover in the same way as single ones.
+    for (uint32_t i = 0; i < 10; ++i)
+        log.append_records(items.data(), static_cast<uint32_t>(items.size()));
+    TestLog log2{flash};
+    EXPECT_EQ(log2.get_record_count(), log.get_record_count());
+    EXPECT_EQ(log2.get_slots_remaining(), log.get_slots_remaining());
+    EXPECT_TRUE(*std::ranges::prev(log2.end()) == items.back());
+}
+
+
+namespace {
+
+// Holds the timer events until run() is called. The Linux timer queue emits with its mutex held, 
+// so dispatching from post() would deadlock when the flush stops the timer.
+class FlushEventLoop : public eg::IEventLoop
+{
+public:
+    void post(const eg::Event& ev) override { m_events.push_back(ev); }
+    void run() override 
+    {
+        // Dispatching may post more events, e.g. FlashStorageBase relays erase completions.
+        while (!m_events.empty())
+        {
+            auto events = std::move(m_events);
+            m_events.clear();
+            for (const auto& ev: events)
+                ev.dispatch();
+        }
+    }
+#if defined(OTWAY_EVENT_LOOP_WATER_MARK)
+    uint16_t get_high_water_mark() const { return 0; }
+#endif
+
+private:
+    std::vector<eg::Event> m_events;
+};
+
+class BufferedFlashLogTest : public testing::Test 
+{
+protected:
+    void SetUp() override 
+    {
+        eg::CURRENT_EVENT_LOOP = &m_loop;
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+        eg::Timer::set_virtual_time(true);
+#endif
+    }
+
+    void TearDown() override 
+    {
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+        eg::Timer::set_virtual_time(false);
+#endif
+        eg::CURRENT_EVENT_LOOP = nullptr;
+    }
+
+    void tick(uint32_t ticks)
+    {
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+        eg::Timer::advance_virtual_time(ticks);
+#else
+        while (ticks-- > 0)
+            eg::tick_software_timers();
+#endif
+        m_loop.run();
+    }
+
+    FlushEventLoop    m_loop;
+    MockU5FlashMemory m_flash;
+};
+
+} // namespace {
+
+
+TEST_F(BufferedFlashLogTest, FlushesWhenFull)
+{
+    eg::BufferedFlashLog<TestLogItem, kWriteSize, 8> log{m_flash};
+    for (uint32_t i = 0; i < 7; ++i)
+        log.append_record(TestLogItem{i + 1});
+    EXPECT_EQ(log.get_pending_count(), 7U);
+    EXPECT_EQ(log.get_log().get_record_count(), 0U);
+
+    m_flash.reset_counts();
+    log.append_record(TestLogItem{8});
+    EXPECT_EQ(log.get_pending_count(), 0U);
+    EXPECT_EQ(log.get_log().get_record_count(), 8U);
+    EXPECT_EQ(m_flash.get_write_count(), 2U);
+
+    log.append_record(TestLogItem{9});
+    EXPECT_EQ(log.flush(), TestLog::Result::eOK);
+    EXPECT_EQ(log.get_pending_count(), 0U);
+    EXPECT_EQ(log.flush(), TestLog::Result::eOK);
+
+    uint32_t expected = 1;
+    for (const TestLogItem& item: log.get_log().records())
+        EXPECT_TRUE(item == TestLogItem{expected++});
+    EXPECT_EQ(expected, 10U);
+}
+
+
+TEST_F(BufferedFlashLogTest, FlushesAtPageBoundary)
+{
+    // The buffer is larger than a page, so only the page boundaries cause flushes.
+    eg::BufferedFlashLog<TestLogItem, kWriteSize, 300> log{m_flash};
+    const uint32_t count = log.get_log().get_records_per_page();
+    ASSERT_LT(count, 300U);
+
+    // The batches are cut at the end of each page, so no single write spans an erase. After the 
+    // first page, each flush also starts the next page: a header write, and an erase if it wraps.
+    const uint32_t writes = 1 + (count + TestLog::kMarkerBatch - 1) / TestLog::kMarkerBatch;
+    uint32_t written = 0;
+    for (uint32_t page = 0; page < kNumPages * 2; ++page)
+    {
+        for (uint32_t i = 0; i < count - 1; ++i)
+            log.append_record(TestLogItem{++written});
+        EXPECT_EQ(log.get_pending_count(), count - 1);
+
+        m_flash.reset_counts();
+        log.append_record(TestLogItem{++written});
+        EXPECT_EQ(log.get_pending_count(), 0U);
+        EXPECT_EQ(log.get_log().get_slots_remaining(), 0U);
+        EXPECT_EQ(m_flash.get_write_count(), (page == 0) ? writes : (writes + 1));
+        EXPECT_EQ(m_flash.get_erase_count(), (page < kNumPages) ? 0U : 1U);
+    }
+    EXPECT_TRUE(*std::ranges::prev(log.get_log().end()) == TestLogItem{written});
+}
+
+
+TEST_F(BufferedFlashLogTest, FlushesOnTimeout)
+{
+    eg::BufferedFlashLog<TestLogItem, kWriteSize, 32> log{m_flash, 100};
+    tick(500);
+    EXPECT_EQ(log.get_log().get_record_count(), 0U);
+
+    // The first record starts the timer. Later ones don't restart it.
+    log.append_record(TestLogItem{1});
+    tick(60);
+    log.append_record(TestLogItem{2});
+    tick(39);
+    EXPECT_EQ(log.get_pending_count(), 2U);
+    tick(1);
+    EXPECT_EQ(log.get_pending_count(), 0U);
+    EXPECT_EQ(log.get_log().get_record_count(), 2U);
+
+    // An explicit flush stops the timer.
+    log.append_record(TestLogItem{3});
+    log.flush();
+    m_flash.reset_counts();
+    tick(200);
+    EXPECT_EQ(m_flash.get_write_count(), 0U);
+    EXPECT_EQ(log.get_log().get_record_count(), 3U);
+}
+
+
+TEST_F(BufferedFlashLogTest, BufferedRecordsAreLostOnReset)
+{
+    {
+        eg::BufferedFlashLog<TestLogItem, kWriteSize, 16> log{m_flash};
+        for (uint32_t i = 0; i < 20; ++i)
+            log.append_record(TestLogItem{i + 1});
+        EXPECT_EQ(log.get_pending_count(), 4U);
+    }
+
+    // Only the flushed records are recovered, and they are intact.
+    TestLog log{m_flash};
+    EXPECT_EQ(log.get_record_count(), 16U);
+    EXPECT_TRUE(*std::ranges::prev(log.end()) == TestLogItem{16});
+}
+
+
+TEST_F(BufferedFlashLogTest, KeepsRecordsWhichFailed)
+{
+    eg::sim::SimFlashMemory<MockU5FlashMemory> flash;
+    eg::BufferedFlashLog<TestLogItem, kWriteSize, 40> log{flash};
+    for (uint32_t i = 0; i < 39; ++i)
+        log.append_record(TestLogItem{i + 1});
+
+    // The flash fails after the records and the first batch of markers are programmed. 
+    const uint32_t units = sizeof(TestLogItem) / kWriteSize;
+    flash.cut_power_after(40 * units + TestLog::kMarkerBatch);
+    EXPECT_EQ(log.append_record(TestLogItem{40}), TestLog::Result::eFlashFailed);
+    EXPECT_EQ(log.get_log().get_record_count(), TestLog::kMarkerBatch);
+    EXPECT_EQ(log.get_pending_count(), 40U - TestLog::kMarkerBatch);
+
+    // Only the rest are written again, in the next page.
+    flash.power_on();
+    EXPECT_EQ(log.flush(), TestLog::Result::eOK);
+    EXPECT_EQ(log.get_pending_count(), 0U);
+
+    TestLog recovered{flash};
+    uint32_t expected = 1;
+    for (const TestLogItem& item: recovered.records())
+        EXPECT_TRUE(item == TestLogItem{expected++});
+    EXPECT_EQ(expected, 41U);
+    EXPECT_EQ(recovered.get_newest_page(), 1U);
+}
+
+
+namespace {
+
+using TimedU5FlashMemory = eg::TimedFlashMemory<MockU5FlashMemory>;
+
+class BackgroundEraseTest : public testing::Test 
+{
+protected:
+    // FlashStorageBase connects its signals on construction, so needs the event loop.
+    void SetUp() override    
+    { 
+        eg::CURRENT_EVENT_LOOP = &m_loop; 
+        m_storage_ptr = std::make_unique<eg::MockFlashStorage>(m_flash);
+    }
+
+    void TearDown() override 
+    { 
+        m_storage_ptr.reset();
+        eg::CURRENT_EVENT_LOOP = nullptr; 
+    }
+
+    // Stands in for the erase completing some time later, in the background.
+    void complete_erase(bool success = true)
+    {
+        m_storage_ptr->complete_erase(success);
+        m_loop.run();
+    }
+
+    FlushEventLoop                        m_loop;
+    TimedU5FlashMemory                    m_flash;
+    std::unique_ptr<eg::MockFlashStorage> m_storage_ptr;
+};
+
+} // namespace {
+
+
+TEST_F(BackgroundEraseTest, ErasesNextPageAhead)
+{
+    TestLog log{m_flash, *m_storage_ptr};
+    const uint32_t count = log.get_records_per_page();
+
+    // Nothing needs erasing until the log wraps.
+    uint32_t written = 0;
+    while (written < count * (kNumPages - 1))
+        EXPECT_EQ(log.append_record(TestLogItem{++written}), TestLog::Result::eOK);
+    EXPECT_EQ(m_storage_ptr->get_erase_requests(), 0U);
+
+    // Starting the last page makes the first page the next one. It is erased in the background 
+    // straight away, and its records are discarded then.
+    EXPECT_EQ(log.append_record(TestLogItem{++written}), TestLog::Result::eOK);
+    EXPECT_TRUE(m_storage_ptr->is_erase_pending());
+    EXPECT_EQ(log.get_record_count(), count * (kNumPages - 2) + 1);
+    EXPECT_TRUE(*log.begin() == TestLogItem{count + 1});
+    complete_erase();
+
+    // When the page is needed, it is already blank. No erase happens in the append, and the page 
+    // is not read again to check. The only reads are one chunk of the page after it, which is 
+    // found to need erasing, and the header of the new oldest page.
+    while (log.get_slots_remaining() > 0)
+        log.append_record(TestLogItem{++written});
+    m_flash.reset_counts();
+    EXPECT_EQ(log.append_record(TestLogItem{++written}), TestLog::Result::eOK);
+    EXPECT_EQ(m_flash.get_erase_count(), 0U);
+    EXPECT_EQ(m_flash.get_read_count(), 2U);
+    EXPECT_EQ(log.get_oldest_page(), 2U);
+    EXPECT_TRUE(m_storage_ptr->is_erase_pending());
+    complete_erase();
+
+    // Recovery sees the same state. 
+    uint32_t expected = written - log.get_record_count() + 1;
+    TestLog log2{m_flash};
+    EXPECT_EQ(log2.get_record_count(), log.get_record_count());
+    for (const TestLogItem& item: log2.records())
+        EXPECT_TRUE(item == TestLogItem{expected++});
+}
+
+
+TEST_F(BackgroundEraseTest, BusyUntilEraseCompletes)
+{
+    TestLog log{m_flash, *m_storage_ptr};
+    const uint32_t count = log.get_records_per_page();
+    uint32_t written = 0;
+    while (written < count * kNumPages)
+        log.append_record(TestLogItem{++written});
+    EXPECT_TRUE(m_storage_ptr->is_erase_pending());
+
+    // The next page is still being erased. 
+    const uint32_t records = log.get_record_count();
+    EXPECT_EQ(log.append_record(TestLogItem{written + 1}), TestLog::Result::eBusy);
+    EXPECT_EQ(log.get_record_count(), records);
+
+    complete_erase();
+    EXPECT_EQ(log.append_record(TestLogItem{++written}), TestLog::Result::eOK);
+    EXPECT_TRUE(*std::ranges::prev(log.end()) == TestLogItem{written});
+}
+
+
+TEST_F(BackgroundEraseTest, FallsBackToSynchronousEraseOnFailure)
+{
+    TestLog log{m_flash, *m_storage_ptr};
+    const uint32_t count = log.get_records_per_page();
+    uint32_t written = 0;
+    while (written < count * kNumPages)
+        log.append_record(TestLogItem{++written});
+
+    complete_erase(false);
+    m_flash.reset_counts();
+    EXPECT_EQ(log.append_record(TestLogItem{++written}), TestLog::Result::eOK);
+    EXPECT_EQ(m_flash.get_erase_count(), 1U);
+    EXPECT_TRUE(*std::ranges::prev(log.end()) == TestLogItem{written});
+}
+
+
+TEST_F(BackgroundEraseTest, ErasesAheadOnStartup)
+{
+    {
+        TestLog log{m_flash};
+        for (uint32_t i = 0; i < log.get_records_per_page() * kNumPages; ++i)
+            log.append_record(TestLogItem{i + 1});
+    }
+    EXPECT_EQ(m_storage_ptr->get_erase_requests(), 0U);
+
+    // The current page is full, and the next one holds the oldest records.
+    TestLog log{m_flash, *m_storage_ptr};
+    EXPECT_TRUE(m_storage_ptr->is_erase_pending());
+    EXPECT_EQ(log.get_record_count(), log.get_records_per_page() * (kNumPages - 1));
+    EXPECT_EQ(log.get_oldest_page(), 1U);
+}
+
+
+TEST_F(BackgroundEraseTest, BufferedLogRetriesWhenBusy)
+{
+    eg::BufferedFlashLog<TestLogItem, kWriteSize, 8> log{m_flash, *m_storage_ptr};
+    const uint32_t count = log.get_log().get_records_per_page();
+    uint32_t written = 0;
+    while (written < count * kNumPages)
+        log.append_record(TestLogItem{++written});
+    ASSERT_EQ(log.get_pending_count(), 0U);
+
+    // The records wait in the buffer while the erase is in progress. When it is full, 
+    // new records are refused.
+    for (uint32_t i = 0; i < 8; ++i)
+        log.append_record(TestLogItem{++written});
+    EXPECT_EQ(log.get_pending_count(), 8U);
+    EXPECT_EQ(log.append_record(TestLogItem{written + 1}), TestLog::Result::eBusy);
+    EXPECT_EQ(log.get_pending_count(), 8U);
+
+    complete_erase();
+    EXPECT_EQ(log.flush(), TestLog::Result::eOK);
+    EXPECT_EQ(log.get_pending_count(), 0U);
+    EXPECT_TRUE(*std::ranges::prev(log.get_log().end()) == TestLogItem{written});
+}
+
+
+TEST_F(BackgroundEraseTest, ScansBlankPageOnce)
+{
+    TestLog log{m_flash, *m_storage_ptr};
+    const uint32_t count = log.get_records_per_page();
+
+    // On the first trip round, each page after the current one is found to be blank when the 
+    // current one is started. Starting it later doesn't check it again.
+    uint32_t written = 0;
+    while (written < count)
+        log.append_record(TestLogItem{++written});
+    m_flash.reset_counts();
+    EXPECT_EQ(log.append_record(TestLogItem{++written}), TestLog::Result::eOK);
+    EXPECT_EQ(m_flash.get_read_count(), kPageSize / kWriteSize);
+    EXPECT_EQ(m_storage_ptr->get_erase_requests(), 0U);
+}
+
+
+// Another client of the same flash storage can abort the background erase. The log then
+// erases the page synchronously when it is needed, rather than waiting for ever.
+TEST_F(BackgroundEraseTest, EraseAbortedByAnotherClient)
+{
+    TestLog log{m_flash, *m_storage_ptr};
+    const uint32_t count = log.get_records_per_page();
+    uint32_t written = 0;
+    while (written < count * (kNumPages - 1))
+        log.append_record(TestLogItem{++written});
+
+    // The other client's read is in progress, so the erase of the first page queues behind it.
+    uint8_t buffer[kWriteSize];
+    EXPECT_EQ(m_storage_ptr->Read(kNumPages - 1, 0, buffer, kWriteSize), eg::FlashOperationStatus::Success);
+    EXPECT_EQ(log.append_record(TestLogItem{++written}), TestLog::Result::eOK);
+    EXPECT_EQ(m_storage_ptr->get_erase_requests(), 0U);
+
+    // Aborting drops the queued erase, and the log is told.
+    m_storage_ptr->Abort();
+    m_loop.run();
+    EXPECT_EQ(m_storage_ptr->get_erase_requests(), 0U);
+
+    while (log.get_slots_remaining() > 0)
+        log.append_record(TestLogItem{++written});
+    m_flash.reset_counts();
+    EXPECT_EQ(log.append_record(TestLogItem{++written}), TestLog::Result::eOK);
+    EXPECT_EQ(m_flash.get_erase_count(), 1U);
+    EXPECT_TRUE(*std::ranges::prev(log.end()) == TestLogItem{written});
+}
+
+
+// Another client can also check and clear the status while the erase is in progress. The 
+// erase is forgotten by the storage, so the client's requests run at once, but its completion
+// still reaches the log when it arrives.
+TEST_F(BackgroundEraseTest, EraseOutlivesCheckAndClearStatus)
+{
+    TestLog log{m_flash, *m_storage_ptr};
+    const uint32_t count = log.get_records_per_page();
+    uint32_t written = 0;
+    while (written < count * (kNumPages - 1) + 1)
+        log.append_record(TestLogItem{++written});
+    EXPECT_TRUE(m_storage_ptr->is_erase_pending());
+
+    // The read is not held up by the erase. It finds the header of page 1.
+    TestLog::Header header{};
+    m_storage_ptr->CheckAndClearStatus();
+    EXPECT_EQ(m_storage_ptr->Read(1, 0, reinterpret_cast<uint8_t*>(&header), sizeof(header)), eg::FlashOperationStatus::Success);
+    EXPECT_EQ(header.index, 1U);
+    m_loop.run();
+
+    // Still waiting for the erase.
+    while (log.get_slots_remaining() > 0)
+        log.append_record(TestLogItem{++written});
+    EXPECT_EQ(log.append_record(TestLogItem{written + 1}), TestLog::Result::eBusy);
+
+    complete_erase();
+    m_flash.reset_counts();
+    EXPECT_EQ(log.append_record(TestLogItem{++written}), TestLog::Result::eOK);
+    EXPECT_EQ(m_flash.get_erase_count(), 0U);
+    EXPECT_TRUE(*std::ranges::prev(log.end()) == TestLogItem{written});
+}
+
+
+// The worst case append is the one which starts a new page. With a synchronous erase that 
+// includes the erase time. With the erase done in the background it is just three writes.
+TEST_F(BackgroundEraseTest, WorstCaseAppendLatency)
+{
+    auto worst_case = [](TestLog& log, TimedU5FlashMemory& flash, auto&& after_append)
+    {
+        uint64_t worst = 0;
+        for (uint32_t i = 0; i < log.get_records_per_page() * kNumPages * 3; ++i)
+        {
+            flash.reset_elapsed();
+            EXPECT_EQ(log.append_record(TestLogItem{i + 1}), TestLog::Result::eOK);
+            worst = std::max(worst, flash.get_elapsed_ns());
+            after_append();
+        }
+        return worst;
+    };
+
+    TimedU5FlashMemory sync_flash;
+    TestLog sync_log{sync_flash};
+    const uint64_t sync_worst = worst_case(sync_log, sync_flash, []{});
+
+    TestLog log{m_flash, *m_storage_ptr};
+    const uint64_t background_worst = worst_case(log, m_flash, [this]{ complete_erase(); });
+
+    const auto timing = TimedU5FlashMemory::kSTM32G4;
+    const uint64_t record_ns = timing.program_setup_ns + timing.program_unit_ns * sizeof(TestLogItem) / kWriteSize;
+    const uint64_t header_ns = timing.program_setup_ns + timing.program_unit_ns * sizeof(TestLog::Header) / kWriteSize;
+    const uint64_t marker_ns = timing.program_setup_ns + timing.program_unit_ns;
+    EXPECT_EQ(sync_worst, timing.erase_ns + header_ns + record_ns + marker_ns);
+    EXPECT_EQ(background_worst, header_ns + record_ns + marker_ns);
+}
@@ -0,0 +1,305 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code
+// is confidential information and must not be disclosed to third parties or used without
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include "drivers/FlashScratchpad.h"
+#include "TestSingleThreadedUtils.h"
+#include "mock/MockFlashMemory.h"
+#include "mock/MockFlashStorage.h"
+#include <array>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+
+namespace {
+
+constexpr uint32_t kPageSize  = 2048;
+constexpr uint32_t kWriteSize = 8;       // STM32G4 double word
+using Flash = eg::MockFlashMemory<0x0800'0000, kPageSize, 2, kWriteSize>;
+
+// Typical settings: a few counters which change often, and a table which rarely does.
+struct Settings
+{
+    uint32_t                 boots;
+    uint32_t                 faults;
+    std::array<uint8_t, 200> table;
+    float                    gain;
+};
+
+bool operator==(const Settings& lhs, const Settings& rhs)
+{
+    return std::memcmp(&lhs, &rhs, sizeof(Settings)) == 0;
+}
+
+template <bool kDeltaUpdates>
+using Scratchpad = eg::FlashScratchpad<Settings, kDeltaUpdates>;
+
+// A full copy is the data plus magic, counter and CRC, rounded up to 16 bytes. A delta with one
+// changed chunk is a 16 byte header plus that chunk.
+constexpr uint32_t kFullSize  = 224;
+constexpr uint32_t kDeltaSize = 32;
+
+Settings make_defaults()
+{
+    Settings settings{};
+    for (uint32_t i = 0; i < settings.table.size(); ++i)
+        settings.table[i] = static_cast<uint8_t>(i);
+    settings.gain = 1.0f;
+    return settings;
+}
+
+uint32_t read_magic(const Flash& flash, uint32_t page, uint32_t offset)
+{
+    uint32_t magic;
+    std::memcpy(&magic, flash.get_data(page, offset), sizeof(magic));
+    return magic;
+}
+
+// Holds the events until run() is called, so that the flash storage's completions happen
+// between updates, as they would on the target.
+class QueuedEventLoop : public eg::IEventLoop
+{
+public:
+    void post(const eg::Event& ev) override { m_events.push_back(ev); }
+    void run() override
+    {
+        while (!m_events.empty())
+        {
+            auto events = std::move(m_events);
+            m_events.clear();
+            for (const auto& ev: events)
+                ev.dispatch();
+        }
+    }
+#if defined(OTWAY_EVENT_LOOP_WATER_MARK)
+    uint16_t get_high_water_mark() const { return 0; }
+#endif
+
+private:
+    std::vector<eg::Event> m_events;
+};
+
+class FlashScratchpadTest : public testing::Test
+{
+protected:
+    // FlashStorageBase connects its signals on construction, so needs the event loop.
+    void SetUp() override
+    {
+        eg::CURRENT_EVENT_LOOP = &m_loop;
+        m_storage_ptr = std::make_unique<eg::MockFlashStorage>(m_flash);
+    }
+
+    void TearDown() override
+    {
+        m_storage_ptr.reset();
+        eg::CURRENT_EVENT_LOOP = nullptr;
+    }
+
+    // Lets any page erase the update started complete, and then the storage's completion events.
+    template <typename Pad>
+    void update(Pad& pad, eg::MockFlashStorage& storage, const Settings& settings)
+    {
+        pad.UpdateData(settings);
+        storage.complete_erase();
+        m_loop.run();
+    }
+
+    template <typename Pad>
+    void update(Pad& pad, const Settings& settings) { update(pad, *m_storage_ptr, settings); }
+
+    // Counts the page erases caused by updates which each bump the boot count, as a device
+    // which records its resets might.
+    template <bool kDeltaUpdates>
+    uint32_t count_erases(uint32_t updates)
+    {
+        Flash                flash;
+        eg::MockFlashStorage storage{flash};
+        Scratchpad<kDeltaUpdates> pad{storage, 0, 1, make_defaults()};
+        m_loop.run();
+
+        Settings settings = make_defaults();
+        for (uint32_t i = 0; i < updates; ++i)
+        {
+            ++settings.boots;
+            update(pad, storage, settings);
+        }
+
+        Scratchpad<kDeltaUpdates> restored{storage, 0, 1, make_defaults()};
+        EXPECT_TRUE(restored.GetData() == settings);
+        return flash.get_erase_count();
+    }
+
+    QueuedEventLoop                       m_loop;
+    Flash                                 m_flash;
+    std::unique_ptr<eg::MockFlashStorage> m_storage_ptr;
+};
+
+} // namespace {
+
+
+TEST_F(FlashScratchpadTest, WritesDefaultsToBlankFlash)
+{
+    Scratchpad<false> full{*m_storage_ptr, 0, 1, make_defaults()};
+    EXPECT_TRUE(full.GetData() == make_defaults());
+    EXPECT_EQ(read_magic(m_flash, 0, 0), eg::kMagicNumber);
+
+    Flash                flash;
+    eg::MockFlashStorage storage{flash};
+    Scratchpad<true>     delta{storage, 0, 1, make_defaults()};
+    EXPECT_TRUE(delta.GetData() == make_defaults());
+    EXPECT_EQ(read_magic(flash, 0, 0), eg::kMagicNumber);
+    EXPECT_EQ(read_magic(flash, 0, kFullSize), eg::kBlankNumber);
+}
+
+
+TEST_F(FlashScratchpadTest, DeltaUpdatesAreRestored)
+{
+    Scratchpad<true> pad{*m_storage_ptr, 0, 1, make_defaults()};
+    Settings settings = make_defaults();
+
+    // Only the chunk holding the counters is written.
+    settings.boots = 1;
+    update(pad, settings);
+    EXPECT_EQ(read_magic(m_flash, 0, kFullSize), eg::kDeltaMagicNumber);
+    EXPECT_EQ(read_magic(m_flash, 0, kFullSize + kDeltaSize), eg::kBlankNumber);
+
+    // Changes in two chunks go in one record, so they are applied together.
+    settings.faults   = 3;
+    settings.table[7] = 0x55;
+    settings.gain     = 2.5f;
+    update(pad, settings);
+    EXPECT_EQ(read_magic(m_flash, 0, kFullSize + kDeltaSize), eg::kDeltaMagicNumber);
+    EXPECT_EQ(read_magic(m_flash, 0, kFullSize + 2 * kDeltaSize + 16), eg::kBlankNumber);
+    EXPECT_TRUE(pad.GetData() == settings);
+
+    // Writing the same data again does nothing.
+    m_flash.reset_counts();
+    update(pad, settings);
+    EXPECT_EQ(m_flash.get_write_count(), 0U);
+
+    Scratchpad<true> restored{*m_storage_ptr, 0, 1, make_defaults()};
+    EXPECT_TRUE(restored.GetData() == settings);
+}
+
+
+TEST_F(FlashScratchpadTest, LargeChangesWriteFullCopy)
+{
+    Scratchpad<true> pad{*m_storage_ptr, 0, 1, make_defaults()};
+    Settings settings = make_defaults();
+
+    // A delta of every chunk would be bigger than a full copy.
+    settings.table.fill(0xA5);
+    update(pad, settings);
+    EXPECT_EQ(read_magic(m_flash, 0, kFullSize), eg::kMagicNumber);
+
+    settings.boots = 2;
+    update(pad, settings);
+    EXPECT_EQ(read_magic(m_flash, 0, 2 * kFullSize), eg::kDeltaMagicNumber);
+
+    Scratchpad<true> restored{*m_storage_ptr, 0, 1, make_defaults()};
+    EXPECT_TRUE(restored.GetData() == settings);
+}
+
+
+TEST_F(FlashScratchpadTest, PageSwapStartsWithFullCopy)
+{
+    Scratchpad<true> pad{*m_storage_ptr, 0, 1, make_defaults()};
+    Settings settings = make_defaults();
+
+    const uint32_t deltas_per_page = (kPageSize - kFullSize) / kDeltaSize;
+    for (uint32_t i = 0; i < deltas_per_page; ++i)
+    {
+        ++settings.boots;
+        update(pad, settings);
+    }
+    EXPECT_EQ(m_storage_ptr->get_erase_requests(), 0U);
+
+    // No room for another delta, so the data moves to the other page and the first is erased.
+    ++settings.boots;
+    update(pad, settings);
+    EXPECT_EQ(m_storage_ptr->get_erase_requests(), 1U);
+    EXPECT_EQ(read_magic(m_flash, 1, 0), eg::kMagicNumber);
+    EXPECT_EQ(read_magic(m_flash, 1, kFullSize), eg::kBlankNumber);
+    EXPECT_EQ(read_magic(m_flash, 0, 0), eg::kBlankNumber);
+
+    ++settings.boots;
+    update(pad, settings);
+    EXPECT_EQ(read_magic(m_flash, 1, kFullSize), eg::kDeltaMagicNumber);
+
+    Scratchpad<true> restored{*m_storage_ptr, 0, 1, make_defaults()};
+    EXPECT_TRUE(restored.GetData() == settings);
+}
+
+
+TEST_F(FlashScratchpadTest, InterruptedPageSwapIsCompleted)
+{
+    Scratchpad<true> pad{*m_storage_ptr, 0, 1, make_defaults()};
+    Settings settings = make_defaults();
+    while (m_storage_ptr->get_erase_requests() == 0)
+    {
+        ++settings.boots;
+        pad.UpdateData(settings);
+        m_loop.run();
+    }
+
+    // Reset before the old page is erased. The newer page wins, and the old one is erased again.
+    m_storage_ptr->complete_erase(false);
+    m_loop.run();
+    EXPECT_NE(read_magic(m_flash, 0, 0), eg::kBlankNumber);
+
+    Scratchpad<true> restored{*m_storage_ptr, 0, 1, make_defaults()};
+    EXPECT_TRUE(restored.GetData() == settings);
+    EXPECT_EQ(m_storage_ptr->get_erase_requests(), 2U);
+    m_storage_ptr->complete_erase();
+    m_loop.run();
+    EXPECT_EQ(read_magic(m_flash, 0, 0), eg::kBlankNumber);
+}
+
+
+TEST_F(FlashScratchpadTest, TornDeltaIsIgnored)
+{
+    Settings settings = make_defaults();
+    {
+        Scratchpad<true> pad{*m_storage_ptr, 0, 1, make_defaults()};
+        settings.boots = 1;
+        update(pad, settings);
+    }
+
+    // A reset part way through programming the next delta leaves its header, but not a good CRC.
+    std::array<uint32_t, kDeltaSize / 4> torn{};
+    torn[0] = eg::kDeltaMagicNumber;
+    torn[1] = 2;
+    ASSERT_EQ(m_flash.write(0, kFullSize + kDeltaSize, reinterpret_cast<const uint8_t*>(torn.data()), kDeltaSize),
+        Flash::Result::eOK);
+
+    Scratchpad<true> restored{*m_storage_ptr, 0, 1, make_defaults()};
+    EXPECT_TRUE(restored.GetData() == settings);
+
+    // Nothing more can be appended after the torn record, so the next update swaps pages.
+    settings.boots = 2;
+    update(restored, settings);
+    EXPECT_EQ(m_storage_ptr->get_erase_requests(), 1U);
+    EXPECT_EQ(read_magic(m_flash, 1, 0), eg::kMagicNumber);
+
+    Scratchpad<true> restored2{*m_storage_ptr, 0, 1, make_defaults()};
+    EXPECT_TRUE(restored2.GetData() == settings);
+}
+
+
+TEST_F(FlashScratchpadTest, DeltaUpdatesEraseLessOften)
+{
+    // A full copy takes 224 bytes, so a 2KB page holds 9. One changed chunk takes 32 bytes, so a page
+    // holds a full copy and 57 deltas.
+    constexpr uint32_t kUpdates = 1000;
+    const uint32_t full_erases  = count_erases<false>(kUpdates);
+    const uint32_t delta_erases = count_erases<true>(kUpdates);
+    EXPECT_EQ(full_erases, kUpdates / 9);
+    EXPECT_EQ(delta_erases, kUpdates / 58);
+    EXPECT_LT(delta_erases * 6, full_erases);
+}
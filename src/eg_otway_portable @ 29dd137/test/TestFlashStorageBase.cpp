@@ -12,6 +12,8 @@
 #include "utilities/CriticalSection.h"
 #include "TestSingleThreadedUtils.h"
 #include <stdint.h>
+#include <string>
+#include <vector>
 
 
 namespace {
@@ -153,8 +155,8 @@ TEST_F(FlashTest, ReadNonZeroLength)
     EXPECT_EQ(flash->Read(0, 0, buf, bufLen), eg::FlashOperationStatus::Success);
     EXPECT_EQ(g_test_emit_count, 2); 
     EXPECT_EQ(flash->CheckAndClearStatus(), eg::FlashOperationStatus::Success);
-    // TODO: Should this really return Operation::None?
-    operationResultExpected(eg::OperationCompletion_t{eg::FlashOperationStatus::Success, eg::Operation::None, 0});
+    operationResultExpected(eg::OperationCompletion_t{eg::FlashOperationStatus::Success, eg::Operation::Read, 0});
+    delete [] buf;
 }
 
 
@@ -218,17 +220,25 @@ TEST_F(FlashTest, WriteWithNullBuffer)
 
 TEST_F(FlashTest, WriteInvalidLength)
 {
+    // A write may run on into the next sector, but not past the last valid one
     uint32_t bufLenInvalid = 128;
-    uint8_t* bufInvalid = new uint8_t[bufLen];
-    EXPECT_EQ(flash->Write(0, 0, bufInvalid, bufLenInvalid), eg::FlashOperationStatus::InvalidLength);
+    uint8_t* bufInvalid = new uint8_t[bufLenInvalid];
+    EXPECT_EQ(flash->Write(254, 0, bufInvalid, bufLenInvalid), eg::FlashOperationStatus::InvalidLength);
     EXPECT_EQ(g_test_emit_count, 1); 
     EXPECT_EQ(flash->CheckAndClearStatus(), eg::FlashOperationStatus::None);
-    // TODO: Should this really return Operation::None?
-    operationResultExpected(eg::OperationCompletion_t{eg::FlashOperationStatus::InvalidLength, eg::Operation::Write, 0});
+    operationResultExpected(eg::OperationCompletion_t{eg::FlashOperationStatus::InvalidLength, eg::Operation::Write, 254});
     delete [] bufInvalid;
 }
 
 
+TEST_F(FlashTest, WriteUnalignedLength)
+{
+    EXPECT_EQ(flash->Write(0, 0, buf, 4), eg::FlashOperationStatus::InvalidLength);
+    EXPECT_EQ(g_test_emit_count, 1); 
+    operationResultExpected(eg::OperationCompletion_t{eg::FlashOperationStatus::InvalidLength, eg::Operation::Write, 0});
+}
+
+
 TEST_F(FlashTest, WriteInvalidOffset)
 {
     EXPECT_EQ(flash->Write(0, 64, buf, bufLen), eg::FlashOperationStatus::InvalidOffset);
@@ -266,4 +276,383 @@ TEST_F(FlashTest, EraseBadLocation)
 TEST_F(FlashTest, WriteSize)
 {
     EXPECT_EQ(flash->GetWriteSize(), 8u);
-}
\ No newline at end of file
+}
+
+// Queueing tests
+
+
+namespace {
+
+// A device whose operations complete when the test says so, as they would from the flash interrupt. Each 
+// operation started is recorded, e.g. "E3" for an erase of sector 3 and "W1+32:16" for a write of 16 bytes 
+// at offset 32 in sector 1.
+class DeferredFlash : public eg::FlashStorageBase
+{
+public:
+    explicit DeferredFlash(uint32_t writeSize = kDefaultWriteSize, bool overlap = false) 
+    : FlashStorageBase{writeSize}
+    , mOverlap{overlap} 
+    {
+    }
+
+    bool Initialize() override { return true; }
+    uint32_t GetNumberOfSectors() override { return 16; }
+    bool IsValidSector(uint32_t sectorNumber) override { return sectorNumber < 16; }
+    bool IsSectorReadOnly([[maybe_unused]] uint32_t sectorNumber) override { return false; }
+    uint8_t* GetSectorStartAddress([[maybe_unused]] uint32_t sectorNumber) override { return nullptr; }
+    uint32_t GetSectorSize([[maybe_unused]] uint32_t sectorNumber) override { return 64; }
+
+    void CompleteRead(eg::FlashOperationStatus status = eg::FlashOperationStatus::Success) { mOnFlashReadComplete.emit(status); }
+    void CompleteWrite(eg::FlashOperationStatus status = eg::FlashOperationStatus::Success) { mOnFlashWriteComplete.emit(status); }
+    void CompleteErase(eg::FlashOperationStatus status = eg::FlashOperationStatus::Success) { mOnFlashEraseComplete.emit(status); }
+
+    // The next operation of the given kind ('R', 'W' or 'E') fails to start.
+    void FailNext(char kind) { mFailNext = kind; }
+
+    std::vector<std::string> calls;
+
+protected:
+    eg::FlashOperationStatus OnReadBytes(uint32_t sector, uint32_t offsetInSector, [[maybe_unused]] uint8_t* destinationBuffer, uint32_t numberOfBytesToRead) override
+    {
+        calls.push_back("R" + Describe(sector, offsetInSector, numberOfBytesToRead));
+        return Started('R');
+    }
+
+    eg::FlashOperationStatus OnWriteBytes(uint32_t sector, uint32_t offsetInSector, [[maybe_unused]] const uint8_t* sourceBuffer, uint32_t size) override
+    {
+        calls.push_back("W" + Describe(sector, offsetInSector, size));
+        return Started('W');
+    }
+
+    eg::FlashOperationStatus OnEraseSector(uint32_t sector) override
+    {
+        calls.push_back("E" + std::to_string(sector));
+        return Started('E');
+    }
+
+    void OnAbort() override { }
+
+    bool CanEraseDuringWrite([[maybe_unused]] uint32_t eraseSector, [[maybe_unused]] uint32_t writeSector) override { return mOverlap; }
+
+private:
+    static std::string Describe(uint32_t sector, uint32_t offset, uint32_t length)
+    {
+        return std::to_string(sector) + "+" + std::to_string(offset) + ":" + std::to_string(length);
+    }
+
+    eg::FlashOperationStatus Started(char kind)
+    {
+        if (mFailNext != kind) return eg::FlashOperationStatus::Success;
+        mFailNext = 0;
+        return eg::FlashOperationStatus::Failed;
+    }
+
+private:
+    bool mOverlap;
+    char mFailNext{};
+};
+
+std::vector<eg::OperationCompletion_t> g_completions;
+
+void record(const eg::OperationCompletion_t& result) { g_completions.push_back(result); }
+
+} // namespace {
+
+
+class FlashQueueTest : public testing::Test 
+{
+protected:
+    void SetUp() override
+    {
+        eg::CURRENT_EVENT_LOOP = &m_loop;
+        g_completions.clear();
+    }
+
+    void TearDown() override { eg::CURRENT_EVENT_LOOP = nullptr; }
+
+    void Connect(DeferredFlash& flash) { flash.OnFlashOperationComplete().connect<&record>(); }
+
+    static void ExpectCompletion(size_t index, const eg::OperationCompletion_t expected)
+    {
+        ASSERT_LT(index, g_completions.size());
+        EXPECT_EQ(g_completions[index].Status, expected.Status);
+        EXPECT_EQ(g_completions[index].Op, expected.Op);
+        EXPECT_EQ(g_completions[index].SectorNumber, expected.SectorNumber);
+    }
+
+    using Calls = std::vector<std::string>;
+
+    TestEventLoop m_loop;
+    uint8_t       m_buffer[256]{};
+};
+
+
+TEST_F(FlashQueueTest, RequestsRunInOrder)
+{
+    DeferredFlash flash;
+    Connect(flash);
+    EXPECT_EQ(flash.EraseSector(1), eg::FlashOperationStatus::Success);
+    EXPECT_EQ(flash.Write(2, 0, m_buffer, 8), eg::FlashOperationStatus::Success);
+    EXPECT_EQ(flash.Read(3, 8, m_buffer, 16), eg::FlashOperationStatus::Success);
+    EXPECT_EQ(flash.calls, (Calls{"E1"}));
+
+    flash.CompleteErase();
+    EXPECT_EQ(flash.calls, (Calls{"E1", "W2+0:8"}));
+    flash.CompleteWrite();
+    EXPECT_EQ(flash.calls, (Calls{"E1", "W2+0:8", "R3+8:16"}));
+    flash.CompleteRead();
+
+    ASSERT_EQ(g_completions.size(), 3u);
+    ExpectCompletion(0, {eg::FlashOperationStatus::Success, eg::Operation::Erase, 1});
+    ExpectCompletion(1, {eg::FlashOperationStatus::Success, eg::Operation::Write, 2});
+    ExpectCompletion(2, {eg::FlashOperationStatus::Success, eg::Operation::Read, 3});
+}
+
+
+TEST_F(FlashQueueTest, WriteAcrossSectorsIsSplit)
+{
+    DeferredFlash flash;
+    Connect(flash);
+    EXPECT_EQ(flash.Write(1, 32, m_buffer, 128), eg::FlashOperationStatus::Success);
+    flash.CompleteWrite();
+    flash.CompleteWrite();
+    EXPECT_TRUE(g_completions.empty());
+    flash.CompleteWrite();
+
+    EXPECT_EQ(flash.calls, (Calls{"W1+32:32", "W2+0:64", "W3+0:32"}));
+    ASSERT_EQ(g_completions.size(), 1u);
+    ExpectCompletion(0, {eg::FlashOperationStatus::Success, eg::Operation::Write, 1});
+}
+
+
+TEST_F(FlashQueueTest, ReadSegmentsCompleteOnce)
+{
+    DeferredFlash flash;
+    Connect(flash);
+    const eg::FlashReadSegment_t segments[] = {{5, 0, m_buffer, 16}, {7, 0, m_buffer + 16, 0}, {9, 48, m_buffer + 16, 32}};
+    EXPECT_EQ(flash.ReadSegments(segments, 3), eg::FlashOperationStatus::Success);
+    flash.CompleteRead();
+    flash.CompleteRead();
+    flash.CompleteRead();
+
+    EXPECT_EQ(flash.calls, (Calls{"R5+0:16", "R9+48:16", "R10+0:16"}));
+    ASSERT_EQ(g_completions.size(), 1u);
+    ExpectCompletion(0, {eg::FlashOperationStatus::Success, eg::Operation::Read, 5});
+}
+
+
+TEST_F(FlashQueueTest, FailureAbandonsRestOfOperation)
+{
+    DeferredFlash flash;
+    Connect(flash);
+    const eg::FlashWriteSegment_t segments[] = {{0, 0, m_buffer, 8}, {4, 0, m_buffer, 8}};
+    EXPECT_EQ(flash.WriteSegments(segments, 2, false), eg::FlashOperationStatus::Success);
+    EXPECT_EQ(flash.Read(6, 0, m_buffer, 8), eg::FlashOperationStatus::Success);
+    flash.CompleteWrite(eg::FlashOperationStatus::Failed);
+    flash.CompleteRead();
+
+    EXPECT_EQ(flash.calls, (Calls{"W0+0:8", "R6+0:8"}));
+    ASSERT_EQ(g_completions.size(), 2u);
+    ExpectCompletion(0, {eg::FlashOperationStatus::Failed, eg::Operation::Write, 0});
+    ExpectCompletion(1, {eg::FlashOperationStatus::Success, eg::Operation::Read, 6});
+}
+
+
+TEST_F(FlashQueueTest, SegmentsAreCheckedFirst)
+{
+    DeferredFlash flash;
+    Connect(flash);
+    const eg::FlashWriteSegment_t segments[] = {{0, 0, m_buffer, 8}, {4, 4, m_buffer, 8}};
+    EXPECT_EQ(flash.WriteSegments(segments, 2, false), eg::FlashOperationStatus::InvalidOffset);
+    EXPECT_TRUE(flash.calls.empty());
+    ASSERT_EQ(g_completions.size(), 1u);
+    ExpectCompletion(0, {eg::FlashOperationStatus::InvalidOffset, eg::Operation::Write, 0});
+}
+
+
+TEST_F(FlashQueueTest, WriteSizeComesFromDevice)
+{
+    DeferredFlash flash{16};
+    Connect(flash);
+    EXPECT_EQ(static_cast<eg::IFlashStorage&>(flash).GetWriteSize(), 16u);
+    EXPECT_EQ(flash.Write(0, 8, m_buffer, 16), eg::FlashOperationStatus::InvalidOffset);
+    EXPECT_EQ(flash.Write(0, 16, m_buffer, 24), eg::FlashOperationStatus::InvalidLength);
+    EXPECT_EQ(flash.Write(0, 16, m_buffer, 32), eg::FlashOperationStatus::Success);
+    EXPECT_EQ(flash.calls, (Calls{"W0+16:32"}));
+}
+
+
+TEST_F(FlashQueueTest, EraseFirstOneSectorAtATime)
+{
+    DeferredFlash flash;
+    Connect(flash);
+    const eg::FlashWriteSegment_t segments[] = {{2, 0, m_buffer, 128}};
+    EXPECT_EQ(flash.WriteSegments(segments, 1, true), eg::FlashOperationStatus::Success);
+    flash.CompleteErase();
+    flash.CompleteWrite();
+    flash.CompleteErase();
+    flash.CompleteWrite();
+
+    EXPECT_EQ(flash.calls, (Calls{"E2", "W2+0:64", "E3", "W3+0:64"}));
+    ASSERT_EQ(g_completions.size(), 1u);
+    ExpectCompletion(0, {eg::FlashOperationStatus::Success, eg::Operation::Write, 2});
+}
+
+
+TEST_F(FlashQueueTest, EraseFirstOverlapsNextErase)
+{
+    DeferredFlash flash{DeferredFlash::kDefaultWriteSize, true};
+    Connect(flash);
+    const eg::FlashWriteSegment_t segments[] = {{2, 0, m_buffer, 128}, {6, 0, m_buffer, 8}};
+    EXPECT_EQ(flash.WriteSegments(segments, 2, true), eg::FlashOperationStatus::Success);
+    flash.CompleteErase();
+    EXPECT_EQ(flash.calls, (Calls{"E2", "E3", "W2+0:64"}));
+
+    // The erase may finish before or after the write. Sector 3 is only written once it has.
+    flash.CompleteWrite();
+    EXPECT_EQ(flash.calls.size(), 3u);
+    flash.CompleteErase();
+    EXPECT_EQ(flash.calls, (Calls{"E2", "E3", "W2+0:64", "E6", "W3+0:64"}));
+    flash.CompleteErase();
+    flash.CompleteWrite();
+    EXPECT_TRUE(g_completions.empty());
+    flash.CompleteWrite();
+
+    EXPECT_EQ(flash.calls, (Calls{"E2", "E3", "W2+0:64", "E6", "W3+0:64", "W6+0:8"}));
+    ASSERT_EQ(g_completions.size(), 1u);
+    ExpectCompletion(0, {eg::FlashOperationStatus::Success, eg::Operation::Write, 2});
+}
+
+
+TEST_F(FlashQueueTest, FullQueueIsBusy)
+{
+    DeferredFlash flash;
+    Connect(flash);
+    for (uint32_t sector = 0; sector < DeferredFlash::kMaxRequests; ++sector)
+    {
+        EXPECT_EQ(flash.EraseSector(sector), eg::FlashOperationStatus::Success);
+    }
+    EXPECT_EQ(flash.EraseSector(8), eg::FlashOperationStatus::Busy);
+    ASSERT_EQ(g_completions.size(), 1u);
+    ExpectCompletion(0, {eg::FlashOperationStatus::Busy, eg::Operation::Erase, 8});
+
+    flash.CompleteErase();
+    EXPECT_EQ(flash.EraseSector(8), eg::FlashOperationStatus::Success);
+}
+
+
+TEST_F(FlashQueueTest, AbortCompletesQueue)
+{
+    DeferredFlash flash;
+    Connect(flash);
+    EXPECT_EQ(flash.EraseSector(0), eg::FlashOperationStatus::Success);
+    EXPECT_EQ(flash.Write(1, 0, m_buffer, 8), eg::FlashOperationStatus::Success);
+    flash.Abort();
+
+    // The queued write is completed as aborted. The erase which was in progress reports when it finishes.
+    ASSERT_EQ(g_completions.size(), 1u);
+    ExpectCompletion(0, {eg::FlashOperationStatus::Aborted, eg::Operation::Write, 1});
+    flash.CompleteErase();
+    EXPECT_EQ(flash.calls, (Calls{"E0"}));
+    ASSERT_EQ(g_completions.size(), 2u);
+    ExpectCompletion(1, {eg::FlashOperationStatus::Success, eg::Operation::Erase, 0});
+
+    EXPECT_EQ(flash.Write(2, 0, m_buffer, 8), eg::FlashOperationStatus::Success);
+    EXPECT_EQ(flash.calls, (Calls{"E0", "W2+0:8"}));
+}
+
+
+TEST_F(FlashQueueTest, AbortPartWayThroughOperation)
+{
+    DeferredFlash flash;
+    Connect(flash);
+    EXPECT_EQ(flash.Write(1, 0, m_buffer, 128), eg::FlashOperationStatus::Success);
+    flash.Abort();
+    ASSERT_EQ(g_completions.size(), 1u);
+    ExpectCompletion(0, {eg::FlashOperationStatus::Aborted, eg::Operation::Write, 1});
+
+    // The completion of the piece which was in progress is ignored, and does not complete the next write.
+    EXPECT_EQ(flash.Write(4, 0, m_buffer, 8), eg::FlashOperationStatus::Success);
+    flash.CompleteWrite();
+    EXPECT_EQ(g_completions.size(), 1u);
+    flash.CompleteWrite();
+    EXPECT_EQ(flash.calls, (Calls{"W1+0:64", "W4+0:8"}));
+    ASSERT_EQ(g_completions.size(), 2u);
+    ExpectCompletion(1, {eg::FlashOperationStatus::Success, eg::Operation::Write, 4});
+}
+
+
+TEST_F(FlashQueueTest, CheckAndClearStatusKeepsQueue)
+{
+    // One client's erase is in progress, and another's write and read are queued behind it.
+    DeferredFlash flash;
+    Connect(flash);
+    EXPECT_EQ(flash.EraseSector(1), eg::FlashOperationStatus::Success);
+    EXPECT_EQ(flash.Write(2, 0, m_buffer, 8), eg::FlashOperationStatus::Success);
+    EXPECT_EQ(flash.Read(3, 0, m_buffer, 8), eg::FlashOperationStatus::Success);
+
+    // The erase is forgotten, so the write starts at once. Nothing is dropped.
+    EXPECT_EQ(flash.CheckAndClearStatus(), eg::FlashOperationStatus::Success);
+    EXPECT_EQ(flash.calls, (Calls{"E1", "W2+0:8"}));
+    EXPECT_TRUE(g_completions.empty());
+
+    flash.CompleteErase();
+    flash.CompleteWrite();
+    flash.CompleteRead();
+    EXPECT_EQ(flash.calls, (Calls{"E1", "W2+0:8", "R3+0:8"}));
+    ASSERT_EQ(g_completions.size(), 3u);
+    ExpectCompletion(0, {eg::FlashOperationStatus::Success, eg::Operation::Erase, 1});
+    ExpectCompletion(1, {eg::FlashOperationStatus::Success, eg::Operation::Write, 2});
+    ExpectCompletion(2, {eg::FlashOperationStatus::Success, eg::Operation::Read, 3});
+    EXPECT_EQ(flash.CheckAndClearStatus(), eg::FlashOperationStatus::Success);
+    EXPECT_EQ(flash.CheckAndClearStatus(), eg::FlashOperationStatus::None);
+}
+
+
+TEST_F(FlashQueueTest, StartFailureMovesOn)
+{
+    DeferredFlash flash;
+    Connect(flash);
+
+    // An operation which starts straight away returns the failure.
+    flash.FailNext('E');
+    EXPECT_EQ(flash.EraseSector(0), eg::FlashOperationStatus::Failed);
+    ASSERT_EQ(g_completions.size(), 1u);
+    ExpectCompletion(0, {eg::FlashOperationStatus::Failed, eg::Operation::Erase, 0});
+
+    // A queued one fails when it is reached, and the next starts.
+    EXPECT_EQ(flash.Read(1, 0, m_buffer, 8), eg::FlashOperationStatus::Success);
+    EXPECT_EQ(flash.Write(2, 0, m_buffer, 8), eg::FlashOperationStatus::Success);
+    EXPECT_EQ(flash.Read(3, 0, m_buffer, 8), eg::FlashOperationStatus::Success);
+    flash.FailNext('W');
+    flash.CompleteRead();
+    EXPECT_EQ(flash.calls, (Calls{"E0", "R1+0:8", "W2+0:8", "R3+0:8"}));
+    flash.CompleteRead();
+
+    ASSERT_EQ(g_completions.size(), 4u);
+    ExpectCompletion(1, {eg::FlashOperationStatus::Success, eg::Operation::Read, 1});
+    ExpectCompletion(2, {eg::FlashOperationStatus::Failed, eg::Operation::Write, 2});
+    ExpectCompletion(3, {eg::FlashOperationStatus::Success, eg::Operation::Read, 3});
+}
+
+
+TEST_F(FlashQueueTest, EraseAheadStartFailureErasesInLine)
+{
+    DeferredFlash flash{DeferredFlash::kDefaultWriteSize, true};
+    Connect(flash);
+    const eg::FlashWriteSegment_t segments[] = {{2, 0, m_buffer, 128}};
+    EXPECT_EQ(flash.WriteSegments(segments, 1, true), eg::FlashOperationStatus::Success);
+    flash.FailNext('E');
+    flash.CompleteErase();
+    EXPECT_EQ(flash.calls, (Calls{"E2", "E3", "W2+0:64"}));
+
+    // Sector 3 is erased when it is reached instead.
+    flash.CompleteWrite();
+    EXPECT_EQ(flash.calls, (Calls{"E2", "E3", "W2+0:64", "E3"}));
+    flash.CompleteErase();
+    flash.CompleteWrite();
+
+    EXPECT_EQ(flash.calls, (Calls{"E2", "E3", "W2+0:64", "E3", "W3+0:64"}));
+    ASSERT_EQ(g_completions.size(), 1u);
+    ExpectCompletion(0, {eg::FlashOperationStatus::Success, eg::Operation::Write, 2});
+}
@@ -0,0 +1,191 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include "utilities/CriticalSection.h"
+#include "utilities/LockDomain.h"
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#endif
+
+
+using namespace eg;
+
+
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+
+
+namespace {
+
+// Increment a shared count from several threads, each increment in its own critical section.
+uint32_t hammer(LockDomain& domain, uint32_t threads, uint32_t increments)
+{
+    uint32_t count = 0;
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&]
+        {
+            for (uint32_t i = 0; i < increments; ++i)
+            {
+                CriticalSection cs{domain};
+                count = count + 1;
+            }
+        });
+    }
+    for (auto& worker: workers) worker.join();
+    return count;
+}
+
+} // namespace {
+
+
+TEST(LockDomain, Nesting)
+{
+    LockDomain domain{"nesting"};
+    {
+        CriticalSection cs1{domain};
+        {
+            // This would deadlock with the old shared std::mutex.
+            CriticalSection cs2{domain};
+            EXPECT_TRUE(domain.is_held_by_this_thread());
+        }
+        EXPECT_TRUE(domain.is_held_by_this_thread());
+    }
+    EXPECT_FALSE(domain.is_held_by_this_thread());
+
+    // The same for the global domain.
+    {
+        CriticalSection cs1;
+        CriticalSection cs2;
+        EXPECT_TRUE(LockDomain::global().is_held_by_this_thread());
+    }
+    EXPECT_FALSE(LockDomain::global().is_held_by_this_thread());
+}
+
+
+TEST(LockDomain, MutualExclusion)
+{
+    LockDomain adaptive{"adaptive", LockDomain::Kind::Adaptive};
+    EXPECT_EQ(hammer(adaptive, 4, 20000), 80000U);
+
+    LockDomain spin{"spin", LockDomain::Kind::Spin};
+    EXPECT_EQ(hammer(spin, 4, 20000), 80000U);
+}
+
+
+TEST(LockDomain, IndependentDomains)
+{
+    LockDomain first{"first"};
+    LockDomain second{"second"};
+
+    std::atomic<bool> entered{false};
+    CriticalSection cs{first};
+    std::thread other{[&]
+    {
+        // Not blocked by this thread holding the first domain.
+        CriticalSection cs{second};
+        entered = true;
+    }};
+    other.join();
+    EXPECT_TRUE(entered);
+}
+
+
+TEST(LockDomain, Blocks)
+{
+    LockDomain domain{"blocks"};
+
+    std::atomic<bool> entered{false};
+    std::thread other;
+    {
+        CriticalSection cs{domain};
+        other = std::thread{[&]
+        {
+            CriticalSection cs{domain};
+            entered = true;
+        }};
+        // Long enough for the other thread to give up spinning and sleep.
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+        EXPECT_FALSE(entered);
+    }
+    other.join();
+    EXPECT_TRUE(entered);
+}
+
+
+#if defined(OTWAY_LOCK_PROFILING)
+TEST(LockDomain, Profiling)
+{
+    LockDomain domain{"profiled"};
+    {
+        CriticalSection cs1{domain};
+        CriticalSection cs2{domain};
+    }
+    {
+        CriticalSection cs{domain};
+    }
+
+    LockStats stats = domain.get_stats();
+    EXPECT_STREQ(stats.name, "profiled");
+    // Nested entries are not counted.
+    EXPECT_EQ(stats.acquisitions, 2U);
+    EXPECT_EQ(stats.contended, 0U);
+    EXPECT_EQ(stats.total_wait_ns, 0U);
+
+    std::thread other;
+    {
+        CriticalSection cs{domain};
+        other = std::thread{[&] { CriticalSection cs{domain}; }};
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    other.join();
+
+    stats = domain.get_stats();
+    EXPECT_EQ(stats.acquisitions, 4U);
+    EXPECT_EQ(stats.contended, 1U);
+    EXPECT_GT(stats.total_wait_ns, 1'000'000U);
+    EXPECT_EQ(stats.max_wait_ns, stats.total_wait_ns);
+
+    domain.reset_stats();
+    stats = domain.get_stats();
+    EXPECT_EQ(stats.acquisitions, 0U);
+    EXPECT_EQ(stats.contended, 0U);
+
+    // The domain can be found in the registry, as can the global domain.
+    LockDomain::global();
+    bool found_profiled = false;
+    bool found_global   = false;
+    LockDomain::for_each([&](LockDomain& d)
+    {
+        found_profiled |= (std::string{d.get_name()} == "profiled");
+        found_global   |= (std::string{d.get_name()} == "global");
+    });
+    EXPECT_TRUE(found_profiled);
+    EXPECT_TRUE(found_global);
+}
+#endif
+
+
+#else
+
+
+TEST(LockDomain, MapsOntoCriticalSection)
+{
+    // Domains are accepted but there is only one critical section.
+    static LockDomain domain{"domain"};
+    EXPECT_STREQ(domain.get_name(), "domain");
+    CriticalSection cs{domain};
+}
+
+
+#endif
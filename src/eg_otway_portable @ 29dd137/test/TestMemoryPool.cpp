@@ -8,7 +8,12 @@
 /////////////////////////////////////////////////////////////////////////////////////////////
 #include "gtest/gtest.h"
 #include "utilities/MemoryPool.h"
+// Poisoning is header-only, so it can be enabled for just this test.
+#define OTWAY_MEMORY_POOL_POISON
+#include "utilities/LockFreeMemoryPool.h"
+#include <atomic>
 #include <set>
+#include <thread>
 #include <vector>
 #include <algorithm>
 #include <random>
@@ -97,4 +102,132 @@ TEST(MemoryPoolTest, FreeNullPtrReturnsFalse)
     constexpr int POOL_SIZE = 32;
     eg::MemoryPool<TestStruct, POOL_SIZE> pool;
     EXPECT_FALSE(pool.free(nullptr));
-}
\ No newline at end of file
+}
+
+
+TEST(MemoryPoolTest, FreeRejectsMisalignedAndDoubleFree)
+{
+    constexpr int POOL_SIZE = 4;
+    eg::MemoryPool<TestStruct, POOL_SIZE> pool;
+
+    auto p = pool.alloc();
+    ASSERT_TRUE(p != nullptr);
+
+    // Inside the pool but not the start of an item.
+    auto misaligned = reinterpret_cast<TestStruct*>(reinterpret_cast<uint8_t*>(p) + 4);
+    EXPECT_FALSE(pool.free(misaligned));
+    // Never allocated.
+    EXPECT_FALSE(pool.free(p + 1));
+    EXPECT_EQ(pool.available(), POOL_SIZE - 1);
+
+    EXPECT_TRUE(pool.free(p));
+    EXPECT_FALSE(pool.free(p));
+    EXPECT_EQ(pool.available(), POOL_SIZE);
+
+    // The free list is intact.
+    std::set<TestStruct*> allocated;
+    while (auto q = pool.alloc()) allocated.insert(q);
+    EXPECT_EQ(allocated.size(), POOL_SIZE);
+}
+
+
+TEST(LockFreeMemoryPoolTest, AllocateAndFree)
+{
+    constexpr int POOL_SIZE = 32;
+    eg::LockFreeMemoryPool<TestStruct, POOL_SIZE> pool;
+
+    std::set<TestStruct*> allocated;
+    for (int i = 0; i < POOL_SIZE; ++i)
+    {
+        EXPECT_EQ(pool.available(), POOL_SIZE - i);
+        auto p = pool.alloc();
+        ASSERT_TRUE(p != nullptr);
+        EXPECT_TRUE(allocated.insert(p).second);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % alignof(TestStruct), 0U);
+    }
+    EXPECT_EQ(pool.available(), 0);
+    EXPECT_EQ(pool.low_water_mark(), 0);
+    EXPECT_TRUE(pool.alloc() == nullptr);
+
+    for (auto p: allocated)
+    {
+        EXPECT_TRUE(pool.free(p));
+    }
+    EXPECT_EQ(pool.available(), POOL_SIZE);
+    EXPECT_EQ(pool.low_water_mark(), 0);
+}
+
+
+TEST(LockFreeMemoryPoolTest, FreeRejectsBadPointers)
+{
+    constexpr int POOL_SIZE = 4;
+    eg::LockFreeMemoryPool<TestStruct, POOL_SIZE> pool;
+    TestStruct outside{};
+
+    auto p = pool.alloc();
+    ASSERT_TRUE(p != nullptr);
+    EXPECT_FALSE(pool.free(nullptr));
+    EXPECT_FALSE(pool.free(&outside));
+    EXPECT_FALSE(pool.free(reinterpret_cast<TestStruct*>(reinterpret_cast<uint8_t*>(p) + 4)));
+    EXPECT_EQ(pool.double_frees(), 0U);
+
+    EXPECT_TRUE(pool.free(p));
+    EXPECT_FALSE(pool.free(p));
+    EXPECT_EQ(pool.double_frees(), 1U);
+    EXPECT_EQ(pool.available(), POOL_SIZE);
+}
+
+
+TEST(LockFreeMemoryPoolTest, Poisoning)
+{
+    eg::LockFreeMemoryPool<TestStruct, 4> pool;
+    using Pool = decltype(pool);
+
+    auto p = pool.alloc();
+    ASSERT_TRUE(p != nullptr);
+    auto bytes = reinterpret_cast<const uint8_t*>(p);
+    for (size_t i = 0; i < sizeof(TestStruct); ++i) EXPECT_EQ(bytes[i], Pool::kAllocPoison);
+
+    pool.free(p);
+    for (size_t i = 0; i < sizeof(TestStruct); ++i) EXPECT_EQ(bytes[i], Pool::kFreePoison);
+}
+
+
+TEST(LockFreeMemoryPoolTest, ConcurrentAllocFree)
+{
+    constexpr int POOL_SIZE  = 64;
+    constexpr int THREADS    = 4;
+    constexpr int ITERATIONS = 20000;
+    static eg::LockFreeMemoryPool<TestStruct, POOL_SIZE> pool;
+
+    // Each thread holds a few items at a time and checks that nobody else wrote to them.
+    std::atomic<uint32_t> errors{};
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < THREADS; ++t)
+    {
+        threads.emplace_back([t, &errors]
+        {
+            TestStruct* held[8]{};
+            for (uint32_t i = 0; i < ITERATIONS; ++i)
+            {
+                auto& slot = held[i % 8];
+                if (slot)
+                {
+                    if ((slot->field1 != t) || (slot->field2 != i - 8)) ++errors;
+                    if (!pool.free(slot)) ++errors;
+                }
+                slot = pool.alloc();
+                if (!slot) { ++errors; continue; }
+                slot->field1 = t;
+                slot->field2 = i;
+            }
+            for (auto slot: held) if (slot && !pool.free(slot)) ++errors;
+        });
+    }
+    for (auto& thread: threads) thread.join();
+
+    EXPECT_EQ(errors, 0U);
+    EXPECT_EQ(pool.available(), POOL_SIZE);
+    EXPECT_EQ(pool.double_frees(), 0U);
+    EXPECT_GE(pool.low_water_mark(), POOL_SIZE - THREADS * 8);
+}
@@ -0,0 +1,226 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code
+// is confidential information and must not be disclosed to third parties or used without
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+
+#include "gtest/gtest.h"
+#include "drivers/MmapFlashMemory.h"
+#include "drivers/FlashLog.h"
+#include <array>
+#include <cstdio>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace {
+
+using Flash  = eg::MmapFlashMemory;
+using Result = Flash::Result;
+
+constexpr Flash::Geometry kGeometry{0x0800'0000, 512, 4, 8};
+
+struct LogRecord
+{
+    uint32_t sequence;
+    uint32_t data;
+};
+
+class MmapFlashMemoryTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_path = testing::TempDir() + "mmap_flash_" + std::to_string(::getpid()) + ".bin";
+        std::remove(m_path.c_str());
+    }
+
+    void TearDown() override { std::remove(m_path.c_str()); }
+
+    bool is_blank(const Flash& flash, uint32_t page) const
+    {
+        const uint8_t* data = flash.get_data(page, 0);
+        for (uint32_t i = 0; i < kGeometry.page_size; ++i)
+            if (data[i] != 0xFF) return false;
+        return true;
+    }
+
+    std::string m_path;
+};
+
+} // namespace {
+
+
+TEST_F(MmapFlashMemoryTest, NewFileIsErased)
+{
+    Flash flash{m_path.c_str(), kGeometry};
+    ASSERT_TRUE(flash.is_open());
+    EXPECT_EQ(flash.get_page_count(), 4U);
+    EXPECT_EQ(flash.get_page_size(0), 512U);
+    EXPECT_EQ(flash.get_write_size(), 8U);
+    EXPECT_EQ(flash.get_page_address(2), 0x0800'0400U);
+    EXPECT_EQ(flash.get_page_index(0x0800'05FF), 2U);
+    for (uint32_t page = 0; page < 4; ++page)
+        EXPECT_TRUE(is_blank(flash, page));
+
+    struct stat status{};
+    ASSERT_EQ(::stat(m_path.c_str(), &status), 0);
+    EXPECT_EQ(status.st_size, 4 * 512);
+}
+
+
+TEST_F(MmapFlashMemoryTest, ProgrammingOnlyClearsBits)
+{
+    Flash flash{m_path.c_str(), kGeometry};
+    const std::array<uint8_t, 8> first{0x0F, 0xF0, 0x00, 0xFF, 0x12, 0x34, 0x56, 0x78};
+    const std::array<uint8_t, 8> second{0xF0, 0xF0, 0xFF, 0x00, 0xFF, 0xFF, 0xFF, 0xFF};
+    ASSERT_EQ(flash.write(1, 8, first.data(), first.size()), Result::eOK);
+    ASSERT_EQ(flash.write(0x0800'0208, second.data(), second.size()), Result::eOK);
+
+    // get_data() points into the mapping, so it sees the writes.
+    const uint8_t* data = flash.get_data(1, 8);
+    EXPECT_EQ(data, flash.get_data(0x0800'0208));
+    for (uint32_t i = 0; i < first.size(); ++i)
+        EXPECT_EQ(data[i], first[i] & second[i]);
+
+    ASSERT_EQ(flash.erase_address(0x0800'0300), Result::eOK);
+    EXPECT_TRUE(is_blank(flash, 1));
+}
+
+
+TEST_F(MmapFlashMemoryTest, RejectsBadArguments)
+{
+    Flash flash{m_path.c_str(), kGeometry};
+    std::array<uint8_t, 16> data{};
+    EXPECT_EQ(flash.write(0x0700'0000, data.data(), 8), Result::eInvalidAddress);
+    EXPECT_EQ(flash.write(0x0800'0800, data.data(), 8), Result::eInvalidAddress);
+    EXPECT_EQ(flash.write(0x0800'0004, data.data(), 8), Result::eUnalignedAddress);
+    EXPECT_EQ(flash.write(0x0800'0000, data.data(), 4), Result::eUnalignedSize);
+    EXPECT_EQ(flash.write(0x0800'01F8, data.data(), 16), Result::eInvalidSize);
+    EXPECT_EQ(flash.write(4, 0, data.data(), 8), Result::eInvalidPage);
+    EXPECT_EQ(flash.write(0, 512, data.data(), 8), Result::eInvalidOffset);
+    EXPECT_EQ(flash.read(0x0800'01F8, data.data(), 16), Result::eInvalidSize);
+    EXPECT_EQ(flash.erase_page(4), Result::eInvalidPage);
+    EXPECT_EQ(flash.erase_address(0x0800'0800), Result::eInvalidAddress);
+    EXPECT_EQ(flash.get_data(0x0800'0800), nullptr);
+    EXPECT_EQ(flash.get_page_index(0x0800'0800), Flash::kInvalidArgument);
+    EXPECT_TRUE(is_blank(flash, 0));
+}
+
+
+TEST_F(MmapFlashMemoryTest, DumpCanBeOpenedReadOnly)
+{
+    const std::array<uint8_t, 8> data{1, 2, 3, 4, 5, 6, 7, 8};
+    {
+        Flash flash{m_path.c_str(), kGeometry};
+        ASSERT_EQ(flash.write(3, 16, data.data(), data.size()), Result::eOK);
+    }
+
+    Flash dump{m_path.c_str(), kGeometry, Flash::Mode::eReadOnly};
+    ASSERT_TRUE(dump.is_open());
+    std::array<uint8_t, 8> read{};
+    ASSERT_EQ(dump.read(3, 16, read.data(), read.size()), Result::eOK);
+    EXPECT_EQ(read, data);
+    EXPECT_EQ(dump.write(0, 0, data.data(), data.size()), Result::eFlashFailed);
+    EXPECT_EQ(dump.erase_page(3), Result::eFlashFailed);
+
+    // A dump which is too small for the geometry can't be used.
+    Flash::Geometry larger = kGeometry;
+    larger.page_count = 8;
+    Flash short_dump{m_path.c_str(), larger, Flash::Mode::eReadOnly};
+    EXPECT_FALSE(short_dump.is_open());
+    EXPECT_EQ(short_dump.read(0, 0, read.data(), read.size()), Result::eFlashFailed);
+    EXPECT_EQ(short_dump.get_data(0, 0), nullptr);
+}
+
+
+TEST_F(MmapFlashMemoryTest, ShortFileIsExtendedWithErasedPages)
+{
+    const std::array<uint8_t, 8> data{};
+    {
+        Flash flash{m_path.c_str(), kGeometry};
+        ASSERT_EQ(flash.write(3, 0, data.data(), data.size()), Result::eOK);
+    }
+
+    Flash::Geometry larger = kGeometry;
+    larger.page_count = 6;
+    Flash flash{m_path.c_str(), larger};
+    ASSERT_TRUE(flash.is_open());
+    EXPECT_EQ(*flash.get_data(3, 0), 0U);
+    EXPECT_TRUE(is_blank(flash, 4));
+    EXPECT_TRUE(is_blank(flash, 5));
+}
+
+
+TEST_F(MmapFlashMemoryTest, InvalidGeometryIsNotOpened)
+{
+    Flash::Geometry geometry = kGeometry;
+    geometry.page_size = 500;
+    Flash flash{m_path.c_str(), geometry};
+    EXPECT_FALSE(flash.is_open());
+    EXPECT_EQ(flash.erase_page(0), Result::eFlashFailed);
+    EXPECT_EQ(flash.flush(), Result::eFlashFailed);
+}
+
+
+TEST_F(MmapFlashMemoryTest, SyncsAreBatched)
+{
+    Flash flash{m_path.c_str(), kGeometry, Flash::Mode::eReadWrite, 4};
+    const uint32_t syncs = flash.get_sync_count();
+    const std::array<uint8_t, 8> data{};
+    for (uint32_t i = 0; i < 10; ++i)
+        ASSERT_EQ(flash.write(0, i * 8, data.data(), data.size()), Result::eOK);
+    EXPECT_EQ(flash.get_sync_count(), syncs + 2);
+
+    // The last two writes are synced on request, and then there is nothing left to do.
+    EXPECT_EQ(flash.flush(), Result::eOK);
+    EXPECT_EQ(flash.get_sync_count(), syncs + 3);
+    EXPECT_EQ(flash.flush(), Result::eOK);
+    EXPECT_EQ(flash.get_sync_count(), syncs + 3);
+
+    // Zero leaves it all to flush().
+    Flash lazy{m_path.c_str(), kGeometry, Flash::Mode::eReadWrite, 0};
+    for (uint32_t page = 0; page < 4; ++page)
+        ASSERT_EQ(lazy.erase_page(page), Result::eOK);
+    EXPECT_EQ(lazy.get_sync_count(), 0U);
+    EXPECT_EQ(lazy.flush(), Result::eOK);
+    EXPECT_EQ(lazy.get_sync_count(), 1U);
+}
+
+
+TEST_F(MmapFlashMemoryTest, FlashLogPersists)
+{
+    using Log = eg::FlashLog<LogRecord, 8>;
+    {
+        Flash flash{m_path.c_str(), kGeometry};
+        Log   log{flash};
+        for (uint32_t i = 1; i <= 100; ++i)
+            ASSERT_EQ(log.append_record(LogRecord{i, i * 3}), Log::Result::eOK);
+    }
+
+    // A later run, and a host tool reading the dump, both find the records.
+    Flash flash{m_path.c_str(), kGeometry};
+    Log   log{flash};
+    ASSERT_EQ(log.get_record_count(), 100U);
+    const LogRecord* last = log.get_pointer_by_index(99);
+    ASSERT_NE(last, nullptr);
+    EXPECT_EQ(last->sequence, 100U);
+
+    Flash dump{m_path.c_str(), kGeometry, Flash::Mode::eReadOnly};
+    Log   reader{dump};
+    uint32_t expected = 1;
+    for (const LogRecord& record: reader)
+    {
+        EXPECT_EQ(record.sequence, expected);
+        EXPECT_EQ(record.data, expected * 3);
+        ++expected;
+    }
+    EXPECT_EQ(expected, 101U);
+}
+
+#endif // OTWAY_TARGET_PLATFORM_LINUX
@@ -0,0 +1,98 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include "utilities/ObjectPool.h"
+#include "utilities/MemoryPool.h"
+#include <set>
+#include <stdexcept>
+
+
+namespace {
+
+struct Tracked
+{
+    Tracked(uint32_t value) : m_value{value} { ++s_live; }
+    ~Tracked() { --s_live; }
+
+    uint32_t m_value;
+    inline static int s_live{};
+};
+
+struct Throws
+{
+    Throws() { throw std::runtime_error{"construction failed"}; }
+};
+
+} // namespace {
+
+
+TEST(ObjectPoolTest, MakeConstructsAndHandleDestroys)
+{
+    eg::ObjectPool<Tracked, 4> pool;
+    EXPECT_EQ(pool.capacity(), 4);
+    {
+        auto a = pool.make(1U);
+        auto b = pool.make(2U);
+        ASSERT_TRUE(a && b);
+        EXPECT_EQ(a->m_value, 1U);
+        EXPECT_EQ(b->m_value, 2U);
+        EXPECT_EQ(Tracked::s_live, 2);
+        EXPECT_EQ(pool.available(), 2);
+
+        // Ownership moves like any other unique_ptr.
+        auto c = std::move(a);
+        EXPECT_FALSE(a);
+        EXPECT_EQ(c->m_value, 1U);
+    }
+    EXPECT_EQ(Tracked::s_live, 0);
+    EXPECT_EQ(pool.available(), 4);
+    EXPECT_EQ(pool.low_water_mark(), 2);
+}
+
+
+TEST(ObjectPoolTest, Exhaustion)
+{
+    eg::ObjectPool<Tracked, 2, eg::MemoryPool<Tracked, 2>> pool;
+    auto a = pool.make(1U);
+    auto b = pool.make(2U);
+    auto c = pool.make(3U);
+    EXPECT_TRUE(a && b);
+    EXPECT_FALSE(c);
+    EXPECT_EQ(Tracked::s_live, 2);
+
+    a.reset();
+    c = pool.make(3U);
+    EXPECT_TRUE(c);
+    EXPECT_EQ(c->m_value, 3U);
+}
+
+
+TEST(ObjectPoolTest, CreateAndDestroy)
+{
+    eg::ObjectPool<Tracked, 2> pool;
+    Tracked outside{5U};
+
+    Tracked* object = pool.create(7U);
+    ASSERT_TRUE(object != nullptr);
+    EXPECT_EQ(Tracked::s_live, 2);
+    EXPECT_FALSE(pool.destroy(&outside));
+    EXPECT_FALSE(pool.destroy(nullptr));
+    EXPECT_TRUE(pool.destroy(object));
+    EXPECT_EQ(Tracked::s_live, 1);
+    EXPECT_EQ(pool.available(), 2);
+}
+
+
+TEST(ObjectPoolTest, ConstructorThrows)
+{
+    eg::ObjectPool<Throws, 2> pool;
+    EXPECT_THROW(pool.make(), std::runtime_error);
+    // The memory was returned.
+    EXPECT_EQ(pool.available(), 2);
+}
@@ -0,0 +1,334 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code
+// is confidential information and must not be disclosed to third parties or used without
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include "drivers/FlashLog.h"
+#include "drivers/FlashKeyValueStore.h"
+#include "drivers/FlashScratchpad.h"
+#include "TestSingleThreadedUtils.h"
+#include "mock/MockFlashStorage.h"
+#include "sim/PowerCutHarness.h"
+#include "sim/SimFlashMemory.h"
+#include <array>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <random>
+#include <ranges>
+#include <vector>
+
+
+// Crash consistency of the flash clients. Each test runs a workload thousands of times with the
+// power cut at a random point, and checks what the client recovers after the reset.
+
+namespace {
+
+constexpr uint32_t kWriteSize = 8;       // STM32G4 double word
+constexpr uint32_t kTrials    = 2000;
+
+// Small pages, so that the workloads move between pages and erase them often.
+using SmallFlash = eg::sim::SimFlashMemory<eg::MockFlashMemory<0x0800'0000, 512, 4, kWriteSize>>;
+using LargeFlash = eg::sim::SimFlashMemory<eg::MockFlashMemory<0x0800'0000, 2048, 2, kWriteSize>>;
+
+
+struct LogRecord
+{
+    uint32_t sequence;
+    uint32_t inverse;
+    uint32_t data[2];
+};
+
+LogRecord make_record(uint32_t sequence)
+{
+    return LogRecord{sequence, ~sequence, {sequence * 2654435761U, 0x5A5A'5A5AU}};
+}
+
+bool operator==(const LogRecord& lhs, const LogRecord& rhs)
+{
+    return std::memcmp(&lhs, &rhs, sizeof(LogRecord)) == 0;
+}
+
+using Log = eg::FlashLog<LogRecord, kWriteSize>;
+
+
+using Store = eg::FlashKeyValueStore<kWriteSize, 16>;
+using Value = std::vector<uint8_t>;
+
+// The keys which have been written, mapped to their values.
+using StoreModel = std::map<uint16_t, Value>;
+// The key being written or erased (no value) when the power failed.
+using StoreOperation = std::optional<std::pair<uint16_t, std::optional<Value>>>;
+
+// Random writes and erases of keys 1 to 8, keeping the model up to date with those which complete.
+void run_store(Store& store, SmallFlash& flash, uint32_t seed, uint32_t operations, StoreModel& model, StoreOperation& in_flight)
+{
+    std::mt19937 random{seed};
+    for (uint32_t i = 0; (i < operations) && flash.is_powered(); ++i)
+    {
+        const uint16_t key = static_cast<uint16_t>(1 + random() % 8);
+        if (((random() % 8) == 0) && store.contains(key))
+        {
+            in_flight = {key, std::nullopt};
+            store.erase(key);
+            if (flash.is_powered()) model.erase(key);
+        }
+        else
+        {
+            Value value(1 + random() % 60);
+            for (auto& byte: value)
+                byte = static_cast<uint8_t>(random());
+            in_flight = {key, value};
+            store.write(key, value.data(), static_cast<uint16_t>(value.size()));
+            if (flash.is_powered()) model[key] = value;
+        }
+    }
+}
+
+void expect_store(const Store& store, const StoreModel& model)
+{
+    for (uint16_t key = 1; key <= 8; ++key)
+    {
+        auto it = model.find(key);
+        if (it == model.end())
+        {
+            EXPECT_FALSE(store.contains(key)) << "key " << key;
+            continue;
+        }
+
+        std::array<uint8_t, 256> buffer;
+        uint16_t size = 0;
+        ASSERT_EQ(store.read(key, buffer.data(), buffer.size(), size), Store::Result::eOK) << "key " << key;
+        EXPECT_TRUE(Value(buffer.data(), buffer.data() + size) == it->second) << "key " << key;
+    }
+}
+
+
+struct Settings
+{
+    uint32_t                 boots;
+    uint32_t                 faults;
+    std::array<uint8_t, 200> table;
+    float                    gain;
+};
+
+bool operator==(const Settings& lhs, const Settings& rhs)
+{
+    return std::memcmp(&lhs, &rhs, sizeof(Settings)) == 0;
+}
+
+using Scratchpad = eg::FlashScratchpad<Settings, true>;
+
+// Mostly the counter changes, and now and then some of the table.
+void change_settings(Settings& settings, uint32_t i)
+{
+    ++settings.boots;
+    if ((i % 10) == 0)
+        settings.table[(i * 37) % settings.table.size()] ^= 0xFF;
+    if ((i % 50) == 0)
+        settings.gain += 0.5f;
+}
+
+
+// Dispatches the events queued by the flash storage.
+class QueuedEventLoop : public eg::IEventLoop
+{
+public:
+    void post(const eg::Event& ev) override { m_events.push_back(ev); }
+    void run() override
+    {
+        while (!m_events.empty())
+        {
+            auto events = std::move(m_events);
+            m_events.clear();
+            for (const auto& ev: events)
+                ev.dispatch();
+        }
+    }
+#if defined(OTWAY_EVENT_LOOP_WATER_MARK)
+    uint16_t get_high_water_mark() const { return 0; }
+#endif
+
+private:
+    std::vector<eg::Event> m_events;
+};
+
+class PowerCutTest : public testing::Test
+{
+protected:
+    void SetUp() override    { eg::CURRENT_EVENT_LOOP = &m_loop; }
+    void TearDown() override { eg::CURRENT_EVENT_LOOP = nullptr; }
+
+    QueuedEventLoop m_loop;
+};
+
+} // namespace {
+
+
+TEST_F(PowerCutTest, FlashLog)
+{
+    // A little over one trip round the pages.
+    constexpr uint32_t kAppends = 100;
+
+    eg::sim::PowerCutHarness<SmallFlash> harness{1};
+    uint32_t acknowledged = 0;
+    harness.run(kTrials,
+        [&](SmallFlash& flash)
+        {
+            acknowledged = 0;
+            Log log{flash};
+            for (uint32_t sequence = 1; (sequence <= kAppends) && flash.is_powered(); ++sequence)
+            {
+                log.append_record(make_record(sequence));
+                if (flash.is_powered()) acknowledged = sequence;
+            }
+        },
+        [&](SmallFlash& flash)
+        {
+            SCOPED_TRACE(testing::Message() << "cut " << harness.get_cut());
+            Log log{flash};
+            std::vector<LogRecord> records(log.begin(), log.end());
+
+            // The records end with the last one acknowledged. A record is acknowledged once its 
+            // marker is programmed, so the one being written at the cut is not there, even in part.
+            // Only the oldest records are lost to the ring, and to a page closed by a torn record.
+            const uint32_t count       = static_cast<uint32_t>(records.size());
+            const uint32_t min_records = (4 - 2) * log.get_records_per_page();
+            ASSERT_LE(count, acknowledged);
+            ASSERT_GE(count, std::min(acknowledged, min_records));
+            for (uint32_t i = 0; i < count; ++i)
+                ASSERT_TRUE(records[i] == make_record(acknowledged - count + 1 + i)) << "record " << i;
+            ASSERT_EQ(log.get_record_count(), count);
+
+            // The log carries on after the reset, for long enough to start another page.
+            constexpr uint32_t kMore = 32;
+            for (uint32_t i = 1; i <= kMore; ++i)
+                ASSERT_EQ(log.append_record(make_record(1'000'000 + i)), Log::Result::eOK);
+            Log reopened{flash};
+            ASSERT_GE(reopened.get_record_count(), kMore);
+            uint32_t expected = 1'000'000 + kMore;
+            for (const LogRecord& record: std::views::reverse(reopened) | std::views::take(kMore))
+                EXPECT_TRUE(record == make_record(expected--));
+        });
+    EXPECT_EQ(harness.get_trials(), kTrials);
+}
+
+
+TEST_F(PowerCutTest, FlashKeyValueStore)
+{
+    // Each page holds a dozen or so entries, so this goes round the pages a few times.
+    constexpr uint32_t kOperations = 120;
+
+    eg::sim::PowerCutHarness<SmallFlash> harness{2};
+    StoreModel     acknowledged;
+    StoreOperation in_flight;
+    harness.run(kTrials,
+        [&](SmallFlash& flash)
+        {
+            acknowledged.clear();
+            in_flight.reset();
+            Store store{flash};
+            run_store(store, flash, 42, kOperations, acknowledged, in_flight);
+        },
+        [&](SmallFlash& flash)
+        {
+            SCOPED_TRACE(testing::Message() << "cut " << harness.get_cut());
+            Store store{flash};
+
+            // Each key holds its acknowledged value, or the value being written at the cut.
+            StoreModel expected = acknowledged;
+            if (in_flight && !flash.is_powered())
+            {
+                const auto& [key, value] = *in_flight;
+                std::array<uint8_t, 256> buffer;
+                uint16_t size = 0;
+                const bool found = (store.read(key, buffer.data(), buffer.size(), size) == Store::Result::eOK);
+                const bool is_new = value ? (found && (Value(buffer.data(), buffer.data() + size) == *value)) : !found;
+                if (is_new)
+                {
+                    if (value) expected[key] = *value;
+                    else       expected.erase(key);
+                }
+            }
+            expect_store(store, expected);
+
+            // The store carries on after the reset, for long enough to reuse every page.
+            StoreOperation unused;
+            run_store(store, flash, 7, kOperations / 2, expected, unused);
+            Store reopened{flash};
+            expect_store(reopened, expected);
+        });
+    EXPECT_EQ(harness.get_trials(), kTrials);
+}
+
+
+TEST_F(PowerCutTest, FlashScratchpadDeltas)
+{
+    // A page holds a full copy and about 50 deltas, so this swaps pages twice.
+    constexpr uint32_t kUpdates = 100;
+
+    Settings defaults{};
+    defaults.gain = 1.0f;
+
+    eg::sim::PowerCutHarness<LargeFlash> harness{3};
+    Settings acknowledged{};
+    Settings in_flight{};
+    harness.run(kTrials,
+        [&](LargeFlash& flash)
+        {
+            eg::MockFlashStorage storage{flash};
+            Scratchpad pad{storage, 0, 1, defaults};
+            m_loop.run();
+            acknowledged = pad.GetData();
+            in_flight    = acknowledged;
+
+            Settings settings = acknowledged;
+            for (uint32_t i = 0; (i < kUpdates) && flash.is_powered(); ++i)
+            {
+                change_settings(settings, i);
+                in_flight = settings;
+                pad.UpdateData(settings);
+                storage.complete_erase();
+                m_loop.run();
+                if (flash.is_powered()) acknowledged = settings;
+            }
+        },
+        [&](LargeFlash& flash)
+        {
+            SCOPED_TRACE(testing::Message() << "cut " << harness.get_cut());
+            eg::MockFlashStorage storage{flash};
+            Scratchpad pad{storage, 0, 1, defaults};
+            storage.complete_erase();
+            m_loop.run();
+            const Settings recovered = pad.GetData();
+            ASSERT_TRUE((recovered == acknowledged) || (recovered == in_flight));
+
+            // It carries on after the reset, for long enough to swap pages.
+            Settings next = recovered;
+            for (uint32_t i = 0; i < kUpdates / 2 + 10; ++i)
+            {
+                change_settings(next, i);
+                pad.UpdateData(next);
+                storage.complete_erase();
+                m_loop.run();
+            }
+
+            eg::MockFlashStorage storage2{flash};
+            Scratchpad reopened{storage2, 0, 1, defaults};
+            storage2.complete_erase();
+            m_loop.run();
+            EXPECT_TRUE(reopened.GetData() == next);
+        },
+        [&](LargeFlash& flash)
+        {
+            // First boot writes the defaults. A failure there goes to Error_Handler().
+            eg::MockFlashStorage storage{flash};
+            Scratchpad pad{storage, 0, 1, defaults};
+            m_loop.run();
+        });
+    EXPECT_EQ(harness.get_trials(), kTrials);
+}
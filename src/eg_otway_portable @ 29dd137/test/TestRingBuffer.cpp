@@ -123,4 +123,28 @@ TEST(RingBuffer, ClearingTheBuffer)
     EXPECT_TRUE(buffer.size() == 0);
     EXPECT_TRUE(buffer.capacity() == 7);
     EXPECT_TRUE(buffer.pop() == false);
-}
\ No newline at end of file
+}
+TEST(RingBuffer, AccessInPlace)
+{
+    eg::RingBufferArray<int, 4> buffer;
+
+    // Wrap the positions around first.
+    for (int i = 0; i < 3; ++i)
+    {
+        buffer.put(i);
+        buffer.pop();
+    }
+    for (int i = 1; i <= 4; ++i)
+    {
+        buffer.put(100 + i);
+    }
+
+    for (uint16_t index = 0; index < buffer.size(); ++index)
+    {
+        EXPECT_EQ(buffer.at(index), 101 + index);
+    }
+    buffer.at(2) = 42;
+    buffer.pop();
+    buffer.pop();
+    EXPECT_EQ(buffer.front(), 42);
+}
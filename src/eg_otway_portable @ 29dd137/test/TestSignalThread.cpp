@@ -12,6 +12,18 @@
 #include "utilities/RingBuffer.h"
 #include "utilities/CriticalSection.h"
 #include "mock/event_loop/TestEventLoop.h"
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+#include "event_loop/ThreadEventLoop.h"
+#include "event_loop/EventLoopStats.h"
+#if !defined(OTWAY_LINUX_STATIC)
+#include "event_loop/ThreadPoolEventLoop.h"
+#endif
+#include "utilities/ThreadConfig.h"
+#include "timers/Timer.h"
+#include <atomic>
+#include <pthread.h>
+#include <set>
+#endif
 
 // If the definition produces an error, you are probably trying to compile it alongside
 // other compilation units with their own definitios of these functions. 
@@ -58,7 +70,14 @@ IEventLoop* default_event_loop_impl() { return &loop1; }
 // This is required in order to allow Signal::dispatch() to determine in which 
 // event loop's context (i.e. which thread) it is running. For a single threaded 
 // program this doesn't really add value.
-IEventLoop* this_event_loop_impl() { return TestEventLoop::m_self; }
+IEventLoop* this_event_loop_impl() 
+{ 
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+    // Also allow the library's own ThreadEventLoop to be tested here.
+    if (!TestEventLoop::m_self) return get_thread_event_loop();
+#endif
+    return TestEventLoop::m_self; 
+}
 
 } // namespace eg
 
@@ -159,4 +178,354 @@ TEST(SignalThread, OneSignalEmitsToTwoThreads)
     EXPECT_TRUE(g_callback1_id != g_callback3_id);
     EXPECT_TRUE(g_callback1_id == loop1.get_id());
     EXPECT_TRUE(g_callback3_id == loop2.get_id());
-}
\ No newline at end of file
+}
+
+
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+TEST(SignalThread, ThreadEventLoopStats)
+{
+    using namespace std::chrono_literals;
+
+    eg::ThreadEventLoop loop{"stats"};
+
+    eg::Signal<int> signal;
+    signal.connect<callback3>(loop);
+
+    eg::EventLoopStats stats{};
+    EXPECT_TRUE(loop.get_stats(stats));
+    EXPECT_EQ(stats.posted, 0U);
+
+    g_callback3_value = 0;
+    for (int i = 1; i <= 10; ++i)
+    {
+        signal.emit(i);
+    }
+    std::this_thread::sleep_for(20ms);
+
+    EXPECT_EQ(g_callback3_value, 10);
+    EXPECT_TRUE(loop.get_stats(stats));
+    EXPECT_EQ(stats.posted, 10U);
+    EXPECT_EQ(stats.dispatched, 10U);
+    EXPECT_EQ(stats.depth, 0U);
+    EXPECT_GE(stats.peak_depth, 1U);
+    EXPECT_LE(stats.peak_depth, 10U);
+
+    uint32_t total = 0;
+    for (auto count: stats.latency_histogram) total += count;
+    EXPECT_EQ(total, 10U);
+    EXPECT_GT(stats.idle_time, 0U);
+
+    loop.reset_stats();
+    EXPECT_TRUE(loop.get_stats(stats));
+    EXPECT_EQ(stats.posted, 0U);
+    EXPECT_EQ(stats.peak_depth, 0U);
+}
+
+
+// The thread pool and lambda slots allocate, so are not available in the static mode.
+#if !defined(OTWAY_LINUX_STATIC)
+namespace {
+
+// Wait for a condition set by other threads, with a timeout so a failure does not hang.
+template <typename Pred>
+bool wait_for(Pred pred)
+{
+    using namespace std::chrono_literals;
+    for (int i = 0; i < 2000; ++i)
+    {
+        if (pred()) return true;
+        std::this_thread::sleep_for(1ms);
+    }
+    return pred();
+}
+
+// The slots are written as if for a single-threaded loop. They detect being called 
+// concurrently, and check that the values from each signal arrive in order.
+class PoolThing
+{
+public:
+    void on_a(const int& value) { enter(); m_ordered_a &= (value == m_last_a + 1); m_last_a = value; leave(); }
+    void on_b(const int& value) { enter(); m_ordered_b &= (value == m_last_b + 1); m_last_b = value; leave(); }
+
+    int  m_last_a{};
+    int  m_last_b{};
+    bool m_ordered_a{true};
+    bool m_ordered_b{true};
+    std::atomic<bool>     m_overlapped{false};
+    std::atomic<int>      m_count{0};
+
+private:
+    void enter() 
+    { 
+        if (m_busy.exchange(true)) m_overlapped = true; 
+    }
+    void leave() 
+    { 
+        m_busy = false; 
+        ++m_count; 
+    }
+    std::atomic<bool> m_busy{false};
+};
+
+} // namespace {
+
+
+TEST(SignalThread, ThreadPoolPreservesOrder)
+{
+    eg::ThreadPoolEventLoop pool{4};
+    EXPECT_EQ(pool.get_worker_count(), 4U);
+
+    // Two signals connected to the same object must not be dispatched concurrently, and 
+    // each must be dispatched in order.
+    eg::Signal<int> signal_a;
+    eg::Signal<int> signal_b;
+    PoolThing thing;
+    signal_a.connect<&PoolThing::on_a>(&thing, pool);
+    signal_b.connect<&PoolThing::on_b>(&thing, pool);
+
+    constexpr int kCount = 5000;
+    std::jthread emitter_b{[&signal_b]() { for (int i = 1; i <= kCount; ++i) signal_b.emit(i); }};
+    for (int i = 1; i <= kCount; ++i) signal_a.emit(i);
+    emitter_b.join();
+
+    EXPECT_TRUE(wait_for([&thing]() { return thing.m_count == 2 * kCount; }));
+    EXPECT_FALSE(thing.m_overlapped);
+    EXPECT_TRUE(thing.m_ordered_a);
+    EXPECT_TRUE(thing.m_ordered_b);
+    EXPECT_EQ(thing.m_last_a, kCount);
+    EXPECT_EQ(thing.m_last_b, kCount);
+}
+
+
+TEST(SignalThread, ThreadPoolRunsInParallel)
+{
+    using namespace std::chrono_literals;
+
+    eg::ThreadPoolEventLoop pool{4};
+
+    // Independent objects are spread across the workers. Each slot blocks for a while, 
+    // so the work must be taken by more than one thread.
+    constexpr int kThings = 16;
+    eg::Signal<int> signals[kThings];
+    std::atomic<int> done{0};
+    std::mutex       mutex;
+    std::set<std::thread::id> threads;
+
+    for (int i = 0; i < kThings; ++i)
+    {
+        signals[i].connect([&](int) 
+        {
+            std::this_thread::sleep_for(2ms);
+            std::lock_guard<std::mutex> lock(mutex);
+            threads.insert(std::this_thread::get_id());
+            ++done;
+        }, pool);
+    }
+
+    for (int round = 0; round < 4; ++round)
+    {
+        for (int i = 0; i < kThings; ++i) signals[i].emit(round);
+    }
+
+    EXPECT_TRUE(wait_for([&done]() { return done == 4 * kThings; }));
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_GT(threads.size(), 1U);
+}
+
+
+TEST(SignalThread, ThreadPoolNestedEmit)
+{
+    eg::ThreadPoolEventLoop pool{2};
+
+    // A slot which emits another signal handled in the same pool. 
+    eg::Signal<int> first;
+    eg::Signal<int> second;
+    PoolThing thing;
+    first.connect([&second](int value) { second.emit(value); }, pool);
+    second.connect<&PoolThing::on_a>(&thing, pool);
+
+    for (int i = 1; i <= 1000; ++i) first.emit(i);
+
+    EXPECT_TRUE(wait_for([&thing]() { return thing.m_count == 1000; }));
+    EXPECT_TRUE(thing.m_ordered_a);
+}
+
+
+TEST(SignalThread, ThreadPoolStats)
+{
+    eg::ThreadPoolEventLoop pool{2};
+
+    // Events spread over several strands are added up.
+    constexpr int kThings = 8;
+    eg::Signal<int> signals[kThings];
+    std::atomic<int> done{0};
+    for (int i = 0; i < kThings; ++i)
+    {
+        signals[i].connect([&done](int) { ++done; }, pool);
+    }
+
+    for (int round = 0; round < 10; ++round)
+    {
+        for (int i = 0; i < kThings; ++i) signals[i].emit(round);
+    }
+    EXPECT_TRUE(wait_for([&done]() { return done == 10 * kThings; }));
+
+    // The last dispatch is recorded just after the slot returns.
+    eg::EventLoopStats stats{};
+    EXPECT_TRUE(wait_for([&]() { pool.get_stats(stats); return stats.dispatched == 10U * kThings; }));
+    EXPECT_EQ(stats.posted, 10U * kThings);
+    EXPECT_EQ(stats.depth, 0U);
+    EXPECT_GE(stats.peak_depth, 1U);
+    uint32_t latencies = 0;
+    for (auto count: stats.latency_histogram) latencies += count;
+    EXPECT_EQ(latencies, 10U * kThings);
+
+    pool.reset_stats();
+    pool.get_stats(stats);
+    EXPECT_EQ(stats.posted, 0U);
+    EXPECT_EQ(stats.dispatched, 0U);
+}
+
+
+TEST(SignalThread, ThreadConfigAffinity)
+{
+    // Pin the loop to the highest numbered CPU this process may use, so that the test means
+    // something on machines where CPU 0 is not available or is the only choice.
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+    int target = -1;
+    for (int cpu = 0; cpu < 64; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &allowed)) target = cpu;
+    }
+    ASSERT_GE(target, 0);
+
+    eg::ThreadConfig config{};
+    config.affinity       = uint64_t{1} << target;
+    config.prefault_stack = 64 * 1024;
+    eg::ThreadEventLoop loop{"pinned", config};
+
+    std::atomic<int> cpu{-1};
+    eg::Signal<> signal;
+    signal.connect([&cpu]() { cpu = sched_getcpu(); }, loop);
+    signal.emit();
+
+    EXPECT_TRUE(wait_for([&cpu]() { return cpu >= 0; }));
+    EXPECT_EQ(cpu, target);
+}
+
+
+namespace {
+
+// Returns whether the process is allowed to use real-time scheduling.
+bool realtime_permitted()
+{
+    bool permitted = false;
+    std::thread probe{[&permitted]() 
+    {
+        sched_param param{};
+        param.sched_priority = 1;
+        permitted = (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0);
+    }};
+    probe.join();
+    return permitted;
+}
+
+// Post events at intervals to a loop, and return its latency statistics.
+eg::EventLoopStats measure_latency(eg::ThreadEventLoop& loop)
+{
+    using namespace std::chrono_literals;
+    constexpr uint32_t kEvents = 1000;
+
+    std::atomic<uint32_t> count{0};
+    eg::Signal<> signal;
+    signal.connect([&count]() { ++count; }, loop);
+    loop.reset_stats();
+
+    for (uint32_t i = 0; i < kEvents; ++i)
+    {
+        signal.emit();
+        std::this_thread::sleep_for(200us);
+    }
+    wait_for([&count]() { return count == kEvents; });
+
+    eg::EventLoopStats stats{};
+    loop.get_stats(stats);
+    return stats;
+}
+
+// The scheduling policy and priority of a loop's thread.
+struct SchedState
+{
+    int policy{-1};
+    int priority{-1};
+};
+
+SchedState get_sched_state(eg::ThreadEventLoop& loop)
+{
+    std::atomic<bool> done{false};
+    SchedState state{};
+    eg::Signal<> signal;
+    signal.connect([&]() 
+    { 
+        sched_param param{};
+        pthread_getschedparam(pthread_self(), &state.policy, &param);
+        state.priority = param.sched_priority;
+        done = true;
+    }, loop);
+    signal.emit();
+    wait_for([&done]() { return done.load(); });
+    return state;
+}
+
+} // namespace {
+
+
+// Checks that a real-time configuration is applied to the loop's thread, that the default 
+// configuration puts a thread created by a real-time thread back to the normal policy, and
+// that the real-time loop wakes promptly. This needs CAP_SYS_NICE (or a suitable 
+// RLIMIT_RTPRIO), so it is skipped when not permitted. Timing on a shared CI machine is not 
+// repeatable, so only a generous bound is checked for the latency.
+TEST(SignalThread, ThreadConfigRealtimeLatency)
+{
+    if (!realtime_permitted())
+    {
+        GTEST_SKIP() << "Real-time scheduling is not permitted for this process";
+    }
+
+    eg::ThreadConfig config{};
+    config.policy         = eg::ThreadConfig::Policy::Fifo;
+    config.priority       = 80;
+    config.prefault_stack = 64 * 1024;
+    eg::ThreadEventLoop rt_loop{"realtime", config};
+
+    const auto rt_state = get_sched_state(rt_loop);
+    EXPECT_EQ(rt_state.policy, SCHED_FIFO);
+    EXPECT_EQ(rt_state.priority, 80);
+
+    // A thread inherits the policy of the thread which creates it.
+    SchedState normal_state{};
+    std::thread creator{[&normal_state]() 
+    {
+        sched_param param{};
+        param.sched_priority = 10;
+        pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        eg::ThreadEventLoop normal_loop{"normal"};
+        normal_state = get_sched_state(normal_loop);
+    }};
+    creator.join();
+    EXPECT_EQ(normal_state.policy, SCHED_OTHER);
+    EXPECT_EQ(normal_state.priority, 0);
+
+    const auto realtime = measure_latency(rt_loop);
+    EXPECT_EQ(realtime.dispatched, 1000U);
+    EXPECT_LE(realtime.get_latency_percentile(99), 2047U);
+
+    // The timer thread can be configured in the same way.
+    eg::Timer::set_thread_config(config);
+    eg::Timer::set_thread_config({});
+}
+#endif // !defined(OTWAY_LINUX_STATIC)
+
+#endif
@@ -0,0 +1,141 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code
+// is confidential information and must not be disclosed to third parties or used without
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include "sim/SimFlashMemory.h"
+#include <array>
+#include <cstring>
+
+
+namespace {
+
+constexpr uint32_t kPageSize  = 512;
+constexpr uint32_t kWriteSize = 8;
+using SimFlash = eg::sim::SimFlashMemory<eg::MockFlashMemory<0x0800'0000, kPageSize, 4, kWriteSize>>;
+using Result   = SimFlash::Result;
+
+std::array<uint8_t, 32> make_data()
+{
+    std::array<uint8_t, 32> data;
+    for (uint32_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i);
+    return data;
+}
+
+bool is_blank(const SimFlash& flash, uint32_t page, uint32_t offset, uint32_t size)
+{
+    const uint8_t* data = flash.get_data(page, offset);
+    for (uint32_t i = 0; i < size; ++i)
+        if (data[i] != 0xFF) return false;
+    return true;
+}
+
+} // namespace {
+
+
+TEST(SimFlashMemory, CutsWriteAtWord)
+{
+    SimFlash flash;
+    const auto data = make_data();
+
+    // Two words of the four get programmed.
+    flash.cut_power_after(2);
+    EXPECT_EQ(flash.write(1, 0, data.data(), data.size()), Result::eFlashFailed);
+    EXPECT_FALSE(flash.is_powered());
+    EXPECT_EQ(std::memcmp(flash.get_data(1, 0), data.data(), 2 * kWriteSize), 0);
+    EXPECT_TRUE(is_blank(flash, 1, 2 * kWriteSize, 2 * kWriteSize));
+    EXPECT_EQ(flash.get_units(), 2U);
+
+    // Nothing works until the power comes back.
+    EXPECT_EQ(flash.write(2, 0, data.data(), data.size()), Result::eFlashFailed);
+    EXPECT_EQ(flash.erase_page(1), Result::eFlashFailed);
+    EXPECT_TRUE(is_blank(flash, 2, 0, data.size()));
+
+    flash.power_on();
+    EXPECT_EQ(flash.write(2, 0, data.data(), data.size()), Result::eOK);
+    EXPECT_EQ(flash.get_units(), 6U);
+}
+
+
+TEST(SimFlashMemory, CutsWriteAtByte)
+{
+    SimFlash flash{SimFlash::kSTM32G4, SimFlash::Granularity::eByte};
+    const auto data = make_data();
+
+    flash.cut_power_after(8);
+    EXPECT_EQ(flash.write(0, 0, data.data(), kWriteSize), Result::eOK);
+    EXPECT_EQ(flash.write(0, kWriteSize, data.data(), kWriteSize), Result::eFlashFailed);
+    EXPECT_EQ(std::memcmp(flash.get_data(0, 0), data.data(), kWriteSize), 0);
+    EXPECT_TRUE(is_blank(flash, 0, kWriteSize, kWriteSize));
+
+    // The cut can come at any byte of a word.
+    flash.power_on();
+    flash.cut_power_after(3);
+    EXPECT_EQ(flash.write(0, 16, data.data(), kWriteSize), Result::eFlashFailed);
+    EXPECT_EQ(std::memcmp(flash.get_data(0, 16), data.data(), 3), 0);
+    EXPECT_TRUE(is_blank(flash, 0, 19, 5));
+}
+
+
+TEST(SimFlashMemory, CutEraseLeavesRestOfPage)
+{
+    SimFlash flash;
+    std::array<uint8_t, kPageSize> zeros{};
+    ASSERT_EQ(flash.write(3, 0, zeros.data(), zeros.size()), Result::eOK);
+
+    flash.cut_power_after(0, 100);
+    EXPECT_EQ(flash.erase_page(3), Result::eFlashFailed);
+    EXPECT_FALSE(flash.is_powered());
+
+    // Rounded down to the write size.
+    EXPECT_TRUE(is_blank(flash, 3, 0, 96));
+    EXPECT_EQ(*flash.get_data(3, 96), 0U);
+    EXPECT_EQ(*flash.get_data(3, kPageSize - 1), 0U);
+    EXPECT_EQ(flash.get_wear(3), 1U);
+}
+
+
+TEST(SimFlashMemory, WearAndEndurance)
+{
+    SimFlash flash;
+    flash.set_endurance(3);
+    const auto data = make_data();
+
+    for (uint32_t i = 0; i < 3; ++i)
+        EXPECT_EQ(flash.erase_page(1), Result::eOK);
+    EXPECT_TRUE(flash.is_worn_out(1));
+    EXPECT_FALSE(flash.is_worn_out(0));
+
+    // A worn out page doesn't erase, and keeps its contents.
+    ASSERT_EQ(flash.write(1, 0, data.data(), data.size()), Result::eOK);
+    EXPECT_EQ(flash.erase_page(1), Result::eFlashFailed);
+    EXPECT_EQ(std::memcmp(flash.get_data(1, 0), data.data(), data.size()), 0);
+
+    // The wear is for the lifetime of the flash.
+    flash.reset_counts();
+    EXPECT_EQ(flash.get_page_erase_count(1), 0U);
+    EXPECT_EQ(flash.get_wear(1), 3U);
+    EXPECT_EQ(flash.get_max_wear(), 3U);
+    EXPECT_EQ(flash.get_min_wear(), 0U);
+}
+
+
+TEST(SimFlashMemory, Latency)
+{
+    constexpr SimFlash::Timing kTiming{1'000, 100, 50'000};
+    SimFlash flash{kTiming};
+    const auto data = make_data();
+
+    EXPECT_EQ(flash.write(0, 0, data.data(), data.size()), Result::eOK);
+    EXPECT_EQ(flash.get_elapsed_ns(), 1'000U + 4 * 100U);
+    EXPECT_EQ(flash.get_max_operation_ns(), 1'400U);
+
+    EXPECT_EQ(flash.erase_page(0), Result::eOK);
+    EXPECT_EQ(flash.get_elapsed_ns(), 51'400U);
+    EXPECT_EQ(flash.get_max_operation_ns(), 50'000U);
+}
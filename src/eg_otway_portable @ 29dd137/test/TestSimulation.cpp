@@ -0,0 +1,202 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2024.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include "sim/SimKernel.h"
+#include "timers/Timer.h"
+#include "TestSingleThreadedUtils.h"
+#include <sstream>
+
+
+namespace {
+
+using eg::sim::SimTime;
+using eg::sim::SimKernel;
+using eg::sim::SimEventLoop;
+
+
+void set_current_loop(eg::IEventLoop* loop)
+{
+    eg::CURRENT_EVENT_LOOP = loop;
+}
+
+
+// A timer driven producer in one loop, which passes data to a consumer in another loop. 
+struct Producer
+{
+    Producer(SimEventLoop& loop, uint32_t period)
+    : m_timer{period, eg::Timer::Type::Repeating}
+    {
+        m_timer.on_update().connect<&Producer::on_timer>(this, loop);
+        m_timer.start();
+    }
+
+    void on_timer() { m_data.emit(++m_count); }
+
+    eg::Timer          m_timer;
+    eg::Signal<uint32_t> m_data;
+    uint32_t           m_count{};
+};
+
+
+struct Consumer
+{
+    Consumer(eg::Signal<uint32_t>& data, SimEventLoop& loop)
+    {
+        data.connect<&Consumer::on_data>(this, loop);
+    }
+
+    void on_data(const uint32_t& value) { m_last = value; ++m_count; }
+
+    uint32_t m_last{};
+    uint32_t m_count{};
+};
+
+
+} // namespace {
+
+
+class SimulationTest : public testing::Test {
+    protected:     
+    virtual void TearDown() {
+        eg::CURRENT_EVENT_LOOP = nullptr;
+    }
+};
+
+
+TEST_F(SimulationTest, TimerDrivenPipeline)
+{
+    SimKernel    kernel{set_current_loop};
+    SimEventLoop main_loop{kernel, "main", 16, 200};
+    SimEventLoop work_loop{kernel, "work", 16};
+
+    Producer producer{main_loop, 1};
+    Consumer consumer{producer.m_data, work_loop};
+    work_loop.set_cost(producer.m_data, 300);
+
+    // One second of virtual time.
+    kernel.run_for(1'000'000);
+
+    EXPECT_EQ(main_loop.get_report().dispatched, 1000U);
+    EXPECT_EQ(work_loop.get_report().dispatched, 1000U);
+    EXPECT_EQ(consumer.m_count, 1000U);
+    EXPECT_EQ(consumer.m_last, 1000U);
+
+    // Neither loop is overloaded, so nothing waits in a queue.
+    EXPECT_EQ(main_loop.get_report().high_water_mark, 1U);
+    EXPECT_EQ(work_loop.get_report().max_latency, 0U);
+    EXPECT_NEAR(main_loop.get_utilisation(), 0.2, 0.001);
+    EXPECT_NEAR(work_loop.get_utilisation(), 0.3, 0.001);
+    EXPECT_EQ(kernel.now(), 1'000'000U);
+}
+
+
+TEST_F(SimulationTest, BurstsQueueAndOverflow)
+{
+    SimKernel    kernel{set_current_loop};
+    SimEventLoop loop{kernel, "burst", 4, 100};
+    kernel.set_timers_enabled(false);
+
+    eg::Signal<> signal;
+    uint32_t     count = 0;
+    struct Counter { uint32_t* count; void on_signal() { ++*count; } } counter{&count};
+    signal.connect<&Counter::on_signal>(&counter, loop);
+
+    // A burst of six events every 10ms, into a queue of four.
+    kernel.schedule_every(10'000, [&signal]() 
+    { 
+        for (int i = 0; i < 6; ++i) signal.emit(); 
+    });
+    kernel.run_for(100'000);
+
+    // Bursts at 0, 10, ... 90ms, and one more at the end time.
+    const auto& report = loop.get_report();
+    EXPECT_EQ(report.posted,     66U);
+    EXPECT_EQ(report.overflows,  22U);
+    EXPECT_EQ(report.high_water_mark, 4U);
+    EXPECT_EQ(count, report.dispatched);
+    
+    // The fourth event in each burst waits for three dispatches.
+    EXPECT_EQ(report.max_latency, 300U);
+    EXPECT_EQ(loop.get_latency_percentile(1.0), 511U);
+    EXPECT_EQ(report.latency_histogram[0], 11U);
+}
+
+
+TEST_F(SimulationTest, DriverCompletion)
+{
+    SimKernel    kernel{set_current_loop};
+    SimEventLoop loop{kernel, "driver", 8};
+    kernel.set_timers_enabled(false);
+
+    // Simulate a driver which completes each transfer 250us after it was started. The 
+    // completion handler starts the next transfer.
+    struct Driver
+    {
+        SimKernel&   kernel;
+        eg::Signal<> on_complete{};
+        uint32_t     transfers{};
+
+        void start() { kernel.schedule_after(250, [this]() { on_complete.emit(); }); }
+        void completed() { ++transfers; start(); }
+    } driver{kernel};
+
+    driver.on_complete.connect<&Driver::completed>(&driver, loop);
+    loop.set_cost(driver.on_complete, 50);
+    driver.start();
+
+    kernel.run_for(30'000);
+    EXPECT_EQ(driver.transfers, 120U);
+    EXPECT_NEAR(loop.get_utilisation(), 0.2, 0.01);
+}
+
+
+TEST_F(SimulationTest, Repeatable)
+{
+    auto run = []()
+    {
+        SimKernel    kernel{set_current_loop};
+        SimEventLoop main_loop{kernel, "main", 8};
+        SimEventLoop work_loop{kernel, "work", 8};
+
+        Producer producer1{main_loop, 3};
+        Producer producer2{main_loop, 7};
+        Consumer consumer{producer1.m_data, work_loop};
+        producer2.m_data.connect<&Consumer::on_data>(&consumer, work_loop);
+        work_loop.set_default_cost(1700);
+
+        kernel.run_for(500'000);
+
+        std::ostringstream os;
+        kernel.print(os);
+        return os.str();
+    };
+
+    const std::string first = run();
+    EXPECT_EQ(first, run());
+    EXPECT_NE(first.find("work:"), std::string::npos);
+}
+
+
+#if defined(OTWAY_TARGET_PLATFORM_BAREMETAL)
+TEST_F(SimulationTest, PeakSignalLinks)
+{
+    SimKernel    kernel{set_current_loop};
+    SimEventLoop loop{kernel, "main", 8};
+    const uint16_t before = eg::SignalBase::pool_size() - eg::SignalBase::pool_free();
+
+    {
+        Producer producer{loop, 1};
+        Consumer consumer1{producer.m_data, loop};
+        Consumer consumer2{producer.m_data, loop};
+        kernel.run_for(10'000);
+    }
+
+    EXPECT_EQ(kernel.get_peak_links_used(), before + 3);
+}
+#endif
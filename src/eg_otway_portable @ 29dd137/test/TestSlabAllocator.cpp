@@ -0,0 +1,151 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "gtest/gtest.h"
+#include "utilities/SlabAllocator.h"
+#include <set>
+#include <vector>
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+#include <memory_resource>
+#endif
+
+
+namespace {
+
+using Slab = eg::SlabAllocator<eg::SlabClass<16, 4>, eg::SlabClass<64, 2>, eg::SlabClass<256, 1>>;
+
+} // namespace {
+
+
+TEST(SlabAllocatorTest, SizeClasses)
+{
+    Slab slab;
+    EXPECT_EQ(Slab::kNumClasses, 3);
+    EXPECT_EQ(Slab::kMaxBlockSize, 256);
+    EXPECT_EQ(slab.block_size(0), 16);
+    EXPECT_EQ(slab.block_size(2), 256);
+
+    // Each request comes from the smallest class that fits.
+    void* small  = slab.allocate(1);
+    void* medium = slab.allocate(17);
+    void* large  = slab.allocate(256);
+    ASSERT_TRUE(small && medium && large);
+    EXPECT_EQ(slab.available(0), 3);
+    EXPECT_EQ(slab.available(1), 1);
+    EXPECT_EQ(slab.available(2), 0);
+
+    for (void* p: {small, medium, large})
+    {
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % alignof(std::max_align_t), 0U);
+        EXPECT_TRUE(slab.owns(p));
+    }
+
+    // Too large, or over-aligned.
+    EXPECT_TRUE(slab.allocate(257) == nullptr);
+    EXPECT_TRUE(slab.allocate(8, 2 * alignof(std::max_align_t)) == nullptr);
+
+    EXPECT_TRUE(slab.deallocate(small));
+    EXPECT_TRUE(slab.deallocate(medium));
+    EXPECT_TRUE(slab.deallocate(large));
+    EXPECT_FALSE(slab.deallocate(large));
+    EXPECT_EQ(slab.available(0), 4);
+    EXPECT_EQ(slab.available(1), 2);
+    EXPECT_EQ(slab.available(2), 1);
+    EXPECT_EQ(slab.low_water_mark(2), 0);
+}
+
+
+TEST(SlabAllocatorTest, FallsBackToLargerClass)
+{
+    Slab slab;
+    std::set<void*> blocks;
+    // Four from the 16 byte class, then two from 64 and one from 256.
+    for (int i = 0; i < 7; ++i)
+    {
+        void* p = slab.allocate(8);
+        ASSERT_TRUE(p != nullptr);
+        EXPECT_TRUE(blocks.insert(p).second);
+    }
+    EXPECT_TRUE(slab.allocate(8) == nullptr);
+    EXPECT_EQ(slab.available(0) + slab.available(1) + slab.available(2), 0);
+
+    int outside = 0;
+    EXPECT_FALSE(slab.owns(&outside));
+    EXPECT_FALSE(slab.deallocate(&outside));
+    for (void* p: blocks) EXPECT_TRUE(slab.deallocate(p));
+}
+
+
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+TEST(SlabAllocatorTest, MemoryResource)
+{
+    static Slab slab;
+    eg::SlabResource<Slab> resource{slab};
+
+    {
+        std::pmr::vector<uint32_t> values{&resource};
+        values.reserve(10); // 40 bytes, from the 64 byte class
+        for (uint32_t i = 0; i < 10; ++i) values.push_back(i);
+        EXPECT_EQ(slab.available(1), 1);
+        EXPECT_TRUE(slab.owns(values.data()));
+    }
+    EXPECT_EQ(slab.available(1), 2);
+
+    // Nothing reaches the heap by default.
+    EXPECT_THROW((void)resource.allocate(1024), std::bad_alloc);
+
+    // Unless there is an upstream resource.
+    eg::SlabResource<Slab> fallback{slab, std::pmr::new_delete_resource()};
+    void* p = fallback.allocate(1024);
+    EXPECT_FALSE(slab.owns(p));
+    fallback.deallocate(p, 1024);
+}
+
+
+TEST(SlabAllocatorTest, MemoryResourceKeepsRejectedFreesFromUpstream)
+{
+    // Anything freed upstream would reach this.
+    class Upstream : public std::pmr::memory_resource
+    {
+    public:
+        uint32_t frees{};
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override { return std::pmr::new_delete_resource()->allocate(bytes, alignment); }
+        void  do_deallocate(void* ptr, size_t bytes, size_t alignment) override 
+        { 
+            ++frees; 
+            std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment); 
+        }
+        bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    static Slab slab;
+    Upstream upstream;
+    eg::SlabResource<Slab> resource{slab, &upstream};
+
+    // A double free, and a pointer into the middle of a block, stay with the slab.
+    void* p = resource.allocate(16);
+    ASSERT_TRUE(slab.owns(p));
+    resource.deallocate(p, 16);
+    resource.deallocate(p, 16);
+    void* q = resource.allocate(16);
+    resource.deallocate(static_cast<uint8_t*>(q) + 4, 12);
+    EXPECT_EQ(resource.rejected_frees(), 2U);
+    EXPECT_EQ(upstream.frees, 0U);
+    EXPECT_EQ(slab.available(0), 3);
+    resource.deallocate(q, 16);
+    EXPECT_EQ(slab.available(0), 4);
+
+    // Memory from upstream still goes back there.
+    void* r = resource.allocate(1024);
+    resource.deallocate(r, 1024);
+    EXPECT_EQ(upstream.frees, 1U);
+    EXPECT_EQ(resource.rejected_frees(), 2U);
+}
+#endif
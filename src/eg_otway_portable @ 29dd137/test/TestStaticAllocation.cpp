@@ -0,0 +1,135 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// Checks that OTWAY_LINUX_STATIC uses no heap after initialisation. This executable is only 
+// built with that configuration, as the default Linux backend allocates on every post.
+
+#if defined(OTWAY_TARGET_PLATFORM_LINUX) && defined(OTWAY_LINUX_STATIC)
+
+#include "gtest/gtest.h"
+#include "signals/Signal.h"
+#include "timers/Timer.h"
+#include "event_loop/ThreadEventLoop.h"
+#include "mock/AllocationCounter.h"
+#include <atomic>
+#include <thread>
+
+
+namespace {
+
+eg::ThreadEventLoop* g_default_loop;
+
+} // namespace {
+
+
+namespace eg {
+
+IEventLoop* default_event_loop_impl() { return g_default_loop; }
+IEventLoop* this_event_loop_impl()    { return get_thread_event_loop(); }
+
+void on_assert_triggered(char const* file, uint32_t line, const char* function, const char* message) 
+{ 
+    (void) file; 
+    (void) line;
+    (void) function;
+    (void) message;
+}
+
+} // namespace eg
+
+
+namespace {
+
+class Consumer
+{
+public:
+    void on_value(const uint32_t& value) { m_ordered &= (value == m_last + 1); m_last = value; ++m_count; }
+    void on_tick()                       { ++m_ticks; }
+
+    uint32_t              m_last{};
+    bool                  m_ordered{true};
+    std::atomic<uint32_t> m_count{};
+    std::atomic<uint32_t> m_ticks{};
+};
+
+template <typename Pred>
+bool wait_for(Pred pred)
+{
+    using namespace std::chrono_literals;
+    for (int i = 0; i < 2000; ++i)
+    {
+        if (pred()) return true;
+        std::this_thread::sleep_for(1ms);
+    }
+    return pred();
+}
+
+} // namespace {
+
+
+TEST(StaticAllocation, CounterDetectsAllocation)
+{
+    eg::test::AllocationCounter::arm();
+    auto* leak = new uint32_t{};
+    eg::test::AllocationCounter::disarm();
+    delete leak;
+    EXPECT_GE(eg::test::AllocationCounter::violations(), 1U);
+}
+
+
+TEST(StaticAllocation, NoHeapAfterInit)
+{
+    // Initialisation: create the loops, connect the signals and start the timer. 
+    eg::ThreadEventLoop loop1{"static1"};
+    eg::ThreadEventLoop loop2{"static2"};
+    g_default_loop = &loop1;
+
+    Consumer consumer1;
+    Consumer consumer2;
+    eg::Signal<uint32_t> signal;
+    signal.connect<&Consumer::on_value>(&consumer1, loop1);
+    signal.connect<&Consumer::on_value>(&consumer2, loop2);
+
+    eg::Timer timer{1, eg::Timer::Type::Repeating};
+    timer.on_update().connect<&Consumer::on_tick>(&consumer1, loop1);
+    timer.start();
+
+    // Let the threads settle before checking.
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    const uint32_t before = eg::test::AllocationCounter::violations();
+
+    // Steady state operation.
+    constexpr uint32_t kCount = 2000;
+    eg::test::AllocationCounter::arm();
+    // Overflow is a terminal error, so the consumers must never fall more than half a queue
+    // behind. The other half leaves room for the timer's events. 
+    constexpr uint32_t kSlack = OTWAY_THREAD_EVENT_LOOP_QUEUE_SIZE / 2;
+    bool kept_up = true;
+    for (uint32_t i = 1; (i <= kCount) && kept_up; ++i)
+    {
+        kept_up = wait_for([&]() { return (consumer1.m_count + kSlack >= i) && (consumer2.m_count + kSlack >= i); });
+        signal.emit(i);
+    }
+    const bool done = kept_up && wait_for([&]() { return (consumer1.m_count == kCount) && (consumer2.m_count == kCount) && (consumer1.m_ticks > 10); });
+    timer.stop();
+    timer.start();
+    timer.stop();
+    eg::test::AllocationCounter::disarm();
+
+    EXPECT_TRUE(done);
+    EXPECT_EQ(eg::test::AllocationCounter::violations(), before);
+    EXPECT_TRUE(consumer1.m_ordered);
+    EXPECT_TRUE(consumer2.m_ordered);
+
+    loop1.stop();
+    loop2.stop();
+    g_default_loop = nullptr;
+}
+
+#endif
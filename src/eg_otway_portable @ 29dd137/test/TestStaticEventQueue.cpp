@@ -0,0 +1,240 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// StaticEventQueue is the queue used by FreeRTOSEventLoop. The loop itself cannot be tested 
+// on the host, but the queue is platform independent. The timestamps are used here only to 
+// identify the events.
+
+#include "gtest/gtest.h"
+#include "event_loop/StaticEventQueue.h"
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
+
+namespace {
+
+template <uint8_t N>
+bool post(eg::StaticEventQueue<N>& queue, uint32_t id)
+{
+    eg::Event* slot = queue.acquire();
+    if (!slot) return false;
+    slot->m_timestamp = id;
+    queue.push(slot);
+    return true;
+}
+
+} // namespace {
+
+
+TEST(StaticEventQueue, FifoOrder)
+{
+    eg::StaticEventQueue<4> queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.capacity(), 4U);
+    EXPECT_EQ(queue.pop(), nullptr);
+
+    for (uint32_t id = 1; id <= 4; ++id)
+    {
+        EXPECT_TRUE(post(queue, id));
+        EXPECT_EQ(queue.back().m_timestamp, id);
+    }
+    EXPECT_TRUE(queue.full());
+    EXPECT_FALSE(post(queue, 5));
+
+    for (uint32_t id = 1; id <= 4; ++id)
+    {
+        eg::Event* slot = queue.pop();
+        ASSERT_NE(slot, nullptr);
+        EXPECT_EQ(slot->m_timestamp, id);
+        queue.release(slot);
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+
+TEST(StaticEventQueue, InFlightSlotIsNotReused)
+{
+    eg::StaticEventQueue<3> queue;
+    for (uint32_t id = 1; id <= 3; ++id) post(queue, id);
+
+    // Event 1 is being dispatched, which makes room for one more pending event.
+    eg::Event* in_flight = queue.pop();
+    ASSERT_NE(in_flight, nullptr);
+    EXPECT_TRUE(post(queue, 4));
+    EXPECT_FALSE(post(queue, 5));
+    EXPECT_EQ(in_flight->m_timestamp, 1U);
+
+    // Dropping the oldest pending events must never hand out the in-flight slot.
+    for (uint32_t id = 5; id <= 20; ++id)
+    {
+        eg::Event* slot = queue.drop_oldest();
+        ASSERT_NE(slot, nullptr);
+        EXPECT_NE(slot, in_flight);
+        slot->m_timestamp = id;
+        queue.push(slot);
+    }
+    EXPECT_EQ(in_flight->m_timestamp, 1U);
+    queue.release(in_flight);
+
+    // Only the most recent events remain, in order.
+    for (uint32_t id = 18; id <= 20; ++id)
+    {
+        eg::Event* slot = queue.pop();
+        ASSERT_NE(slot, nullptr);
+        EXPECT_EQ(slot->m_timestamp, id);
+        queue.release(slot);
+    }
+    EXPECT_EQ(queue.drop_oldest(), nullptr);
+}
+
+
+TEST(StaticEventQueue, WrapsAround)
+{
+    eg::StaticEventQueue<5> queue;
+    uint32_t next_post = 1;
+    uint32_t next_pop  = 1;
+    for (int round = 0; round < 100; ++round)
+    {
+        while (post(queue, next_post)) ++next_post;
+        EXPECT_TRUE(queue.full());
+
+        for (int i = 0; i < 3; ++i)
+        {
+            eg::Event* slot = queue.pop();
+            ASSERT_NE(slot, nullptr);
+            EXPECT_EQ(slot->m_timestamp, next_pop++);
+            queue.release(slot);
+        }
+    }
+}
+
+
+TEST(StaticEventQueue, AbandonedSlot)
+{
+    eg::StaticEventQueue<2> queue;
+    eg::Event* slot = queue.acquire();
+    ASSERT_NE(slot, nullptr);
+    queue.abandon(slot);
+    EXPECT_TRUE(queue.empty());
+
+    EXPECT_TRUE(post(queue, 1));
+    EXPECT_TRUE(post(queue, 2));
+    EXPECT_FALSE(post(queue, 3));
+}
+
+
+TEST(StaticEventQueue, ReservedSlotsCountAgainstCapacity)
+{
+    eg::StaticEventQueue<3> queue;
+
+    // A task acquires a slot and is interrupted before pushing it. The ISR can only fill 
+    // the remaining room.
+    eg::Event* task_slot = queue.acquire();
+    ASSERT_NE(task_slot, nullptr);
+    EXPECT_TRUE(post(queue, 1));
+    EXPECT_TRUE(post(queue, 2));
+    EXPECT_TRUE(queue.full());
+    EXPECT_FALSE(post(queue, 99));
+
+    // Dropping the oldest makes room without disturbing the reservation.
+    eg::Event* dropped = queue.drop_oldest();
+    ASSERT_NE(dropped, nullptr);
+    EXPECT_NE(dropped, task_slot);
+    EXPECT_EQ(queue.acquire(), nullptr);
+    dropped->m_timestamp = 3;
+    queue.push(dropped);
+
+    task_slot->m_timestamp = 4;
+    queue.push(task_slot);
+    EXPECT_EQ(queue.size(), 3U);
+
+    // Each event is popped exactly once.
+    for (uint32_t id: {2U, 3U, 4U})
+    {
+        eg::Event* slot = queue.pop();
+        ASSERT_NE(slot, nullptr);
+        EXPECT_EQ(slot->m_timestamp, id);
+        queue.release(slot);
+    }
+    EXPECT_EQ(queue.pop(), nullptr);
+}
+
+
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+// The pattern used by FreeRTOSEventLoop, with a mutex standing in for the critical section: 
+// producers copy into their slots outside the lock. Every event must be dispatched exactly
+// once, and those from each producer in order.
+TEST(StaticEventQueue, ConcurrentProducers)
+{
+    constexpr uint32_t kProducers = 4;
+    constexpr uint32_t kEvents    = 5000;
+
+    eg::StaticEventQueue<4> queue;
+    std::mutex mutex;
+
+    std::vector<std::thread> producers;
+    for (uint32_t producer = 0; producer < kProducers; ++producer)
+    {
+        producers.emplace_back([&, producer]()
+        {
+            for (uint32_t seq = 1; seq <= kEvents; ++seq)
+            {
+                eg::Event* slot = nullptr;
+                while (!slot)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        slot = queue.acquire();
+                    }
+                    if (!slot) std::this_thread::yield();
+                }
+
+                // Give the others a chance to run between acquire() and push().
+                std::this_thread::yield();
+                slot->m_timestamp = (producer << 16) | seq;
+
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push(slot);
+            }
+        });
+    }
+
+    uint32_t last[kProducers]{};
+    bool ordered = true;
+    for (uint32_t count = 0; count < kProducers * kEvents; )
+    {
+        eg::Event* slot;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slot = queue.pop();
+        }
+        if (!slot)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        const uint32_t producer = slot->m_timestamp >> 16;
+        const uint32_t seq      = slot->m_timestamp & 0xFFFFU;
+        ordered &= (producer < kProducers) && (seq == last[producer] + 1);
+        if (producer < kProducers) last[producer] = seq;
+        ++count;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.release(slot);
+    }
+
+    for (auto& producer: producers) producer.join();
+    EXPECT_TRUE(ordered);
+    EXPECT_TRUE(queue.empty());
+}
+#endif
@@ -0,0 +1,236 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2024.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+
+// Traceability:
+// PRS-103 Timer interface and PRS-104 Timer class
+
+#if defined(OTWAY_TARGET_PLATFORM_LINUX) 
+
+#include "gtest/gtest.h"
+#include "timers/Timer.h"
+#include "TestSingleThreadedUtils.h"
+namespace {
+
+int g_timer1_count;
+void on_timer1()
+{
+    ++g_timer1_count;
+}
+
+int g_timer2_count;
+void on_timer2()
+{
+    ++g_timer2_count;
+}
+
+int g_timer3_count;
+void on_timer3()
+{
+    ++g_timer3_count;
+}
+
+class TestEventLoop : public eg::IEventLoop
+{
+public:
+    // Dispatch immediately so that Signal::emit() is synchronous. With virtual time, 
+    // the timer signals are emitted from the thread calling advance_virtual_time().
+    void post(const eg::Event& ev) override { ev.dispatch(); }
+    void run() override {}
+#if defined(OTWAY_EVENT_LOOP_WATER_MARK)
+    uint16_t get_high_water_mark() const { return 0; }
+#endif
+};
+
+} // namespace {
+
+// Same scenarios as the bare metal tests, but driving the Linux timer queue through 
+// virtual time. Each call to advance_virtual_time(1) is equivalent to tick_software_timers().
+class TimerLinuxTest : public testing::Test {
+    protected:     
+    TestEventLoop * m_loop;
+
+    virtual void SetUp() {
+        m_loop = new TestEventLoop(); 
+        eg::CURRENT_EVENT_LOOP = m_loop;
+        eg::Timer::set_virtual_time(true);
+    }
+
+    virtual void TearDown() {
+        eg::Timer::set_virtual_time(false);
+        delete m_loop;
+        eg::CURRENT_EVENT_LOOP = nullptr;
+    }
+};
+
+TEST_F(TimerLinuxTest, OneTimerStopped)
+{
+    constexpr int TIMER1_TICKS = 93;
+
+    eg::Timer timer1{TIMER1_TICKS, eg::Timer::Type::Repeating};
+    timer1.on_update().connect<on_timer1>();
+    EXPECT_FALSE(timer1.is_running());
+    EXPECT_EQ(timer1.get_ticks_remaining(), 0U);
+
+    g_timer1_count = 0;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_TRUE(g_timer1_count == 0);
+        eg::Timer::advance_virtual_time(1);
+    }
+}
+
+TEST_F(TimerLinuxTest, OneTimerStarted)
+{
+    constexpr int TIMER1_TICKS = 93;
+
+    eg::Timer timer1{TIMER1_TICKS, eg::Timer::Type::Repeating};
+    timer1.on_update().connect<on_timer1>();
+    timer1.start();
+    EXPECT_TRUE(timer1.is_running());
+
+    g_timer1_count = 0;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_TRUE(g_timer1_count == i / TIMER1_TICKS);
+        eg::Timer::advance_virtual_time(1);
+    }
+    EXPECT_TRUE(timer1.is_running());
+}
+
+TEST_F(TimerLinuxTest, GetTicksRemaining)
+{
+    constexpr int TIMER1_TICKS = 93;
+
+    eg::Timer timer1{TIMER1_TICKS, eg::Timer::Type::Repeating};
+    timer1.on_update().connect<on_timer1>();
+    timer1.start();
+
+    EXPECT_EQ(timer1.get_ticks_remaining(), TIMER1_TICKS);
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        if (i == 0 || i % TIMER1_TICKS == 0) EXPECT_EQ(timer1.get_ticks_remaining(), TIMER1_TICKS);
+        else EXPECT_EQ(timer1.get_ticks_remaining(), TIMER1_TICKS - (i % TIMER1_TICKS));
+        eg::Timer::advance_virtual_time(1);
+    }
+}
+
+TEST_F(TimerLinuxTest, OneTimerOneShot)
+{
+    constexpr int TIMER1_TICKS = 93;
+
+    eg::Timer timer1{TIMER1_TICKS, eg::Timer::Type::OneShot};
+    timer1.on_update().connect<on_timer1>();
+    timer1.start();
+
+    g_timer1_count = 0;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_TRUE(g_timer1_count == (i >= TIMER1_TICKS));
+        EXPECT_EQ(timer1.is_running(), (i < TIMER1_TICKS));
+        eg::Timer::advance_virtual_time(1);
+    }
+}
+
+TEST_F(TimerLinuxTest, ThreeTimersStarted)
+{
+    constexpr int TIMER1_TICKS = 93;
+    constexpr int TIMER2_TICKS = 101;
+    constexpr int TIMER3_TICKS = 113;
+
+    eg::Timer timer1{TIMER1_TICKS, eg::Timer::Type::Repeating};
+    timer1.on_update().connect<on_timer1>();
+    timer1.start();
+
+    eg::Timer timer2{TIMER2_TICKS, eg::Timer::Type::Repeating};
+    timer2.on_update().connect<on_timer2>();
+    timer2.start();
+
+    eg::Timer timer3{TIMER3_TICKS, eg::Timer::Type::Repeating};
+    timer3.on_update().connect<on_timer3>();
+    timer3.start();
+
+    g_timer1_count = 0;
+    g_timer2_count = 0;
+    g_timer3_count = 0;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_TRUE(g_timer1_count == i / TIMER1_TICKS);
+        EXPECT_TRUE(g_timer2_count == i / TIMER2_TICKS);
+        EXPECT_TRUE(g_timer3_count == i / TIMER3_TICKS);
+        eg::Timer::advance_virtual_time(1);
+    }
+
+    timer2.stop();    
+    EXPECT_FALSE(timer2.is_running());
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT_TRUE(g_timer1_count == (1000 + i) / TIMER1_TICKS);
+        EXPECT_TRUE(g_timer2_count == (1000 )    / TIMER2_TICKS); // Unchanged as stopped
+        EXPECT_TRUE(g_timer3_count == (1000 + i) / TIMER3_TICKS);
+        eg::Timer::advance_virtual_time(1);
+    }
+}
+
+TEST_F(TimerLinuxTest, AdvanceManyTicks)
+{
+    constexpr int TIMER1_TICKS = 10;
+
+    eg::Timer timer1{TIMER1_TICKS, eg::Timer::Type::Repeating};
+    timer1.on_update().connect<on_timer1>();
+    timer1.start();
+
+    g_timer1_count = 0;
+
+    // Repeating timers fire once for each period elapsed in a single large step.
+    eg::Timer::advance_virtual_time(1000);
+    EXPECT_EQ(g_timer1_count, 100);
+    EXPECT_EQ(timer1.get_ticks_remaining(), TIMER1_TICKS);
+}
+
+TEST_F(TimerLinuxTest, SetPeriodStopsTimer)
+{
+    eg::Timer timer1{50, eg::Timer::Type::OneShot};
+    timer1.start();
+    EXPECT_TRUE(timer1.is_running());
+
+    timer1.set_period(20);
+    EXPECT_FALSE(timer1.is_running());
+    EXPECT_EQ(timer1.get_period(), 20U);
+
+    timer1.set_type(eg::Timer::Type::Repeating);
+    EXPECT_EQ(timer1.get_type(), eg::Timer::Type::Repeating);
+}
+
+TEST_F(TimerLinuxTest, GetTickCount)
+{
+    uint32_t start = eg::Timer::get_tick_count();
+    eg::Timer::advance_virtual_time(250);
+    EXPECT_EQ(eg::Timer::get_tick_count() - start, 250U);
+}
+
+TEST_F(TimerLinuxTest, InterfacePointer)
+{
+    eg::Timer timer1{5, eg::Timer::Type::OneShot};
+    eg::ITimer& itimer = timer1;
+    itimer.on_update().connect<on_timer1>();
+
+    g_timer1_count = 0;
+    itimer.start();
+    eg::Timer::advance_virtual_time(5);
+    EXPECT_EQ(g_timer1_count, 1);
+    EXPECT_FALSE(itimer.is_running());
+}
+
+#endif // OTWAY_TARGET_PLATFORM_LINUX
@@ -0,0 +1,91 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+namespace {
+
+std::atomic<bool>     g_armed{false};
+std::atomic<uint32_t> g_allocations{0};
+std::atomic<uint32_t> g_violations{0};
+
+
+void* counted_alloc(std::size_t size)
+{
+    ++g_allocations;
+    if (g_armed)
+    {
+        ++g_violations;
+    }
+
+    // malloc(0) may return null, which operator new must not.
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc{};
+    return ptr;
+}
+
+
+void* counted_aligned_alloc(std::size_t size, std::align_val_t align)
+{
+    ++g_allocations;
+    if (g_armed)
+    {
+        ++g_violations;
+    }
+
+    // aligned_alloc requires the size to be a multiple of the alignment.
+    const auto alignment = static_cast<std::size_t>(align);
+    const std::size_t rounded = ((size ? size : 1) + alignment - 1) & ~(alignment - 1);
+    void* ptr = std::aligned_alloc(alignment, rounded);
+    if (!ptr) throw std::bad_alloc{};
+    return ptr;
+}
+
+} // namespace {
+
+
+namespace eg::test {
+
+void     AllocationCounter::arm()         { g_armed = true; }
+void     AllocationCounter::disarm()      { g_armed = false; }
+bool     AllocationCounter::is_armed()    { return g_armed; }
+uint32_t AllocationCounter::allocations() { return g_allocations; }
+uint32_t AllocationCounter::violations()  { return g_violations; }
+
+} // namespace eg::test {
+
+
+// Replacements for the global allocation functions. The nothrow and array forms are 
+// forwarded here by the standard library, but are replaced explicitly to be sure.
+void* operator new(std::size_t size)                                    { return counted_alloc(size); }
+void* operator new[](std::size_t size)                                  { return counted_alloc(size); }
+void* operator new(std::size_t size, std::align_val_t align)            { return counted_aligned_alloc(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align)          { return counted_aligned_alloc(size, align); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return counted_alloc(size); } catch (...) { return nullptr; }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return counted_alloc(size); } catch (...) { return nullptr; }
+}
+
+void operator delete(void* ptr) noexcept                                { std::free(ptr); }
+void operator delete[](void* ptr) noexcept                              { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept                   { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept                 { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept              { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept            { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
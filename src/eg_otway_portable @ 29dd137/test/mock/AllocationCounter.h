@@ -0,0 +1,33 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <cstdint>
+
+
+namespace eg::test {
+
+
+// A test hook which replaces the global operator new to count heap allocations. Link 
+// mock/AllocationCounter.cpp into a test executable to use it. Once initialisation is 
+// complete, arm the counter: any allocation after that, from any thread, is a violation
+// of the no-heap-after-init rule. Disarm before using gtest assertions, which may allocate.
+class AllocationCounter
+{
+public:
+    static void     arm();
+    static void     disarm();
+    static bool     is_armed();
+    // Total number of allocations since the program started.
+    static uint32_t allocations();
+    // Number of allocations made while armed.
+    static uint32_t violations();
+};
+
+
+} // namespace eg::test {
@@ -92,6 +92,7 @@ public:
         if ((address % kWriteSize) != 0) return Result::eUnalignedAddress;
         if ((size % kWriteSize) != 0) return Result::eUnalignedSize;
 
+        ++m_writes;
         for (uint32_t i = 0; i < size; ++i)
             // codechecker_intentional [core.uninitialized.Assign] static analyser worries that data is &=ing uninitialised stuff. OK in test environment.
             m_data[address + i] &= data[i];
@@ -117,6 +118,7 @@ public:
         // if ((address % kWriteSize) != 0) return Result::eUnalignedAddress;
         // if ((size % kWriteSize) != 0) return Result::eUnalignedSize;
 
+        ++m_reads;
         for (uint32_t i = 0; i < size; ++i)
             data[i] = m_data[address + i];
         return Result::eOK;
@@ -137,6 +139,8 @@ public:
 
         if (address >= kMemorySize) return Result::eInvalidAddress;
 
+        ++m_erases;
+        ++m_page_erases[address / kPageSize];
         address = (address / kPageSize) * kPageSize;
         std::memset(&m_data[address], 0xFF, kPageSize);
         return Result::eOK;
@@ -148,9 +152,68 @@ public:
         return erase_address(get_page_address(page));
     }
 
+    // Operation counts, for tests and benchmarks which care how much work the client does.
+    // Access through get_data() is not counted.
+    uint32_t get_read_count() const  { return m_reads; }
+    uint32_t get_write_count() const { return m_writes; }
+    uint32_t get_erase_count() const { return m_erases; }
+    void reset_counts() { m_reads = 0; m_writes = 0; m_erases = 0; m_page_erases.fill(0); }
+
+    // Erases of each page, for looking at wear.
+    uint32_t get_page_erase_count(uint32_t page) const { return (page < kNumPages) ? m_page_erases[page] : 0; }
+
 private:
     static constexpr uint32_t kMemorySize = kPageSize * kNumPages;
     std::array<uint8_t, kMemorySize> m_data{};
+    mutable uint32_t m_reads{};
+    uint32_t m_writes{};
+    uint32_t m_erases{};
+    std::array<uint32_t, kNumPages> m_page_erases{};
+};
+
+
+// The mock flash, plus a simple model of how long each operation would take on a device. Each
+// program operation has a fixed cost for the controller (unlock, clear flags, wait for busy) plus
+// a cost per write unit, and a page erase is very slow. Nothing actually waits: the time is added
+// up so that tests and benchmarks can report latency and throughput in device terms.
+template <typename Flash>
+class TimedFlashMemory : public Flash
+{
+public:
+    struct Timing
+    {
+        uint64_t program_setup_ns;
+        uint64_t program_unit_ns;
+        uint64_t erase_ns;
+    };
+    // In the region of the STM32G4 datasheet figures. 
+    static constexpr Timing kSTM32G4{20'000, 40'000, 22'000'000};
+
+    explicit TimedFlashMemory(const Timing& timing = kSTM32G4)
+    : m_timing{timing}
+    {
+    }
+
+    using Flash::write;
+    IFlashMemory::Result write(uint32_t address, const uint8_t* data, uint32_t size) override
+    {
+        m_elapsed_ns += m_timing.program_setup_ns + m_timing.program_unit_ns * (size / Flash::get_write_size());
+        return Flash::write(address, data, size);
+    }
+
+    using Flash::erase_address;
+    IFlashMemory::Result erase_address(uint32_t address) override
+    {
+        m_elapsed_ns += m_timing.erase_ns;
+        return Flash::erase_address(address);
+    }
+
+    uint64_t get_elapsed_ns() const { return m_elapsed_ns; }
+    void reset_elapsed() { m_elapsed_ns = 0; }
+
+private:
+    Timing   m_timing;
+    uint64_t m_elapsed_ns{};
 };
 
 
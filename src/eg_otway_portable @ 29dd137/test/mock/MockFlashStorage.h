@@ -0,0 +1,104 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "drivers/FlashStorageBase.h"
+#include "interfaces/IFlashMemory.h"
+#include <cstdint>
+
+
+namespace eg
+{
+
+
+// An asynchronous IFlashStorage over the same pages as an IFlashMemory (sector N is page N). Only 
+// erase is asynchronous: the request is held until complete_erase() is called, which stands in for
+// the flash controller's end of operation interrupt. Reads and writes complete immediately, and their 
+// status is available from CheckAndClearStatus() straight away, as for a blocking driver. A failure is
+// returned rather than signalled. Those made while an erase is pending are queued by FlashStorageBase 
+// until it completes.
+class MockFlashStorage : public virtual FlashStorageBase
+{
+public:
+    explicit MockFlashStorage(IFlashMemory& flash)
+    : FlashStorageBase{flash.get_write_size()}
+    , m_flash{flash}
+    {
+    }
+
+    bool Initialize() override { return true; }
+    uint32_t GetNumberOfSectors() override { return m_flash.get_page_count(); }
+    bool IsValidSector(uint32_t sector) override { return sector < m_flash.get_page_count(); }
+    bool IsSectorReadOnly([[maybe_unused]] uint32_t sector) override { return false; }
+    // The flash is memory mapped, as on the target. Clients must only change it through Write().
+    uint8_t* GetSectorStartAddress(uint32_t sector) override { return const_cast<uint8_t*>(m_flash.get_data(sector, 0)); }
+    uint32_t GetSectorSize(uint32_t sector) override { return m_flash.get_page_size(sector); }
+
+    bool is_erase_pending() const { return m_erase_pending; }
+    uint32_t get_erase_requests() const { return m_erase_requests; }
+
+    // Finish the pending erase, if any. The completion is signalled through the event loop.
+    void complete_erase(bool success = true)
+    {
+        if (!m_erase_pending) return;
+        m_erase_pending = false;
+        if (success) 
+        {
+            m_flash.erase_page(m_erase_sector);
+        }
+        mOnFlashEraseComplete.emit(success ? FlashOperationStatus::Success : FlashOperationStatus::Failed);
+    }
+
+protected:
+    FlashOperationStatus OnReadBytes(uint32_t sector, uint32_t offset, uint8_t* buffer, uint32_t size) override
+    {
+        auto status = to_status(m_flash.read(sector, offset, buffer, size));
+        mLastOperationStatus = status;
+        if (status == FlashOperationStatus::Success)
+        {
+            mOnFlashReadComplete.emit(status);
+        }
+        return status;
+    }
+
+    FlashOperationStatus OnWriteBytes(uint32_t sector, uint32_t offset, const uint8_t* buffer, uint32_t size) override
+    {
+        auto status = to_status(m_flash.write(sector, offset, buffer, size));
+        mLastOperationStatus = status;
+        if (status == FlashOperationStatus::Success)
+        {
+            mOnFlashWriteComplete.emit(status);
+        }
+        return status;
+    }
+
+    FlashOperationStatus OnEraseSector(uint32_t sector) override
+    {
+        ++m_erase_requests;
+        m_erase_pending = true;
+        m_erase_sector  = sector;
+        return FlashOperationStatus::Success;
+    }
+
+    void OnAbort() override {}
+
+private:
+    static FlashOperationStatus to_status(IFlashMemory::Result result)
+    {
+        return (result == IFlashMemory::Result::eOK) ? FlashOperationStatus::Success : FlashOperationStatus::Failed;
+    }
+
+private:
+    IFlashMemory& m_flash;
+    bool          m_erase_pending{};
+    uint32_t      m_erase_sector{};
+    uint32_t      m_erase_requests{};
+};
+
+
+} // namespace eg {
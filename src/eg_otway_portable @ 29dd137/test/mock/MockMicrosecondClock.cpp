@@ -0,0 +1,25 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#if defined(OTWAY_TARGET_PLATFORM_BAREMETAL) 
+
+#include "utilities/MicrosecondClock.h"
+#include "timers/Timer.h"
+
+namespace eg 
+{ 
+
+// There is no hardware counter on the host. The software timer tick is close enough for 
+// tests, which register their own clock when they care about the figures.
+uint32_t platform_get_microseconds() 
+{ 
+    return Timer::get_tick_count() * 1000U;
+}
+
+}
+#endif  // defined(OTWAY_TARGET_PLATFORM_BAREMETAL) 
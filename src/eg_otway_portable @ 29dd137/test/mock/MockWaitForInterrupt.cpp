@@ -0,0 +1,36 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#if defined(OTWAY_TARGET_PLATFORM_BAREMETAL) 
+
+#include "utilities/WaitForInterrupt.h"
+#include <cstdint>
+
+namespace eg 
+{ 
+
+// Host stand-ins for WFI and WFE. Rather than sleeping, they count the calls and invoke an 
+// optional hook, which a test can use to simulate an interrupt arriving during the sleep.
+uint32_t MOCK_WAIT_FOR_INTERRUPT_COUNT = 0;
+uint32_t MOCK_WAIT_FOR_EVENT_COUNT     = 0;
+void   (*MOCK_WAIT_HOOK)()             = nullptr;
+
+void platform_wait_for_interrupt() 
+{ 
+    ++MOCK_WAIT_FOR_INTERRUPT_COUNT;
+    if (MOCK_WAIT_HOOK) MOCK_WAIT_HOOK();
+}
+
+void platform_wait_for_event() 
+{ 
+    ++MOCK_WAIT_FOR_EVENT_COUNT;
+    if (MOCK_WAIT_HOOK) MOCK_WAIT_HOOK();
+}
+
+}
+#endif  // defined(OTWAY_TARGET_PLATFORM_BAREMETAL) 
@@ -99,10 +99,12 @@ class TestEventLoop : public eg::IEventLoop
         }
 
     private:
-        std::jthread                        m_thread;
+        // The thread must be declared last so that the members it uses are constructed
+        // before it starts running.
         std::mutex                          m_mutex;
         std::condition_variable_any         m_condition;
         eg::RingBufferArray<eg::Event, 16>  m_queue;
+        std::jthread                        m_thread;
 
     private:
         friend eg::IEventLoop* eg::default_event_loop_impl();
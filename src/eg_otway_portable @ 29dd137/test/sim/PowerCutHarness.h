@@ -0,0 +1,91 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code
+// is confidential information and must not be disclosed to third parties or used without
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "SimFlashMemory.h"
+#include "gtest/gtest.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+
+
+namespace eg::sim {
+
+
+// Randomised crash consistency testing of a flash client. Each trial runs the workload on fresh
+// flash with the power cut at a random point, then restores the power and runs the check. The
+// check plays the part of the firmware after the reset: it restarts the client on the surviving
+// flash and verifies what it recovers against what the workload recorded as done before the cut.
+// The workload should stop when the flash loses power.
+//
+// The cut points are spread over the units of work the workload does with no cut, which the
+// first run finds. An optional setup runs on the fresh flash before the cut is armed, for work 
+// which is not under test, such as formatting on first boot. The seed makes the trials repeatable. 
+// Trials stop at the first gtest failure, and get_cut() gives the cut which caused it.
+template <typename SimFlash>
+class PowerCutHarness
+{
+public:
+    using Workload    = std::function<void(SimFlash&)>;
+    using Check       = std::function<void(SimFlash&)>;
+    using Setup       = std::function<void(SimFlash&)>;
+    using Granularity = typename SimFlash::Granularity;
+
+public:
+    explicit PowerCutHarness(uint32_t seed, Granularity granularity = Granularity::eWord)
+    : m_random{seed}
+    , m_granularity{granularity}
+    {
+    }
+
+    // Returns the number of units of work in the workload.
+    uint64_t run(uint32_t trials, const Workload& workload, const Check& check, const Setup& setup = {})
+    {
+        auto flash = make_flash();
+        m_cut = SimFlash::kNever;
+        if (setup) setup(*flash);
+        const uint64_t start = flash->get_units();
+        workload(*flash);
+        const uint64_t units = flash->get_units() - start;
+        check(*flash);
+
+        std::uniform_int_distribution<uint64_t> cut_point{0, (units > 0) ? (units - 1) : 0};
+        std::uniform_int_distribution<uint32_t> erase_progress{0, flash->get_page_size(0)};
+        for (uint32_t trial = 0; (trial < trials) && !::testing::Test::HasFailure(); ++trial)
+        {
+            flash = make_flash();
+            if (setup) setup(*flash);
+            m_cut = cut_point(m_random);
+            flash->cut_power_after(m_cut, erase_progress(m_random));
+            workload(*flash);
+            flash->power_on();
+            check(*flash);
+            ++m_trials;
+        }
+        return units;
+    }
+
+    uint64_t get_cut() const { return m_cut; }
+    uint32_t get_trials() const { return m_trials; }
+
+private:
+    std::unique_ptr<SimFlash> make_flash() const
+    {
+        return std::make_unique<SimFlash>(SimFlash::kSTM32G4, m_granularity);
+    }
+
+private:
+    std::mt19937 m_random;
+    Granularity  m_granularity;
+    uint64_t     m_cut{SimFlash::kNever};
+    uint32_t     m_trials{};
+};
+
+
+} // namespace eg::sim {
@@ -0,0 +1,170 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code
+// is confidential information and must not be disclosed to third parties or used without
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "../mock/MockFlashMemory.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+
+namespace eg::sim {
+
+
+// Flash simulator for torture testing and benchmarking flash clients (FlashLog, FlashKeyValueStore,
+// FlashScratchpad through MockFlashStorage, ...) on the host. It builds on the mock flash (programming
+// is a bitwise AND, erase sets 0xFF) and TimedFlashMemory (program and erase latency, accumulated in
+// virtual time), and adds:
+// - Wear. The lifetime erase count of each page, which reset_counts() leaves alone, and an optional
+//   endurance limit. An erase of a worn out page fails and leaves the page as it was.
+// - Power cuts. The power fails after a given number of units of work, where a unit is one byte or
+//   one write word programmed (see Granularity), or one page erase. A program which is cut leaves the
+//   units before the cut programmed, and the rest untouched. An erase which is cut leaves the start
+//   of the page erased, and the rest as it was. The operation which is cut, and everything after it
+//   until power_on(), fails with eFlashFailed. Reads still work, so that the state can be examined.
+//
+// Running a workload once with no cut gives the number of units of work it does. Repeating it with
+// cuts at points in that range, and restarting the client on the surviving flash each time, checks
+// its crash consistency. See PowerCutHarness.
+template <typename Flash>
+class SimFlashMemory : public TimedFlashMemory<Flash>
+{
+    using Base = TimedFlashMemory<Flash>;
+
+public:
+    using Result = IFlashMemory::Result;
+    using Timing = typename Base::Timing;
+    static constexpr uint64_t kNever = std::numeric_limits<uint64_t>::max();
+
+    // Most MCU flash programs a whole word at a time, with ECC over it, so a cut can't leave part of
+    // a word programmed. Serial NOR flash programs bytes.
+    enum class Granularity { eByte, eWord };
+
+public:
+    explicit SimFlashMemory(const Timing& timing = Base::kSTM32G4, Granularity granularity = Granularity::eWord)
+    : Base{timing}
+    , m_unit_size{(granularity == Granularity::eByte) ? 1U : Flash::get_write_size()}
+    , m_wear(Flash::get_page_count(), 0)
+    {
+    }
+
+    using Base::write;
+    Result write(uint32_t address, const uint8_t* data, uint32_t size) override
+    {
+        if (!m_powered) return Result::eFlashFailed;
+
+        const uint64_t start = Base::get_elapsed_ns();
+        const uint64_t units = size / m_unit_size;
+        Result result = Result::eFlashFailed;
+        if ((m_units + units) <= m_cut_at)
+        {
+            m_units += units;
+            result = Base::write(address, data, size);
+        }
+        else
+        {
+            // The cut comes part way through. Blank bytes leave the flash as it was.
+            const uint32_t done = static_cast<uint32_t>(m_cut_at - m_units) * m_unit_size;
+            std::vector<uint8_t> partial(size, 0xFF);
+            std::memcpy(partial.data(), data, done);
+            Base::write(address, partial.data(), size);
+            cut();
+        }
+        m_max_operation_ns = std::max(m_max_operation_ns, Base::get_elapsed_ns() - start);
+        return result;
+    }
+
+    using Base::erase_address;
+    Result erase_address(uint32_t address) override
+    {
+        if (!m_powered) return Result::eFlashFailed;
+
+        const uint32_t page = Flash::get_page_index(address);
+        if (page == IFlashMemory::kInvalidArgument) return Base::erase_address(address);
+        if (is_worn_out(page)) return Result::eFlashFailed;
+
+        const uint64_t start = Base::get_elapsed_ns();
+        Result result = Result::eFlashFailed;
+        ++m_wear[page];
+        if ((m_units + 1) <= m_cut_at)
+        {
+            ++m_units;
+            result = Base::erase_address(address);
+        }
+        else
+        {
+            // Erase the page and program the part which didn't get erased back. That is counted
+            // as a write by the mock.
+            const uint32_t page_size = Flash::get_page_size(page);
+            const uint32_t erased    = std::min(m_erase_progress, page_size) / Flash::get_write_size() * Flash::get_write_size();
+            const uint8_t* contents  = Flash::get_data(page, 0);
+            std::vector<uint8_t> kept(contents + erased, contents + page_size);
+            Base::erase_address(address);
+            if (erased < page_size)
+            {
+                Flash::write(address + erased, kept.data(), page_size - erased);
+            }
+            cut();
+        }
+        m_max_operation_ns = std::max(m_max_operation_ns, Base::get_elapsed_ns() - start);
+        return result;
+    }
+
+    // Power cuts. The power fails once the given number of further units of work have been done.
+    // If that is part way through an erase, erase_progress is how many bytes at the start of the
+    // page are erased (rounded down to the write size).
+    void cut_power_after(uint64_t units, uint32_t erase_progress = 0)
+    {
+        m_cut_at         = (units == kNever) ? kNever : m_units + units;
+        m_erase_progress = erase_progress;
+    }
+    void cancel_power_cut() { m_cut_at = kNever; }
+
+    bool is_powered() const { return m_powered; }
+    void power_on()
+    {
+        m_powered = true;
+        m_cut_at  = kNever;
+    }
+
+    // Units of work done so far.
+    uint64_t get_units() const { return m_units; }
+
+    // Wear. The limit is the number of erases a page can take (0 for no limit).
+    void set_endurance(uint32_t cycles) { m_endurance = cycles; }
+    uint32_t get_endurance() const { return m_endurance; }
+    uint32_t get_wear(uint32_t page) const { return (page < m_wear.size()) ? m_wear[page] : 0; }
+    uint32_t get_max_wear() const { return *std::max_element(m_wear.begin(), m_wear.end()); }
+    uint32_t get_min_wear() const { return *std::min_element(m_wear.begin(), m_wear.end()); }
+    bool is_worn_out(uint32_t page) const { return (m_endurance > 0) && (get_wear(page) >= m_endurance); }
+
+    // Latency of the slowest single program or erase, in virtual time.
+    uint64_t get_max_operation_ns() const { return m_max_operation_ns; }
+
+private:
+    void cut()
+    {
+        m_units   = m_cut_at;
+        m_powered = false;
+    }
+
+private:
+    uint32_t              m_unit_size;
+    std::vector<uint32_t> m_wear;
+    uint32_t              m_endurance{};
+    uint64_t              m_units{};
+    uint64_t              m_cut_at{kNever};
+    uint32_t              m_erase_progress{};
+    bool                  m_powered{true};
+    uint64_t              m_max_operation_ns{};
+};
+
+
+} // namespace eg::sim {
@@ -0,0 +1,267 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2024.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "SimKernel.h"
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+
+
+namespace eg::sim {
+
+
+SimEventLoop::SimEventLoop(SimKernel& kernel, const char* name, uint16_t capacity, SimTime default_cost)
+: m_kernel{kernel}
+, m_name{name}
+, m_capacity{capacity}
+, m_default_cost{default_cost}
+{
+    m_kernel.add_loop(this);
+}
+
+
+SimEventLoop::~SimEventLoop()
+{
+    m_kernel.remove_loop(this);
+}
+
+
+void SimEventLoop::post(const Event& event)
+{
+    ++m_report.posted;
+    if (m_queue.size() >= m_capacity)
+    {
+        // The real loop would assert here.
+        ++m_report.overflows;
+        return;
+    }
+
+    m_queue.push_back(Pending{event, m_kernel.now()});
+    m_report.high_water_mark = std::max(m_report.high_water_mark, get_depth());
+}
+
+
+void SimEventLoop::dispatch_one(SimTime now)
+{
+    Pending pending = m_queue.front();
+    m_queue.pop_front();
+
+    const SimTime latency = now - pending.posted;
+    const uint8_t bucket  = std::min<uint8_t>(std::bit_width(latency), kLatencyBuckets - 1);
+    ++m_report.latency_histogram[bucket];
+    m_report.total_latency += latency;
+    m_report.max_latency    = std::max(m_report.max_latency, latency);
+
+    auto   it   = m_costs.find(pending.event.m_signal);
+    SimTime cost = (it != m_costs.end()) ? it->second : m_default_cost;
+    m_busy_until        = now + cost;
+    m_report.busy_time += cost;
+    ++m_report.dispatched;
+
+    // Events emitted by the handler are posted at the start of the dispatch. This is 
+    // slightly optimistic but keeps the model simple.
+    pending.event.dispatch();
+}
+
+
+bool SimEventLoop::get_stats(EventLoopStats& stats) const
+{
+    stats             = EventLoopStats{};
+    stats.posted      = m_report.posted;
+    stats.dispatched  = m_report.dispatched;
+    stats.depth       = get_depth();
+    stats.peak_depth  = m_report.high_water_mark;
+    stats.busy_time   = m_report.busy_time;
+    stats.idle_time   = (m_kernel.now() > m_report.busy_time) ? (m_kernel.now() - m_report.busy_time) : 0;
+    stats.max_latency = static_cast<uint32_t>(m_report.max_latency);
+    std::copy(std::begin(m_report.latency_histogram), std::end(m_report.latency_histogram), 
+        std::begin(stats.latency_histogram));
+    return true;
+}
+
+
+double SimEventLoop::get_utilisation() const
+{
+    const SimTime elapsed = m_kernel.now();
+    if (elapsed == 0) return 0.0;
+    // The last dispatch may extend beyond the current time.
+    const SimTime busy = m_report.busy_time - ((m_busy_until > elapsed) ? (m_busy_until - elapsed) : 0);
+    return static_cast<double>(busy) / static_cast<double>(elapsed);
+}
+
+
+SimTime SimEventLoop::get_latency_percentile(double fraction) const
+{
+    const uint64_t target = static_cast<uint64_t>(fraction * m_report.dispatched + 0.5);
+    uint64_t count = 0;
+    for (uint8_t bucket = 0; bucket < kLatencyBuckets; ++bucket)
+    {
+        count += m_report.latency_histogram[bucket];
+        if ((count >= target) && (count > 0))
+        {
+            return (bucket == 0) ? 0 : ((SimTime{1} << bucket) - 1);
+        }
+    }
+    return m_report.max_latency;
+}
+
+
+void SimEventLoop::print(std::ostream& os) const
+{
+    const double mean = m_report.dispatched ? 
+        static_cast<double>(m_report.total_latency) / m_report.dispatched : 0.0;
+
+    os << m_name << ": posted=" << m_report.posted 
+       << " dispatched=" << m_report.dispatched
+       << " overflows=" << m_report.overflows
+       << " hwm=" << m_report.high_water_mark << "/" << m_capacity
+       << " load=" << std::fixed << std::setprecision(1) << (get_utilisation() * 100.0) << "%"
+       << " latency(us) mean=" << mean 
+       << " p99<=" << get_latency_percentile(0.99)
+       << " max=" << m_report.max_latency << "\n";
+
+    os << "    histogram:";
+    for (uint8_t bucket = 0; bucket < kLatencyBuckets; ++bucket)
+    {
+        os << " " << m_report.latency_histogram[bucket];
+    }
+    os << "\n";
+}
+
+
+SimKernel::SimKernel(CurrentHook set_current)
+: m_set_current{set_current}
+{
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+    Timer::set_virtual_time(true);
+#endif
+    sample_links();
+}
+
+
+SimKernel::~SimKernel()
+{
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+    Timer::set_virtual_time(false);
+#endif
+}
+
+
+void SimKernel::schedule_at(SimTime time, Action action)
+{
+    m_actions.push(Scheduled{std::max(time, m_now), m_sequence++, std::move(action)});
+}
+
+
+void SimKernel::schedule_every(SimTime period, Action action, SimTime first)
+{
+    // The action reschedules itself after each invocation.
+    auto repeat = [this, period, action]() 
+    { 
+        action(); 
+        schedule_every(period, action, m_now + period); 
+    };
+    schedule_at(first, repeat);
+}
+
+
+void SimKernel::run_until(SimTime end)
+{
+    while (true)
+    {
+        // Find the time of the next thing to happen.
+        SimTime next = end + 1;
+        if (!m_actions.empty())   next = std::min(next, m_actions.top().time);
+        if (m_timers_enabled)     next = std::min(next, m_next_tick);
+        for (auto loop: m_loops)
+        {
+            if (!loop->m_queue.empty()) next = std::min(next, std::max(m_now, loop->next_ready()));
+        }
+
+        if (next > end) break;
+        m_now = next;
+
+        // Stimuli first, then timers, then the loops. The order is fixed so that results
+        // are repeatable.
+        while (!m_actions.empty() && (m_actions.top().time <= m_now))
+        {
+            // Copy before pop because the action may schedule further actions.
+            Action action = m_actions.top().action;
+            m_actions.pop();
+            action();
+        }
+
+        if (m_timers_enabled && (m_next_tick <= m_now))
+        {
+            tick_timers();
+            m_next_tick += kTickPeriod;
+        }
+
+        for (auto loop: m_loops)
+        {
+            if (loop->is_ready(m_now))
+            {
+                m_set_current(loop);
+                loop->dispatch_one(m_now);
+                m_set_current(nullptr);
+            }
+        }
+
+        sample_links();
+    }
+
+    m_now = end;
+}
+
+
+void SimKernel::tick_timers()
+{
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+    Timer::advance_virtual_time(1);
+#else
+    tick_software_timers();
+#endif
+}
+
+
+void SimKernel::sample_links()
+{
+#if defined(OTWAY_TARGET_PLATFORM_BAREMETAL) || defined(OTWAY_TARGET_PLATFORM_FREERTOS)
+    const uint16_t used = SignalBase::pool_size() - SignalBase::pool_free();
+    m_peak_links_used   = std::max(m_peak_links_used, used);
+#endif
+}
+
+
+void SimKernel::add_loop(SimEventLoop* loop)
+{
+    m_loops.push_back(loop);
+}
+
+
+void SimKernel::remove_loop(SimEventLoop* loop)
+{
+    m_loops.erase(std::remove(m_loops.begin(), m_loops.end(), loop), m_loops.end());
+}
+
+
+void SimKernel::print(std::ostream& os) const
+{
+    os << "Simulated " << m_now << "us";
+#if defined(OTWAY_TARGET_PLATFORM_BAREMETAL) || defined(OTWAY_TARGET_PLATFORM_FREERTOS)
+    os << ", signal links peak=" << m_peak_links_used << "/" << SignalBase::pool_size();
+#endif
+    os << "\n";
+    for (auto loop: m_loops)
+    {
+        loop->print(os);
+    }
+}
+
+
+} // namespace eg::sim {
@@ -0,0 +1,188 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2024.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "signals/Signal.h"
+#include "timers/Timer.h"
+#include "event_loop/EventLoopStats.h"
+#include "utilities/NonCopyable.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <queue>
+#include <vector>
+
+
+namespace eg::sim {
+
+
+// Virtual time in microseconds. The software timers tick once every kTickPeriod.
+using SimTime = uint64_t;
+constexpr SimTime kTickPeriod = 1000;
+
+
+class SimKernel;
+
+
+// An event loop whose dispatching is driven by the SimKernel rather than by a thread. Each 
+// loop models an independent execution context (a thread or the main loop of a core). 
+// Dispatching an event keeps the loop busy for the cost of that event, which is looked up 
+// per signal, and events posted meanwhile wait in the queue. This is what produces queue
+// depth and latency.
+//
+// The queue capacity is the size of the real queue being modelled. Rather than asserting
+// like the real loops, an overflow is counted and the event dropped, so that the report can 
+// show how far short the capacity was.
+class SimEventLoop : public IEventLoop
+{
+public:
+    // Same buckets as EventLoopStats.
+    static constexpr uint8_t kLatencyBuckets = EventLoopStats::kLatencyBuckets;
+
+    struct Report
+    {
+        uint32_t posted{};
+        uint32_t dispatched{};
+        uint32_t overflows{};
+        uint16_t high_water_mark{};
+        SimTime  busy_time{};
+        SimTime  max_latency{};
+        uint64_t total_latency{};
+        uint32_t latency_histogram[kLatencyBuckets]{};
+    };
+
+public:
+    SimEventLoop(SimKernel& kernel, const char* name, uint16_t capacity, SimTime default_cost = 1);
+    ~SimEventLoop();
+
+    void post(const Event& event) override;
+    // Dispatching is driven by SimKernel::run_until().
+    void run() override {}
+    // The report in the common form. Times are virtual.
+    bool get_stats(EventLoopStats& stats) const override;
+#if defined(OTWAY_EVENT_LOOP_WATER_MARK)
+    uint16_t get_high_water_mark() const { return m_report.high_water_mark; }
+#endif
+
+    // Cost model. The time taken to dispatch an event for the given signal.
+    void set_cost(const SignalBase& signal, SimTime cost) { m_costs[&signal] = cost; }
+    void set_default_cost(SimTime cost) { m_default_cost = cost; }
+
+    const char*   get_name() const { return m_name; }
+    uint16_t      get_capacity() const { return m_capacity; }
+    uint16_t      get_depth() const { return static_cast<uint16_t>(m_queue.size()); }
+    const Report& get_report() const { return m_report; }
+
+    // Fraction of the elapsed virtual time spent dispatching events.
+    double get_utilisation() const;
+    // Upper bound of the histogram bucket containing the given fraction (0..1) of latencies.
+    SimTime get_latency_percentile(double fraction) const;
+
+    void print(std::ostream& os) const;
+
+private:
+    friend class SimKernel;
+    bool   is_ready(SimTime now) const { return !m_queue.empty() && (m_busy_until <= now); }
+    SimTime next_ready() const { return m_busy_until; }
+    void   dispatch_one(SimTime now);
+
+    struct Pending
+    {
+        Event   event;
+        SimTime posted;
+    };
+
+private:
+    SimKernel&                          m_kernel;
+    const char*                         m_name;
+    uint16_t                            m_capacity;
+    SimTime                             m_default_cost;
+    SimTime                             m_busy_until{};
+    std::deque<Pending>                 m_queue;
+    std::map<const SignalBase*, SimTime> m_costs;
+    Report                              m_report{};
+};
+
+
+// Discrete event simulation of an application built from Signals, Timers and event loops. 
+// A single virtual clock drives everything:
+// - Scheduled actions, which model stimuli and simulated driver completions (e.g. emitting
+//   a driver's signal some microseconds after a transfer was started).
+// - The software timers, which are ticked every kTickPeriod. On Linux the Timer is switched 
+//   to virtual time for the lifetime of the kernel.
+// - Any number of SimEventLoops, each dispatching its queue at the pace given by its cost model.
+// 
+// Nothing sleeps, so the simulation runs as fast as the CPU allows, and the results are 
+// repeatable. Typical use is to capacity plan a firmware build (queue sizes, MAX_SIGNAL_LINKS)
+// on the host. 
+// 
+// While a loop dispatches, it is made the current loop through the hook passed to the 
+// constructor, so that this_event_loop() can return it. This must match the application's 
+// implementation of this_event_loop_impl(). Only one kernel should exist at a time. 
+class SimKernel : private NonCopyable
+{
+public:
+    using Action      = std::function<void()>;
+    using CurrentHook = void (*)(IEventLoop* loop);
+
+public:
+    SimKernel(CurrentHook set_current);
+    ~SimKernel();
+
+    SimTime now() const { return m_now; }
+
+    // Stimuli. Actions run from the kernel with no loop current, as if from an ISR.
+    void schedule_at(SimTime time, Action action);
+    void schedule_after(SimTime delay, Action action) { schedule_at(m_now + delay, std::move(action)); }
+    void schedule_every(SimTime period, Action action, SimTime first = 0);
+
+    // Enable or disable ticking of the software timers (enabled by default).
+    void set_timers_enabled(bool enabled) { m_timers_enabled = enabled; }
+
+    void run_until(SimTime end);
+    void run_for(SimTime duration) { run_until(m_now + duration); }
+
+    // Peak number of signal links allocated from the pool (bare metal only, else zero).
+    uint16_t get_peak_links_used() const { return m_peak_links_used; }
+    const std::vector<SimEventLoop*>& get_loops() const { return m_loops; }
+
+    void print(std::ostream& os) const;
+
+private:
+    friend class SimEventLoop;
+    void add_loop(SimEventLoop* loop);
+    void remove_loop(SimEventLoop* loop);
+    void tick_timers();
+    void sample_links();
+
+    struct Scheduled
+    {
+        SimTime  time;
+        uint64_t sequence;   // Preserves the order of actions scheduled for the same time.
+        Action   action;
+        bool operator>(const Scheduled& other) const
+        {
+            return (time != other.time) ? (time > other.time) : (sequence > other.sequence);
+        }
+    };
+
+private:
+    CurrentHook                m_set_current;
+    SimTime                    m_now{};
+    SimTime                    m_next_tick{kTickPeriod};
+    bool                       m_timers_enabled{true};
+    uint64_t                   m_sequence{};
+    uint16_t                   m_peak_links_used{};
+    std::priority_queue<Scheduled, std::vector<Scheduled>, std::greater<Scheduled>> m_actions;
+    std::vector<SimEventLoop*> m_loops;
+};
+
+
+} // namespace eg::sim {
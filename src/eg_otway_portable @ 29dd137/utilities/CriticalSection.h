@@ -8,11 +8,9 @@
 /////////////////////////////////////////////////////////////////////////////////////////////
 #pragma once
 #include "NonCopyable.h"
-#if defined(OTWAY_TARGET_PLATFORM_LINUX)
-#include <mutex>
-#elif defined(OTWAY_TARGET_PLATFORM_FREERTOS)
+#include "LockDomain.h"
+#if defined(OTWAY_TARGET_PLATFORM_FREERTOS)
 //#include "FreeRTOS.h"
-#elif defined(OTWAY_TARGET_PLATFORM_BAREMETAL) 
 #endif
 
 
@@ -35,7 +33,12 @@ namespace eg {
 //   interrupts, but makes use of the ability to leave high priority interrupts enabled on 
 //   devices which have this feature (e.g. ARM Cortex-M4).
 // - Linux does not have a concept of a critical section, but this can be simulated easily with 
-//   a shared mutex.
+//   a lock. The default constructor locks a global LockDomain. Pass a different domain to give
+//   a subsystem its own lock, so that it doesn't serialise with unrelated code. Domains are 
+//   recursive, so nested critical sections in the same thread are fine. See LockDomain.h.
+//
+// The LockDomain constructor is accepted on every platform so that portable code can name its 
+// domain. On bare metal and FreeRTOS it is the same as the default constructor.
 
 
 #if defined(OTWAY_TARGET_PLATFORM_LINUX)
@@ -45,17 +48,21 @@ class CriticalSection : private NonCopyable
 {
     public:
         CriticalSection()
+        : CriticalSection{LockDomain::global()}
+        {
+        }
+        explicit CriticalSection(LockDomain& domain)
+        : m_domain{domain}
         {
-            m_mutex.lock();
+            m_domain.lock();
         }
         ~CriticalSection()
         {
-            m_mutex.unlock();
+            m_domain.unlock();
         }       
 
     private:
-        // Or maybe recursive_mutex;
-        inline static std::mutex m_mutex{};
+        LockDomain& m_domain;
 };
 
 
@@ -71,6 +78,10 @@ class CriticalSection : private NonCopyable
             platform_enter_critical();
             ++m_nested;
         }
+        explicit CriticalSection([[maybe_unused]] LockDomain& domain)
+        : CriticalSection{}
+        {
+        }
         ~CriticalSection()
         {
             --m_nested;
@@ -96,6 +107,10 @@ class CriticalSection : private NonCopyable
 	public:
 		CriticalSection();
 		CriticalSection(uint8_t new_ipl);
+		explicit CriticalSection([[maybe_unused]] LockDomain& domain)
+		: CriticalSection{}
+		{
+		}
 		~CriticalSection()
 		{
 			platform_restore_interrupt_priority_level(m_previous_level);
@@ -0,0 +1,147 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "LockDomain.h"
+#include <chrono>
+#include <mutex>
+
+
+namespace eg {
+
+
+namespace {
+
+// Spin this many times before sleeping in an Adaptive domain. Roughly a microsecond, which 
+// is longer than most of the sections protected by Otway.
+constexpr uint32_t kAdaptiveSpins = 100;
+
+void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+#if defined(OTWAY_LOCK_PROFILING)
+// Guards the list of domains. Only used when domains are created or destroyed, and while 
+// visiting them.
+std::mutex  g_registry_mutex;
+LockDomain* g_registry_head{};
+#endif
+
+} // namespace {
+
+
+LockDomain::LockDomain(const char* name, Kind kind)
+: m_name{name}
+, m_kind{kind}
+{
+#if defined(OTWAY_LOCK_PROFILING)
+    m_stats.name = name;
+    std::lock_guard lock{g_registry_mutex};
+    m_next = g_registry_head;
+    if (m_next) m_next->m_prev = this;
+    g_registry_head = this;
+#endif
+}
+
+
+LockDomain::~LockDomain()
+{
+#if defined(OTWAY_LOCK_PROFILING)
+    std::lock_guard lock{g_registry_mutex};
+    if (m_prev) m_prev->m_next = m_next;
+    else        g_registry_head = m_next;
+    if (m_next) m_next->m_prev = m_prev;
+#endif
+}
+
+
+LockDomain& LockDomain::global()
+{
+    // Function local so that it is usable during static initialisation.
+    static LockDomain domain{"global"};
+    return domain;
+}
+
+
+void LockDomain::lock_contended()
+{
+#if defined(OTWAY_LOCK_PROFILING)
+    const auto start = std::chrono::steady_clock::now();
+#endif
+
+    uint32_t spins = 0;
+    bool expected = false;
+    while (!m_locked.compare_exchange_weak(expected, true, std::memory_order_acquire, std::memory_order_relaxed))
+    {
+        expected = false;
+        if ((m_kind == Kind::Adaptive) && (++spins > kAdaptiveSpins))
+        {
+            // Sleeps only if the domain is still held.
+            m_locked.wait(true, std::memory_order_relaxed);
+        }
+        else
+        {
+            cpu_relax();
+        }
+    }
+
+#if defined(OTWAY_LOCK_PROFILING)
+    const auto wait = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    ++m_stats.contended;
+    m_stats.total_wait_ns += wait;
+    if (wait > m_stats.max_wait_ns) m_stats.max_wait_ns = wait;
+#endif
+}
+
+
+#if defined(OTWAY_LOCK_PROFILING)
+LockStats LockDomain::get_stats()
+{
+    const bool nested = is_held_by_this_thread();
+    lock();
+    // Don't count our own acquisition.
+    if (!nested) --m_stats.acquisitions;
+    LockStats stats = m_stats;
+    unlock();
+    return stats;
+}
+
+
+void LockDomain::reset_stats()
+{
+    lock();
+    m_stats = LockStats{m_name};
+    unlock();
+}
+
+
+void LockDomain::registry_lock()
+{
+    g_registry_mutex.lock();
+}
+
+
+void LockDomain::registry_unlock()
+{
+    g_registry_mutex.unlock();
+}
+
+
+LockDomain* LockDomain::registry_head()
+{
+    return g_registry_head;
+}
+#endif
+
+
+} // namespace eg {
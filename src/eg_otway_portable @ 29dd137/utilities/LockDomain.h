@@ -0,0 +1,179 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "NonCopyable.h"
+#include <cstdint>
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+#include <atomic>
+#include <thread>
+#endif
+
+
+namespace eg { 
+
+
+// A lock domain is the thing a CriticalSection locks. On Linux, CriticalSection used to lock 
+// a single shared mutex, so that the logger, the signals and any driver code all serialised 
+// on each other, and nested use in the same thread deadlocked. Now each subsystem (or object) 
+// can have its own domain:
+//
+//     LockDomain g_uart_lock{"uart"};
+//     ...
+//     CriticalSection cs{g_uart_lock};
+//
+// Domains are recursive: a thread which holds a domain can enter it again. They never 
+// allocate. A Spin domain busy waits, and suits very short sections which are rarely 
+// contended. An Adaptive domain spins briefly and then sleeps on a futex (via 
+// std::atomic::wait()) until the holder leaves.
+//
+// Bare metal and FreeRTOS have only one critical section (interrupts are masked), so domains 
+// are accepted for source compatibility and all map onto it.
+//
+// Build with OTWAY_LOCK_PROFILING to record the acquisitions and the time spent waiting for 
+// each Linux domain. See LockStats.
+
+
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+
+
+struct LockStats
+{
+    const char* name{};
+    // Acquisitions which did not nest inside the same thread's hold of the domain.
+    uint32_t acquisitions{};
+    // Acquisitions which found the domain held by another thread.
+    uint32_t contended{};
+    uint64_t total_wait_ns{};
+    uint64_t max_wait_ns{};
+};
+
+
+class LockDomain : private NonCopyable
+{
+    public:
+        enum class Kind : uint8_t { Spin, Adaptive };
+
+        LockDomain(const char* name, Kind kind = Kind::Adaptive);
+        ~LockDomain();
+
+        const char* get_name() const { return m_name; }
+        Kind        get_kind() const { return m_kind; }
+
+        void lock()
+        {
+            const auto self = std::this_thread::get_id();
+            if (m_owner.load(std::memory_order_relaxed) == self)
+            {
+                ++m_depth;
+                return;
+            }
+
+            bool expected = false;
+            if (!m_locked.compare_exchange_strong(expected, true, std::memory_order_acquire, std::memory_order_relaxed))
+            {
+                lock_contended();
+            }
+            m_owner.store(self, std::memory_order_relaxed);
+            m_depth = 1;
+        #if defined(OTWAY_LOCK_PROFILING)
+            ++m_stats.acquisitions;
+        #endif
+        }
+
+        void unlock()
+        {
+            if (--m_depth > 0) return;
+
+            m_owner.store(std::thread::id{}, std::memory_order_relaxed);
+            m_locked.store(false, std::memory_order_release);
+            if (m_kind == Kind::Adaptive)
+            {
+                m_locked.notify_one();
+            }
+        }
+
+        bool is_held_by_this_thread() const 
+        { 
+            return m_owner.load(std::memory_order_relaxed) == std::this_thread::get_id(); 
+        }
+
+        // The domain used by the default CriticalSection constructor. 
+        static LockDomain& global();
+
+    #if defined(OTWAY_LOCK_PROFILING)
+        LockStats get_stats();
+        void      reset_stats();
+
+        // Visit every domain which currently exists, e.g. to log the most contended. 
+        template <typename Func>
+        static void for_each(Func func);
+    #endif
+
+    private:
+        void lock_contended();
+
+    private:
+        const char*                  m_name;
+        Kind                         m_kind;
+        std::atomic<bool>            m_locked{false};
+        std::atomic<std::thread::id> m_owner{};
+        // Only touched by the owning thread.
+        uint32_t                     m_depth{};
+
+    #if defined(OTWAY_LOCK_PROFILING)
+        // Updated while the domain is held, so no further synchronisation is needed.
+        LockStats   m_stats{};
+        // Intrusive list of all domains, so that registration never allocates.
+        LockDomain* m_next{};
+        LockDomain* m_prev{};
+        static void        registry_lock();
+        static void        registry_unlock();
+        static LockDomain* registry_head();
+    #endif
+};
+
+
+#if defined(OTWAY_LOCK_PROFILING)
+template <typename Func>
+void LockDomain::for_each(Func func)
+{
+    registry_lock();
+    for (LockDomain* domain = registry_head(); domain != nullptr; domain = domain->m_next)
+    {
+        func(*domain);
+    }
+    registry_unlock();
+}
+#endif
+
+
+#else
+
+
+class LockDomain : private NonCopyable
+{
+    public:
+        enum class Kind : uint8_t { Spin, Adaptive };
+
+        constexpr LockDomain(const char* name, [[maybe_unused]] Kind kind = Kind::Adaptive)
+        : m_name{name}
+        {
+        }
+
+        const char* get_name() const { return m_name; }
+
+    private:
+        const char* m_name;
+};
+
+
+#endif
+
+
+} // namespace eg { 
@@ -0,0 +1,182 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+
+namespace eg { 
+
+
+// A MemoryPool which is safe to use concurrently from several threads, or from interrupts and
+// application code, without a CriticalSection. The free list is a Treiber stack: a lock-free 
+// singly linked list which is pushed and popped with compare-and-swap on the head. 
+//
+// Items are linked by index rather than by pointer, so the head is a 16-bit index and a 16-bit 
+// tag packed into one 32-bit word. The tag is incremented by every pop, which defeats the ABA 
+// problem: a thread which read the head, and then slept while the same item was popped, 
+// pushed and popped again, will find that the tag has changed and retry. A 32-bit word has 
+// native compare-and-swap on Cortex-M3 and above, as well as on Linux hosts. Cortex-M0 has 
+// no such instruction and should use MemoryPool with a CriticalSection.
+//
+// free() rejects pointers which are outside the pool or misaligned, and items which are not
+// currently allocated (double frees), using an atomic bitmap. Define OTWAY_MEMORY_POOL_POISON 
+// to fill items with kFreePoison when freed, and with kAllocPoison when allocated, to make 
+// use-after-free and uninitialised reads easier to spot in a debugger.
+template <typename T, uint16_t SIZE>
+class LockFreeMemoryPool
+{
+    static_assert(SIZE > 0U && SIZE < 0xFFFFU, "Pool size must be in 1..65534");
+
+public:
+    static constexpr uint8_t kFreePoison  = 0xDD;
+    static constexpr uint8_t kAllocPoison = 0xCD;
+
+    LockFreeMemoryPool()
+    {
+        for (uint16_t i = 0U; i < SIZE; ++i)
+        {
+            m_next[i].store(static_cast<uint16_t>(i + 1U), std::memory_order_relaxed);
+        #if defined(OTWAY_MEMORY_POOL_POISON)
+            std::memset(&m_pool[i], kFreePoison, sizeof(PoolItem));
+        #endif
+        }
+        m_next[SIZE - 1U].store(kNull, std::memory_order_relaxed);
+        m_head.store(make_head(0U, 0U), std::memory_order_release);
+    }
+
+    T* alloc()
+    {
+        uint32_t head = m_head.load(std::memory_order_acquire);
+        uint16_t index;
+        do
+        {
+            index = index_of(head);
+            if (index == kNull)
+            {
+                return nullptr;
+            }
+            // If another thread pops this item first, the value read here may be stale, but 
+            // then the tag will have changed and the exchange will fail.
+            const uint16_t next = m_next[index].load(std::memory_order_relaxed);
+            if (m_head.compare_exchange_weak(head, make_head(next, static_cast<uint16_t>(tag_of(head) + 1U)),
+                std::memory_order_acquire, std::memory_order_acquire))
+            {
+                break;
+            }
+        } 
+        while (true);
+
+        m_allocated[index / 32U].fetch_or(uint32_t{1} << (index % 32U), std::memory_order_relaxed);
+        update_low_water_mark(static_cast<uint16_t>(m_free.fetch_sub(1U, std::memory_order_relaxed) - 1U));
+
+    #if defined(OTWAY_MEMORY_POOL_POISON)
+        std::memset(&m_pool[index], kAllocPoison, sizeof(PoolItem));
+    #endif
+        return reinterpret_cast<T*>(&m_pool[index]);
+    }
+
+    bool free(T* ptr)
+    {
+        if (!ptr)
+            return false;
+
+        // Does this memory belong to this pool, and is it the start of an item?
+        const auto address = reinterpret_cast<uintptr_t>(ptr);
+        const auto base    = reinterpret_cast<uintptr_t>(&m_pool[0]);
+        if ((address < base) || (address >= reinterpret_cast<uintptr_t>(&m_pool[SIZE])))
+            return false;
+        if (((address - base) % sizeof(PoolItem)) != 0U)
+            return false;
+
+        // Clearing the bit is the point at which the item is freed, so only one of several 
+        // concurrent frees of the same item can succeed.
+        const auto index = static_cast<uint16_t>((address - base) / sizeof(PoolItem));
+        const uint32_t bit = uint32_t{1} << (index % 32U);
+        if ((m_allocated[index / 32U].fetch_and(~bit, std::memory_order_relaxed) & bit) == 0U)
+        {
+            m_double_frees.fetch_add(1U, std::memory_order_relaxed);
+            return false;
+        }
+
+    #if defined(OTWAY_MEMORY_POOL_POISON)
+        std::memset(&m_pool[index], kFreePoison, sizeof(PoolItem));
+    #endif
+
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        do
+        {
+            m_next[index].store(index_of(head), std::memory_order_relaxed);
+        }
+        while (!m_head.compare_exchange_weak(head, make_head(index, tag_of(head)), 
+            std::memory_order_release, std::memory_order_relaxed));
+
+        m_free.fetch_add(1U, std::memory_order_relaxed);
+        return true;
+    }
+
+    uint16_t available() const
+    {
+        return m_free.load(std::memory_order_relaxed);
+    }
+
+    uint16_t low_water_mark() const
+    {
+        return m_lowest.load(std::memory_order_relaxed);
+    }
+
+    // Is the pointer within this pool's storage? Used to find the owner of an allocation.
+    bool owns(const void* ptr) const
+    {
+        const auto address = reinterpret_cast<uintptr_t>(ptr);
+        return (address >= reinterpret_cast<uintptr_t>(&m_pool[0])) && (address < reinterpret_cast<uintptr_t>(&m_pool[SIZE]));
+    }
+
+    static constexpr uint16_t capacity() { return SIZE; }
+
+    // The number of frees rejected because the item was not allocated.
+    uint32_t double_frees() const
+    {
+        return m_double_frees.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint16_t kNull = 0xFFFFU;
+
+    // This union is to ensure that each item is correctly aligned for T.
+    union PoolItem
+    {
+        alignas(T) uint8_t data[sizeof(T)];
+    };
+
+    static constexpr uint32_t make_head(uint16_t index, uint16_t tag) { return (uint32_t{tag} << 16U) | index; }
+    static constexpr uint16_t index_of(uint32_t head) { return static_cast<uint16_t>(head & 0xFFFFU); }
+    static constexpr uint16_t tag_of(uint32_t head)   { return static_cast<uint16_t>(head >> 16U); }
+
+    void update_low_water_mark(uint16_t free)
+    {
+        uint16_t lowest = m_lowest.load(std::memory_order_relaxed);
+        while ((free < lowest) && !m_lowest.compare_exchange_weak(lowest, free, std::memory_order_relaxed)) {}
+    }
+
+private:
+    std::atomic<uint32_t> m_head{make_head(kNull, 0U)};
+    std::atomic<uint16_t> m_free{SIZE};
+    std::atomic<uint16_t> m_lowest{SIZE};
+    std::atomic<uint32_t> m_double_frees{};
+    // Links are held apart from the items so that the free list survives poisoning, and so 
+    // that a stale read of a link by a losing thread is not a data race.
+    std::atomic<uint16_t> m_next[SIZE];
+    std::atomic<uint32_t> m_allocated[(SIZE + 31U) / 32U]{};
+    PoolItem              m_pool[SIZE];
+};
+
+
+} // namespace eg {
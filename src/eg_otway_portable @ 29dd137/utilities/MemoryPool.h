@@ -14,7 +14,7 @@ namespace eg {
 
 
 // Note that this class is not thread/interrupt safe. External serialisation must 
-// provided where necessary.
+// provided where necessary. See LockFreeMemoryPool for a variant which doesn't need it.
 template <typename T, uint16_t SIZE>
 class MemoryPool
 {
@@ -31,8 +31,10 @@ public:
     {
         for (uint16_t i = 0U; i < SIZE; ++i)
         {
-            free(reinterpret_cast<T*>(&(m_pool[i])));
+            m_pool[i].next = m_free_list;
+            m_free_list    = &m_pool[i];
         }
+        m_free = SIZE;
     }
     
     T* alloc()
@@ -42,6 +44,7 @@ public:
 
         PoolItem* item = m_free_list;
         m_free_list    = item->next;
+        set_allocated(index_of(item), true);
 
         --m_free;
         if (m_free < m_lowest)
@@ -61,14 +64,16 @@ public:
             // Does this memory belong to this pool?
             if ((item >= &m_pool[0]) && (item < &m_pool[SIZE]))
             {
-                // The pointer must have a value matching allocations from this pool.
-
-                // Bonus, walk the free list to check for double deletions.
-                //PoolItem* free = m_free_list;
-                //while (free)
-                //{
-                //    free = free->next;
-                //}
+                // The pointer must have a value matching allocations from this pool, and 
+                // must not already have been freed. Pushing a misaligned or free item
+                // would corrupt the free list.
+                const uintptr_t offset = reinterpret_cast<uintptr_t>(item) - reinterpret_cast<uintptr_t>(&m_pool[0]);
+                if ((offset % sizeof(PoolItem)) != 0U)
+                    return false;
+                const uint16_t index = index_of(item);
+                if (!is_allocated(index))
+                    return false;
+                set_allocated(index, false);
 
                 item->next  = m_free_list;
                 m_free_list = item;
@@ -90,11 +95,41 @@ public:
         return m_lowest;
     }
 
+    // Is the pointer within this pool's storage? Used to find the owner of an allocation.
+    bool owns(const void* ptr) const
+    {
+        const auto address = reinterpret_cast<uintptr_t>(ptr);
+        return (address >= reinterpret_cast<uintptr_t>(&m_pool[0])) && (address < reinterpret_cast<uintptr_t>(&m_pool[SIZE]));
+    }
+
+    static constexpr uint16_t capacity() { return SIZE; }
+
+private:
+    uint16_t index_of(const PoolItem* item) const
+    {
+        return static_cast<uint16_t>(item - &m_pool[0]);
+    }
+
+    bool is_allocated(uint16_t index) const
+    {
+        return (m_allocated[index / 32U] & (uint32_t{1} << (index % 32U))) != 0U;
+    }
+
+    void set_allocated(uint16_t index, bool allocated)
+    {
+        if (allocated)
+            m_allocated[index / 32U] |= (uint32_t{1} << (index % 32U));
+        else
+            m_allocated[index / 32U] &= ~(uint32_t{1} << (index % 32U));
+    }
+
 private:
     uint16_t  m_free      = 0;
     uint16_t  m_lowest    = SIZE;
     PoolItem* m_free_list = nullptr;
     PoolItem  m_pool[SIZE];
+    // One bit per item, set while it is allocated. Used to reject double frees.
+    uint32_t  m_allocated[(SIZE + 31U) / 32U]{};
 };
 
 
@@ -0,0 +1,29 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <cstdint>
+
+// The default clock for EventLoopMonitor on microcontrollers. 
+
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+#error MicrosecondClock.h should not be used in Linux projects.
+#elif defined(OTWAY_TARGET_PLATFORM_FREERTOS) || defined(OTWAY_TARGET_PLATFORM_BAREMETAL)
+
+namespace eg {
+
+// This is declared in the portable library but must be implemented by the
+// application or platform-specific library.
+
+// A free running microsecond counter, which wraps at 2^32. It must be safe to call from 
+// interrupt handlers, and with interrupts disabled.
+uint32_t platform_get_microseconds();
+
+} // namespace eg {
+
+#endif
@@ -0,0 +1,98 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "utilities/LockFreeMemoryPool.h"
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+
+namespace eg { 
+
+
+// A pool of SIZE objects of type T which constructs and destroys them, unlike MemoryPool which 
+// deals in raw memory. make() returns a Handle, a std::unique_ptr whose deleter returns the 
+// object to the pool, so ownership is as clear as it is for heap objects: 
+//
+//     ObjectPool<Message, 16> g_messages;
+//     ...
+//     auto message = g_messages.make(id, payload);
+//     if (!message) { /* The pool is exhausted */ }
+//
+// The pool must outlive its handles. By default the storage is a LockFreeMemoryPool, so the
+// pool may be used from several threads or interrupts. Pass MemoryPool<T, SIZE> as the 
+// third argument where that isn't needed (or isn't possible, e.g. Cortex-M0).
+template <typename T, uint16_t SIZE, typename Storage = LockFreeMemoryPool<T, SIZE>>
+class ObjectPool
+{
+public:
+    class Deleter
+    {
+    public:
+        Deleter() = default;
+        explicit Deleter(ObjectPool* pool) : m_pool{pool} {}
+        void operator()(T* object) const { if (m_pool) m_pool->destroy(object); }
+    private:
+        ObjectPool* m_pool{};
+    };
+
+    using Handle = std::unique_ptr<T, Deleter>;
+
+public:
+    // Construct an object in place. The handle is empty if the pool is exhausted.
+    template <typename... Args>
+    Handle make(Args&&... args)
+    {
+        return Handle{create(std::forward<Args>(args)...), Deleter{this}};
+    }
+
+    // As make(), but the caller is responsible for passing the object to destroy().
+    template <typename... Args>
+    T* create(Args&&... args)
+    {
+        T* memory = m_storage.alloc();
+        if (!memory)
+            return nullptr;
+
+    #if defined(__cpp_exceptions)
+        try
+        {
+            return new (memory) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            m_storage.free(memory);
+            throw;
+        }
+    #else
+        return new (memory) T(std::forward<Args>(args)...);
+    #endif
+    }
+
+    // Returns false if the object does not belong to this pool. Destroying an object twice is 
+    // undefined, as it is for delete.
+    bool destroy(T* object)
+    {
+        if (!object || !m_storage.owns(object))
+            return false;
+        object->~T();
+        return m_storage.free(object);
+    }
+
+    uint16_t available() const      { return m_storage.available(); }
+    uint16_t low_water_mark() const { return m_storage.low_water_mark(); }
+    static constexpr uint16_t capacity() { return SIZE; }
+
+private:
+    Storage m_storage{};
+};
+
+
+} // namespace eg {
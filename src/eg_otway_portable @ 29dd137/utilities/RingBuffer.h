@@ -31,6 +31,20 @@ public:
         return m_buffer[m_get_pos];
     }
 
+    // Access the most recently added item, e.g. to amend it in place after put().
+    // This assumes that there is something in the buffer.
+    T& back()
+    {
+        return m_buffer[(m_put_pos + m_buflen - 1U) % m_buflen];
+    }
+
+    // Access an item in place, where index 0 is the oldest item. This assumes that index is 
+    // less than size().
+    T& at(uint16_t index)
+    {
+        return m_buffer[(m_get_pos + index) % m_buflen];
+    }
+
     // Remove the next item, if any, from the reing buffer with returning its value.
     bool pop()
     {
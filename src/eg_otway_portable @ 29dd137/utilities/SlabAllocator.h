@@ -0,0 +1,195 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include "utilities/LockFreeMemoryPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+#include <memory_resource>
+#include <new>
+#endif
+
+
+namespace eg { 
+
+
+// One size class of a SlabAllocator: COUNT blocks of BLOCK_SIZE bytes.
+template <uint16_t BLOCK_SIZE, uint16_t COUNT>
+struct SlabClass
+{
+    static constexpr uint16_t kBlockSize = BLOCK_SIZE;
+    static constexpr uint16_t kCount     = COUNT;
+
+    struct alignas(std::max_align_t) Block
+    {
+        uint8_t data[BLOCK_SIZE];
+    };
+    using Pool = LockFreeMemoryPool<Block, COUNT>;
+};
+
+
+// A general purpose allocator for variable sized requests, built from a LockFreeMemoryPool 
+// for each of several size classes, which must be listed in increasing order of size:
+//
+//     SlabAllocator<SlabClass<32, 64>, SlabClass<128, 16>, SlabClass<512, 4>> g_slab;
+//
+// A request is served by the smallest class which fits it, or by a larger class if that one is
+// exhausted. All the storage is inside the object, so declaring it static gives a fixed arena
+// which is sized at compile time and never touches the heap. Like its pools, the allocator is 
+// lock-free. Blocks are aligned for any fundamental type.
+//
+// On Linux, SlabResource adapts the allocator to std::pmr::memory_resource, so that standard
+// containers can use it.
+template <typename... Classes>
+class SlabAllocator
+{
+    static_assert(sizeof...(Classes) > 0, "SlabAllocator needs at least one size class");
+
+public:
+    static constexpr uint8_t  kNumClasses   = sizeof...(Classes);
+    static constexpr uint16_t kMaxBlockSize = std::max({Classes::kBlockSize...});
+
+    // Returns nullptr if no class is large enough or all the suitable classes are exhausted.
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+    {
+        void* result = nullptr;
+        if (alignment <= alignof(std::max_align_t))
+        {
+            for_each_class([&](auto& pool, uint16_t block_size)
+            {
+                if (!result && (size <= block_size))
+                {
+                    result = pool.alloc();
+                }
+            });
+        }
+        return result;
+    }
+
+    // Returns false if the memory was not allocated by this allocator.
+    bool deallocate(void* ptr)
+    {
+        bool result = false;
+        for_each_class([&](auto& pool, uint16_t)
+        {
+            if (!result && pool.owns(ptr))
+            {
+                using Block = std::remove_pointer_t<decltype(pool.alloc())>;
+                result = pool.free(static_cast<Block*>(ptr));
+            }
+        });
+        return result;
+    }
+
+    bool owns(const void* ptr) const
+    {
+        bool result = false;
+        visit(*this, [&](const auto& pool, uint16_t) { result = result || pool.owns(ptr); });
+        return result;
+    }
+
+    // Statistics for the size class with the given index (in the order declared).
+    uint16_t block_size(uint8_t index) const     { return get(index, [](const auto&, uint16_t size) { return size; }); }
+    uint16_t available(uint8_t index) const      { return get(index, [](const auto& pool, uint16_t) { return pool.available(); }); }
+    uint16_t low_water_mark(uint8_t index) const { return get(index, [](const auto& pool, uint16_t) { return pool.low_water_mark(); }); }
+
+private:
+    // Call func(pool, block_size) for each size class in turn.
+    template <typename Self, typename Func>
+    static void visit(Self& self, Func func)
+    {
+        visit(self, func, std::make_index_sequence<kNumClasses>{});
+    }
+
+    template <typename Self, typename Func, size_t... I>
+    static void visit(Self& self, Func func, std::index_sequence<I...>)
+    {
+        (func(std::get<I>(self.m_pools), std::tuple_element_t<I, std::tuple<Classes...>>::kBlockSize), ...);
+    }
+
+    template <typename Func>
+    void for_each_class(Func func) { visit(*this, func); }
+
+    template <typename Func>
+    uint16_t get(uint8_t index, Func func) const
+    {
+        uint16_t result = 0;
+        uint8_t  i      = 0;
+        visit(*this, [&](const auto& pool, uint16_t block_size)
+        {
+            if (i++ == index) result = func(pool, block_size);
+        });
+        return result;
+    }
+
+private:
+    std::tuple<typename Classes::Pool...> m_pools{};
+};
+
+
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+
+
+// Use a SlabAllocator as a polymorphic memory resource, e.g. for a std::pmr::vector. Requests
+// which the slab can't serve are passed upstream. The default upstream throws std::bad_alloc,
+// so nothing reaches the heap unless asked to. Only memory outside the slab is freed upstream. 
+// A free of slab memory which the slab rejects (a double free, or not the start of a block) is 
+// counted, as the pools count double frees, and otherwise ignored.
+template <typename Slab>
+class SlabResource : public std::pmr::memory_resource
+{
+public:
+    explicit SlabResource(Slab& slab, std::pmr::memory_resource* upstream = std::pmr::null_memory_resource())
+    : m_slab{slab}
+    , m_upstream{upstream}
+    {
+    }
+
+    // The number of frees of slab memory which the slab rejected.
+    uint32_t rejected_frees() const { return m_rejected_frees; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        void* result = m_slab.allocate(bytes, alignment);
+        return result ? result : m_upstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+    {
+        if (!m_slab.owns(ptr))
+        {
+            m_upstream->deallocate(ptr, bytes, alignment);
+        }
+        else if (!m_slab.deallocate(ptr))
+        {
+            ++m_rejected_frees;
+        }
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    Slab&                      m_slab;
+    std::pmr::memory_resource* m_upstream;
+    std::atomic<uint32_t>      m_rejected_frees{};
+};
+
+
+#endif
+
+
+} // namespace eg {
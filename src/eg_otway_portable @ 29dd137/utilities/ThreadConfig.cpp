@@ -0,0 +1,109 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include "ThreadConfig.h"
+#include "logging/Logger.h"
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+
+namespace eg {
+
+
+namespace {
+
+bool apply_affinity(uint64_t affinity)
+{
+    if (affinity == 0) return true;
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (uint8_t cpu = 0; cpu < 64; ++cpu)
+    {
+        if (affinity & (uint64_t{1} << cpu))
+        {
+            CPU_SET(cpu, &cpus);
+        }
+    }
+
+    const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (error != 0)
+    {
+        EG_LOG_WARN("Failed to set thread affinity: %s", std::strerror(error));
+        return false;
+    }
+    return true;
+}
+
+
+bool apply_policy(ThreadConfig::Policy policy, uint8_t priority)
+{
+    // Default is applied too, as a thread inherits the policy of the thread which created it.
+    sched_param param{};
+    int native = SCHED_OTHER;
+    switch (policy)
+    {
+        case ThreadConfig::Policy::Fifo:       native = SCHED_FIFO; param.sched_priority = priority; break;
+        case ThreadConfig::Policy::RoundRobin: native = SCHED_RR;   param.sched_priority = priority; break;
+        default: break;
+    }
+
+    const int error = pthread_setschedparam(pthread_self(), native, &param);
+    if (error != 0)
+    {
+        EG_LOG_WARN("Failed to set thread scheduling policy: %s", std::strerror(error));
+        return false;
+    }
+    return true;
+}
+
+
+bool apply_lock_memory(bool lock_memory)
+{
+    if (!lock_memory) return true;
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        EG_LOG_WARN("Failed to lock memory: %s", std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+
+// Not inlined so that the array really is placed on the stack of the calling thread.
+__attribute__((noinline)) void prefault_stack(uint32_t size)
+{
+    if (size == 0) return;
+
+    // Writing through a volatile pointer stops the compiler from removing the loop.
+    auto* stack = static_cast<volatile uint8_t*>(__builtin_alloca(size));
+    for (uint32_t offset = 0; offset < size; offset += 4096)
+    {
+        stack[offset] = 0;
+    }
+}
+
+} // namespace {
+
+
+bool apply_thread_config(const ThreadConfig& config)
+{
+    bool result = true;
+    result &= apply_affinity(config.affinity);
+    result &= apply_policy(config.policy, config.priority);
+    result &= apply_lock_memory(config.lock_memory);
+    prefault_stack(config.prefault_stack);
+    return result;
+}
+
+
+} // namespace eg {
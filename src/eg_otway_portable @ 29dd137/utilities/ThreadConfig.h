@@ -0,0 +1,51 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+#include <cstdint>
+
+
+#if !defined(OTWAY_TARGET_PLATFORM_LINUX)
+#error This file is requires OTWAY_TARGET_PLATFORM_LINUX to be defined.
+#endif
+
+
+namespace eg {
+
+
+// Real-time configuration for the threads created by Otway on Linux (ThreadEventLoop and the 
+// Timer thread). The default runs the thread with the normal time-sharing policy (SCHED_OTHER),
+// even if it was created by a real-time thread, and otherwise leaves everything as the OS set
+// it. A typical control loop is pinned to an isolated core (e.g. booted with isolcpus=3), runs
+// SCHED_FIFO above everything else in the application, and has its memory locked so that it 
+// never takes a page fault.
+struct ThreadConfig
+{
+    enum class Policy : uint8_t { Default, Fifo, RoundRobin };
+
+    // Bit N set allows the thread to run on CPU N. Zero leaves the affinity unchanged.
+    uint64_t affinity{};
+    // Priority is 1 (lowest) to 99 (highest) for Fifo and RoundRobin, and ignored for Default.
+    Policy   policy{Policy::Default};
+    uint8_t  priority{};
+    // Lock all current and future pages of the process into RAM (mlockall()).
+    bool     lock_memory{};
+    // Touch this many bytes of the thread's stack so those pages are resident before the 
+    // first event is dispatched. Must be comfortably less than the stack size (8MB default).
+    uint32_t prefault_stack{};
+};
+
+
+// Apply the configuration to the calling thread. Each setting is attempted independently. 
+// Failures are logged as warnings (typically EPERM when running without CAP_SYS_NICE or 
+// CAP_IPC_LOCK, or the RLIMIT_RTPRIO/RLIMIT_MEMLOCK limits are too low), and false is 
+// returned, but the thread carries on with whatever was applied.
+bool apply_thread_config(const ThreadConfig& config);
+
+
+} // namespace eg {
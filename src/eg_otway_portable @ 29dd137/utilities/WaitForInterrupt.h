@@ -0,0 +1,35 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code 
+// is confidential information and must not be disclosed to third parties or used without 
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// Low power waits for an idle event loop. These are typically called with all interrupts 
+// disabled (see DisableInterrupts), after checking that there is nothing to do. A pending 
+// interrupt still wakes the core, and the handler runs when interrupts are re-enabled. This 
+// avoids the race in which an interrupt posts an event between the check and the sleep.
+
+#if defined(OTWAY_TARGET_PLATFORM_LINUX)
+#error WaitForInterrupt.h should not be used in Linux projects.
+#elif defined(OTWAY_TARGET_PLATFORM_FREERTOS) || defined(OTWAY_TARGET_PLATFORM_BAREMETAL)
+
+namespace eg {
+
+// These are declared in the portable library but must be implemented by the
+// application or platform-specific library.
+
+// Sleep until an interrupt is pending (WFI on Cortex-M).
+void platform_wait_for_interrupt();
+// Sleep until an event is signalled (WFE on Cortex-M). This must also wake for an interrupt 
+// which becomes pending while interrupts are disabled, as WFI does. On Cortex-M that needs
+// SCB->SCR SEVONPEND, which the implementation is responsible for setting. It may return 
+// early, but must not sleep through an interrupt which is already pending.
+void platform_wait_for_event();
+
+} // namespace eg {
+
+#endif
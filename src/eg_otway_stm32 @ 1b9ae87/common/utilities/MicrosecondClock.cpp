@@ -0,0 +1,77 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code
+// is confidential information and must not be disclosed to third parties or used without
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include OTWAY_STM32_DEVICE_HEADER
+#include "utilities/MicrosecondClock.h"
+#include "timers/Timer.h"
+#include <cstdint>
+
+
+// This function is declared in eg_otway_portable but left to be implemented along with the 
+// platform-specific drivers. It is shared by all the Cortex-M families, each of which defines
+// OTWAY_STM32_DEVICE_HEADER as its CMSIS device header.
+namespace eg {
+
+namespace {
+
+uint32_t g_last_cycles;
+uint32_t g_last_ticks;
+uint64_t g_cycles;      // Not yet converted to microseconds
+uint32_t g_microseconds;
+bool     g_started;
+
+} // namespace {
+
+
+uint32_t platform_get_microseconds()
+{
+    // This is called from interrupt handlers as well as the event loop.
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (!g_started)
+    {
+        // Unlock access to the cycle counter register, as in CycleCounter.
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if defined(CORE_CM7)
+        DWT->LAR = 0xC5ACCE55;
+#endif
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+        g_last_cycles = DWT->CYCCNT;
+        g_last_ticks  = Timer::get_tick_count();
+        g_started     = true;
+    }
+
+    const uint32_t cycles         = DWT->CYCCNT;
+    const uint32_t ticks          = Timer::get_tick_count();
+    const uint32_t cycles_per_us  = SystemCoreClock / 1'000'000U;
+    // The cycle counter wraps every few seconds at full speed. If the loop slept for longer 
+    // than half of that, fall back to the millisecond tick.
+    const uint32_t wrap_ticks     = (0xFFFF'FFFFU / SystemCoreClock) * 1000U / 2U;
+    const uint32_t elapsed_ticks  = ticks - g_last_ticks;
+    if (elapsed_ticks < wrap_ticks)
+    {
+        g_cycles       += cycles - g_last_cycles;
+        g_microseconds += static_cast<uint32_t>(g_cycles / cycles_per_us);
+        g_cycles       %= cycles_per_us;
+    }
+    else
+    {
+        g_microseconds += elapsed_ticks * 1000U;
+        g_cycles        = 0;
+    }
+    g_last_cycles = cycles;
+    g_last_ticks  = ticks;
+    const uint32_t result = g_microseconds;
+
+    __set_PRIMASK(primask);
+    return result;
+}
+
+
+} // namespace eg {
@@ -0,0 +1,50 @@
+/////////////////////////////////////////////////////////////////////////////////////////////
+// (c) eg technology ltd, 2025.  All rights reserved.
+//
+// This software is the property of eg technology ltd. and may not be copied or reproduced
+// otherwise than on to a single hard disk for backup or archival purposes. The source code
+// is confidential information and must not be disclosed to third parties or used without
+// the express written permission of eg technology ltd.
+/////////////////////////////////////////////////////////////////////////////////////////////
+#include OTWAY_STM32_DEVICE_HEADER
+#include "utilities/WaitForInterrupt.h"
+
+
+// These functions are declared in eg_otway_portable but left to be implemented
+// along with the platform-specific drivers. They are shared by all the Cortex-M families.
+namespace eg {
+
+void platform_wait_for_interrupt()
+{
+    // Data synchronisation barrier - required to ensure all writes to memory are
+    // complete before the core sleeps.
+    __DSB();
+    // Sleep until an interrupt is pending. This wakes even when PRIMASK is set, in 
+    // which case the handler runs once interrupts are enabled again.
+    __WFI();
+    __ISB();
+}
+
+
+void platform_wait_for_event()
+{
+    // With interrupts disabled, a pending interrupt only wakes WFE if SEVONPEND is set: 
+    // an interrupt becoming pending then sets the event register. One which became pending
+    // before it was set has not, so return without sleeping the first time. The caller
+    // re-enables interrupts and checks again, as it would after any wake up.
+    if ((SCB->SCR & SCB_SCR_SEVONPEND_Msk) == 0U)
+    {
+        SCB->SCR |= SCB_SCR_SEVONPEND_Msk;
+        __DSB();
+        return;
+    }
+
+    __DSB();
+    // Sleep until the event register is set. Returns immediately if it is already set,
+    // so a SEV or an interrupt which arrived before this call is not lost.
+    __WFE();
+    __ISB();
+}
+
+
+} // namespace eg {
@@ -7,9 +7,7 @@
 namespace eg
 {
 	FlashInternal::FlashInternal(uint8_t *bank1StartAddress, uint8_t *bank2StartAddress, unsigned int numPages)
-        // TODO_AC Why has this changed?
-        //: FlashStorageBase(kWriteSize), mSectorSize(8192u), mBank1StartAddress(bank1StartAddress), mBank2StartAddress(bank2StartAddress)
-        : FlashStorageBase(), mSectorSize(8192u), mBank1StartAddress(bank1StartAddress), mBank2StartAddress(bank2StartAddress)
+        : FlashStorageBase(kWriteSize), mSectorSize(8192u), mBank1StartAddress(bank1StartAddress), mBank2StartAddress(bank2StartAddress)
     {
         mNumSectors = numPages * 2;
 
@@ -144,7 +142,11 @@ namespace eg
 
         mLastOperationStatus = result == HAL_OK ? FlashOperationStatus::Success : FlashOperationStatus::Failed;
 
-        mOnFlashWriteComplete.emit(mLastOperationStatus);
+        // A failure is returned rather than signalled. See FlashStorageBase.
+        if (mLastOperationStatus == FlashOperationStatus::Success)
+        {
+            mOnFlashWriteComplete.emit(mLastOperationStatus);
+        }
 
         return mLastOperationStatus;
     }
@@ -181,7 +183,11 @@ namespace eg
 
         mLastOperationStatus = HAL_OK == result ? FlashOperationStatus::Success : FlashOperationStatus::Failed;
 
-        mOnFlashEraseComplete.emit(mLastOperationStatus);
+        // A failure is returned rather than signalled. See FlashStorageBase.
+        if (mLastOperationStatus == FlashOperationStatus::Success)
+        {
+            mOnFlashEraseComplete.emit(mLastOperationStatus);
+        }
 
         return mLastOperationStatus;
     }